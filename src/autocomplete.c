@@ -8,44 +8,51 @@
 
 #include "autocomplete.h"
 
-#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
-#ifdef __APPLE__
-#include <sys/types.h>
-#include <sys/dir.h>
-#else
-#include <dirent.h>
-#endif /* __APPLE__ */
-
 #include "configdir.h"
+#include "dir_cache.h"
 #include "execute.h"
 #include "line_info.h"
 #include "misc_tools.h"
 #include "toxic.h"
 #include "windows.h"
 
-static void print_ac_matches(ToxWindow *self, Toxic *toxic, char **list, size_t n_matches, bool have_matches)
+/* The maximum number of matches printed when there's more than one */
+#define MAX_PRINTED_MATCHES 75
+
+/* Prints the first MAX_PRINTED_MATCHES of the `n_matches` strings in `list`, and how many weren't printed. */
+static void print_ac_matches(ToxWindow *self, Toxic *toxic, const char *const *list, size_t n_matches,
+                             bool have_matches)
 {
     if (have_matches) {
         execute(self->chatwin->history, self, toxic, "/clear", GLOBAL_COMMAND_MODE);
     }
 
-    for (size_t i = 0; i < n_matches; ++i) {
+    const size_t n_printed = MIN(n_matches, MAX_PRINTED_MATCHES);
+
+    for (size_t i = 0; i < n_printed; ++i) {
         line_info_add(self, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0, "%s", list[i]);
     }
 
+    if (n_matches > n_printed) {
+        line_info_add(self, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0, "... and %zu more",
+                      n_matches - n_printed);
+    }
+
     line_info_add(self, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0, " ");
 }
 
 /* puts match in match buffer. if more than one match, add first n chars that are identical.
  * e.g. if matches contains: [foo, foobar, foe] we put fo in match.
  *
+ * If `sorted` is true the matches are in byte order, so only the first and last need to be compared.
+ *
  * Returns the length of the match.
  */
 static size_t get_str_match(ToxWindow *self, char *match, size_t match_sz, const char *const *matches, size_t n_items,
-                            size_t max_size)
+                            size_t max_size, bool sorted)
 {
     UNUSED_VAR(self);
 
@@ -56,7 +63,7 @@ static size_t get_str_match(ToxWindow *self, char *match, size_t match_sz, const
     for (size_t i = 0; i < max_size; ++i) {
         char ch1 = matches[0][i];
 
-        for (size_t j = 0; j < n_items; ++j) {
+        for (size_t j = sorted ? n_items - 1 : 0; j < n_items; ++j) {
             char ch2 = matches[j][i];
 
             if (ch1 != ch2 || !ch1) {
@@ -76,6 +83,7 @@ static size_t get_str_match(ToxWindow *self, char *match, size_t match_sz, const
  * with "Hello john". If multiple matches, prints out all the matches and semi-completes line.
  *
  * `list` is a pointer to `n_items` strings. Each string in the list must be <= MAX_STR_SIZE.
+ * If `index` is non-null it's searched instead of `list`.
  *
  * dir_search should be true if the line being completed is a file path.
  *
@@ -88,7 +96,7 @@ static size_t get_str_match(ToxWindow *self, char *match, size_t match_sz, const
  * Note: This function should not be called directly. Use complete_line() and complete_path() instead.
  */
 static int complete_line_helper(ToxWindow *self, Toxic *toxic, const char *const *list, const size_t n_items,
-                                bool dir_search, char *out)
+                                const Name_Index *index, bool dir_search, char *out)
 {
     ChatContext *ctx = self->chatwin;
 
@@ -147,32 +155,46 @@ static int complete_line_helper(ToxWindow *self, Toxic *toxic, const char *const
         }
     }
 
-    if (!sub[0] && !(dir_search && n_items == 1)) {
-        free(sub);
-        return 0;
-    }
-
     const int s_len = strlen(sub);
     size_t n_matches = 0;
+    const char **found = NULL;
+    const char *const *matches;
+
+    if (index != NULL) {
+        /* the matches are already next to each other in the index */
+        uint32_t first;
+        n_matches = name_index_find_prefix(index, sub, s_len, &first);
+        matches = (const char *const *) &index->names[first];
+    } else {
+        found = malloc(MAX(n_items, 1) * sizeof(const char *));
+
+        if (found == NULL) {
+            free(sub);
+            return -1;
+        }
 
-    char **matches = (char **) malloc_ptr_array(n_items, MAX_STR_SIZE);
+        /* put all list matches in matches array */
+        for (size_t i = 0; i < n_items; ++i) {
+            if (strncmp(list[i], sub, s_len) == 0) {
+                found[n_matches++] = list[i];
+            }
+        }
 
-    if (matches == NULL) {
-        free(sub);
-        return -1;
+        matches = found;
     }
 
-    /* put all list matches in matches array */
-    for (size_t i = 0; i < n_items; ++i) {
-        if (strncmp(list[i], sub, s_len) == 0) {
-            snprintf(matches[n_matches++], MAX_STR_SIZE, "%s", list[i]);
-        }
-    }
+    const bool empty_sub = sub[0] == '\0';
 
     free(sub);
 
+    /* nothing was typed to complete, unless it's the only name in a directory */
+    if (empty_sub && !(dir_search && n_matches == 1)) {
+        free(found);
+        return 0;
+    }
+
     if (!n_matches) {
-        free_ptr_array((void **) matches);
+        free(found);
         return -1;
     }
 
@@ -181,10 +203,10 @@ static int complete_line_helper(ToxWindow *self, Toxic *toxic, const char *const
     }
 
     char match[MAX_STR_SIZE];
-    const size_t match_len = get_str_match(self, match, sizeof(match), (const char *const *) matches,
-                                           n_matches, MAX_STR_SIZE);
+    const size_t match_len = get_str_match(self, match, sizeof(match), matches, n_matches, MAX_STR_SIZE,
+                                           index != NULL);
 
-    free_ptr_array((void **) matches);
+    free(found);
 
     if (match_len == 0) {
         return 0;
@@ -298,15 +320,18 @@ static const char *const status_list[] = {
 static int complete_line_command_arg(ToxWindow *self, Toxic *toxic, const char *input)
 {
     if (strncmp(input, "/status", strlen("/status")) == 0) {
-        return complete_line_helper(self, toxic, status_list, sizeof(status_list) / sizeof(char *), false, NULL);
+        return complete_line_helper(self, toxic, status_list, sizeof(status_list) / sizeof(char *), NULL, false,
+                                    NULL);
     }
 
     if (strncmp(input, "/game", strlen("/game")) == 0) {
-        return complete_line_helper(self, toxic, game_list, sizeof(game_list) / sizeof(char *), false, NULL);
+        return complete_line_helper(self, toxic, game_list, sizeof(game_list) / sizeof(char *), NULL, false,
+                                    NULL);
     }
 
     if (strncmp(input, "/color", strlen("/color")) == 0) {
-        return complete_line_helper(self, toxic, color_list, sizeof(color_list) / sizeof(char *), false, NULL);
+        return complete_line_helper(self, toxic, color_list, sizeof(color_list) / sizeof(char *), NULL, false,
+                                    NULL);
     }
 
     return -1;
@@ -316,7 +341,7 @@ int complete_line(ToxWindow *self, Toxic *toxic, const char *const *list, size_t
 {
     char cmd[MAX_STR_SIZE] = {0};
 
-    const int ret = complete_line_helper(self, toxic, list, n_items, false, cmd);
+    const int ret = complete_line_helper(self, toxic, list, n_items, NULL, false, cmd);
 
     if (ret >= 0) {
         return ret;
@@ -325,9 +350,22 @@ int complete_line(ToxWindow *self, Toxic *toxic, const char *const *list, size_t
     return complete_line_command_arg(self, toxic, cmd);
 }
 
-static int complete_path(ToxWindow *self, Toxic *toxic, const char *const *list, const size_t n_items)
+int complete_line_index(ToxWindow *self, Toxic *toxic, const Name_Index *index)
 {
-    return complete_line_helper(self, toxic, list, n_items, true, NULL);
+    char cmd[MAX_STR_SIZE] = {0};
+
+    const int ret = complete_line_helper(self, toxic, NULL, 0, index, false, cmd);
+
+    if (ret >= 0) {
+        return ret;
+    }
+
+    return complete_line_command_arg(self, toxic, cmd);
+}
+
+static int complete_path(ToxWindow *self, Toxic *toxic, const Name_Index *names)
+{
+    return complete_line_helper(self, toxic, NULL, 0, names, true, NULL);
 }
 
 /* Transforms a tab complete starting with the shorthand "~" into the full home directory. */
@@ -360,25 +398,145 @@ static void complete_home_dir(ToxWindow *self, const Paths *paths, char *path, i
     ctx->len = ctx->pos;
 }
 
-/*
- * Return true if the first `p_len` chars in `s` are equal to `p` and `s` is a valid directory name.
+/* Replaces the file name being typed in the path argument that starts at `arg_start` in the input line
+ * with `name`, which is in the directory `dir`. A '/' is appended if it's a directory.
+ *
+ * Returns the diff between old len and new len of ctx->line on success.
+ * Returns -1 on failure.
  */
-static bool is_partial_match(const char *s, const char *p, size_t p_len)
+static int dir_match_replace(ToxWindow *self, const char *dir, const char *name, int arg_start)
 {
-    if (s == NULL || p == NULL) {
-        return false;
+    ChatContext *ctx = self->chatwin;
+
+    if (ctx->pos < arg_start || ctx->pos > ctx->len) {
+        return -1;
     }
 
-    return strncmp(s, p, p_len) == 0 && strcmp(".", s) != 0 && strcmp("..", s) != 0;
+    int start = ctx->pos;
+
+    while (start > arg_start && ctx->line[start - 1] != L'/') {
+        --start;
+    }
+
+    char path[TOXIC_MAX_PATH_LENGTH + 1];
+    const size_t dir_len = strlen(dir);
+    snprintf(path, sizeof(path), "%s%s%s", dir, dir_len > 0 && dir[dir_len - 1] == '/' ? "" : "/", name);
+
+    const bool is_dir = file_type(path) == FILE_TYPE_DIRECTORY;
+
+    wchar_t wname[MAX_STR_SIZE];
+
+    if (mbs_to_wcs_buf(wname, name, sizeof(wname) / sizeof(wchar_t)) == -1) {
+        return -1;
+    }
+
+    const int wname_len = wcslen(wname);
+    const int new_len = wname_len + (is_dir ? 1 : 0);
+    const int diff = new_len - (ctx->pos - start);
+
+    if (ctx->len + diff >= MAX_STR_SIZE) {
+        return -1;
+    }
+
+    /* move the rest of the line along with its null terminator */
+    wmemmove(&ctx->line[start + new_len], &ctx->line[ctx->pos], ctx->len - ctx->pos + 1);
+    wmemcpy(&ctx->line[start], wname, wname_len);
+
+    if (is_dir) {
+        ctx->line[start + wname_len] = L'/';
+    }
+
+    ctx->len += diff;
+    ctx->pos += diff;
+
+    return diff;
+}
+
+struct fuzzy_match {
+    const char *name;
+    int score;
+};
+
+/* Matches `b_name` against the names in the directory `b_path` when none of them start with it,
+ * allowing other characters between the ones that were typed. A single match replaces the typed name
+ * and several matches are printed, best first.
+ *
+ * Returns the diff between old len and new len of ctx->line on success.
+ * Returns -1 if there are no matches.
+ */
+static int dir_match_fuzzy(ToxWindow *self, Toxic *toxic, const Name_Index *names, const char *b_path,
+                           const char *b_name, int arg_start)
+{
+    if (b_name[0] == '\0') {
+        return -1;
+    }
+
+    struct fuzzy_match best[MAX_PRINTED_MATCHES];
+    size_t n_best = 0;
+    size_t n_matches = 0;
+
+    for (uint32_t i = 0; i < names->count; ++i) {
+        const int score = dir_cache_fuzzy_score(b_name, names->names[i]);
+
+        if (score < 0) {
+            continue;
+        }
+
+        ++n_matches;
+
+        /* names are visited in order, so matches with equal scores stay sorted by name */
+        size_t pos = n_best;
+
+        while (pos > 0 && best[pos - 1].score < score) {
+            --pos;
+        }
+
+        if (pos == MAX_PRINTED_MATCHES) {
+            continue;
+        }
+
+        if (n_best < MAX_PRINTED_MATCHES) {
+            ++n_best;
+        }
+
+        memmove(&best[pos + 1], &best[pos], (n_best - 1 - pos) * sizeof(struct fuzzy_match));
+        best[pos].name = names->names[i];
+        best[pos].score = score;
+    }
+
+    if (n_matches == 0) {
+        return -1;
+    }
+
+    if (n_matches == 1) {
+        return dir_match_replace(self, b_path, best[0].name, arg_start);
+    }
+
+    const char *list[MAX_PRINTED_MATCHES];
+
+    for (size_t i = 0; i < n_best; ++i) {
+        list[i] = best[i].name;
+    }
+
+    print_ac_matches(self, toxic, list, n_matches, true);
+
+    return 0;
 }
 
+/* A path completion that's waiting for its directory to be listed. Only used by the interface thread. */
+static struct Dir_Match_Pending {
+    bool active;
+    uint16_t window_id;
+    wchar_t line[MAX_STR_SIZE];
+    char path[TOXIC_MAX_PATH_LENGTH + 1];
+} dir_match_pending;
+
 /* Attempts to match /command "<incomplete-dir>" line to matching directories.
  * If there is only one match the line is auto-completed.
  *
  * Returns the diff between old len and new len of ctx->line on success.
  * Returns -1 if no matches or more than one match.
  */
-#define MAX_DIRS 75
 int dir_match(ToxWindow *self, Toxic *toxic, const wchar_t *line, const wchar_t *cmd)
 {
     char b_path[TOXIC_MAX_PATH_LENGTH + 1];
@@ -411,45 +569,62 @@ int dir_match(ToxWindow *self, Toxic *toxic, const wchar_t *line, const wchar_t
     snprintf(b_name, sizeof(b_name), "%s", &b_path[si + 1]);
     b_path[si + 1] = '\0';
     size_t b_name_len = strlen(b_name);
-    DIR *dp = opendir(b_path);
 
-    if (dp == NULL) {
-        return -1;
+    Dir_Cache_Status status;
+    const Name_Index *names = dir_cache_acquire(b_path, &status);
+
+    if (status == DIR_CACHE_LOADING) {
+        /* dir_match_poll() completes the line once the directory has been listed */
+        dir_match_pending.active = true;
+        dir_match_pending.window_id = self->id;
+        wcscpy(dir_match_pending.line, self->chatwin->line);
+        snprintf(dir_match_pending.path, sizeof(dir_match_pending.path), "%s", b_path);
+        return 0;
     }
 
-    char **dirnames = (char **) malloc_ptr_array(MAX_DIRS, NAME_MAX + 1);
+    dir_match_pending.active = false;
 
-    if (dirnames == NULL) {
-        closedir(dp);
+    if (names == NULL) {
         return -1;
     }
 
-    struct dirent *entry;
-
-    int dircount = 0;
+    uint32_t first;
+    const uint32_t n_matches = name_index_find_prefix(names, b_name, b_name_len, &first);
+    int ret;
 
-    while ((entry = readdir(dp)) && dircount < MAX_DIRS) {
-        if (is_partial_match(entry->d_name, b_name, b_name_len)) {
-            snprintf(dirnames[dircount], NAME_MAX + 1, "%s", entry->d_name);
-            ++dircount;
+    if (n_matches == 0) {
+        ret = dir_match_fuzzy(self, toxic, names, b_path, b_name, wcslen(cmd) + 1);
+    } else {
+        if (n_matches > 1) {
+            print_ac_matches(self, toxic, (const char *const *) &names->names[first], n_matches, true);
         }
+
+        ret = complete_path(self, toxic, names);
     }
 
-    closedir(dp);
+    dir_cache_release();
 
-    if (dircount == 0) {
-        free_ptr_array((void **) dirnames);
-        return -1;
-    }
+    return ret;
+}
 
-    if (dircount > 1) {
-        qsort(dirnames, dircount, sizeof(char *), qsort_ptr_char_array_helper);
-        print_ac_matches(self, toxic, dirnames, dircount, true);
+void dir_match_poll(Toxic *toxic)
+{
+    if (!dir_match_pending.active || dir_cache_is_loading(dir_match_pending.path)) {
+        return;
     }
 
-    const int ret = complete_path(self, toxic, (const char *const *) dirnames, dircount);
+    dir_match_pending.active = false;
 
-    free_ptr_array((void **) dirnames);
+    pthread_mutex_lock(&Winthread.lock);
 
-    return ret;
+    ToxWindow *self = get_active_window(toxic->windows);
+
+    /* only if the line hasn't been edited since tab was pressed */
+    if (self != NULL && self->id == dir_match_pending.window_id && self->chatwin != NULL
+            && wcscmp(self->chatwin->line, dir_match_pending.line) == 0) {
+        self->onKey(self, toxic, L'\t', false);
+        flag_interface_refresh();
+    }
+
+    pthread_mutex_unlock(&Winthread.lock);
 }
@@ -9,6 +9,7 @@
 #ifndef AUTOCOMPLETE_H
 #define AUTOCOMPLETE_H
 
+#include "name_index.h"
 #include "toxic.h"
 #include "windows.h"
 
@@ -28,12 +29,28 @@
  */
 int complete_line(ToxWindow *self, Toxic *toxic, const char *const *list, size_t n_items);
 
+/*
+ * Same as complete_line(), but completes the word with the names in `index`, which are found with a
+ * binary search instead of comparing the word to every name.
+ */
+int complete_line_index(ToxWindow *self, Toxic *toxic, const Name_Index *index);
+
 /* Attempts to match /command "<incomplete-dir>" line to matching directories.
- * If there is only one match the line is auto-completed.
+ * If there is only one match the line is auto-completed. If no names start with the one being typed,
+ * names that contain its characters in the same order are matched instead.
+ *
+ * Directories are listed by a background thread. If the directory hasn't been listed yet this returns
+ * 0 and the line is completed by dir_match_poll() once it has.
  *
  * Returns the diff between old len and new len of ctx->line on success.
  * Returns -1 if no matches or more than one match.
  */
 int dir_match(ToxWindow *self, Toxic *toxic, const wchar_t *line, const wchar_t *cmd);
 
+/* Completes the path that dir_match() was waiting for a directory listing to complete, if the listing
+ * is ready and the line hasn't been changed since. Must be called by the interface thread without the
+ * Winthread lock held.
+ */
+void dir_match_poll(Toxic *toxic);
+
 #endif /* AUTOCOMPLETE_H */
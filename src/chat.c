@@ -19,6 +19,7 @@
 #include <wchar.h>
 
 #include "autocomplete.h"
+#include "dir_transfers.h"
 #include "execute.h"
 #include "file_transfers.h"
 #include "friendlist.h"
@@ -50,6 +51,8 @@ static void init_infobox(ToxWindow *self, double VAD_threshold);
 static void kill_infobox(ToxWindow *self);
 #endif /* AUDIO */
 
+static void kill_transfer_pane(ToxWindow *self);
+
 /* Array of chat command names used for tab completion. */
 static const char *const chat_cmd_list[] = {
     "/accept",
@@ -64,6 +67,7 @@ static const char *const chat_cmd_list[] = {
     "/color",
     "/connect",
     "/exit",
+    "/frames",
     "/gaccept",
     "/conference",
     "/group",
@@ -84,8 +88,10 @@ static const char *const chat_cmd_list[] = {
     "/nospam",
     "/quit",
     "/savefile",
+    "/search",
     "/sendfile",
     "/status",
+    "/wakeups",
 
 #ifdef AUDIO
 
@@ -146,14 +152,14 @@ void kill_chat_window(ToxWindow *self, Toxic *toxic)
     kill_all_file_transfers_friend(toxic, self->num);
 
     if (ctx != NULL) {
-        log_disable(ctx->log);
         line_info_cleanup(ctx->hst);
         cqueue_cleanup(ctx->cqueue);
 
+        kill_transfer_pane(self);
         delwin(ctx->linewin);
         delwin(ctx->history);
 
-        free(ctx->log);
+        log_free(ctx->log);
         free(ctx);
     }
 
@@ -271,6 +277,9 @@ static void chat_onConnectionChange(ToxWindow *self, Toxic *toxic, uint32_t num,
 
         chat_pause_file_transfers(toxic->friends, num);
 
+        /* toxcore drops its receipts along with the connection, so anything in flight must be sent again */
+        cqueue_reset_sent(ctx->cqueue);
+
         if (c_config->show_connection_msg) {
             msg = "has gone offline";
             line_info_add(self, c_config, true, name, NULL, DISCONNECTION, 0, RED, "%s", msg);
@@ -401,14 +410,16 @@ static void chat_pause_file_transfers(FriendsList *friends, uint32_t friendnum)
 {
     ToxicFriend *friend = &friends->list[friendnum];
 
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        struct FileTransfer *fts = &friend->file_sender[i];
+    for (size_t i = 0; i < friend->file_sender.size; ++i) {
+        struct FileTransfer *fts = friend->file_sender.transfers[i];
 
         if (fts->file_type == TOX_FILE_KIND_DATA && fts->state >= FILE_TRANSFER_STARTED) {
             fts->state = FILE_TRANSFER_PAUSED;
         }
+    }
 
-        struct FileTransfer *ftr = &friend->file_receiver[i];
+    for (size_t i = 0; i < friend->file_receiver.size; ++i) {
+        struct FileTransfer *ftr = friend->file_receiver.transfers[i];
 
         if (ftr->file_type == TOX_FILE_KIND_DATA && ftr->state >= FILE_TRANSFER_STARTED) {
             ftr->state = FILE_TRANSFER_PAUSED;
@@ -419,8 +430,10 @@ static void chat_pause_file_transfers(FriendsList *friends, uint32_t friendnum)
 /* Tries to resume broken file senders. Called when a friend comes online */
 static void chat_resume_file_senders(ToxWindow *self, const Toxic *toxic, uint32_t friendnum)
 {
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        struct FileTransfer *ft = &toxic->friends->list[friendnum].file_sender[i];
+    const FileTransferTable *senders = &toxic->friends->list[friendnum].file_sender;
+
+    for (size_t i = 0; i < senders->size; ++i) {
+        struct FileTransfer *ft = senders->transfers[i];
 
         if (ft->state != FILE_TRANSFER_PAUSED || ft->file_type != TOX_FILE_KIND_DATA) {
             continue;
@@ -447,8 +460,6 @@ static void chat_onFileChunkRequest(ToxWindow *self, Toxic *toxic, uint32_t frie
         return;
     }
 
-    Tox *tox = toxic->tox;
-
     if (friendnum != self->num) {
         return;
     }
@@ -466,56 +477,31 @@ static void chat_onFileChunkRequest(ToxWindow *self, Toxic *toxic, uint32_t frie
     char msg[MAX_STR_SIZE];
 
     if (length == 0) {
+        /* files in a directory are reported all together when it's finished */
+        if (ft->dir_id != 0) {
+            close_file_transfer(self, toxic, ft, -1, NULL, silent);
+            return;
+        }
+
         snprintf(msg, sizeof(msg), "File '%s' successfully sent.", ft->file_name);
-        print_progress_bar(self, ft->bps, 100.0, ft->line_id);
         close_file_transfer(self, toxic, ft, -1, msg, transfer_completed);
         return;
     }
 
-    if (ft->file == NULL) {
+    if (ft->reader == NULL) {
         snprintf(msg, sizeof(msg), "File transfer for '%s' failed: Null file pointer.", ft->file_name);
         close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
         return;
     }
 
-    if (ft->position != position) {
-        if (fseek(ft->file, position, SEEK_SET) == -1) {
-            snprintf(msg, sizeof(msg), "File transfer for '%s' failed: Seek fail.", ft->file_name);
-            close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
-            return;
-        }
-
-        ft->position = position;
-    }
-
-    uint8_t *send_data = malloc(length);
-
-    if (send_data == NULL) {
-        snprintf(msg, sizeof(msg), "File transfer for '%s' failed: Out of memory.", ft->file_name);
-        close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
-        return;
-    }
-
-    size_t send_length = fread(send_data, 1, length, ft->file);
-
-    if (send_length != length) {
-        snprintf(msg, sizeof(msg), "File transfer for '%s' failed: Read fail.", ft->file_name);
+    if (file_reader_request(ft->reader, position, length) != 0) {
+        snprintf(msg, sizeof(msg), "File transfer for '%s' failed: Invalid chunk request.", ft->file_name);
         close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
-        free(send_data);
         return;
     }
 
-    Tox_Err_File_Send_Chunk err;
-    tox_file_send_chunk(tox, ft->friendnumber, ft->filenumber, position, send_data, send_length, &err);
-
-    free(send_data);
-
-    if (err != TOX_ERR_FILE_SEND_CHUNK_OK) {
-        fprintf(stderr, "tox_file_send_chunk failed in chat callback (error %d)\n", err);
-    }
-
-    ft->position += send_length;
-    ft->bps += send_length;
+    /* chunks whose data hasn't been read yet are sent from the Tox loop once it has */
+    file_transfer_send_chunks(toxic, ft);
 }
 
 static void chat_onFileRecvChunk(ToxWindow *self, Toxic *toxic, uint32_t friendnum, uint32_t filenumber,
@@ -545,25 +531,40 @@ static void chat_onFileRecvChunk(ToxWindow *self, Toxic *toxic, uint32_t friendn
     char msg[MAX_STR_SIZE];
 
     if (length == 0) {
+        /* the rest of the file is written and synced to disk in the background */
+        file_writer_close(ft->writer, true);
+        ft->writer = NULL;
+
+        if (ft->dir_id != 0) {
+            close_file_transfer(self, toxic, ft, -1, NULL, silent);
+            return;
+        }
+
         snprintf(msg, sizeof(msg), "File '%s' successfully received.", ft->file_name);
-        print_progress_bar(self, ft->bps, 100.0, ft->line_id);
         close_file_transfer(self, toxic, ft, -1, msg, transfer_completed);
         return;
     }
 
-    if (ft->file == NULL) {
+    if (ft->writer == NULL) {
         snprintf(msg, sizeof(msg), "File transfer for '%s' failed: Invalid file pointer.", ft->file_name);
         close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
         return;
     }
 
-    if (fwrite(data, length, 1, ft->file) != 1) {
+    const int ret = file_writer_append(ft->writer, (const uint8_t *) data, length);
+
+    if (ret == -1) {
         snprintf(msg, sizeof(msg), "File transfer for '%s' failed: Write fail.", ft->file_name);
         close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
         return;
     }
 
-    ft->bps += length;
+    if (ret == 1) {
+        /* the disk has fallen behind; file_transfers_check_writers() resumes the sender once it catches up */
+        Tox_Err_File_Control err;
+        tox_file_control(toxic->tox, friendnum, filenumber, TOX_FILE_CONTROL_PAUSE, &err);
+    }
+
     ft->position += length;
 }
 
@@ -588,15 +589,13 @@ static void chat_onFileControl(ToxWindow *self, Toxic *toxic, uint32_t friendnum
 
     switch (control) {
         case TOX_FILE_CONTROL_RESUME: {    /* transfer is accepted */
-            if (ft->state == FILE_TRANSFER_PENDING) {
+            if (ft->state == FILE_TRANSFER_PENDING && ft->dir_id != 0) {
+                ft->state = FILE_TRANSFER_STARTED;
+            } else if (ft->state == FILE_TRANSFER_PENDING) {
                 ft->state = FILE_TRANSFER_STARTED;
                 line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "File transfer [%zu] for '%s' accepted.",
                               ft->index, ft->file_name);
                 sound_notify(self, toxic, silent, NT_NOFOCUS | c_config->bell_on_filetrans_accept | NT_WNDALERT_2, NULL);
-                char progline[MAX_STR_SIZE];
-                init_progress_bar(progline);
-                line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "%s", progline);
-                ft->line_id = self->chatwin->hst->line_end->id + 2;
             } else if (ft->state == FILE_TRANSFER_PAUSED) {    /* transfer is resumed */
                 ft->state = FILE_TRANSFER_STARTED;
             }
@@ -639,10 +638,10 @@ static bool chat_resume_broken_ft(ToxWindow *self, Toxic *toxic, uint32_t friend
 
     bool resuming = false;
     struct FileTransfer *ft = NULL;
-    size_t i;
+    const FileTransferTable *receivers = &toxic->friends->list[friendnum].file_receiver;
 
-    for (i = 0; i < MAX_FILES; ++i) {
-        ft = &toxic->friends->list[friendnum].file_receiver[i];
+    for (size_t i = 0; i < receivers->size; ++i) {
+        ft = receivers->transfers[i];
 
         if (ft->state == FILE_TRANSFER_INACTIVE) {
             continue;
@@ -708,51 +707,23 @@ static bool valid_file_name(const char *filename, size_t length)
     return true;
 }
 
-static void chat_onFileRecv(ToxWindow *self, Toxic *toxic, uint32_t friendnum, uint32_t filenumber, uint64_t file_size,
-                            const char *filename, size_t name_length)
+/* Picks a path in the download directory that isn't taken to save the file `filename` to, and puts it
+ * in `ft`'s file_path.
+ *
+ * Return true on success.
+ * Return false on failure, in which case `ft` is closed.
+ */
+static bool chat_set_recv_file_path(ToxWindow *self, Toxic *toxic, struct FileTransfer *ft, const char *filename,
+                                    size_t name_length)
 {
-    if (toxic == NULL || self == NULL) {
-        return;
-    }
-
-    Tox *tox = toxic->tox;
     const Client_Config *c_config = toxic->c_config;
 
-    if (self->num != friendnum) {
-        return;
-    }
-
-    /* first check if we need to resume a broken transfer */
-    if (chat_resume_broken_ft(self, toxic, friendnum, filenumber)) {
-        return;
-    }
-
-    struct FileTransfer *ft = new_file_transfer(toxic->friends, self, friendnum, filenumber, FILE_TRANSFER_RECV,
-                              TOX_FILE_KIND_DATA);
-
-    if (ft == NULL) {
-        tox_file_control(tox, friendnum, filenumber, TOX_FILE_CONTROL_CANCEL, NULL);
-        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
-                      "File transfer request failed: Too many concurrent file transfers.");
-        return;
-    }
-
-    char sizestr[32];
-    bytes_convert_str(sizestr, sizeof(sizestr), file_size);
-    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "File transfer request for '%s' (%s)", filename,
-                  sizestr);
-
-    if (!valid_file_name(filename, name_length)) {
-        close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, "File transfer failed: Invalid file name.", notif_error);
-        return;
-    }
-
     size_t file_path_buf_size = TOXIC_MAX_PATH_LENGTH + name_length + 1;
     char *file_path = malloc(file_path_buf_size);
 
     if (file_path == NULL) {
         close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, "File transfer failed: Out of memory.", notif_error);
-        return;
+        return false;
     }
 
     size_t path_len = name_length;
@@ -765,10 +736,10 @@ static void chat_onFileRecv(ToxWindow *self, Toxic *toxic, uint32_t friendnum, u
         snprintf(file_path, file_path_buf_size, "%s", filename);
     }
 
-    if (path_len >= file_path_buf_size || path_len >= sizeof(ft->file_path) || name_length >= sizeof(ft->file_name)) {
+    if (path_len >= file_path_buf_size || path_len >= sizeof(ft->file_path)) {
         close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, "File transfer failed: File path too long.", notif_error);
         free(file_path);
-        return;
+        return false;
     }
 
     /* Append a number to duplicate file names */
@@ -788,7 +759,7 @@ static void chat_onFileRecv(ToxWindow *self, Toxic *toxic, uint32_t friendnum, u
         if (path_len + d_len >= file_path_buf_size) {
             close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, "File transfer failed: File path too long.", notif_error);
             free(file_path);
-            return;
+            return false;
         }
 
         strcat(file_path, d);
@@ -797,16 +768,87 @@ static void chat_onFileRecv(ToxWindow *self, Toxic *toxic, uint32_t friendnum, u
         if (++count > 99) {  // If there are this many duplicate file names we should probably give up
             close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, "File transfer failed: invalid file path.", notif_error);
             free(file_path);
-            return;
+            return false;
         }
     }
 
-    ft->file_size = file_size;
     snprintf(ft->file_path, sizeof(ft->file_path), "%s", file_path);
+
+    free(file_path);
+
+    return true;
+}
+
+static void chat_onFileRecv(ToxWindow *self, Toxic *toxic, uint32_t friendnum, uint32_t filenumber, uint64_t file_size,
+                            const char *filename, size_t name_length)
+{
+    if (toxic == NULL || self == NULL) {
+        return;
+    }
+
+    Tox *tox = toxic->tox;
+    const Client_Config *c_config = toxic->c_config;
+
+    if (self->num != friendnum) {
+        return;
+    }
+
+    /* first check if we need to resume a broken transfer */
+    if (chat_resume_broken_ft(self, toxic, friendnum, filenumber)) {
+        return;
+    }
+
+    struct FileTransfer *ft = new_file_transfer(toxic->friends, self, friendnum, filenumber, FILE_TRANSFER_RECV,
+                              TOX_FILE_KIND_DATA);
+
+    if (ft == NULL) {
+        tox_file_control(tox, friendnum, filenumber, TOX_FILE_CONTROL_CANCEL, NULL);
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                      "File transfer request failed: Too many concurrent file transfers.");
+        return;
+    }
+
+    ft->file_size = file_size;
     snprintf(ft->file_name, sizeof(ft->file_name), "%s", filename);
     tox_file_get_file_id(tox, friendnum, filenumber, ft->file_id, NULL);
 
-    free(file_path);
+    /* a file in a directory is saved to its place in the directory */
+    char dir_path[TOXIC_MAX_PATH_LENGTH];
+    const int dir_path_len = dir_recv_match(self, toxic, ft, dir_path, sizeof(dir_path));
+    const bool in_dir = dir_path_len >= 0;
+
+    if (!in_dir) {
+        char sizestr[32];
+        bytes_convert_str(sizestr, sizeof(sizestr), file_size);
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "File transfer request for '%s' (%s)", filename,
+                      sizestr);
+    }
+
+    if (!valid_file_name(filename, name_length)) {
+        close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, "File transfer failed: Invalid file name.", notif_error);
+        return;
+    }
+
+    /* a file we've received part of before is saved to the same place and picks up where it left off */
+    if (file_transfer_load_journal(toxic, ft)) {
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                      "Part of '%s' was received before, and the rest will be added to '%s'.", filename, ft->file_path);
+    } else if (in_dir && !chat_set_recv_file_path(self, toxic, ft, dir_path, dir_path_len)) {
+        return;
+    } else if (!in_dir && !chat_set_recv_file_path(self, toxic, ft, filename, name_length)) {
+        return;
+    }
+
+    /* the user accepts a directory's files all at once */
+    if (in_dir) {
+        if (dir_recv_is_accepted(toxic->friends, ft)) {
+            char cmd[MAX_STR_SIZE];
+            snprintf(cmd, sizeof(cmd), "/savefile %zu", ft->index);
+            execute(self->window, self, toxic, cmd, CHAT_COMMAND_MODE);
+        }
+
+        return;
+    }
 
     if (self->active_box != -1) {
         box_notify2(self, toxic, transfer_pending, NT_WNDALERT_0 | NT_NOFOCUS | c_config->bell_on_filetrans,
@@ -1296,6 +1338,161 @@ static void draw_infobox(ToxWindow *self)
 
 #endif /* AUDIO */
 
+static void kill_transfer_pane(ToxWindow *self)
+{
+    struct transfer_pane *pane = &self->chatwin->transfer_pane;
+
+    if (pane->win != NULL) {
+        delwin(pane->win);
+        pane->win = NULL;
+    }
+}
+
+/* Prints one transfer's row of the transfer pane on the current line of `win`, which is `width` columns wide. */
+static void draw_transfer_pane_row(WINDOW *win, const struct transfer_stat *stat, int width)
+{
+    const bool sending = stat->flags & TRANSFER_STAT_SENDING;
+
+    char label[16];
+
+    if (stat->flags & TRANSFER_STAT_DIRECTORY) {
+        snprintf(label, sizeof(label), "%s dir", sending ? "out" : "in");
+    } else {
+        snprintf(label, sizeof(label), "%s %d", sending ? "out" : "in", stat->id);
+    }
+
+    char rate[32];
+
+    if (stat->flags & TRANSFER_STAT_PAUSED) {
+        snprintf(rate, sizeof(rate), "paused");
+    } else {
+        char bps_str[24];
+        bytes_convert_str(bps_str, sizeof(bps_str), stat->bps);
+        snprintf(rate, sizeof(rate), "%s/s", bps_str);
+    }
+
+    /* a transfer whose size isn't known yet shows how much it has transferred instead of how far along it is */
+    char done[24];
+
+    if (stat->size > 0) {
+        snprintf(done, sizeof(done), "%.1f%%", transfer_stat_percent(stat));
+    } else {
+        bytes_convert_str(done, sizeof(done), stat->position);
+    }
+
+    /* label, name, done, bar and rate, with a space between each */
+    const int fixed = 8 + 1 + 10 + 1 + 13;
+    const int flexible = width - fixed - 1;
+
+    if (flexible < 4) {
+        return;
+    }
+
+    int name_cols = MIN(32, flexible / 2);
+    int bar_cols = flexible - name_cols - 3;
+
+    if (bar_cols < 8 || stat->size == 0) {
+        name_cols = flexible;
+        bar_cols = 0;
+    }
+
+    const int name_len = (int) transfer_stat_name_fit(stat->name, name_cols);
+
+    wattron(win, A_BOLD);
+    wprintw(win, " %-7s ", label);
+    wattroff(win, A_BOLD);
+    wprintw(win, "%-*.*s %10s ", name_cols, name_len, stat->name, done);
+
+    if (bar_cols > 0) {
+        char bar[64];
+        transfer_stat_bar(stat, bar, MIN((size_t) bar_cols, sizeof(bar) - 1));
+        wprintw(win, "[%s] ", bar);
+    }
+
+    wprintw(win, "%13s", rate);
+}
+
+/* Takes a snapshot of the transfers with the chat window's friend that are in progress, and draws them in the
+ * transfer pane at the top of the chat history. The pane is removed when there are none.
+ *
+ * Return true if any transfers are in progress.
+ */
+static bool draw_transfer_pane(ToxWindow *self, Toxic *toxic)
+{
+    struct transfer_pane *pane = &self->chatwin->transfer_pane;
+    const uint64_t now = transfer_stats_now();
+
+    const size_t num_files = file_transfers_get_stats(toxic->friends, self->num, pane->stats, TRANSFER_PANE_MAX_ROWS,
+                             now);
+    const size_t num_shown = MIN(num_files, TRANSFER_PANE_MAX_ROWS);
+    const size_t num_dirs = dir_transfers_get_stats(toxic->friends, self->num, pane->stats + num_shown,
+                            TRANSFER_PANE_MAX_ROWS - num_shown, now);
+
+    pane->num_transfers = num_files + num_dirs;
+
+    if (pane->num_transfers == 0) {
+        kill_transfer_pane(self);
+        return false;
+    }
+
+    int x2;
+    int y2;
+    getmaxyx(self->window, y2, x2);
+
+    const size_t num_rows = MIN(pane->num_transfers, TRANSFER_PANE_MAX_ROWS);
+    const int height = (int) num_rows + (pane->num_transfers > num_rows ? 1 : 0) + 1;  /* plus the bottom border */
+    int width = x2;
+
+#ifdef AUDIO
+
+    if (self->chatwin->infobox.active) {
+        width -= INFOBOX_WIDTH + 1;
+    }
+
+#endif /* AUDIO */
+
+    /* leave at least a couple of lines of the chat history in view */
+    if (y2 - CHATBOX_HEIGHT - WINDOW_BAR_HEIGHT - TOP_BAR_HEIGHT < height + 2 || width <= 0) {
+        kill_transfer_pane(self);
+        return true;
+    }
+
+    if (pane->win != NULL) {
+        int pane_y;
+        int pane_x;
+        getmaxyx(pane->win, pane_y, pane_x);
+
+        if (pane_y != height || pane_x != width) {
+            kill_transfer_pane(self);
+        }
+    }
+
+    if (pane->win == NULL) {
+        pane->win = newwin(height, width, TOP_BAR_HEIGHT, 0);
+
+        if (pane->win == NULL) {
+            return true;
+        }
+    }
+
+    werase(pane->win);
+
+    for (size_t i = 0; i < num_rows; ++i) {
+        wmove(pane->win, i, 0);
+        draw_transfer_pane_row(pane->win, &pane->stats[i], width);
+    }
+
+    if (pane->num_transfers > num_rows) {
+        wmove(pane->win, num_rows, 0);
+        wprintw(pane->win, " ... and %zu more", pane->num_transfers - num_rows);
+    }
+
+    mvwhline(pane->win, height - 1, 0, ACS_HLINE, width);
+    wnoutrefresh(pane->win);
+
+    return true;
+}
+
 static void send_action(ToxWindow *self, ChatContext *ctx, Toxic *toxic, char *action)
 {
     if (action == NULL) {
@@ -1653,6 +1850,15 @@ static void chat_onDraw(ToxWindow *self, Toxic *toxic)
 
     wnoutrefresh(self->window);
 
+    pthread_mutex_lock(&Winthread.lock);
+
+    /* keep redrawing while the transfers' progress changes */
+    if (draw_transfer_pane(self, toxic)) {
+        flag_interface_refresh();
+    }
+
+    pthread_mutex_unlock(&Winthread.lock);
+
 #ifdef AUDIO
 
     if (ctx->infobox.active) {
@@ -1664,14 +1870,6 @@ static void chat_onDraw(ToxWindow *self, Toxic *toxic)
     if (self->help->active) {
         help_draw_main(self);
     }
-
-    pthread_mutex_lock(&Winthread.lock);
-
-    if (refresh_file_transfer_progress(toxic->friends, self, self->num)) {
-        flag_interface_refresh();
-    }
-
-    pthread_mutex_unlock(&Winthread.lock);
 }
 
 static void chat_init_log(ToxWindow *self, Toxic *toxic, const char *self_nick)
@@ -1701,6 +1899,53 @@ static void chat_init_log(ToxWindow *self, Toxic *toxic, const char *self_nick)
     }
 }
 
+struct chat_replay_ctx {
+    ToxWindow *self;
+    const Client_Config *c_config;
+    const char *selfname;
+};
+
+static int chat_replay_queued_message(const struct cqueue_msg *msg, void *userdata)
+{
+    const struct chat_replay_ctx *ctx = (const struct chat_replay_ctx *) userdata;
+
+    return line_info_add(ctx->self, ctx->c_config, true, ctx->selfname, NULL, msg->type, 0, 0, "%s", msg->message);
+}
+
+/* Loads the messages that were still waiting to be sent to the friend when toxic last closed this window. */
+static void chat_init_queue(ToxWindow *self, Toxic *toxic)
+{
+    Tox *tox = toxic->tox;
+    ChatContext *ctx = self->chatwin;
+
+    uint8_t self_key[TOX_PUBLIC_KEY_SIZE];
+    tox_self_get_public_key(tox, self_key);
+
+    char path[TOXIC_MAX_PATH_LENGTH];
+
+    if (cqueue_get_journal_path(toxic->paths, self_key, (const uint8_t *) toxic->friends->list[self->num].pub_key,
+                                path, sizeof(path)) != 0) {
+        line_info_add(self, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Failed to open message queue journal.");
+        return;
+    }
+
+    char selfname[TOX_MAX_NAME_LENGTH + 1];
+    tox_self_get_name(tox, (uint8_t *) selfname);
+
+    const size_t len = tox_self_get_name_size(tox);
+    selfname[len] = '\0';
+
+    struct chat_replay_ctx replay_ctx = {
+        self,
+        toxic->c_config,
+        selfname,
+    };
+
+    if (cqueue_load_journal(ctx->cqueue, path, chat_replay_queued_message, &replay_ctx) != 0) {
+        line_info_add(self, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Failed to open message queue journal.");
+    }
+}
+
 static void chat_onInit(ToxWindow *self, Toxic *toxic)
 {
     curs_set(1);
@@ -1770,6 +2015,7 @@ static void chat_onInit(ToxWindow *self, Toxic *toxic)
     friend_set_auto_file_accept(toxic->friends, self->num, friend_config_get_auto_accept_files(toxic->friends, self->num));
 
     chat_init_log(self, toxic, name);
+    chat_init_queue(self, toxic);
 
     execute(ctx->history, self, toxic, "/log", GLOBAL_COMMAND_MODE);  // Print log status to screen
 
@@ -13,6 +13,7 @@
 
 #include "chat.h"
 #include "conference.h"
+#include "dir_transfers.h"
 #include "execute.h"
 #include "file_transfers.h"
 #include "friendlist.h"
@@ -80,7 +81,7 @@ void cmd_cancelfile(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, cha
     const char *inoutstr = argv[1];
     const long int idx = strtol(argv[2], NULL, 10);
 
-    if ((idx == 0 && strcmp(argv[2], "0")) || idx >= MAX_FILES || idx < 0) {
+    if ((idx == 0 && strcmp(argv[2], "0")) || idx < 0) {
         line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Invalid file ID.");
         return;
     }
@@ -373,9 +374,17 @@ void cmd_savefile(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char
         return;
     }
 
+    if (strcmp(argv[1], "-r") == 0) {
+        if (dir_recv_accept(self, toxic) == -1) {
+            line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "No incoming directory.");
+        }
+
+        return;
+    }
+
     const long int idx = strtol(argv[1], NULL, 10);
 
-    if ((idx == 0 && strcmp(argv[1], "0")) || idx < 0 || idx >= MAX_FILES) {
+    if ((idx == 0 && strcmp(argv[1], "0")) || idx < 0 || idx >= MAX_FILE_TRANSFERS) {
         line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "No pending file transfers with ID %ld", idx);
         return;
     }
@@ -392,29 +401,43 @@ void cmd_savefile(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char
         return;
     }
 
-    if ((ft->file = fopen(ft->file_path, "a")) == NULL) {
+    if (dir_recv_create_parents(ft) != 0) {
         const char *msg =  "File transfer failed: Invalid download path.";
         close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
         return;
     }
 
-    Tox_Err_File_Control err;
-    tox_file_control(tox, self->num, ft->filenumber, TOX_FILE_CONTROL_RESUME, &err);
+    const bool resume = ft->journaled && ft->journal_position > 0;
+
+    if (resume) {
+        ft->writer = file_writer_resume(ft->file_path, ft->journal_position, ft->journal_checksum);
+    } else {
+        ft->writer = file_writer_open(ft->file_path);
+    }
+
+    if (ft->writer == NULL) {
+        const char *msg =  "File transfer failed: Invalid download path.";
+        close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
+        return;
+    }
+
+    Tox_Err_File_Control err = TOX_ERR_FILE_CONTROL_OK;
+
+    /* a resumed transfer is accepted by file_transfers_check_writers() once its saved data has been checked */
+    if (!resume) {
+        tox_file_control(tox, self->num, ft->filenumber, TOX_FILE_CONTROL_RESUME, &err);
+    }
 
     if (err != TOX_ERR_FILE_CONTROL_OK) {
         goto on_recv_error;
     }
 
-    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Saving file [%ld] as: '%s'", idx,
-                  ft->file_path);
-
-    const bool auto_accept_files = friend_get_auto_accept_files(toxic->friends, self->num);
-    const uint32_t line_skip = auto_accept_files ? 4 : 2;
+    /* files in a directory are announced with their directory */
+    if (ft->dir_id == 0) {
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Saving file [%ld] as: '%s'", idx,
+                      ft->file_path);
+    }
 
-    char progline[MAX_STR_SIZE];
-    init_progress_bar(progline);
-    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "%s", progline);
-    ft->line_id = self->chatwin->hst->line_end->id + line_skip;
     ft->state = FILE_TRANSFER_STARTED;
 
     return;
@@ -444,6 +467,79 @@ on_recv_error:
     }
 }
 
+/* Adds `path` to the friend's file send queue, to be sent once they're online and have room for it. */
+static void sendfile_queue(ToxWindow *self, Toxic *toxic, const char *path, size_t path_len)
+{
+    const int queue_idx = file_send_queue_add(toxic->friends, self->num, path, path_len);
+
+    char msg[MAX_STR_SIZE];
+
+    switch (queue_idx) {
+        case -1: {
+            snprintf(msg, sizeof(msg), "Invalid file name: path is null or length is zero.");
+            break;
+        }
+
+        case -2: {
+            snprintf(msg, sizeof(msg), "File name is too long.");
+            break;
+        }
+
+        case -3: {
+            snprintf(msg, sizeof(msg), "Failed to queue file transfer (OOM)");
+            break;
+        }
+
+        default: {
+            snprintf(msg, sizeof(msg), "File transfer queued. Type \"/cancel out %d\" to cancel.", queue_idx);
+            break;
+        }
+    }
+
+    line_info_add(self, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0, "%s", msg);
+}
+
+/* Starts sending the directory at `path`. */
+static void sendfile_dir(ToxWindow *self, Toxic *toxic, const char *path)
+{
+    const Client_Config *c_config = toxic->c_config;
+
+    while (*path == ' ') {
+        ++path;
+    }
+
+    if (*path == '\0') {
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Directory path required.");
+        return;
+    }
+
+    const int ret = dir_send_start(self, toxic, path);
+
+    switch (ret) {
+        case 0: {
+            line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                          "Sending directory '%s'. Its files will be offered a few at a time.", path);
+            return;
+        }
+
+        case -1: {
+            line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                          "A directory is already being sent to this friend.");
+            return;
+        }
+
+        case -2: {
+            line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Directory `%s` not found.", path);
+            return;
+        }
+
+        default: {
+            line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Invalid directory name.");
+            return;
+        }
+    }
+}
+
 void cmd_sendfile(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char (*argv)[MAX_STR_SIZE])
 {
     UNUSED_VAR(window);
@@ -462,6 +558,11 @@ void cmd_sendfile(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char
         return;
     }
 
+    if (strncmp(argv[1], "-r ", 3) == 0) {
+        sendfile_dir(self, toxic, argv[1] + 3);
+        return;
+    }
+
     char path[TOXIC_MAX_PATH_LENGTH];
     snprintf(path, sizeof(path), "%s", argv[1]);
     const int path_len = strlen(path);
@@ -495,6 +596,13 @@ void cmd_sendfile(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char
         return;
     }
 
+    /* wait for one of the friend's other transfers to finish rather than splitting the bandwidth further */
+    if (file_transfer_num_active_sends(toxic->friends, self->num) >= MAX_ACTIVE_FILE_SENDS) {
+        fclose(file_to_send);
+        sendfile_queue(self, toxic, path, path_len);
+        return;
+    }
+
     Tox_Err_File_Send err;
     const uint32_t filenum = tox_file_send(tox, self->num, TOX_FILE_KIND_DATA, (uint64_t) filesize, NULL,
                                            (uint8_t *) file_name, namelen, &err);
@@ -513,6 +621,13 @@ void cmd_sendfile(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char
     memcpy(ft->file_name, file_name, namelen + 1);
     ft->file = file_to_send;
     ft->file_size = (uint64_t)filesize;
+    ft->reader = file_reader_open(fileno(file_to_send), ft->file_size);
+
+    if (ft->reader == NULL) {
+        close_file_transfer(self, toxic, ft, TOX_FILE_CONTROL_CANCEL, "File transfer failed: Out of memory.", silent);
+        return;
+    }
+
     tox_file_get_file_id(tox, self->num, filenum, ft->file_id, NULL);
 
     char sizestr[32];
@@ -533,34 +648,7 @@ on_send_error:
         }
 
         case TOX_ERR_FILE_SEND_FRIEND_NOT_CONNECTED: {
-            const int queue_idx = file_send_queue_add(toxic->friends, self->num, path, path_len);
-
-            char msg[MAX_STR_SIZE];
-
-            switch (queue_idx) {
-                case -1: {
-                    snprintf(msg, sizeof(msg), "Invalid file name: path is null or length is zero.");
-                    break;
-                }
-
-                case -2: {
-                    snprintf(msg, sizeof(msg), "File name is too long.");
-                    break;
-                }
-
-                case -3: {
-                    snprintf(msg, sizeof(msg), "File send queue is full.");
-                    break;
-                }
-
-                default: {
-                    snprintf(msg, sizeof(msg), "File transfer queued. Type \"/cancel out %d\" to cancel.", queue_idx);
-                    break;
-                }
-            }
-
-            line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "%s", msg);
-
+            sendfile_queue(self, toxic, path, path_len);
             return;
         }
 
@@ -76,6 +76,7 @@ static const char *const conference_cmd_list[] = {
     "/connect",
     "/decline",
     "/exit",
+    "/frames",
     "/group",
 #ifdef GAMES
     "/game",
@@ -95,12 +96,14 @@ static const char *const conference_cmd_list[] = {
     "/nospam",
     "/quit",
     "/requests",
+    "/search",
 #ifdef AUDIO
     "/ptt",
     "/sense",
 #endif
     "/status",
     "/title",
+    "/wakeups",
 
 #ifdef PYTHON
 
@@ -139,12 +142,11 @@ static void kill_conference_window(ToxWindow *self, Windows *windows, const Clie
     ChatContext *ctx = self->chatwin;
 
     if (ctx != NULL) {
-        log_disable(ctx->log);
         line_info_cleanup(ctx->hst);
         delwin(ctx->linewin);
         delwin(ctx->history);
         delwin(ctx->sidebar);
-        free(ctx->log);
+        log_free(ctx->log);
         free(ctx);
     }
 
@@ -968,18 +970,7 @@ static bool conference_onKey(ToxWindow *self, Toxic *toxic, wint_t key, bool ltr
             } else if (wcsncmp(ctx->line, L"/avatar ", wcslen(L"/avatar ")) == 0) {
                 diff = dir_match(self, toxic, ctx->line, L"/avatar");
             } else if (wcsncmp(ctx->line, L"/cinvite ", wcslen(L"/cinvite ")) == 0) {
-                size_t num_friends = friendlist_get_count(toxic->friends);
-                char **friend_names = (char **) malloc_ptr_array(num_friends, TOX_MAX_NAME_LENGTH);
-
-                if (friend_names != NULL) {
-                    friendlist_get_names(toxic->friends, friend_names, num_friends, TOX_MAX_NAME_LENGTH);
-                    diff = complete_line(self, toxic, (const char *const *) friend_names, num_friends);
-                    free_ptr_array((void **) friend_names);
-                } else {
-                    diff = -1;
-                    num_friends = 0;
-                    fprintf(stderr, "Failed to allocate memory for friends name list\n");
-                }
+                diff = complete_line_index(self, toxic, &toxic->friends->names);
             }
 
 #ifdef PYTHON
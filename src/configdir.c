@@ -76,56 +76,54 @@ char *get_user_config_dir(const Paths *paths)
     return user_config_dir;
 }
 
-/* Creates the config and chatlog directories.
+/* Creates `path` if it doesn't already exist.
  *
  * Returns 0 on success.
  * Returns -1 on failure.
  */
-int create_user_config_dirs(char *path)
+static int create_dir(const char *path)
 {
     struct stat buf;
-    int mkdir_err = mkdir(path, 0700);
+    const int mkdir_err = mkdir(path, 0700);
 
     if (mkdir_err && (errno != EEXIST || stat(path, &buf) || !S_ISDIR(buf.st_mode))) {
         return -1;
     }
 
-    size_t path_len = strlen(path);
-    size_t fullpath_len = path_len + strlen(CONFIGDIR) + 1;
-    char *fullpath = malloc(fullpath_len);
+    return 0;
+}
 
-    if (fullpath == NULL) {
+/* Creates the config, chatlog, message queue and file transfer directories.
+ *
+ * Returns 0 on success.
+ * Returns -1 on failure.
+ */
+int create_user_config_dirs(char *path)
+{
+    if (create_dir(path) != 0) {
         return -1;
     }
 
-    size_t logpath_len = path_len + strlen(LOGDIR) + 1;
-    char *logpath = malloc(logpath_len);
+    const char *subdirs[] = {CONFIGDIR, LOGDIR, QUEUEDIR, TRANSFERDIR};
+    const size_t path_len = strlen(path);
 
-    if (logpath == NULL) {
-        free(fullpath);
-        return -1;
-    }
+    for (size_t i = 0; i < sizeof(subdirs) / sizeof(subdirs[0]); ++i) {
+        const size_t fullpath_len = path_len + strlen(subdirs[i]) + 1;
+        char *fullpath = malloc(fullpath_len);
 
-    snprintf(fullpath, fullpath_len, "%s%s", path, CONFIGDIR);
-    snprintf(logpath, logpath_len, "%s%s", path, LOGDIR);
+        if (fullpath == NULL) {
+            return -1;
+        }
 
-    mkdir_err = mkdir(fullpath, 0700);
+        snprintf(fullpath, fullpath_len, "%s%s", path, subdirs[i]);
 
-    if (mkdir_err && (errno != EEXIST || stat(fullpath, &buf) || !S_ISDIR(buf.st_mode))) {
+        const int ret = create_dir(fullpath);
         free(fullpath);
-        free(logpath);
-        return -1;
-    }
 
-    mkdir_err = mkdir(logpath, 0700);
-
-    if (mkdir_err && (errno != EEXIST || stat(logpath, &buf) || !S_ISDIR(buf.st_mode))) {
-        free(fullpath);
-        free(logpath);
-        return -1;
+        if (ret != 0) {
+            return -1;
+        }
     }
 
-    free(logpath);
-    free(fullpath);
     return 0;
 }
@@ -15,6 +15,8 @@
 
 #define CONFIGDIR "/tox/"
 #define LOGDIR "/tox/chatlogs/"
+#define QUEUEDIR "/tox/queue/"
+#define TRANSFERDIR "/tox/transfers/"
 
 #ifndef S_ISDIR
 #define S_ISDIR(mode)  (((mode) & S_IFMT) == S_IFDIR)
@@ -35,7 +37,7 @@ char *get_user_config_dir(const Paths *paths);
 /* get the user's home directory. */
 void get_home_dir(const Paths *paths, char *home, int size);
 
-/* Creates the config and chatlog directories.
+/* Creates the config, chatlog, message queue and file transfer directories.
  *
  * Returns 0 on success.
  * Returns -1 on failure.
@@ -0,0 +1,610 @@
+/*  dir_cache.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <sys/types.h>
+#include <sys/dir.h>
+#else
+#include <dirent.h>
+#endif /* __APPLE__ */
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif /* __linux__ */
+
+#include "dir_cache.h"
+
+#ifdef __linux__
+/* Changes to a directory that change its list of names */
+#define DIR_CACHE_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+#endif /* __linux__ */
+
+/* How many names are read between checks for whether the background thread is being stopped */
+#define DIR_CACHE_STOP_CHECK_INTERVAL 4096
+
+typedef enum Dir_Cache_State {
+    DIR_CACHE_ENTRY_EMPTY,
+    DIR_CACHE_ENTRY_QUEUED,
+    DIR_CACHE_ENTRY_LOADING,
+    DIR_CACHE_ENTRY_READY,
+    DIR_CACHE_ENTRY_FAILED,
+} Dir_Cache_State;
+
+struct dir_cache_entry {
+    char *path;
+    Name_Index names;
+    Dir_Cache_State state;
+    bool stale;              /* the directory has changed since it was listed */
+    int watch;               /* inotify watch descriptor, or -1 if the directory isn't watched */
+    uint64_t generation;     /* changes whenever the slot is reused, so a listing of an evicted directory is thrown away */
+    uint64_t last_used;
+    time_t listed_at;
+};
+
+/* Everything is guarded by the lock. */
+static struct dir_cache {
+    pthread_mutex_t lock;
+    pthread_t       tid;
+    bool            running;
+    bool            stop;
+    Reactor         *notify;
+    Reactor         wake;           /* signalled when a directory is queued or the thread should stop */
+    int             inotify_fd;
+
+    struct dir_cache_entry entries[DIR_CACHE_SIZE];
+    uint64_t clock;
+    uint64_t generation;
+} cache = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .inotify_fd = -1,
+};
+
+static time_t dir_cache_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+static struct dir_cache_entry *dir_cache_find(const char *path)
+{
+    for (size_t i = 0; i < DIR_CACHE_SIZE; ++i) {
+        struct dir_cache_entry *entry = &cache.entries[i];
+
+        if (entry->state != DIR_CACHE_ENTRY_EMPTY && strcmp(entry->path, path) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/* Removes the inotify watch `watch` unless another entry still uses it, which happens when two paths
+ * lead to the same directory. */
+static void dir_cache_unwatch(int watch)
+{
+#ifdef __linux__
+
+    if (watch < 0 || cache.inotify_fd < 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < DIR_CACHE_SIZE; ++i) {
+        const struct dir_cache_entry *entry = &cache.entries[i];
+
+        if (entry->state != DIR_CACHE_ENTRY_EMPTY && entry->watch == watch) {
+            return;
+        }
+    }
+
+    inotify_rm_watch(cache.inotify_fd, watch);
+#else
+    (void) watch;
+#endif /* __linux__ */
+}
+
+static void dir_cache_evict(struct dir_cache_entry *entry)
+{
+    const int watch = entry->watch;
+
+    free(entry->path);
+    name_index_free(&entry->names);
+
+    entry->path = NULL;
+    entry->state = DIR_CACHE_ENTRY_EMPTY;
+    entry->watch = -1;
+    entry->generation = ++cache.generation;
+
+    dir_cache_unwatch(watch);
+}
+
+/* Puts `path` in an empty slot, or in the least recently used one if they're all taken, and queues
+ * it to be listed.
+ *
+ * Return NULL on failure.
+ */
+static struct dir_cache_entry *dir_cache_claim(const char *path)
+{
+    const size_t length = strlen(path);
+    char *copy = malloc(length + 1);
+
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    memcpy(copy, path, length + 1);
+
+    struct dir_cache_entry *entry = &cache.entries[0];
+
+    for (size_t i = 0; i < DIR_CACHE_SIZE; ++i) {
+        struct dir_cache_entry *slot = &cache.entries[i];
+
+        if (slot->state == DIR_CACHE_ENTRY_EMPTY) {
+            entry = slot;
+            break;
+        }
+
+        if (slot->last_used < entry->last_used) {
+            entry = slot;
+        }
+    }
+
+    if (entry->state != DIR_CACHE_ENTRY_EMPTY) {
+        dir_cache_evict(entry);
+    }
+
+    entry->path = copy;
+    entry->state = DIR_CACHE_ENTRY_QUEUED;
+    entry->stale = false;
+    entry->watch = -1;
+    entry->generation = ++cache.generation;
+
+    return entry;
+}
+
+static bool dir_cache_is_stale(const struct dir_cache_entry *entry)
+{
+    if (entry->stale) {
+        return true;
+    }
+
+    if (entry->watch >= 0) {
+        return false;
+    }
+
+    return dir_cache_now() - entry->listed_at >= DIR_CACHE_MAX_AGE;
+}
+
+static bool dir_cache_stopping(void)
+{
+    pthread_mutex_lock(&cache.lock);
+    const bool stop = cache.stop;
+    pthread_mutex_unlock(&cache.lock);
+
+    return stop;
+}
+
+/* Puts the names in the directory at `path`, excluding "." and "..", in `names` and sorts them.
+ *
+ * Return 0 on success.
+ * Return -1 on failure or if the background thread is being stopped.
+ */
+static int dir_cache_list(const char *path, Name_Index *names)
+{
+    DIR *dp = opendir(path);
+
+    if (dp == NULL) {
+        return -1;
+    }
+
+    int ret = 0;
+    const struct dirent *entry;
+
+    while ((entry = readdir(dp)) != NULL && names->count < DIR_CACHE_MAX_NAMES) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        if (name_index_append(names, entry->d_name, 0) != 0) {
+            ret = -1;
+            break;
+        }
+
+        if (names->count % DIR_CACHE_STOP_CHECK_INTERVAL == 0 && dir_cache_stopping()) {
+            ret = -1;
+            break;
+        }
+    }
+
+    closedir(dp);
+
+    if (ret == 0) {
+        name_index_sort(names);
+    }
+
+    return ret;
+}
+
+/* Lists the directory of the queued `entry`. Must be called with the lock held, which is released
+ * while the directory is being read. */
+static void dir_cache_load(struct dir_cache_entry *entry)
+{
+    const size_t length = strlen(entry->path);
+    char *path = malloc(length + 1);
+
+    if (path == NULL) {
+        entry->state = DIR_CACHE_ENTRY_FAILED;
+        entry->listed_at = dir_cache_now();
+        return;
+    }
+
+    memcpy(path, entry->path, length + 1);
+
+    const uint64_t generation = entry->generation;
+
+    entry->state = DIR_CACHE_ENTRY_LOADING;
+    entry->stale = false;
+
+#ifdef __linux__
+
+    /* watched before it's listed so that changes made while it's being read aren't missed */
+    if (entry->watch < 0 && cache.inotify_fd >= 0) {
+        entry->watch = inotify_add_watch(cache.inotify_fd, path, DIR_CACHE_WATCH_MASK);
+    }
+
+#endif /* __linux__ */
+
+    pthread_mutex_unlock(&cache.lock);
+
+    Name_Index names = {0};
+    const int ret = dir_cache_list(path, &names);
+
+    free(path);
+
+    pthread_mutex_lock(&cache.lock);
+
+    if (entry->generation != generation) {    /* evicted while it was being listed */
+        name_index_free(&names);
+        return;
+    }
+
+    name_index_free(&entry->names);
+    entry->names = names;
+    entry->state = ret == 0 ? DIR_CACHE_ENTRY_READY : DIR_CACHE_ENTRY_FAILED;
+    entry->listed_at = dir_cache_now();
+
+    if (ret != 0) {
+        name_index_free(&entry->names);
+    }
+
+    if (cache.notify != NULL) {
+        reactor_signal(cache.notify);
+    }
+}
+
+/* Returns the most recently used entry that's waiting to be listed, or NULL if there are none. */
+static struct dir_cache_entry *dir_cache_next_queued(void)
+{
+    struct dir_cache_entry *next = NULL;
+
+    for (size_t i = 0; i < DIR_CACHE_SIZE; ++i) {
+        struct dir_cache_entry *entry = &cache.entries[i];
+
+        if (entry->state == DIR_CACHE_ENTRY_QUEUED && (next == NULL || entry->last_used > next->last_used)) {
+            next = entry;
+        }
+    }
+
+    return next;
+}
+
+static void dir_cache_on_event(int watch, uint32_t mask)
+{
+#ifdef __linux__
+
+    for (size_t i = 0; i < DIR_CACHE_SIZE; ++i) {
+        struct dir_cache_entry *entry = &cache.entries[i];
+
+        if (entry->state == DIR_CACHE_ENTRY_EMPTY) {
+            continue;
+        }
+
+        /* events were dropped, so any directory could have changed */
+        if (mask & IN_Q_OVERFLOW) {
+            entry->stale = true;
+            continue;
+        }
+
+        if (entry->watch != watch) {
+            continue;
+        }
+
+        entry->stale = true;
+
+        /* the directory is gone and the kernel removed the watch */
+        if (mask & IN_IGNORED) {
+            entry->watch = -1;
+        }
+    }
+
+#else
+    (void) watch;
+    (void) mask;
+#endif /* __linux__ */
+}
+
+/* Marks the entries whose directories have changed as stale. */
+static void dir_cache_read_events(void)
+{
+#ifdef __linux__
+    union {
+        struct inotify_event event;
+        char buf[4096];
+    } events;
+
+    while (true) {
+        const ssize_t length = read(cache.inotify_fd, events.buf, sizeof(events.buf));
+
+        if (length <= 0) {
+            break;
+        }
+
+        ssize_t offset = 0;
+
+        while (offset + (ssize_t) sizeof(struct inotify_event) <= length) {
+            const struct inotify_event *event = (const struct inotify_event *) &events.buf[offset];
+            dir_cache_on_event(event->wd, event->mask);
+            offset += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+#endif /* __linux__ */
+}
+
+static void *dir_cache_thread(void *data)
+{
+    (void) data;
+
+    pthread_mutex_lock(&cache.lock);
+
+    while (!cache.stop) {
+        struct dir_cache_entry *entry = dir_cache_next_queued();
+
+        if (entry != NULL) {
+            dir_cache_load(entry);
+            continue;
+        }
+
+        const int fd = cache.inotify_fd;
+
+        pthread_mutex_unlock(&cache.lock);
+        const int events = reactor_wait(&cache.wake, fd, -1);
+        pthread_mutex_lock(&cache.lock);
+
+        if (events > 0 && (events & REACTOR_WAKE_FD)) {
+            dir_cache_read_events();
+        }
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+
+    return NULL;
+}
+
+int dir_cache_start(Reactor *notify)
+{
+    pthread_mutex_lock(&cache.lock);
+
+    if (cache.running) {
+        pthread_mutex_unlock(&cache.lock);
+        return 0;
+    }
+
+    if (reactor_init(&cache.wake) != 0) {
+        pthread_mutex_unlock(&cache.lock);
+        return -1;
+    }
+
+#ifdef __linux__
+
+    /* without inotify listings are trusted for DIR_CACHE_MAX_AGE seconds instead */
+    if (cache.inotify_fd < 0) {
+        cache.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+
+#endif /* __linux__ */
+
+    cache.stop = false;
+    cache.notify = notify;
+
+    if (pthread_create(&cache.tid, NULL, dir_cache_thread, NULL) != 0) {
+        cache.notify = NULL;
+        reactor_free(&cache.wake);
+        pthread_mutex_unlock(&cache.lock);
+        return -1;
+    }
+
+    cache.running = true;
+
+    pthread_mutex_unlock(&cache.lock);
+
+    return 0;
+}
+
+void dir_cache_stop(void)
+{
+    pthread_mutex_lock(&cache.lock);
+
+    if (cache.running) {
+        cache.stop = true;
+        reactor_signal(&cache.wake);
+        pthread_mutex_unlock(&cache.lock);
+
+        pthread_join(cache.tid, NULL);
+
+        pthread_mutex_lock(&cache.lock);
+        cache.running = false;
+        cache.notify = NULL;
+        reactor_free(&cache.wake);
+    }
+
+    for (size_t i = 0; i < DIR_CACHE_SIZE; ++i) {
+        if (cache.entries[i].state != DIR_CACHE_ENTRY_EMPTY) {
+            dir_cache_evict(&cache.entries[i]);
+        }
+    }
+
+    if (cache.inotify_fd >= 0) {
+        close(cache.inotify_fd);
+        cache.inotify_fd = -1;
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+}
+
+const Name_Index *dir_cache_acquire(const char *path, Dir_Cache_Status *status)
+{
+    pthread_mutex_lock(&cache.lock);
+
+    struct dir_cache_entry *entry = dir_cache_find(path);
+
+    if (entry == NULL) {
+        entry = dir_cache_claim(path);
+
+        if (entry == NULL) {
+            pthread_mutex_unlock(&cache.lock);
+            *status = DIR_CACHE_ERROR;
+            return NULL;
+        }
+    } else if ((entry->state == DIR_CACHE_ENTRY_READY || entry->state == DIR_CACHE_ENTRY_FAILED)
+               && dir_cache_is_stale(entry)) {
+        entry->state = DIR_CACHE_ENTRY_QUEUED;
+    }
+
+    entry->last_used = ++cache.clock;
+
+    if (entry->state == DIR_CACHE_ENTRY_QUEUED) {
+        if (cache.running) {
+            reactor_signal(&cache.wake);
+        } else {
+            dir_cache_load(entry);
+        }
+    }
+
+    switch (entry->state) {
+        case DIR_CACHE_ENTRY_READY: {
+            *status = DIR_CACHE_READY;
+            return &entry->names;
+        }
+
+        case DIR_CACHE_ENTRY_FAILED: {
+            *status = DIR_CACHE_ERROR;
+            break;
+        }
+
+        default: {
+            *status = DIR_CACHE_LOADING;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+
+    return NULL;
+}
+
+void dir_cache_release(void)
+{
+    pthread_mutex_unlock(&cache.lock);
+}
+
+bool dir_cache_is_loading(const char *path)
+{
+    pthread_mutex_lock(&cache.lock);
+
+    const struct dir_cache_entry *entry = dir_cache_find(path);
+    const bool loading = entry != NULL
+                         && (entry->state == DIR_CACHE_ENTRY_QUEUED || entry->state == DIR_CACHE_ENTRY_LOADING);
+
+    pthread_mutex_unlock(&cache.lock);
+
+    return loading;
+}
+
+static bool dir_cache_is_word_start(const char *name, size_t i)
+{
+    if (i == 0) {
+        return true;
+    }
+
+    const unsigned char prev = (unsigned char) name[i - 1];
+
+    if (prev == '.' || prev == '_' || prev == '-' || prev == ' ') {
+        return true;
+    }
+
+    return islower(prev) && isupper((unsigned char) name[i]);
+}
+
+int dir_cache_fuzzy_score(const char *pattern, const char *name)
+{
+    int score = 0;
+    size_t p = 0;
+    size_t first = 0;
+    bool prev_matched = false;
+
+    size_t i = 0;
+
+    for (; name[i] != '\0' && pattern[p] != '\0'; ++i) {
+        const unsigned char ch = (unsigned char) name[i];
+
+        if (tolower(ch) != tolower((unsigned char) pattern[p])) {
+            prev_matched = false;
+            continue;
+        }
+
+        if (p == 0) {
+            first = i;
+        }
+
+        score += 16;
+
+        if (prev_matched) {
+            score += 16;
+        }
+
+        if (dir_cache_is_word_start(name, i)) {
+            score += 24;
+        }
+
+        if (ch == (unsigned char) pattern[p]) {
+            score += 2;
+        }
+
+        prev_matched = true;
+        ++p;
+    }
+
+    if (pattern[p] != '\0') {
+        return -1;
+    }
+
+    const size_t length = i + strlen(&name[i]);
+
+    score -= 2 * (int) (first < 16 ? first : 16);
+    score -= (int) (length < 64 ? length : 64) / 4;
+
+    return score > 0 ? score : 0;
+}
@@ -0,0 +1,88 @@
+/*  dir_cache.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef DIR_CACHE_H
+#define DIR_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "name_index.h"
+#include "reactor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Number of directory listings kept in memory */
+#define DIR_CACHE_SIZE 8
+
+/* Directories with more entries than this are only partly listed */
+#define DIR_CACHE_MAX_NAMES (1 << 20)
+
+/* How long a listing is trusted for when changes to its directory can't be watched, in seconds */
+#define DIR_CACHE_MAX_AGE 5
+
+typedef enum Dir_Cache_Status {
+    DIR_CACHE_READY,      /* the listing is in memory and up to date */
+    DIR_CACHE_LOADING,    /* the directory is being listed */
+    DIR_CACHE_ERROR,      /* the directory couldn't be listed */
+} Dir_Cache_Status;
+
+/*
+ * Keeps the names in recently completed directories in memory for path tab completion.
+ *
+ * A background thread lists directories so that large or slow (e.g. network mounted) directories
+ * don't block the interface, and the reactor passed to dir_cache_start() is signalled when a listing
+ * is ready. On Linux each cached directory is watched with inotify and listed again after it changes.
+ * Elsewhere a listing is listed again once it's older than DIR_CACHE_MAX_AGE seconds.
+ *
+ * If the background thread isn't running, directories are listed by the thread asking for them.
+ */
+
+/* Starts the background thread, which signals `notify` when a directory has been listed.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int dir_cache_start(Reactor *notify);
+
+/* Stops the background thread and frees all cached listings. */
+void dir_cache_stop(void);
+
+/* Looks up the listing of the directory at `path`, which must end with a '/' or be ".", and puts
+ * its status in `status`. A directory that isn't cached or has changed is queued to be listed.
+ *
+ * If the status is DIR_CACHE_READY the names in the directory, excluding "." and "..", are returned
+ * and the cache is kept locked until dir_cache_release() is called. The index must not be modified.
+ *
+ * Returns NULL if the status isn't DIR_CACHE_READY.
+ */
+const Name_Index *dir_cache_acquire(const char *path, Dir_Cache_Status *status);
+
+/* Unlocks the cache after a successful call to dir_cache_acquire(). */
+void dir_cache_release(void);
+
+/* Return true if the directory at `path` is queued to be listed or being listed. */
+bool dir_cache_is_loading(const char *path);
+
+/* Scores how well `pattern` matches `name` for fuzzy completion. Every character of `pattern` must
+ * appear in `name` in the same order, ignoring case. Consecutive characters and characters at the
+ * start of a word score higher, and matches that start later or in longer names score lower.
+ *
+ * Returns a score of 0 or more, where higher is better.
+ * Returns -1 if `pattern` doesn't match `name`.
+ */
+int dir_cache_fuzzy_score(const char *pattern, const char *name);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* DIR_CACHE_H */
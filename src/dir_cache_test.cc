@@ -0,0 +1,161 @@
+#include "dir_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+class DirCache : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/dir_cache_test.XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        dir_ = std::string(tmpl) + "/";
+        ASSERT_EQ(reactor_init(&notify_), 0);
+    }
+
+    void TearDown() override
+    {
+        dir_cache_stop();
+        reactor_free(&notify_);
+
+        for (const std::string &name : files_) {
+            unlink((dir_ + name).c_str());
+        }
+
+        rmdir(dir_.c_str());
+    }
+
+    void create(const std::string &name)
+    {
+        FILE *fp = std::fopen((dir_ + name).c_str(), "w");
+        ASSERT_NE(fp, nullptr);
+        std::fclose(fp);
+        files_.push_back(name);
+    }
+
+    /* Waits for the background thread to list the directory and returns its names. */
+    std::vector<std::string> wait_for_names()
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        std::vector<std::string> names;
+
+        while (std::chrono::steady_clock::now() < deadline) {
+            Dir_Cache_Status status;
+            const Name_Index *index = dir_cache_acquire(dir_.c_str(), &status);
+
+            if (status == DIR_CACHE_READY) {
+                for (uint32_t i = 0; i < index->count; ++i) {
+                    names.push_back(index->names[i]);
+                }
+
+                dir_cache_release();
+                return names;
+            }
+
+            EXPECT_EQ(status, DIR_CACHE_LOADING);
+            reactor_wait(&notify_, -1, 100);
+        }
+
+        ADD_FAILURE() << "the directory wasn't listed";
+        return names;
+    }
+
+    std::string dir_;
+    std::vector<std::string> files_;
+    Reactor notify_;
+};
+
+TEST_F(DirCache, ListsWithoutThread)
+{
+    create("b.txt");
+    create("a.txt");
+
+    Dir_Cache_Status status;
+    const Name_Index *index = dir_cache_acquire(dir_.c_str(), &status);
+
+    ASSERT_EQ(status, DIR_CACHE_READY);
+    ASSERT_EQ(index->count, 2);
+    EXPECT_STREQ(index->names[0], "a.txt");
+    EXPECT_STREQ(index->names[1], "b.txt");
+
+    dir_cache_release();
+}
+
+TEST_F(DirCache, ListsInBackground)
+{
+    create("notes.txt");
+    create("avatar.png");
+
+    ASSERT_EQ(dir_cache_start(&notify_), 0);
+
+    EXPECT_EQ(wait_for_names(), (std::vector<std::string> {"avatar.png", "notes.txt"}));
+    EXPECT_FALSE(dir_cache_is_loading(dir_.c_str()));
+}
+
+#ifdef __linux__
+TEST_F(DirCache, ListsAgainAfterChange)
+{
+    create("one");
+
+    ASSERT_EQ(dir_cache_start(&notify_), 0);
+    ASSERT_EQ(wait_for_names(), (std::vector<std::string> {"one"}));
+
+    create("two");
+
+    /* the listing is up to date once the change has been noticed */
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    std::vector<std::string> names;
+
+    while (names.size() != 2 && std::chrono::steady_clock::now() < deadline) {
+        names = wait_for_names();
+    }
+
+    EXPECT_EQ(names, (std::vector<std::string> {"one", "two"}));
+}
+#endif /* __linux__ */
+
+TEST_F(DirCache, MissingDirectory)
+{
+    const std::string missing = dir_ + "missing/";
+
+    Dir_Cache_Status status;
+    EXPECT_EQ(dir_cache_acquire(missing.c_str(), &status), nullptr);
+    EXPECT_EQ(status, DIR_CACHE_ERROR);
+}
+
+TEST(DirCacheFuzzy, Matches)
+{
+    EXPECT_GE(dir_cache_fuzzy_score("abc", "abc"), 0);
+    EXPECT_GE(dir_cache_fuzzy_score("abc", "a_big_cat"), 0);
+    EXPECT_GE(dir_cache_fuzzy_score("ABC", "abc"), 0);
+    EXPECT_GE(dir_cache_fuzzy_score("", "abc"), 0);
+
+    EXPECT_EQ(dir_cache_fuzzy_score("abc", "acb"), -1);
+    EXPECT_EQ(dir_cache_fuzzy_score("abcd", "abc"), -1);
+    EXPECT_EQ(dir_cache_fuzzy_score("x", ""), -1);
+}
+
+TEST(DirCacheFuzzy, Ranking)
+{
+    /* consecutive characters beat scattered ones */
+    EXPECT_GT(dir_cache_fuzzy_score("rep", "report.pdf"), dir_cache_fuzzy_score("rep", "recipe.txt"));
+
+    /* the start of each word counts */
+    EXPECT_GT(dir_cache_fuzzy_score("mp", "my_photo.jpg"), dir_cache_fuzzy_score("mp", "lamp.jpg"));
+
+    /* shorter names win ties */
+    EXPECT_GT(dir_cache_fuzzy_score("toxic", "toxic"), dir_cache_fuzzy_score("toxic", "toxic-0.16.1.tar.gz"));
+}
+
+}  // namespace
@@ -0,0 +1,702 @@
+/*  dir_transfers.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "dir_transfers.h"
+#include "execute.h"
+#include "friendlist.h"
+#include "line_info.h"
+#include "misc_tools.h"
+#include "notify.h"
+#include "transfer_manifest.h"
+
+static void dir_transfer_clear(DirTransfer *dir)
+{
+    dir_walk_close(dir->walk);
+
+    for (size_t i = 0; i < dir->num_entries; ++i) {
+        free(dir->entries[i].path);
+    }
+
+    free(dir->entries);
+
+    *dir = (DirTransfer) {
+        0
+    };
+}
+
+static DirTransfer *get_dir_transfer(FriendsList *friends, const FileTransfer *ft)
+{
+    ToxicFriend *friend = &friends->list[ft->friendnumber];
+
+    return ft->direction == FILE_TRANSFER_SEND ? &friend->dir_send : &friend->dir_recv;
+}
+
+/* Sends a manifest packet to `friendnumber`.
+ *
+ * Return 0 on success.
+ * Return 1 if toxcore's send queue is full.
+ * Return -1 on failure.
+ */
+static int dir_transfer_send_packet(const Toxic *toxic, uint32_t friendnumber, const struct manifest_packet *packet)
+{
+    uint8_t buf[TOX_MAX_CUSTOM_PACKET_SIZE];
+    buf[0] = CUSTOM_PACKET_FILE_MANIFEST;
+
+    const int length = manifest_packet_pack(packet, buf + 1, sizeof(buf) - 1);
+
+    if (length < 0) {
+        return -1;
+    }
+
+    Tox_Err_Friend_Custom_Packet err;
+
+    if (!tox_friend_send_lossless_packet(toxic->tox, friendnumber, buf, length + 1, &err)) {
+        return err == TOX_ERR_FRIEND_CUSTOM_PACKET_SENDQ ? 1 : -1;
+    }
+
+    return 0;
+}
+
+/* Returns the number of bytes of `dir` that have been transferred, including its files in progress. */
+static uint64_t dir_transfer_bytes(const DirTransfer *dir, const FileTransferTable *table)
+{
+    uint64_t transferred = dir->bytes_done;
+
+    for (size_t i = 0; i < table->size; ++i) {
+        const FileTransfer *ft = table->transfers[i];
+
+        if (ft->state != FILE_TRANSFER_INACTIVE && ft->dir_id == dir->id) {
+            transferred += ft->position;
+        }
+    }
+
+    return transferred;
+}
+
+static size_t dir_transfer_get_stat(DirTransfer *dir, bool sending, const FileTransferTable *table,
+                                    struct transfer_stat *stats, size_t max, size_t count, uint64_t now)
+{
+    if (!dir->active || dir->num_files == 0) {
+        return count;
+    }
+
+    const uint64_t transferred = dir_transfer_bytes(dir, table);
+    const double bps = transfer_rate_sample(&dir->rate, transferred, now);
+
+    if (count < max) {
+        /* the directory's size is only known once every file has been offered */
+        uint64_t size = 0;
+
+        if (dir->ended) {
+            size = dir->bytes_expected > 0 ? dir->bytes_expected : dir->bytes_offered;
+        }
+
+        stats[count] = (struct transfer_stat) {
+            .name = dir->name,
+            .position = transferred,
+            .size = size,
+            .bps = bps,
+            .id = -1,
+            .flags = TRANSFER_STAT_DIRECTORY | (sending ? TRANSFER_STAT_SENDING : 0),
+        };
+    }
+
+    return count + 1;
+}
+
+size_t dir_transfers_get_stats(FriendsList *friends, uint32_t friendnumber, struct transfer_stat *stats, size_t max,
+                               uint64_t now)
+{
+    if (friends == NULL) {
+        return 0;
+    }
+
+    ToxicFriend *friend = &friends->list[friendnumber];
+
+    size_t count = dir_transfer_get_stat(&friend->dir_recv, false, &friend->file_receiver, stats, max, 0, now);
+    count = dir_transfer_get_stat(&friend->dir_send, true, &friend->file_sender, stats, max, count, now);
+
+    return count;
+}
+
+/* Tells the user that `dir` has finished and stops it. */
+static void dir_transfer_finish(ToxWindow *self, const Toxic *toxic, DirTransfer *dir, bool sending)
+{
+    if (self != NULL) {
+        char sizestr[32];
+        bytes_convert_str(sizestr, sizeof(sizestr), dir->bytes_done);
+
+        line_info_add(self, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Directory '%s' %s: %u files (%s).",
+                      dir->name, sending ? "sent" : "received", dir->num_done, sizestr);
+
+        if (dir->num_failed > 0 || dir->num_skipped > 0) {
+            line_info_add(self, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                          "%u files failed and %u were skipped because they were empty, unreadable or invalid.",
+                          dir->num_failed, dir->num_skipped);
+        }
+
+        sound_notify(self, toxic, transfer_completed, NT_NOFOCUS | NT_WNDALERT_2, NULL);
+    }
+
+    dir_transfer_clear(dir);
+}
+
+int dir_send_start(ToxWindow *self, Toxic *toxic, const char *path)
+{
+    DirTransfer *dir = &toxic->friends->list[self->num].dir_send;
+
+    if (dir->active) {
+        return -1;
+    }
+
+    char name[TOX_MAX_FILENAME_LENGTH + 1];
+    const int name_len = get_file_name(name, sizeof(name), path);
+
+    if (name_len <= 0 || !manifest_path_is_valid(name, name_len)) {
+        return -3;
+    }
+
+    struct dir_walk *walk = dir_walk_open(path);
+
+    if (walk == NULL) {
+        return -2;
+    }
+
+    dir_transfer_clear(dir);
+
+    uint32_t id;
+
+    do {
+        id = rand_not_secure();
+    } while (id == 0);
+
+    dir->active = true;
+    dir->id = id;
+    dir->walk = walk;
+    snprintf(dir->name, sizeof(dir->name), "%s", name);
+
+    return 0;
+}
+
+/* Makes a file_id for the next file offered from `dir`. The directory's id and the file's sequence number
+ * keep it unique among the directory's files.
+ */
+static void dir_send_make_file_id(const DirTransfer *dir, uint8_t *file_id)
+{
+    const uint32_t seq = dir->num_files + dir->num_skipped;
+
+    for (size_t i = 0; i < TOX_FILE_ID_LENGTH; ++i) {
+        file_id[i] = (uint8_t) rand_not_secure();
+    }
+
+    for (size_t i = 0; i < 4; ++i) {
+        file_id[i] = (uint8_t)(dir->id >> (8 * (3 - i)));
+        file_id[4 + i] = (uint8_t)(seq >> (8 * (3 - i)));
+    }
+}
+
+/* Offers the file that `dir`'s walk is on to `friendnumber`, after sending its manifest entry.
+ *
+ * Return 0 if the file was offered.
+ * Return 1 if it should be tried again later.
+ * Return -1 if it can't be offered.
+ */
+static int dir_send_file(ToxWindow *self, Toxic *toxic, DirTransfer *dir, uint32_t friendnumber)
+{
+    const char *relative = dir->next_relative;
+    const char *file_name = strrchr(relative, '/');
+    file_name = file_name != NULL ? file_name + 1 : relative;
+
+    const size_t name_len = strlen(file_name);
+
+    if (name_len > TOX_MAX_FILENAME_LENGTH) {
+        return -1;
+    }
+
+    struct manifest_packet packet = {
+        .type = MANIFEST_PACKET_ENTRY,
+        .id = dir->id,
+        .size = dir->next_size,
+        .name = relative,
+        .name_length = strlen(relative),
+    };
+
+    dir_send_make_file_id(dir, packet.file_id);
+
+    FILE *file = fopen(dir->next_path, "r");
+
+    if (file == NULL) {
+        return -1;
+    }
+
+    const int ret = dir_transfer_send_packet(toxic, friendnumber, &packet);
+
+    if (ret != 0) {
+        fclose(file);
+        return ret;
+    }
+
+    Tox_Err_File_Send err;
+    const uint32_t filenum = tox_file_send(toxic->tox, friendnumber, TOX_FILE_KIND_DATA, dir->next_size, packet.file_id,
+                                           (const uint8_t *) file_name, name_len, &err);
+
+    if (err != TOX_ERR_FILE_SEND_OK) {
+        fclose(file);
+        return err == TOX_ERR_FILE_SEND_TOO_MANY ? 1 : -1;
+    }
+
+    FileTransfer *ft = new_file_transfer(toxic->friends, self, friendnumber, filenum, FILE_TRANSFER_SEND,
+                                         TOX_FILE_KIND_DATA);
+
+    if (ft == NULL) {
+        tox_file_control(toxic->tox, friendnumber, filenum, TOX_FILE_CONTROL_CANCEL, NULL);
+        fclose(file);
+        return -1;
+    }
+
+    snprintf(ft->file_name, sizeof(ft->file_name), "%s", file_name);
+    memcpy(ft->file_id, packet.file_id, TOX_FILE_ID_LENGTH);
+    ft->file = file;
+    ft->file_size = dir->next_size;
+    ft->dir_id = dir->id;
+
+    ++dir->num_files;
+    dir->bytes_offered += dir->next_size;
+
+    ft->reader = file_reader_open(fileno(file), ft->file_size);
+
+    if (ft->reader == NULL) {
+        close_file_transfer(NULL, toxic, ft, TOX_FILE_CONTROL_CANCEL, NULL, silent);
+    }
+
+    return 0;
+}
+
+void dir_send_schedule(ToxWindow *self, Toxic *toxic, uint32_t friendnumber)
+{
+    if (toxic == NULL || self == NULL) {
+        return;
+    }
+
+    ToxicFriend *friend = &toxic->friends->list[friendnumber];
+    DirTransfer *dir = &friend->dir_send;
+
+    if (!dir->active || friend->connection_status == TOX_CONNECTION_NONE) {
+        return;
+    }
+
+    if (!dir->announced) {
+        const struct manifest_packet packet = {
+            .type = MANIFEST_PACKET_BEGIN,
+            .id = dir->id,
+            .name = dir->name,
+            .name_length = strlen(dir->name),
+        };
+
+        if (dir_transfer_send_packet(toxic, friendnumber, &packet) != 0) {
+            return;
+        }
+
+        dir->announced = true;
+    }
+
+    while (dir->walk != NULL && file_transfer_num_active_sends(toxic->friends, friendnumber) < MAX_ACTIVE_FILE_SENDS) {
+        if (!dir->have_next) {
+            if (dir_walk_next(dir->walk, &dir->next_path, &dir->next_relative, &dir->next_size) == 0) {
+                dir->num_skipped += dir_walk_num_skipped(dir->walk);
+                dir_walk_close(dir->walk);
+                dir->walk = NULL;
+                break;
+            }
+
+            dir->have_next = true;
+        }
+
+        /* there's nothing to transfer, and toxcore doesn't start transfers of empty files */
+        if (dir->next_size == 0) {
+            ++dir->num_skipped;
+            dir->have_next = false;
+            continue;
+        }
+
+        const int ret = dir_send_file(self, toxic, dir, friendnumber);
+
+        if (ret == 1) {
+            return;
+        }
+
+        if (ret == -1) {
+            line_info_add(self, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Failed to send '%s'.",
+                          dir->next_relative);
+            ++dir->num_skipped;
+        }
+
+        dir->have_next = false;
+    }
+
+    if (dir->walk != NULL) {
+        return;
+    }
+
+    if (!dir->ended) {
+        const struct manifest_packet packet = {
+            .type = MANIFEST_PACKET_END,
+            .id = dir->id,
+            .count = dir->num_files,
+            .size = dir->bytes_offered,
+        };
+
+        if (dir_transfer_send_packet(toxic, friendnumber, &packet) != 0) {
+            return;
+        }
+
+        dir->ended = true;
+    }
+
+    if (dir->num_done + dir->num_failed >= dir->num_files) {
+        dir_transfer_finish(self, toxic, dir, true);
+    }
+}
+
+/* Tells the user about the directory being received. */
+static void dir_recv_announce(ToxWindow *self, Toxic *toxic, DirTransfer *dir)
+{
+    const Client_Config *c_config = toxic->c_config;
+
+    dir->announced = true;
+
+    if (dir->accepted) {
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                      "Receiving directory '%s'. Its files will be saved to '%s%s' as they arrive.", dir->name,
+                      c_config->download_path, dir->name);
+        return;
+    }
+
+    if (self->active_box != -1) {
+        box_notify2(self, toxic, transfer_pending, NT_WNDALERT_0 | NT_NOFOCUS | c_config->bell_on_filetrans,
+                    self->active_box, "Incoming directory: %s", dir->name);
+    } else {
+        box_notify(self, toxic, transfer_pending, NT_WNDALERT_0 | NT_NOFOCUS | c_config->bell_on_filetrans,
+                   &self->active_box, self->name, "Incoming directory: %s", dir->name);
+    }
+
+    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                  "Incoming directory: '%s'. Type '/savefile -r' to accept it.", dir->name);
+}
+
+/* Finishes the directory being received once every file in it has been offered and closed. */
+static void dir_recv_check_finished(ToxWindow *self, const Toxic *toxic, DirTransfer *dir)
+{
+    if (dir->active && dir->ended && dir->num_done + dir->num_failed >= dir->num_files) {
+        dir_transfer_finish(self, toxic, dir, false);
+    }
+}
+
+static ToxWindow *get_friend_window(const Toxic *toxic, uint32_t friendnumber)
+{
+    const int window_id = toxic->friends->list[friendnumber].window_id;
+
+    if (window_id < 0) {
+        return NULL;
+    }
+
+    return get_window_pointer_by_id(toxic->windows, window_id);
+}
+
+static void dir_recv_begin(Toxic *toxic, uint32_t friendnumber, const struct manifest_packet *packet)
+{
+    if (packet->name_length > TOX_MAX_FILENAME_LENGTH || memchr(packet->name, '/', packet->name_length) != NULL
+            || !manifest_path_is_valid(packet->name, packet->name_length)) {
+        fprintf(stderr, "Got directory manifest with invalid name\n");
+        return;
+    }
+
+    const Client_Config *c_config = toxic->c_config;
+    DirTransfer *dir = &toxic->friends->list[friendnumber].dir_recv;
+
+    dir_transfer_clear(dir);
+
+    dir->active = true;
+    dir->id = packet->id;
+    dir->accepted = friend_get_auto_accept_files(toxic->friends, friendnumber);
+
+    /* save it next to any directory with the same name rather than inside it */
+    char name[TOX_MAX_FILENAME_LENGTH + 1];
+    snprintf(name, sizeof(name), "%.*s", (int) packet->name_length, packet->name);
+    snprintf(dir->name, sizeof(dir->name), "%s", name);
+
+    for (int count = 1; count < 100; ++count) {
+        char path[TOXIC_MAX_PATH_LENGTH];
+        snprintf(path, sizeof(path), "%s%s", c_config->download_path, dir->name);
+
+        struct stat st;
+
+        if (stat(path, &st) != 0) {
+            break;
+        }
+
+        char suffix[8];
+        snprintf(suffix, sizeof(suffix), "(%d)", count);
+
+        if (strlen(name) + strlen(suffix) >= sizeof(dir->name)) {
+            break;
+        }
+
+        snprintf(dir->name, sizeof(dir->name), "%s%s", name, suffix);
+    }
+
+    ToxWindow *window = get_friend_window(toxic, friendnumber);
+
+    /* without a chat window, the user is told when the first file arrives and opens one */
+    if (window != NULL) {
+        dir_recv_announce(window, toxic, dir);
+    }
+}
+
+static void dir_recv_entry(Toxic *toxic, uint32_t friendnumber, const struct manifest_packet *packet)
+{
+    DirTransfer *dir = &toxic->friends->list[friendnumber].dir_recv;
+
+    if (!dir->active || dir->id != packet->id || dir->ended) {
+        return;
+    }
+
+    if (packet->name_length >= TOXIC_MAX_PATH_LENGTH || !manifest_path_is_valid(packet->name, packet->name_length)
+            || dir->num_entries >= MAX_FILE_TRANSFERS) {
+        ++dir->num_skipped;
+        return;
+    }
+
+    char *path = malloc(packet->name_length + 1);
+
+    if (path == NULL) {
+        ++dir->num_skipped;
+        return;
+    }
+
+    DirTransferEntry *entries = realloc(dir->entries, (dir->num_entries + 1) * sizeof(DirTransferEntry));
+
+    if (entries == NULL) {
+        free(path);
+        ++dir->num_skipped;
+        return;
+    }
+
+    memcpy(path, packet->name, packet->name_length);
+    path[packet->name_length] = '\0';
+
+    dir->entries = entries;
+    dir->entries[dir->num_entries].path = path;
+    memcpy(dir->entries[dir->num_entries].file_id, packet->file_id, TOX_FILE_ID_LENGTH);
+    ++dir->num_entries;
+}
+
+static void dir_recv_end(Toxic *toxic, uint32_t friendnumber, const struct manifest_packet *packet)
+{
+    DirTransfer *dir = &toxic->friends->list[friendnumber].dir_recv;
+
+    if (!dir->active || dir->id != packet->id) {
+        return;
+    }
+
+    dir->ended = true;
+    dir->num_expected = packet->count;
+    dir->bytes_expected = packet->size;
+
+    /* every transfer has been offered by now, so entries that weren't matched never will be */
+    for (size_t i = 0; i < dir->num_entries; ++i) {
+        free(dir->entries[i].path);
+    }
+
+    free(dir->entries);
+    dir->entries = NULL;
+    dir->num_entries = 0;
+
+    dir_recv_check_finished(get_friend_window(toxic, friendnumber), toxic, dir);
+}
+
+void dir_transfers_on_packet(Toxic *toxic, uint32_t friendnumber, const uint8_t *data, size_t length)
+{
+    if (toxic == NULL || friendnumber >= toxic->friends->max_idx || !toxic->friends->list[friendnumber].active) {
+        return;
+    }
+
+    struct manifest_packet packet;
+
+    if (manifest_packet_unpack(data, length, &packet) != 0) {
+        fprintf(stderr, "Got invalid directory manifest packet\n");
+        return;
+    }
+
+    switch (packet.type) {
+        case MANIFEST_PACKET_BEGIN: {
+            dir_recv_begin(toxic, friendnumber, &packet);
+            break;
+        }
+
+        case MANIFEST_PACKET_ENTRY: {
+            dir_recv_entry(toxic, friendnumber, &packet);
+            break;
+        }
+
+        case MANIFEST_PACKET_END: {
+            dir_recv_end(toxic, friendnumber, &packet);
+            break;
+        }
+    }
+}
+
+int dir_recv_match(ToxWindow *self, Toxic *toxic, FileTransfer *ft, char *path, size_t size)
+{
+    if (toxic == NULL || self == NULL) {
+        return -1;
+    }
+
+    DirTransfer *dir = &toxic->friends->list[ft->friendnumber].dir_recv;
+
+    for (size_t i = 0; dir->active && i < dir->num_entries; ++i) {
+        DirTransferEntry *entry = &dir->entries[i];
+
+        if (memcmp(entry->file_id, ft->file_id, TOX_FILE_ID_LENGTH) != 0) {
+            continue;
+        }
+
+        const int length = snprintf(path, size, "%s/%s", dir->name, entry->path);
+
+        free(entry->path);
+        dir->entries[i] = dir->entries[dir->num_entries - 1];
+        --dir->num_entries;
+
+        if (length < 0 || (size_t) length >= size) {
+            ++dir->num_skipped;
+            return -1;
+        }
+
+        ft->dir_id = dir->id;
+        ++dir->num_files;
+        dir->bytes_offered += ft->file_size;
+
+        if (!dir->announced) {
+            dir_recv_announce(self, toxic, dir);
+        }
+
+        return length;
+    }
+
+    return -1;
+}
+
+bool dir_recv_is_accepted(const FriendsList *friends, const FileTransfer *ft)
+{
+    if (friends == NULL || ft->dir_id == 0) {
+        return false;
+    }
+
+    const DirTransfer *dir = &friends->list[ft->friendnumber].dir_recv;
+
+    return dir->active && dir->id == ft->dir_id && dir->accepted;
+}
+
+int dir_recv_accept(ToxWindow *self, Toxic *toxic)
+{
+    if (toxic == NULL || self == NULL) {
+        return -1;
+    }
+
+    ToxicFriend *friend = &toxic->friends->list[self->num];
+    DirTransfer *dir = &friend->dir_recv;
+
+    if (!dir->active) {
+        return -1;
+    }
+
+    dir->accepted = true;
+
+    line_info_add(self, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                  "Accepted directory '%s'. Its files will be saved to '%s%s' as they arrive.", dir->name,
+                  toxic->c_config->download_path, dir->name);
+
+    const FileTransferTable *receivers = &friend->file_receiver;
+
+    for (size_t i = 0; i < receivers->size; ++i) {
+        const FileTransfer *ft = receivers->transfers[i];
+
+        if (ft->state != FILE_TRANSFER_PENDING || ft->dir_id != dir->id || ft->writer != NULL) {
+            continue;
+        }
+
+        char cmd[MAX_STR_SIZE];
+        snprintf(cmd, sizeof(cmd), "/savefile %zu", ft->index);
+        execute(self->window, self, toxic, cmd, CHAT_COMMAND_MODE);
+    }
+
+    return 0;
+}
+
+int dir_recv_create_parents(const FileTransfer *ft)
+{
+    if (ft->dir_id == 0) {
+        return 0;
+    }
+
+    char path[TOXIC_MAX_PATH_LENGTH + 1];
+    snprintf(path, sizeof(path), "%s", ft->file_path);
+
+    for (char *p = strchr(path + 1, '/'); p != NULL; p = strchr(p + 1, '/')) {
+        *p = '\0';
+
+        if (mkdir(path, S_IRWXU | S_IRWXG | S_IRWXO) != 0 && errno != EEXIST) {
+            return -1;
+        }
+
+        *p = '/';
+    }
+
+    return 0;
+}
+
+void dir_transfers_on_file_closed(const Toxic *toxic, const FileTransfer *ft)
+{
+    if (toxic == NULL || ft->dir_id == 0 || ft->state == FILE_TRANSFER_INACTIVE) {
+        return;
+    }
+
+    DirTransfer *dir = get_dir_transfer(toxic->friends, ft);
+
+    if (!dir->active || dir->id != ft->dir_id) {
+        return;
+    }
+
+    if (ft->position >= ft->file_size) {
+        ++dir->num_done;
+    } else {
+        ++dir->num_failed;
+    }
+
+    dir->bytes_done += ft->position;
+
+    /* a directory being sent is finished by dir_send_schedule() */
+    if (ft->direction == FILE_TRANSFER_RECV) {
+        dir_recv_check_finished(ft->window, toxic, dir);
+    }
+}
+
+void dir_transfers_free_friend(FriendsList *friends, uint32_t friendnumber)
+{
+    if (friends == NULL) {
+        return;
+    }
+
+    dir_transfer_clear(&friends->list[friendnumber].dir_send);
+    dir_transfer_clear(&friends->list[friendnumber].dir_recv);
+}
@@ -0,0 +1,124 @@
+/*  dir_transfers.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef DIR_TRANSFERS_H
+#define DIR_TRANSFERS_H
+
+#include <time.h>
+
+#include "dir_walk.h"
+#include "file_transfers.h"
+#include "toxic.h"
+#include "transfer_stats.h"
+#include "windows.h"
+
+/* A file in a directory being received whose transfer hasn't been offered yet */
+typedef struct DirTransferEntry {
+    uint8_t file_id[TOX_FILE_ID_LENGTH];
+    char    *path;    /* relative to the directory */
+} DirTransferEntry;
+
+/*
+ * A directory being sent to or received from a friend. Its files are sent as ordinary file transfers, each
+ * of which has the directory's id as its dir_id, and the directory's manifest is streamed alongside them in
+ * custom packets so that the receiver can put each file in its place.
+ */
+typedef struct DirTransfer {
+    bool     active;
+    uint32_t id;
+    char     name[TOX_MAX_FILENAME_LENGTH + 1];   /* the directory's name (for receivers, the name it's saved as) */
+
+    struct dir_walk *walk;      /* Only used by senders: NULL once every file has been offered */
+    bool     have_next;         /* Only used by senders: the walk's current file is waiting to be offered */
+    const char *next_path;      /* Only used by senders */
+    const char *next_relative;  /* Only used by senders */
+    uint64_t next_size;         /* Only used by senders */
+
+    DirTransferEntry *entries;  /* Only used by receivers */
+    size_t   num_entries;       /* Only used by receivers */
+    bool     accepted;          /* Only used by receivers: files are accepted as they're offered */
+
+    bool     announced;         /* senders: the BEGIN packet has been sent. receivers: the user has been told */
+    bool     ended;             /* every file has been offered */
+    uint32_t num_files;         /* number of files whose transfers have been offered */
+    uint32_t num_done;          /* number of files that have been transferred in full */
+    uint32_t num_failed;        /* number of files whose transfers were closed before they finished */
+    uint32_t num_skipped;       /* number of files that couldn't be offered */
+    uint32_t num_expected;      /* Only used by receivers: the number of files in the directory, once ended */
+    uint64_t bytes_offered;     /* total size of the files that have been offered */
+    uint64_t bytes_expected;    /* Only used by receivers: the size of the directory, once ended */
+    uint64_t bytes_done;        /* number of bytes transferred by files that are no longer in progress */
+
+    struct transfer_rate rate;  /* Sampled by dir_transfers_get_stats() */
+} DirTransfer;
+
+/* Starts sending the directory at `path` to the friend of the chat window `self`. Its files are walked and
+ * offered a few at a time by dir_send_schedule() once the friend is online.
+ *
+ * Return 0 on success.
+ * Return -1 if a directory is already being sent to the friend.
+ * Return -2 if the directory can't be opened.
+ * Return -3 if the directory's name is invalid.
+ */
+int dir_send_start(ToxWindow *self, Toxic *toxic, const char *path);
+
+/* Offers the next files of the directory being sent to `friendnumber`, for as long as they have room for
+ * more outgoing file transfers, and finishes the directory once every file has been transferred.
+ */
+void dir_send_schedule(ToxWindow *self, Toxic *toxic, uint32_t friendnumber);
+
+/* Handles a directory manifest packet from `friendnumber`. */
+void dir_transfers_on_packet(Toxic *toxic, uint32_t friendnumber, const uint8_t *data, size_t length);
+
+/* Checks whether the incoming file transfer `ft` is for a file in the directory being received from its
+ * friend. If it is, `ft` is added to the directory, and the path the file should be saved to, relative to
+ * the download directory, is put in `path`.
+ *
+ * `ft`'s file_id must be set.
+ *
+ * Return the length of the path if `ft` is part of a directory.
+ * Return -1 otherwise.
+ */
+int dir_recv_match(ToxWindow *self, Toxic *toxic, struct FileTransfer *ft, char *path, size_t size);
+
+/* Returns true if `ft` is part of a directory the user has accepted. */
+bool dir_recv_is_accepted(const FriendsList *friends, const struct FileTransfer *ft);
+
+/* Accepts the directory being received from the friend of the chat window `self`, along with any of its
+ * files that are waiting to be accepted.
+ *
+ * Return 0 on success.
+ * Return -1 if no directory is being received.
+ */
+int dir_recv_accept(ToxWindow *self, Toxic *toxic);
+
+/* Creates the directories that the file of the incoming file transfer `ft` is saved in, if it's part of a
+ * directory.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int dir_recv_create_parents(const struct FileTransfer *ft);
+
+/* Adds the file transfer `ft`, which is about to be closed, to the totals of its directory. */
+void dir_transfers_on_file_closed(const Toxic *toxic, const struct FileTransfer *ft);
+
+/* Puts a snapshot of each directory being transferred with `friendnumber` in `stats`, up to `max` of them,
+ * and samples their rates at time `now` (see transfer_stats_now()).
+ *
+ * Return the number of directories being transferred, which may be more than `max`.
+ */
+size_t dir_transfers_get_stats(FriendsList *friends, uint32_t friendnumber, struct transfer_stat *stats, size_t max,
+                               uint64_t now);
+
+/* Stops the directory transfers with `friendnumber` without telling them, and frees their memory. Transfers
+ * of their files that are still open are left to the caller, and no longer count towards them.
+ */
+void dir_transfers_free_friend(FriendsList *friends, uint32_t friendnumber);
+
+#endif /* DIR_TRANSFERS_H */
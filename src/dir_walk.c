@@ -0,0 +1,166 @@
+/*  dir_walk.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "dir_walk.h"
+#include "toxic_constants.h"
+
+struct dir_walk_frame {
+    DIR *dir;
+    size_t path_len;    /* length of the directory's path in the walk's path buffer */
+};
+
+struct dir_walk {
+    struct dir_walk_frame frames[DIR_WALK_MAX_DEPTH + 1];
+    size_t depth;       /* number of open frames */
+    size_t root_len;
+    size_t skipped;
+    char path[TOXIC_MAX_PATH_LENGTH];
+};
+
+/* Opens the directory whose path is in the walk's path buffer and pushes it on the stack.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+static int dir_walk_push(struct dir_walk *walk, size_t path_len)
+{
+    if (walk->depth > DIR_WALK_MAX_DEPTH) {
+        return -1;
+    }
+
+    DIR *dir = opendir(walk->path);
+
+    if (dir == NULL) {
+        return -1;
+    }
+
+    walk->frames[walk->depth] = (struct dir_walk_frame) {
+        .dir = dir,
+        .path_len = path_len,
+    };
+
+    ++walk->depth;
+
+    return 0;
+}
+
+static void dir_walk_pop(struct dir_walk *walk)
+{
+    --walk->depth;
+    closedir(walk->frames[walk->depth].dir);
+}
+
+struct dir_walk *dir_walk_open(const char *root)
+{
+    size_t root_len = strlen(root);
+
+    /* "dir/" and "dir" are the same root */
+    while (root_len > 1 && root[root_len - 1] == '/') {
+        --root_len;
+    }
+
+    if (root_len == 0 || root_len >= TOXIC_MAX_PATH_LENGTH) {
+        return NULL;
+    }
+
+    struct dir_walk *walk = calloc(1, sizeof(struct dir_walk));
+
+    if (walk == NULL) {
+        return NULL;
+    }
+
+    memcpy(walk->path, root, root_len);
+    walk->path[root_len] = '\0';
+    walk->root_len = root_len;
+
+    if (dir_walk_push(walk, root_len) != 0) {
+        free(walk);
+        return NULL;
+    }
+
+    return walk;
+}
+
+int dir_walk_next(struct dir_walk *walk, const char **path, const char **relative, uint64_t *size)
+{
+    while (walk->depth > 0) {
+        struct dir_walk_frame *frame = &walk->frames[walk->depth - 1];
+        const struct dirent *entry = readdir(frame->dir);
+
+        if (entry == NULL) {
+            dir_walk_pop(walk);
+            continue;
+        }
+
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        const size_t name_len = strlen(entry->d_name);
+        const size_t path_len = frame->path_len + 1 + name_len;
+
+        if (path_len >= sizeof(walk->path)) {
+            ++walk->skipped;
+            continue;
+        }
+
+        walk->path[frame->path_len] = '/';
+        memcpy(walk->path + frame->path_len + 1, entry->d_name, name_len + 1);
+
+        struct stat st;
+
+        if (lstat(walk->path, &st) != 0) {
+            ++walk->skipped;
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            if (dir_walk_push(walk, path_len) != 0) {
+                ++walk->skipped;
+            }
+
+            continue;
+        }
+
+        if (!S_ISREG(st.st_mode)) {
+            ++walk->skipped;
+            continue;
+        }
+
+        *path = walk->path;
+        *relative = walk->path + walk->root_len + 1;
+        *size = (uint64_t) st.st_size;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+size_t dir_walk_num_skipped(const struct dir_walk *walk)
+{
+    return walk->skipped;
+}
+
+void dir_walk_close(struct dir_walk *walk)
+{
+    if (walk == NULL) {
+        return;
+    }
+
+    while (walk->depth > 0) {
+        dir_walk_pop(walk);
+    }
+
+    free(walk);
+}
@@ -0,0 +1,58 @@
+/*  dir_walk.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef DIR_WALK_H
+#define DIR_WALK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Maximum number of directories below the root that are descended into. Each level keeps a directory open. */
+#define DIR_WALK_MAX_DEPTH 32
+
+/*
+ * Depth-first walk of the regular files in a directory tree, one file at a time.
+ *
+ * Only the directories on the path from the root to the current file are held open, so memory use depends
+ * on the depth of the tree rather than on how many files it has. Symbolic links and special files are
+ * skipped, as are directories nested deeper than DIR_WALK_MAX_DEPTH and paths that are too long.
+ */
+struct dir_walk;
+
+/* Starts a walk of the directory `root`.
+ *
+ * Returns NULL on failure.
+ */
+struct dir_walk *dir_walk_open(const char *root);
+
+/* Finds the next regular file in the walk. On success `path` is set to its full path, `relative` to its path
+ * relative to the root, and `size` to its size. The strings stay valid until the walk is next used.
+ *
+ * Return 1 if a file was found.
+ * Return 0 if every file has been found.
+ */
+int dir_walk_next(struct dir_walk *walk, const char **path, const char **relative, uint64_t *size);
+
+/* Returns the number of entries that the walk has skipped because they weren't regular files or
+ * directories, couldn't be read, were too deep or their path was too long.
+ */
+size_t dir_walk_num_skipped(const struct dir_walk *walk);
+
+/* Ends the walk and frees `walk`. */
+void dir_walk_close(struct dir_walk *walk);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* DIR_WALK_H */
@@ -0,0 +1,141 @@
+#include "dir_walk.h"
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+class DirWalk : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        std::snprintf(root_, sizeof(root_), "%s/toxic_dir_walk_test_XXXXXX", testing::TempDir().c_str());
+        ASSERT_NE(mkdtemp(root_), nullptr);
+    }
+
+    void TearDown() override
+    {
+        const std::string command = std::string("rm -rf '") + root_ + "'";
+        ASSERT_EQ(std::system(command.c_str()), 0);
+    }
+
+    void make_dir(const std::string &relative)
+    {
+        ASSERT_EQ(mkdir((std::string(root_) + "/" + relative).c_str(), 0700), 0);
+    }
+
+    void make_file(const std::string &relative, size_t size)
+    {
+        FILE *fp = std::fopen((std::string(root_) + "/" + relative).c_str(), "w");
+        ASSERT_NE(fp, nullptr);
+
+        for (size_t i = 0; i < size; ++i) {
+            std::fputc('x', fp);
+        }
+
+        std::fclose(fp);
+    }
+
+    /* Walks `root` and returns the size of each file found, by relative path. */
+    std::map<std::string, uint64_t> walk_all(const std::string &root, size_t *skipped = nullptr)
+    {
+        std::map<std::string, uint64_t> found;
+        struct dir_walk *walk = dir_walk_open(root.c_str());
+        EXPECT_NE(walk, nullptr);
+
+        if (walk == nullptr) {
+            return found;
+        }
+
+        const char *path;
+        const char *relative;
+        uint64_t size;
+
+        while (dir_walk_next(walk, &path, &relative, &size) == 1) {
+            EXPECT_EQ(std::string(path), std::string(root_) + "/" + relative);
+            EXPECT_TRUE(found.emplace(relative, size).second) << relative;
+        }
+
+        if (skipped != nullptr) {
+            *skipped = dir_walk_num_skipped(walk);
+        }
+
+        dir_walk_close(walk);
+
+        return found;
+    }
+
+    char root_[PATH_MAX];
+};
+
+TEST_F(DirWalk, FindsEveryFile)
+{
+    make_file("a", 1);
+    make_dir("sub");
+    make_file("sub/b", 20);
+    make_dir("sub/deeper");
+    make_file("sub/deeper/c", 0);
+    make_dir("empty");
+
+    const std::map<std::string, uint64_t> expected = {
+        {"a", 1},
+        {"sub/b", 20},
+        {"sub/deeper/c", 0},
+    };
+
+    EXPECT_EQ(walk_all(root_), expected);
+}
+
+TEST_F(DirWalk, TrailingSlash)
+{
+    make_file("a", 3);
+
+    const std::map<std::string, uint64_t> expected = {{"a", 3}};
+    EXPECT_EQ(walk_all(std::string(root_) + "//"), expected);
+}
+
+TEST_F(DirWalk, SkipsSymlinks)
+{
+    make_file("a", 1);
+    make_dir("sub");
+    ASSERT_EQ(symlink(root_, (std::string(root_) + "/sub/loop").c_str()), 0);
+    ASSERT_EQ(symlink("../a", (std::string(root_) + "/sub/link").c_str()), 0);
+
+    size_t skipped = 0;
+    const std::map<std::string, uint64_t> expected = {{"a", 1}};
+    EXPECT_EQ(walk_all(root_, &skipped), expected);
+    EXPECT_EQ(skipped, 2);
+}
+
+TEST_F(DirWalk, DepthIsLimited)
+{
+    std::string relative;
+
+    for (int i = 0; i < DIR_WALK_MAX_DEPTH + 2; ++i) {
+        relative += (i > 0 ? "/d" : "d");
+        make_dir(relative);
+        make_file(relative + "/f", 1);
+    }
+
+    size_t skipped = 0;
+    const std::map<std::string, uint64_t> found = walk_all(root_, &skipped);
+
+    EXPECT_EQ(found.size(), DIR_WALK_MAX_DEPTH);
+    EXPECT_EQ(skipped, 1);
+}
+
+TEST_F(DirWalk, MissingRoot)
+{
+    EXPECT_EQ(dir_walk_open((std::string(root_) + "/missing").c_str()), nullptr);
+    EXPECT_EQ(dir_walk_open(""), nullptr);
+}
+
+}  // namespace
@@ -35,6 +35,7 @@ static struct cmd_func global_commands[] = {
     { "/connect",   cmd_connect       },
     { "/decline",   cmd_decline       },
     { "/exit",      cmd_quit          },
+    { "/frames",    cmd_frames        },
     { "/conference", cmd_conference    },
     { "/group",     cmd_groupchat     },
 #ifdef GAMES
@@ -53,7 +54,9 @@ static struct cmd_func global_commands[] = {
     { "/q",         cmd_quit          },
     { "/quit",      cmd_quit          },
     { "/requests",  cmd_requests      },
+    { "/search",    cmd_search        },
     { "/status",    cmd_status        },
+    { "/wakeups",   cmd_wakeups       },
 #ifdef AUDIO
     { "/lsdev",     cmd_list_devices  },
     { "/sdev",      cmd_change_device },
@@ -150,6 +153,7 @@ static const char special_commands[][MAX_CMDNAME_SIZE] = {
     "/note",
     "/passwd",
     "/rejoin",
+    "/search",
     "/silence",
     "/topic",
     "/unignore",
@@ -0,0 +1,630 @@
+/*  file_reader.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE    /* needed for pread() */
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "file_reader.h"
+
+typedef enum File_Reader_Block_State {
+    FILE_READER_BLOCK_EMPTY,
+    FILE_READER_BLOCK_FILLING,
+    FILE_READER_BLOCK_READY,
+    FILE_READER_BLOCK_FAILED,
+} File_Reader_Block_State;
+
+struct file_reader_block {
+    uint8_t *data;
+    uint64_t index;                   /* which block of the file the slot holds */
+    size_t length;
+    File_Reader_Block_State state;
+};
+
+struct file_reader_request {
+    uint64_t position;
+    size_t length;
+    bool deferred;
+};
+
+/* Block `i` of the file is kept in slot `i % FILE_READER_NUM_BLOCKS`. Everything but `fd` and the sizes
+ * is guarded by the global lock. */
+struct file_reader {
+    int fd;
+    uint64_t file_size;
+    uint64_t num_file_blocks;
+    size_t block_capacity;
+
+    struct file_reader_block blocks[FILE_READER_NUM_BLOCKS];
+    uint64_t window_start;            /* first block of the file we want in memory */
+
+    struct file_reader_request *requests;
+    size_t requests_head;
+    size_t num_requests;
+    size_t requests_size;
+
+    uint8_t *bounce;                  /* holds chunks that straddle two blocks */
+    size_t bounce_size;
+
+    bool waiting;                     /* a chunk is waiting on a block that hasn't been read yet */
+    bool filling;                     /* the background thread is reading a block for this reader */
+    bool closing;
+
+    struct file_reader *next;
+    struct file_reader *prev;
+};
+
+static struct file_readers {
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;    /* signalled when a reader needs a block or the thread should stop */
+    pthread_cond_t  done;    /* broadcast whenever the thread finishes reading a block */
+    pthread_t       tid;
+    bool            running;
+    bool            stop;
+    Reactor         *notify;
+
+    /* Open readers. The background thread moves each reader it reads a block for to the end of the list,
+     * so transfers take turns. */
+    struct file_reader *head;
+    struct file_reader *tail;
+
+    size_t num_pending;
+
+    struct file_reader_stats stats;
+} readers = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+static void file_reader_list_remove(struct file_reader *reader)
+{
+    if (reader->prev != NULL) {
+        reader->prev->next = reader->next;
+    } else {
+        readers.head = reader->next;
+    }
+
+    if (reader->next != NULL) {
+        reader->next->prev = reader->prev;
+    } else {
+        readers.tail = reader->prev;
+    }
+
+    reader->next = NULL;
+    reader->prev = NULL;
+}
+
+static void file_reader_list_append(struct file_reader *reader)
+{
+    reader->prev = readers.tail;
+    reader->next = NULL;
+
+    if (readers.tail != NULL) {
+        readers.tail->next = reader;
+    } else {
+        readers.head = reader;
+    }
+
+    readers.tail = reader;
+}
+
+static struct file_reader_block *file_reader_slot(struct file_reader *reader, uint64_t index)
+{
+    return &reader->blocks[index % FILE_READER_NUM_BLOCKS];
+}
+
+static bool file_reader_in_window(const struct file_reader *reader, uint64_t index)
+{
+    return index >= reader->window_start && index - reader->window_start < FILE_READER_NUM_BLOCKS
+           && index < reader->num_file_blocks;
+}
+
+/* Makes `start` the first block we want in memory, freeing the slots of blocks outside the new window so
+ * they can be refilled. */
+static void file_reader_move_window(struct file_reader *reader, uint64_t start)
+{
+    reader->window_start = start;
+
+    for (size_t i = 0; i < FILE_READER_NUM_BLOCKS; ++i) {
+        struct file_reader_block *block = &reader->blocks[i];
+
+        /* a block that's being read is dealt with when the read finishes */
+        if (block->state == FILE_READER_BLOCK_FILLING) {
+            continue;
+        }
+
+        if (!file_reader_in_window(reader, block->index)) {
+            block->state = FILE_READER_BLOCK_EMPTY;
+        }
+    }
+
+    if (readers.running) {
+        pthread_cond_signal(&readers.wake);
+    }
+}
+
+/* Makes `block` ready to be filled with block `index` of the file.
+ *
+ * Return true on success.
+ */
+static bool file_reader_claim_block(struct file_reader *reader, struct file_reader_block *block, uint64_t index)
+{
+    if (block->data == NULL) {
+        block->data = malloc(reader->block_capacity);
+
+        if (block->data == NULL) {
+            return false;
+        }
+    }
+
+    block->index = index;
+    block->state = FILE_READER_BLOCK_FILLING;
+
+    return true;
+}
+
+/* Reads block `index` of the file into `block`, which must have been claimed.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+static int file_reader_read_block(const struct file_reader *reader, struct file_reader_block *block, uint64_t index)
+{
+    const uint64_t offset = index * FILE_READER_BLOCK_SIZE;
+    const uint64_t remaining = reader->file_size - offset;
+    const size_t length = remaining < reader->block_capacity ? (size_t) remaining : reader->block_capacity;
+
+    size_t done = 0;
+
+    while (done < length) {
+        const ssize_t ret = pread(reader->fd, block->data + done, length - done, (off_t) (offset + done));
+
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        /* the file is shorter than it was when the transfer started */
+        if (ret == 0) {
+            return -1;
+        }
+
+        done += (size_t) ret;
+    }
+
+    block->length = length;
+
+    return 0;
+}
+
+/* Publishes the result of reading block `index` of the file into `block`. */
+static void file_reader_finish_block(struct file_reader *reader, struct file_reader_block *block, uint64_t index,
+                                     int ret)
+{
+    if (ret == 0) {
+        ++readers.stats.blocks;
+        readers.stats.bytes += block->length;
+    } else {
+        ++readers.stats.errors;
+    }
+
+    /* the reader may have moved on while the block was being read */
+    if (!file_reader_in_window(reader, index)) {
+        block->state = FILE_READER_BLOCK_EMPTY;
+    } else {
+        block->state = ret == 0 ? FILE_READER_BLOCK_READY : FILE_READER_BLOCK_FAILED;
+    }
+
+    if (reader->waiting && readers.notify != NULL) {
+        reader->waiting = false;
+        reactor_signal(readers.notify);
+    }
+}
+
+/* Returns the next reader that has a block to read and puts the block's index in `index`. Readers
+ * that are waiting for a block go first.
+ *
+ * Returns NULL if no reader needs a block.
+ */
+static struct file_reader *file_reader_find_job(uint64_t *index)
+{
+    for (int pass = 0; pass < 2; ++pass) {
+        for (struct file_reader *reader = readers.head; reader != NULL; reader = reader->next) {
+            if (reader->closing || (pass == 0 && !reader->waiting)) {
+                continue;
+            }
+
+            for (uint64_t i = reader->window_start; file_reader_in_window(reader, i); ++i) {
+                if (file_reader_slot(reader, i)->state == FILE_READER_BLOCK_EMPTY) {
+                    *index = i;
+                    return reader;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void *file_reader_thread(void *data)
+{
+    (void) data;
+
+    pthread_mutex_lock(&readers.lock);
+
+    while (!readers.stop) {
+        uint64_t index;
+        struct file_reader *reader = file_reader_find_job(&index);
+
+        if (reader == NULL) {
+            pthread_cond_wait(&readers.wake, &readers.lock);
+            continue;
+        }
+
+        struct file_reader_block *block = file_reader_slot(reader, index);
+
+        if (!file_reader_claim_block(reader, block, index)) {
+            block->index = index;
+            file_reader_finish_block(reader, block, index, -1);
+            continue;
+        }
+
+        reader->filling = true;
+
+        file_reader_list_remove(reader);
+        file_reader_list_append(reader);
+
+        pthread_mutex_unlock(&readers.lock);
+
+        const int ret = file_reader_read_block(reader, block, index);
+
+        pthread_mutex_lock(&readers.lock);
+
+        reader->filling = false;
+        file_reader_finish_block(reader, block, index, ret);
+
+        pthread_cond_broadcast(&readers.done);
+    }
+
+    pthread_mutex_unlock(&readers.lock);
+
+    return NULL;
+}
+
+int file_reader_start(Reactor *notify)
+{
+    pthread_mutex_lock(&readers.lock);
+
+    if (readers.running) {
+        pthread_mutex_unlock(&readers.lock);
+        return 0;
+    }
+
+    readers.stop = false;
+    readers.notify = notify;
+
+    if (pthread_create(&readers.tid, NULL, file_reader_thread, NULL) != 0) {
+        readers.notify = NULL;
+        pthread_mutex_unlock(&readers.lock);
+        return -1;
+    }
+
+    readers.running = true;
+
+    pthread_mutex_unlock(&readers.lock);
+
+    return 0;
+}
+
+void file_reader_stop(void)
+{
+    pthread_mutex_lock(&readers.lock);
+
+    if (!readers.running) {
+        pthread_mutex_unlock(&readers.lock);
+        return;
+    }
+
+    readers.stop = true;
+    pthread_cond_signal(&readers.wake);
+    pthread_mutex_unlock(&readers.lock);
+
+    pthread_join(readers.tid, NULL);
+
+    pthread_mutex_lock(&readers.lock);
+    readers.running = false;
+    readers.notify = NULL;
+    pthread_mutex_unlock(&readers.lock);
+}
+
+struct file_reader *file_reader_open(int fd, uint64_t file_size)
+{
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct file_reader *reader = calloc(1, sizeof(struct file_reader));
+
+    if (reader == NULL) {
+        return NULL;
+    }
+
+    reader->fd = fd;
+    reader->file_size = file_size;
+    reader->num_file_blocks = (file_size + FILE_READER_BLOCK_SIZE - 1) / FILE_READER_BLOCK_SIZE;
+    reader->block_capacity = file_size < FILE_READER_BLOCK_SIZE ? (size_t) file_size : FILE_READER_BLOCK_SIZE;
+
+    pthread_mutex_lock(&readers.lock);
+
+    file_reader_list_append(reader);
+
+    /* start reading the beginning of the file before toxcore asks for it */
+    if (readers.running) {
+        pthread_cond_signal(&readers.wake);
+    }
+
+    pthread_mutex_unlock(&readers.lock);
+
+    return reader;
+}
+
+void file_reader_close(struct file_reader *reader)
+{
+    if (reader == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&readers.lock);
+
+    reader->closing = true;
+
+    while (reader->filling) {
+        pthread_cond_wait(&readers.done, &readers.lock);
+    }
+
+    file_reader_list_remove(reader);
+
+    if (reader->num_requests > 0) {
+        --readers.num_pending;
+    }
+
+    pthread_mutex_unlock(&readers.lock);
+
+    for (size_t i = 0; i < FILE_READER_NUM_BLOCKS; ++i) {
+        free(reader->blocks[i].data);
+    }
+
+    free(reader->requests);
+    free(reader->bounce);
+    free(reader);
+}
+
+int file_reader_request(struct file_reader *reader, uint64_t position, size_t length)
+{
+    if (length == 0 || length > FILE_READER_BLOCK_SIZE || position > reader->file_size
+            || length > reader->file_size - position) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&readers.lock);
+
+    if (reader->requests_head + reader->num_requests == reader->requests_size) {
+        if (reader->requests_head > 0) {
+            memmove(reader->requests, reader->requests + reader->requests_head,
+                    reader->num_requests * sizeof(struct file_reader_request));
+            reader->requests_head = 0;
+        } else {
+            const size_t new_size = reader->requests_size > 0 ? reader->requests_size * 2 : 16;
+            struct file_reader_request *new_requests = realloc(reader->requests,
+                    new_size * sizeof(struct file_reader_request));
+
+            if (new_requests == NULL) {
+                pthread_mutex_unlock(&readers.lock);
+                return -1;
+            }
+
+            reader->requests = new_requests;
+            reader->requests_size = new_size;
+        }
+    }
+
+    reader->requests[reader->requests_head + reader->num_requests] = (struct file_reader_request) {
+        position,
+        length,
+        false,
+    };
+
+    if (reader->num_requests == 0) {
+        ++readers.num_pending;
+    }
+
+    ++reader->num_requests;
+
+    pthread_mutex_unlock(&readers.lock);
+
+    return 0;
+}
+
+/* Return 1 if blocks `first` through `last` are in memory.
+ * Return 0 if one of them hasn't been read yet.
+ * Return -1 if one of them couldn't be read.
+ */
+static int file_reader_check_blocks(struct file_reader *reader, uint64_t first, uint64_t last)
+{
+    for (uint64_t i = first; i <= last; ++i) {
+        const struct file_reader_block *block = file_reader_slot(reader, i);
+
+        if (block->index != i) {
+            return 0;
+        }
+
+        if (block->state == FILE_READER_BLOCK_FAILED) {
+            return -1;
+        }
+
+        if (block->state != FILE_READER_BLOCK_READY) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Reads the blocks `first` through `last` that aren't in memory on the calling thread. Only used when the
+ * background thread isn't running. */
+static void file_reader_read_now(struct file_reader *reader, uint64_t first, uint64_t last)
+{
+    for (uint64_t i = first; i <= last; ++i) {
+        struct file_reader_block *block = file_reader_slot(reader, i);
+
+        if (block->index == i && block->state == FILE_READER_BLOCK_READY) {
+            continue;
+        }
+
+        if (!file_reader_claim_block(reader, block, i)) {
+            block->index = i;
+            file_reader_finish_block(reader, block, i, -1);
+            continue;
+        }
+
+        file_reader_finish_block(reader, block, i, file_reader_read_block(reader, block, i));
+    }
+}
+
+/* Points `data` at the `length` bytes at `position`, which must be in memory. */
+static int file_reader_get_data(struct file_reader *reader, uint64_t position, size_t length, const uint8_t **data)
+{
+    const uint64_t first = position / FILE_READER_BLOCK_SIZE;
+    const size_t offset = (size_t) (position - first * FILE_READER_BLOCK_SIZE);
+    const struct file_reader_block *block = file_reader_slot(reader, first);
+
+    if (offset + length <= block->length) {
+        *data = block->data + offset;
+        return 0;
+    }
+
+    if (reader->bounce_size < length) {
+        uint8_t *new_bounce = realloc(reader->bounce, length);
+
+        if (new_bounce == NULL) {
+            return -1;
+        }
+
+        reader->bounce = new_bounce;
+        reader->bounce_size = length;
+    }
+
+    const size_t head = block->length - offset;
+    const struct file_reader_block *next = file_reader_slot(reader, first + 1);
+
+    memcpy(reader->bounce, block->data + offset, head);
+    memcpy(reader->bounce + head, next->data, length - head);
+
+    ++readers.stats.copied;
+    *data = reader->bounce;
+
+    return 0;
+}
+
+int file_reader_next(struct file_reader *reader, uint64_t *position, const uint8_t **data, size_t *length)
+{
+    pthread_mutex_lock(&readers.lock);
+
+    if (reader->num_requests == 0) {
+        pthread_mutex_unlock(&readers.lock);
+        return 0;
+    }
+
+    struct file_reader_request *request = &reader->requests[reader->requests_head];
+    const uint64_t first = request->position / FILE_READER_BLOCK_SIZE;
+    const uint64_t last = (request->position + request->length - 1) / FILE_READER_BLOCK_SIZE;
+
+    /* frees the blocks before this chunk, or jumps to it if the transfer has seeked */
+    if (first != reader->window_start) {
+        file_reader_move_window(reader, first);
+    }
+
+    int ret = file_reader_check_blocks(reader, first, last);
+
+    if (ret == 0 && !readers.running) {
+        file_reader_read_now(reader, first, last);
+        ret = file_reader_check_blocks(reader, first, last);
+    }
+
+    if (ret == 0) {
+        if (!request->deferred) {
+            request->deferred = true;
+            ++readers.stats.deferred;
+        }
+
+        reader->waiting = true;
+        pthread_cond_signal(&readers.wake);
+        pthread_mutex_unlock(&readers.lock);
+        return 0;
+    }
+
+    if (ret == 1 && file_reader_get_data(reader, request->position, request->length, data) != 0) {
+        ret = -1;
+    }
+
+    if (ret == 1) {
+        *position = request->position;
+        *length = request->length;
+    }
+
+    pthread_mutex_unlock(&readers.lock);
+
+    return ret;
+}
+
+void file_reader_pop(struct file_reader *reader)
+{
+    pthread_mutex_lock(&readers.lock);
+
+    if (reader->num_requests == 0) {
+        pthread_mutex_unlock(&readers.lock);
+        return;
+    }
+
+    ++reader->requests_head;
+    --reader->num_requests;
+    ++readers.stats.chunks;
+
+    if (reader->num_requests == 0) {
+        reader->requests_head = 0;
+        --readers.num_pending;
+    }
+
+    pthread_mutex_unlock(&readers.lock);
+}
+
+size_t file_reader_num_pending(void)
+{
+    pthread_mutex_lock(&readers.lock);
+    const size_t num_pending = readers.num_pending;
+    pthread_mutex_unlock(&readers.lock);
+
+    return num_pending;
+}
+
+void file_reader_get_stats(struct file_reader_stats *stats)
+{
+    pthread_mutex_lock(&readers.lock);
+    *stats = readers.stats;
+    pthread_mutex_unlock(&readers.lock);
+}
@@ -0,0 +1,99 @@
+/*  file_reader.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef FILE_READER_H
+#define FILE_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "reactor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Size of each block read from disk, and the number of blocks kept in memory ahead of the chunk being sent */
+#define FILE_READER_BLOCK_SIZE (256 * 1024)
+#define FILE_READER_NUM_BLOCKS 16
+
+struct file_reader_stats {
+    uint64_t chunks;          /* number of chunks handed out */
+    uint64_t deferred;        /* number of times a chunk wasn't in memory yet when it was asked for */
+    uint64_t copied;          /* number of chunks that straddled two blocks and had to be copied */
+    uint64_t blocks;          /* number of blocks read from disk */
+    uint64_t bytes;           /* number of bytes read from disk */
+    uint64_t errors;          /* number of failed reads */
+};
+
+/*
+ * Reads files being sent to friends ahead of the chunks toxcore asks for.
+ *
+ * Each reader keeps a ring of blocks covering the part of the file just ahead of the oldest chunk
+ * that hasn't been sent, which a background thread keeps filled with large sequential reads. Chunks
+ * are handed out as pointers into the ring, so sending one costs no syscalls or allocations. A chunk
+ * that isn't in memory yet is kept in the reader's queue, and the reactor passed to file_reader_start()
+ * is signalled once it's been read so the chunk can be sent then.
+ *
+ * If the background thread isn't running, blocks are read when a chunk needs them instead.
+ */
+struct file_reader;
+
+/* Starts the background thread, which signals `notify` when a block that a reader is waiting for
+ * has been read.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int file_reader_start(Reactor *notify);
+
+/* Stops the background thread. Readers stay usable and read blocks as they're needed. */
+void file_reader_stop(void);
+
+/* Creates a reader for the `file_size` byte file open for reading on `fd`. The reader reads `fd` with
+ * pread() and doesn't close it.
+ *
+ * Return NULL on failure.
+ */
+struct file_reader *file_reader_open(int fd, uint64_t file_size);
+
+/* Closes `reader`, waiting for the background thread to finish any read it's doing for it. */
+void file_reader_close(struct file_reader *reader);
+
+/* Queues a request for the `length` bytes of the file at `position`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int file_reader_request(struct file_reader *reader, uint64_t position, size_t length);
+
+/* Puts the oldest queued request in `position` and `length` and points `data` at its bytes. The data
+ * stays valid until the request is removed with file_reader_pop().
+ *
+ * Return 1 if the data is in memory.
+ * Return 0 if there are no queued requests, or the data for the oldest one hasn't been read yet.
+ * Return -1 if the data couldn't be read.
+ */
+int file_reader_next(struct file_reader *reader, uint64_t *position, const uint8_t **data, size_t *length);
+
+/* Removes the oldest queued request from `reader`. */
+void file_reader_pop(struct file_reader *reader);
+
+/* Returns the number of readers that have queued requests. */
+size_t file_reader_num_pending(void);
+
+/* Puts a snapshot of the reader counters in `stats`. */
+void file_reader_get_stats(struct file_reader_stats *stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* FILE_READER_H */
@@ -0,0 +1,342 @@
+#include "file_reader.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+// The largest chunk toxcore asks for
+constexpr size_t kChunkSize = 1371;
+
+class FileReader : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        std::snprintf(path_, sizeof(path_), "%s/toxic_file_reader_test_XXXXXX", testing::TempDir().c_str());
+        fd_ = mkstemp(path_);
+        ASSERT_NE(fd_, -1);
+    }
+
+    void TearDown() override
+    {
+        file_reader_stop();
+
+        if (notify_started_) {
+            reactor_free(&notify_);
+        }
+
+        close(fd_);
+        std::remove(path_);
+    }
+
+    void write_file(size_t size)
+    {
+        contents_.resize(size);
+        uint32_t seed = 1;
+
+        for (size_t i = 0; i < size; ++i) {
+            seed = seed * 1103515245 + 12345;
+            contents_[i] = static_cast<uint8_t>(seed >> 16);
+        }
+
+        ASSERT_EQ(write(fd_, contents_.data(), size), static_cast<ssize_t>(size));
+    }
+
+    void start_thread()
+    {
+        ASSERT_EQ(reactor_init(&notify_), 0);
+        notify_started_ = true;
+        ASSERT_EQ(file_reader_start(&notify_), 0);
+    }
+
+    // Waits for the oldest request to be read and checks its data against the file.
+    void expect_next(struct file_reader *reader, uint64_t position, size_t length)
+    {
+        uint64_t next_position;
+        const uint8_t *data;
+        size_t next_length;
+        int ret;
+
+        while ((ret = file_reader_next(reader, &next_position, &data, &next_length)) == 0) {
+            ASSERT_TRUE(notify_started_);
+            ASSERT_GE(reactor_wait(&notify_, -1, 1000), 0);
+        }
+
+        ASSERT_EQ(ret, 1);
+        ASSERT_EQ(next_position, position);
+        ASSERT_EQ(next_length, length);
+        ASSERT_EQ(std::memcmp(data, contents_.data() + position, length), 0);
+
+        file_reader_pop(reader);
+    }
+
+    // Requests and checks the whole file a chunk at a time, keeping `in_flight` requests queued.
+    void read_sequentially(struct file_reader *reader, size_t in_flight)
+    {
+        uint64_t requested = 0;
+        uint64_t checked = 0;
+
+        while (checked < contents_.size()) {
+            while (requested < contents_.size() && requested - checked < in_flight * kChunkSize) {
+                const size_t length = std::min<uint64_t>(kChunkSize, contents_.size() - requested);
+                ASSERT_EQ(file_reader_request(reader, requested, length), 0);
+                requested += length;
+            }
+
+            const size_t length = std::min<uint64_t>(kChunkSize, contents_.size() - checked);
+            expect_next(reader, checked, length);
+            checked += length;
+        }
+    }
+
+    char path_[PATH_MAX];
+    int fd_ = -1;
+    std::vector<uint8_t> contents_;
+    Reactor notify_;
+    bool notify_started_ = false;
+};
+
+TEST_F(FileReader, ReadsOnDemandWithoutThread)
+{
+    write_file(FILE_READER_BLOCK_SIZE * 3 + 1000);
+
+    struct file_reader *reader = file_reader_open(fd_, contents_.size());
+    ASSERT_NE(reader, nullptr);
+
+    read_sequentially(reader, 1);
+
+    struct file_reader_stats stats;
+    file_reader_get_stats(&stats);
+
+    // every block is read once, and chunks that straddle a block boundary are copied
+    EXPECT_EQ(stats.blocks, 4u);
+    EXPECT_EQ(stats.bytes, contents_.size());
+    EXPECT_GE(stats.copied, 3u);
+
+    file_reader_close(reader);
+}
+
+TEST_F(FileReader, ReadsAheadOnBackgroundThread)
+{
+    write_file(FILE_READER_BLOCK_SIZE * (FILE_READER_NUM_BLOCKS + 4) + 123);
+    start_thread();
+
+    struct file_reader *reader = file_reader_open(fd_, contents_.size());
+    ASSERT_NE(reader, nullptr);
+
+    read_sequentially(reader, 32);
+    EXPECT_EQ(file_reader_num_pending(), 0u);
+
+    file_reader_close(reader);
+}
+
+TEST_F(FileReader, SmallFile)
+{
+    write_file(10);
+    start_thread();
+
+    struct file_reader *reader = file_reader_open(fd_, contents_.size());
+    ASSERT_NE(reader, nullptr);
+
+    ASSERT_EQ(file_reader_request(reader, 0, 10), 0);
+    expect_next(reader, 0, 10);
+
+    file_reader_close(reader);
+}
+
+TEST_F(FileReader, SeekMovesWindow)
+{
+    write_file(FILE_READER_BLOCK_SIZE * (FILE_READER_NUM_BLOCKS * 2));
+    start_thread();
+
+    struct file_reader *reader = file_reader_open(fd_, contents_.size());
+    ASSERT_NE(reader, nullptr);
+
+    const uint64_t far = FILE_READER_BLOCK_SIZE * (FILE_READER_NUM_BLOCKS + 3) + 17;
+
+    ASSERT_EQ(file_reader_request(reader, 0, kChunkSize), 0);
+    ASSERT_EQ(file_reader_request(reader, far, kChunkSize), 0);
+    ASSERT_EQ(file_reader_request(reader, kChunkSize, kChunkSize), 0);
+
+    expect_next(reader, 0, kChunkSize);
+    expect_next(reader, far, kChunkSize);
+    expect_next(reader, kChunkSize, kChunkSize);
+
+    file_reader_close(reader);
+}
+
+TEST_F(FileReader, InvalidRequestsAreRejected)
+{
+    write_file(100);
+
+    struct file_reader *reader = file_reader_open(fd_, contents_.size());
+    ASSERT_NE(reader, nullptr);
+
+    EXPECT_EQ(file_reader_request(reader, 0, 0), -1);
+    EXPECT_EQ(file_reader_request(reader, 90, 11), -1);
+    EXPECT_EQ(file_reader_request(reader, 200, 1), -1);
+    EXPECT_EQ(file_reader_num_pending(), 0u);
+
+    file_reader_close(reader);
+}
+
+TEST_F(FileReader, TruncatedFileFails)
+{
+    write_file(FILE_READER_BLOCK_SIZE * 2);
+    start_thread();
+
+    // the file shrinks after the transfer was offered with its old size
+    ASSERT_EQ(ftruncate(fd_, FILE_READER_BLOCK_SIZE), 0);
+
+    struct file_reader *reader = file_reader_open(fd_, contents_.size());
+    ASSERT_NE(reader, nullptr);
+
+    ASSERT_EQ(file_reader_request(reader, FILE_READER_BLOCK_SIZE + 10, kChunkSize), 0);
+
+    uint64_t position;
+    const uint8_t *data;
+    size_t length;
+    int ret;
+
+    while ((ret = file_reader_next(reader, &position, &data, &length)) == 0) {
+        ASSERT_GE(reactor_wait(&notify_, -1, 1000), 0);
+    }
+
+    EXPECT_EQ(ret, -1);
+
+    file_reader_close(reader);
+    EXPECT_EQ(file_reader_num_pending(), 0u);
+}
+
+TEST_F(FileReader, CloseWithQueuedRequests)
+{
+    write_file(FILE_READER_BLOCK_SIZE * 4);
+    start_thread();
+
+    for (int i = 0; i < 20; ++i) {
+        struct file_reader *reader = file_reader_open(fd_, contents_.size());
+        ASSERT_NE(reader, nullptr);
+        ASSERT_EQ(file_reader_request(reader, 0, kChunkSize), 0);
+        file_reader_close(reader);
+    }
+
+    EXPECT_EQ(file_reader_num_pending(), 0u);
+}
+
+double thread_cpu_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Compares the time and CPU spent on the Tox thread serving a file a chunk at a time. The old sender did
+// an fseek() if needed plus a malloc() and an fread() for every chunk; the reader hands out chunks from
+// blocks read ahead by its own thread. The data goes nowhere, so this measures the sender's cost alone.
+TEST_F(FileReader, DISABLED_Benchmark)
+{
+    constexpr size_t mb = 64;
+    write_file(mb * 1024 * 1024);
+
+    uint64_t checksum_old = 0;
+    uint64_t checksum_new = 0;
+
+    FILE *file = std::fopen(path_, "r");
+    ASSERT_NE(file, nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    double start_cpu = thread_cpu_ms();
+    uint64_t position = 0;
+    uint64_t file_position = 0;
+
+    while (position < contents_.size()) {
+        const size_t length = std::min<uint64_t>(kChunkSize, contents_.size() - position);
+
+        if (file_position != position) {
+            ASSERT_EQ(std::fseek(file, position, SEEK_SET), 0);
+            file_position = position;
+        }
+
+        uint8_t *data = static_cast<uint8_t *>(std::malloc(length));
+        ASSERT_EQ(std::fread(data, 1, length, file), length);
+        checksum_old += data[length - 1];
+        std::free(data);
+
+        file_position += length;
+        position += length;
+    }
+
+    const auto old_time = std::chrono::steady_clock::now() - start;
+    const double old_cpu = thread_cpu_ms() - start_cpu;
+    std::fclose(file);
+
+    start_thread();
+    struct file_reader *reader = file_reader_open(fd_, contents_.size());
+    ASSERT_NE(reader, nullptr);
+
+    start = std::chrono::steady_clock::now();
+    start_cpu = thread_cpu_ms();
+
+    uint64_t requested = 0;
+    uint64_t sent = 0;
+
+    while (sent < contents_.size()) {
+        // toxcore asks for a burst of chunks each iteration
+        while (requested < contents_.size() && requested - sent < 64 * kChunkSize) {
+            const size_t length = std::min<uint64_t>(kChunkSize, contents_.size() - requested);
+            ASSERT_EQ(file_reader_request(reader, requested, length), 0);
+            requested += length;
+        }
+
+        const uint8_t *data;
+        size_t length;
+        uint64_t next_position;
+        int ret;
+
+        while ((ret = file_reader_next(reader, &next_position, &data, &length)) == 1) {
+            checksum_new += data[length - 1];
+            sent += length;
+            file_reader_pop(reader);
+        }
+
+        ASSERT_EQ(ret, 0);
+
+        if (sent < requested) {
+            reactor_wait(&notify_, -1, 1000);
+        }
+    }
+
+    const auto new_time = std::chrono::steady_clock::now() - start;
+    const double new_cpu = thread_cpu_ms() - start_cpu;
+
+    file_reader_close(reader);
+
+    EXPECT_EQ(checksum_old, checksum_new);
+
+    struct file_reader_stats stats;
+    file_reader_get_stats(&stats);
+
+    const double gb = contents_.size() / (1024.0 * 1024.0 * 1024.0);
+    const double old_s = std::chrono::duration<double>(old_time).count();
+    const double new_s = std::chrono::duration<double>(new_time).count();
+
+    std::printf("%zu MiB in %zu byte chunks:\n", mb, kChunkSize);
+    std::printf("  fseek/malloc/fread: %.0f MiB/s, %.0f ms CPU per GiB on the Tox thread\n", mb / old_s, old_cpu / gb);
+    std::printf("  file reader:        %.0f MiB/s, %.0f ms CPU per GiB on the Tox thread "
+                "(%llu blocks read, %llu chunks deferred)\n", mb / new_s, new_cpu / gb,
+                static_cast<unsigned long long>(stats.blocks), static_cast<unsigned long long>(stats.deferred));
+}
+
+}  // namespace
@@ -6,11 +6,14 @@
  *  under the GNU General Public License 3.0.
  */
 
+#include <dirent.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "configdir.h"
+#include "dir_transfers.h"
 #include "execute.h"
 #include "file_transfers.h"
 #include "friendlist.h"
@@ -18,123 +21,159 @@
 #include "misc_tools.h"
 #include "notify.h"
 #include "toxic.h"
+#include "transfer_journal.h"
 #include "windows.h"
 
-/* number of "#"'s in file transfer progress bar. Keep well below MAX_STR_SIZE */
-#define NUM_PROG_MARKS 50
-#define STR_BUF_SIZE 30
-
-/* creates initial progress line that will be updated during file transfer.
-   Assumes progline has room for at least MAX_STR_SIZE bytes */
-void init_progress_bar(char *progline)
+static size_t get_stats_helper(const FileTransferTable *table, struct transfer_stat *stats, size_t max,
+                               size_t count, uint64_t now)
 {
-    strcpy(progline, "0% [");
-
-    for (size_t i = 0; i < NUM_PROG_MARKS; ++i) {
-        strcat(progline, "-");
-    }
+    for (size_t i = 0; i < table->size; ++i) {
+        FileTransfer *ft = table->transfers[i];
 
-    strcat(progline, "] 0.0 B/s");
-}
+        if (ft->state != FILE_TRANSFER_STARTED && ft->state != FILE_TRANSFER_PAUSED) {
+            continue;
+        }
 
-/* prints a progress bar for file transfers. */
-void print_progress_bar(ToxWindow *self, double bps, double pct_done, uint32_t line_id)
-{
-    if (bps < 0 || pct_done < 0 || pct_done > 100) {
-        return;
-    }
+        /* the directory's snapshot covers it */
+        if (ft->dir_id != 0) {
+            continue;
+        }
 
-    char pct_str[STR_BUF_SIZE];
-    snprintf(pct_str, sizeof(pct_str), "%.1f%%", pct_done);
+        const double bps = transfer_rate_sample(&ft->rate, ft->position, now);
 
-    char bps_str[STR_BUF_SIZE];
-    bytes_convert_str(bps_str, sizeof(bps_str), bps);
+        if (count < max) {
+            uint8_t flags = ft->direction == FILE_TRANSFER_SEND ? TRANSFER_STAT_SENDING : 0;
 
-    char prog_line[NUM_PROG_MARKS + 1];
-    prog_line[0] = 0;
+            if (ft->state == FILE_TRANSFER_PAUSED) {
+                flags |= TRANSFER_STAT_PAUSED;
+            }
 
-    int n = pct_done / (100 / NUM_PROG_MARKS);
-    int i, j;
+            stats[count] = (struct transfer_stat) {
+                .name = ft->file_name,
+                .position = ft->position,
+                .size = ft->file_size,
+                .bps = ft->state == FILE_TRANSFER_PAUSED ? 0 : bps,
+                .id = (int32_t) ft->index,
+                .flags = flags,
+            };
+        }
 
-    for (i = 0; i < n; ++i) {
-        strcat(prog_line, "=");
+        ++count;
     }
 
-    if (pct_done < 100) {
-        strcpy(prog_line + n, ">");
-    }
+    return count;
+}
 
-    for (j = i; j < NUM_PROG_MARKS - 1; ++j) {
-        strcat(prog_line, "-");
+size_t file_transfers_get_stats(FriendsList *friends, uint32_t friendnumber, struct transfer_stat *stats, size_t max,
+                                uint64_t now)
+{
+    if (friends == NULL) {
+        return 0;
     }
 
-    size_t line_buf_size = strlen(pct_str) + NUM_PROG_MARKS + strlen(bps_str) + 7;
-    char *full_line = malloc(line_buf_size);
+    const ToxicFriend *friend = &friends->list[friendnumber];
 
-    if (full_line == NULL) {
-        return;
-    }
+    size_t count = get_stats_helper(&friend->file_receiver, stats, max, 0, now);
+    count = get_stats_helper(&friend->file_sender, stats, max, count, now);
+
+    return count;
+}
 
-    snprintf(full_line, line_buf_size, "%s [%s] %s/s", pct_str, prog_line, bps_str);
+static void clear_file_transfer(FileTransfer *ft)
+{
+    const size_t index = ft->index;
 
-    line_info_set(self, line_id, full_line);
+    *ft = (FileTransfer) {
+        0
+    };
 
-    free(full_line);
+    ft->index = index;
 }
 
-static void refresh_progress_helper(ToxWindow *self, FileTransfer *ft)
+/* Returns the table of `friendnumber`'s file transfers in `direction`.
+ * Returns NULL if direction is invalid.
+ */
+static FileTransferTable *get_file_transfer_table(FriendsList *friends, uint32_t friendnumber,
+        FILE_TRANSFER_DIRECTION direction)
 {
-    if (ft->state == FILE_TRANSFER_INACTIVE) {
-        return;
+    if (direction == FILE_TRANSFER_SEND) {
+        return &friends->list[friendnumber].file_sender;
     }
 
-    /* Timeout must be set to 1 second to show correct bytes per second */
-    if (!timed_out(ft->last_line_progress, 1)) {
-        return;
+    if (direction == FILE_TRANSFER_RECV) {
+        return &friends->list[friendnumber].file_receiver;
     }
 
-    double remain = ft->file_size - ft->position;
-    double pct_done = remain > 0 ? (1 - (remain / ft->file_size)) * 100 : 100;
-    print_progress_bar(self, ft->bps, pct_done, ft->line_id);
-
-    ft->bps = 0;
-    ft->last_line_progress = get_unix_time();
+    return NULL;
 }
 
-/* refreshes active file transfer status bars.
- *
- * Return true if there is at least one active file transfer in either direction.
+/* Returns an inactive file transfer from `table`, growing the table if every transfer in it is in use.
+ * Returns NULL if the table can't grow any more.
  */
-bool refresh_file_transfer_progress(FriendsList *friends, ToxWindow *self, uint32_t friendnumber)
+static FileTransfer *file_transfer_table_get_unused(FileTransferTable *table)
 {
-    bool active = false;
+    for (size_t i = 0; i < table->size; ++i) {
+        if (table->transfers[i]->state == FILE_TRANSFER_INACTIVE) {
+            return table->transfers[i];
+        }
+    }
 
-    if (friends == NULL) {
-        return false;
+    if (table->size >= MAX_FILE_TRANSFERS) {
+        return NULL;
+    }
+
+    const size_t old_size = table->size;
+    const size_t new_size = old_size > 0 ? MIN(old_size * 2, MAX_FILE_TRANSFERS) : 4;
+    FileTransfer **new_transfers = realloc(table->transfers, new_size * sizeof(FileTransfer *));
+
+    if (new_transfers == NULL) {
+        return NULL;
     }
 
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        FileTransfer *ft_r = &friends->list[friendnumber].file_receiver[i];
-        FileTransfer *ft_s = &friends->list[friendnumber].file_sender[i];
+    table->transfers = new_transfers;
 
-        refresh_progress_helper(self, ft_r);
-        refresh_progress_helper(self, ft_s);
+    while (table->size < new_size) {
+        FileTransfer *ft = calloc(1, sizeof(FileTransfer));
 
-        if (ft_r->state !=  FILE_TRANSFER_INACTIVE || ft_s->state != FILE_TRANSFER_INACTIVE) {
-            active = true;
+        if (ft == NULL) {
+            break;
         }
+
+        ft->index = table->size;
+        table->transfers[table->size] = ft;
+        ++table->size;
     }
 
-    return active;
+    return table->size > old_size ? table->transfers[old_size] : NULL;
 }
 
-static void clear_file_transfer(FileTransfer *ft)
+static void free_file_transfer_table(FileTransferTable *table)
 {
-    *ft = (FileTransfer) {
+    for (size_t i = 0; i < table->size; ++i) {
+        free(table->transfers[i]);
+    }
+
+    free(table->transfers);
+
+    *table = (FileTransferTable) {
         0
     };
 }
 
+void free_file_transfers_friend(FriendsList *friends, uint32_t friendnumber)
+{
+    if (friends == NULL) {
+        return;
+    }
+
+    ToxicFriend *friend = &friends->list[friendnumber];
+
+    free_file_transfer_table(&friend->file_sender);
+    free_file_transfer_table(&friend->file_receiver);
+    send_queue_clear(&friend->file_send_queue);
+    dir_transfers_free_friend(friends, friendnumber);
+}
+
 /* Returns a pointer to friendnumber's FileTransfer struct associated with filenumber.
  * Returns NULL if filenumber is invalid.
  */
@@ -144,17 +183,23 @@ FileTransfer *get_file_transfer_struct(FriendsList *friends, uint32_t friendnumb
         return NULL;
     }
 
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        FileTransfer *ft_send = &friends->list[friendnumber].file_sender[i];
+    const FileTransferTable *senders = &friends->list[friendnumber].file_sender;
+
+    for (size_t i = 0; i < senders->size; ++i) {
+        FileTransfer *ft = senders->transfers[i];
 
-        if (ft_send->state != FILE_TRANSFER_INACTIVE && ft_send->filenumber == filenumber) {
-            return ft_send;
+        if (ft->state != FILE_TRANSFER_INACTIVE && ft->filenumber == filenumber) {
+            return ft;
         }
+    }
+
+    const FileTransferTable *receivers = &friends->list[friendnumber].file_receiver;
 
-        FileTransfer *ft_recv = &friends->list[friendnumber].file_receiver[i];
+    for (size_t i = 0; i < receivers->size; ++i) {
+        FileTransfer *ft = receivers->transfers[i];
 
-        if (ft_recv->state != FILE_TRANSFER_INACTIVE && ft_recv->filenumber == filenumber) {
-            return ft_recv;
+        if (ft->state != FILE_TRANSFER_INACTIVE && ft->filenumber == filenumber) {
+            return ft;
         }
     }
 
@@ -167,176 +212,509 @@ FileTransfer *get_file_transfer_struct(FriendsList *friends, uint32_t friendnumb
 FileTransfer *get_file_transfer_struct_index(FriendsList *friends, uint32_t friendnumber, uint32_t index,
         FILE_TRANSFER_DIRECTION direction)
 {
-    if (direction != FILE_TRANSFER_RECV && direction != FILE_TRANSFER_SEND) {
-        return NULL;
-    }
-
     if (friends == NULL) {
         return NULL;
     }
 
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        FileTransfer *ft = direction == FILE_TRANSFER_SEND ?
-                           &friends->list[friendnumber].file_sender[i] :
-                           &friends->list[friendnumber].file_receiver[i];
+    const FileTransferTable *table = get_file_transfer_table(friends, friendnumber, direction);
 
-        if (ft->state != FILE_TRANSFER_INACTIVE && ft->index == index) {
-            return ft;
-        }
+    if (table == NULL || index >= table->size) {
+        return NULL;
     }
 
-    return NULL;
+    FileTransfer *ft = table->transfers[index];
+
+    return ft->state != FILE_TRANSFER_INACTIVE ? ft : NULL;
 }
 
-/* Returns a pointer to an unused file sender.
- * Returns NULL if all file senders are in use.
+/* Initializes an unused file transfer and returns its pointer.
+ * Returns NULL on failure.
  */
-static FileTransfer *new_file_sender(FriendsList *friends, ToxWindow *window, uint32_t friendnumber,
-                                     uint32_t filenumber, uint8_t type)
+FileTransfer *new_file_transfer(FriendsList *friends, ToxWindow *window, uint32_t friendnumber, uint32_t filenumber,
+                                FILE_TRANSFER_DIRECTION direction, uint8_t type)
 {
     if (friends == NULL) {
         return NULL;
     }
 
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        FileTransfer *ft = &friends->list[friendnumber].file_sender[i];
+    FileTransferTable *table = get_file_transfer_table(friends, friendnumber, direction);
 
-        if (ft->state == FILE_TRANSFER_INACTIVE) {
-            clear_file_transfer(ft);
-            ft->window = window;
-            ft->index = i;
-            ft->friendnumber = friendnumber;
-            ft->filenumber = filenumber;
-            ft->file_type = type;
-            ft->state = FILE_TRANSFER_PENDING;
-            return ft;
-        }
+    if (table == NULL) {
+        return NULL;
     }
 
-    return NULL;
+    FileTransfer *ft = file_transfer_table_get_unused(table);
+
+    if (ft == NULL) {
+        return NULL;
+    }
+
+    clear_file_transfer(ft);
+    ft->window = window;
+    ft->direction = direction;
+    ft->friendnumber = friendnumber;
+    ft->filenumber = filenumber;
+    ft->file_type = type;
+    ft->state = FILE_TRANSFER_PENDING;
+
+    return ft;
 }
 
-/* Returns a pointer to an unused file receiver.
- * Returns NULL if all file receivers are in use.
- */
-static FileTransfer *new_file_receiver(FriendsList *friends, ToxWindow *window, uint32_t friendnumber,
-                                       uint32_t filenumber,
-                                       uint8_t type)
+size_t file_transfer_num_active_sends(const FriendsList *friends, uint32_t friendnumber)
 {
     if (friends == NULL) {
-        return NULL;
+        return 0;
     }
 
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        FileTransfer *ft = &friends->list[friendnumber].file_receiver[i];
+    const FileTransferTable *senders = &friends->list[friendnumber].file_sender;
+    size_t count = 0;
 
-        if (ft->state == FILE_TRANSFER_INACTIVE) {
-            clear_file_transfer(ft);
-            ft->window = window;
-            ft->index = i;
-            ft->friendnumber = friendnumber;
-            ft->filenumber = filenumber;
-            ft->file_type = type;
-            ft->state = FILE_TRANSFER_PENDING;
-            return ft;
+    for (size_t i = 0; i < senders->size; ++i) {
+        const FileTransfer *ft = senders->transfers[i];
+
+        if (ft->state != FILE_TRANSFER_INACTIVE && ft->file_type == TOX_FILE_KIND_DATA) {
+            ++count;
         }
     }
 
-    return NULL;
+    return count;
 }
 
-/* Initializes an unused file transfer and returns its pointer.
- * Returns NULL on failure.
- */
-FileTransfer *new_file_transfer(FriendsList *friends, ToxWindow *window, uint32_t friendnumber, uint32_t filenumber,
-                                FILE_TRANSFER_DIRECTION direction, uint8_t type)
+int file_send_queue_add(FriendsList *friends, uint32_t friendnumber, const char *file_path, size_t length)
 {
-    if (direction == FILE_TRANSFER_RECV) {
-        return new_file_receiver(friends, window, friendnumber, filenumber, type);
+    if (friends == NULL || length == 0 || file_path == NULL) {
+        return -1;
     }
 
-    if (direction == FILE_TRANSFER_SEND) {
-        return new_file_sender(friends, window, friendnumber, filenumber, type);
+    if (length >= TOXIC_MAX_PATH_LENGTH) {
+        return -2;
     }
 
-    return NULL;
+    uint32_t id;
+
+    if (send_queue_push(&friends->list[friendnumber].file_send_queue, file_path, length, &id) != 0) {
+        return -3;
+    }
+
+    return MAX_FILE_TRANSFERS + id;
 }
 
-int file_send_queue_add(FriendsList *friends, uint32_t friendnumber, const char *file_path, size_t length)
+#define FILE_TRANSFER_SEND_CMD "/sendfile "
+#define FILE_TRANSFER_SEND_LEN (sizeof(FILE_TRANSFER_SEND_CMD) - 1)
+
+void file_send_queue_check(ToxWindow *self, Toxic *toxic, uint32_t friendnumber)
 {
-    if (friends == NULL || length == 0 || file_path == NULL) {
+    if (toxic == NULL || self == NULL) {
+        return;
+    }
+
+    ToxicFriend *friend = &toxic->friends->list[friendnumber];
+
+    if (friend->connection_status == TOX_CONNECTION_NONE) {
+        return;
+    }
+
+    /* each item is only tried once, so one that /sendfile puts back in the queue waits for the next check */
+    size_t remaining = send_queue_length(&friend->file_send_queue);
+
+    while (remaining > 0 && file_transfer_num_active_sends(toxic->friends, friendnumber) < MAX_ACTIVE_FILE_SENDS) {
+        const struct send_queue_item *item = send_queue_front(&friend->file_send_queue);
+
+        if (item == NULL) {
+            break;
+        }
+
+        char command[TOXIC_MAX_PATH_LENGTH + FILE_TRANSFER_SEND_LEN + 1];
+        snprintf(command, sizeof(command), "%s%s", FILE_TRANSFER_SEND_CMD, item->path);
+
+        send_queue_pop(&friend->file_send_queue);
+        --remaining;
+
+        execute(self->window, self, toxic, command, CHAT_COMMAND_MODE);
+    }
+}
+
+int file_send_queue_remove(FriendsList *friends, uint32_t friendnumber, size_t index)
+{
+    if (friends == NULL || index < MAX_FILE_TRANSFERS || index - MAX_FILE_TRANSFERS > UINT32_MAX) {
         return -1;
     }
 
-    if (length > TOX_MAX_FILENAME_LENGTH) {
-        return -2;
+    return send_queue_remove(&friends->list[friendnumber].file_send_queue, index - MAX_FILE_TRANSFERS);
+}
+
+void file_transfers_schedule(Toxic *toxic)
+{
+    if (toxic == NULL) {
+        return;
     }
 
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        PendingFileTransfer *pending_slot = &friends->list[friendnumber].file_send_queue[i];
+    FriendsList *friends = toxic->friends;
 
-        if (pending_slot->pending) {
+    for (size_t i = 0; i < friends->max_idx; ++i) {
+        const ToxicFriend *friend = &friends->list[i];
+
+        if (!friend->active || friend->window_id < 0) {
             continue;
         }
 
-        pending_slot->pending = true;
+        if (send_queue_length(&friend->file_send_queue) == 0 && !friend->dir_send.active) {
+            continue;
+        }
 
-        memcpy(pending_slot->file_path, file_path, length);
-        pending_slot->file_path[length] = 0;
-        pending_slot->length = length;
+        ToxWindow *window = get_window_pointer_by_id(toxic->windows, friend->window_id);
 
-        return i;
-    }
+        if (window == NULL) {
+            continue;
+        }
 
-    return -3;
+        /* files sent on their own go before the rest of a directory */
+        file_send_queue_check(window, toxic, friend->num);
+        dir_send_schedule(window, toxic, friend->num);
+    }
 }
 
-#define FILE_TRANSFER_SEND_CMD "/sendfile "
-#define FILE_TRANSFER_SEND_LEN (sizeof(FILE_TRANSFER_SEND_CMD) - 1)
+void file_transfer_send_chunks(const Toxic *toxic, FileTransfer *ft)
+{
+    uint64_t position;
+    const uint8_t *data;
+    size_t length;
+    int ret;
+
+    while ((ret = file_reader_next(ft->reader, &position, &data, &length)) == 1) {
+        Tox_Err_File_Send_Chunk err;
+        tox_file_send_chunk(toxic->tox, ft->friendnumber, ft->filenumber, position, data, length, &err);
+
+        /* toxcore's send queue is full; try again on the next iteration */
+        if (err == TOX_ERR_FILE_SEND_CHUNK_SENDQ) {
+            return;
+        }
 
-void file_send_queue_check(ToxWindow *self, Toxic *toxic, uint32_t friendnumber)
+        file_reader_pop(ft->reader);
+
+        if (err != TOX_ERR_FILE_SEND_CHUNK_OK) {
+            fprintf(stderr, "tox_file_send_chunk failed (error %d)\n", err);
+            continue;
+        }
+
+        ft->position = position + length;
+    }
+
+    if (ret < 0) {
+        char msg[MAX_STR_SIZE];
+        snprintf(msg, sizeof(msg), "File transfer for '%s' failed: Read fail.", ft->file_name);
+        close_file_transfer(ft->window, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
+    }
+}
+
+void file_transfers_send_pending(const Toxic *toxic)
 {
-    if (toxic == NULL) {
+    if (file_reader_num_pending() == 0) {
         return;
     }
 
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        PendingFileTransfer *pending_slot = &toxic->friends->list[friendnumber].file_send_queue[i];
+    FriendsList *friends = toxic->friends;
 
-        if (!pending_slot->pending) {
+    for (size_t i = 0; i < friends->max_idx; ++i) {
+        if (!friends->list[i].active) {
             continue;
         }
 
-        char command[TOX_MAX_FILENAME_LENGTH + FILE_TRANSFER_SEND_LEN + 1];
-        snprintf(command, sizeof(command), "%s%s", FILE_TRANSFER_SEND_CMD, pending_slot->file_path);
+        FileTransferTable *senders = &friends->list[i].file_sender;
 
-        execute(self->window, self, toxic, command, CHAT_COMMAND_MODE);
+        if (senders->size == 0) {
+            continue;
+        }
+
+        const size_t first = senders->next % senders->size;
 
-        *pending_slot = (PendingFileTransfer) {
-            0,
-        };
+        for (size_t j = 0; j < senders->size; ++j) {
+            FileTransfer *ft = senders->transfers[(first + j) % senders->size];
+
+            if (ft->state == FILE_TRANSFER_STARTED && ft->reader != NULL) {
+                file_transfer_send_chunks(toxic, ft);
+            }
+        }
+
+        senders->next = first + 1;
     }
 }
 
-int file_send_queue_remove(FriendsList *friends, uint32_t friendnumber, size_t index)
+/* Puts the prefix shared by the names of the journal records of every incoming file transfer from
+ * `friendnumber` in `buf`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+static int file_transfer_get_journal_prefix(const Toxic *toxic, uint32_t friendnumber, char *buf, size_t buf_size)
 {
-    if (friends == NULL || index >= MAX_FILES) {
+    uint8_t self_key[TOX_PUBLIC_KEY_SIZE];
+    tox_self_get_public_key(toxic->tox, self_key);
+
+    char self_str[TOX_PUBLIC_KEY_SIZE * 2 + 1];
+    char friend_str[TOX_PUBLIC_KEY_SIZE * 2 + 1];
+
+    if (tox_pk_bytes_to_str(self_key, sizeof(self_key), self_str, sizeof(self_str)) != 0
+            || tox_pk_bytes_to_str((const uint8_t *) toxic->friends->list[friendnumber].pub_key, TOX_PUBLIC_KEY_SIZE,
+                                   friend_str, sizeof(friend_str)) != 0) {
         return -1;
     }
 
-    PendingFileTransfer *pending_slot = &friends->list[friendnumber].file_send_queue[index];
+    const int len = snprintf(buf, buf_size, "%s-%s-", self_str, friend_str);
 
-    if (!pending_slot->pending) {
+    if (len < 0 || (size_t) len >= buf_size) {
         return -1;
     }
 
-    *pending_slot = (PendingFileTransfer) {
-        0,
-    };
+    return 0;
+}
+
+/* Puts the path of the journal record of `ft` in `buf`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+static int file_transfer_get_journal_path(const Toxic *toxic, const FileTransfer *ft, char *buf, size_t buf_size)
+{
+    char prefix[TOX_PUBLIC_KEY_SIZE * 4 + 3];
+    char file_id_str[TOX_FILE_ID_LENGTH * 2 + 1];
+
+    if (file_transfer_get_journal_prefix(toxic, ft->friendnumber, prefix, sizeof(prefix)) != 0
+            || tox_pk_bytes_to_str(ft->file_id, TOX_FILE_ID_LENGTH, file_id_str, sizeof(file_id_str)) != 0) {
+        return -1;
+    }
+
+    char *user_config_dir = get_user_config_dir(toxic->paths);
+
+    if (user_config_dir == NULL) {
+        return -1;
+    }
+
+    const int len = snprintf(buf, buf_size, "%s%s%s%s", user_config_dir, TRANSFERDIR, prefix, file_id_str);
+
+    free(user_config_dir);
+
+    if (len < 0 || (size_t) len >= buf_size) {
+        return -1;
+    }
 
     return 0;
 }
 
+bool file_transfer_load_journal(const Toxic *toxic, FileTransfer *ft)
+{
+    char path[TOXIC_MAX_PATH_LENGTH];
+
+    if (file_transfer_get_journal_path(toxic, ft, path, sizeof(path)) != 0) {
+        return false;
+    }
+
+    struct transfer_record record;
+
+    if (transfer_journal_load(path, &record) != 0) {
+        return false;
+    }
+
+    /* the sender has changed the file, or the partial file is gone or already being received */
+    if (record.file_size != ft->file_size || access(record.file_path, F_OK) != 0
+            || file_transfer_recv_path_exists(toxic->friends, record.file_path)) {
+        remove(path);
+        return false;
+    }
+
+    snprintf(ft->file_path, sizeof(ft->file_path), "%s", record.file_path);
+    ft->journaled = true;
+    ft->journal_position = record.position;
+    ft->journal_checksum = record.checksum;
+
+    return true;
+}
+
+static void file_transfer_save_journal(const Toxic *toxic, FileTransfer *ft)
+{
+    uint64_t position;
+    uint64_t checksum;
+    file_writer_get_progress(ft->writer, &position, &checksum);
+
+    if (position == 0 || (ft->journaled && position == ft->journal_position && checksum == ft->journal_checksum)) {
+        return;
+    }
+
+    char path[TOXIC_MAX_PATH_LENGTH];
+
+    if (file_transfer_get_journal_path(toxic, ft, path, sizeof(path)) != 0) {
+        return;
+    }
+
+    struct transfer_record record = {
+        .file_size = ft->file_size,
+        .position = position,
+        .checksum = checksum,
+    };
+    snprintf(record.file_path, sizeof(record.file_path), "%s", ft->file_path);
+
+    if (transfer_journal_save(path, &record) != 0) {
+        return;
+    }
+
+    ft->journaled = true;
+    ft->journal_position = position;
+    ft->journal_checksum = checksum;
+}
+
+void file_transfers_save_journals(const Toxic *toxic)
+{
+    const FriendsList *friends = toxic->friends;
+
+    for (size_t i = 0; i < friends->max_idx; ++i) {
+        if (!friends->list[i].active) {
+            continue;
+        }
+
+        const FileTransferTable *receivers = &friends->list[i].file_receiver;
+
+        for (size_t j = 0; j < receivers->size; ++j) {
+            FileTransfer *ft = receivers->transfers[j];
+
+            if (ft->state != FILE_TRANSFER_INACTIVE && ft->file_type == TOX_FILE_KIND_DATA && ft->writer != NULL) {
+                file_transfer_save_journal(toxic, ft);
+            }
+        }
+    }
+}
+
+void file_transfers_remove_journals(const Toxic *toxic, uint32_t friendnumber)
+{
+    char prefix[TOX_PUBLIC_KEY_SIZE * 4 + 3];
+
+    if (file_transfer_get_journal_prefix(toxic, friendnumber, prefix, sizeof(prefix)) != 0) {
+        return;
+    }
+
+    char *user_config_dir = get_user_config_dir(toxic->paths);
+
+    if (user_config_dir == NULL) {
+        return;
+    }
+
+    char dir_path[TOXIC_MAX_PATH_LENGTH];
+    const int len = snprintf(dir_path, sizeof(dir_path), "%s%s", user_config_dir, TRANSFERDIR);
+
+    free(user_config_dir);
+
+    if (len < 0 || (size_t) len >= sizeof(dir_path)) {
+        return;
+    }
+
+    DIR *dir = opendir(dir_path);
+
+    if (dir == NULL) {
+        return;
+    }
+
+    const size_t prefix_len = strlen(prefix);
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, prefix, prefix_len) != 0) {
+            continue;
+        }
+
+        char path[TOXIC_MAX_PATH_LENGTH];
+
+        if (snprintf(path, sizeof(path), "%s%s", dir_path, entry->d_name) < (int) sizeof(path)) {
+            remove(path);
+        }
+    }
+
+    closedir(dir);
+}
+
+/* Accepts a resumed transfer once its writer has checked the saved part of the file, asking the sender to
+ * skip what's already been saved.
+ */
+static void file_transfer_resume_saved(const Toxic *toxic, FileTransfer *ft)
+{
+    uint64_t position;
+    uint64_t checksum;
+    file_writer_get_progress(ft->writer, &position, &checksum);
+
+    char msg[MAX_STR_SIZE];
+
+    if ((position > 0 && !tox_file_seek(toxic->tox, ft->friendnumber, ft->filenumber, position, NULL))
+            || !tox_file_control(toxic->tox, ft->friendnumber, ft->filenumber, TOX_FILE_CONTROL_RESUME, NULL)) {
+        snprintf(msg, sizeof(msg), "File transfer for '%s' failed.", ft->file_name);
+        close_file_transfer(ft->window, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
+        return;
+    }
+
+    if (position > 0) {
+        char sizestr[32];
+        bytes_convert_str(sizestr, sizeof(sizestr), position);
+        snprintf(msg, sizeof(msg), "Resuming '%s' after the %s already saved.", ft->file_name, sizestr);
+    } else {
+        snprintf(msg, sizeof(msg), "The saved part of '%s' has changed, so the whole file will be received again.",
+                 ft->file_name);
+    }
+
+    if (ft->window != NULL) {
+        line_info_add(ft->window, toxic->c_config, false, NULL, NULL, SYS_MSG, 0, 0, "%s", msg);
+    }
+
+    ft->position = position;
+    ft->journal_position = position;
+    ft->journal_checksum = checksum;
+}
+
+void file_transfers_check_writers(const Toxic *toxic)
+{
+    if (file_writer_num_waiting() == 0) {
+        return;
+    }
+
+    const FriendsList *friends = toxic->friends;
+
+    for (size_t i = 0; i < friends->max_idx; ++i) {
+        if (!friends->list[i].active) {
+            continue;
+        }
+
+        const FileTransferTable *receivers = &friends->list[i].file_receiver;
+
+        for (size_t j = 0; j < receivers->size; ++j) {
+            FileTransfer *ft = receivers->transfers[j];
+
+            if (ft->state == FILE_TRANSFER_INACTIVE || ft->writer == NULL) {
+                continue;
+            }
+
+            switch (file_writer_poll(ft->writer)) {
+                case FILE_WRITER_EVENT_NONE: {
+                    break;
+                }
+
+                case FILE_WRITER_EVENT_READY: {
+                    file_transfer_resume_saved(toxic, ft);
+                    break;
+                }
+
+                case FILE_WRITER_EVENT_RESUME: {
+                    Tox_Err_File_Control err;
+                    tox_file_control(toxic->tox, ft->friendnumber, ft->filenumber, TOX_FILE_CONTROL_RESUME, &err);
+                    break;
+                }
+
+                case FILE_WRITER_EVENT_ERROR: {
+                    char msg[MAX_STR_SIZE];
+                    snprintf(msg, sizeof(msg), "File transfer for '%s' failed: Write fail.", ft->file_name);
+                    close_file_transfer(ft->window, toxic, ft, TOX_FILE_CONTROL_CANCEL, msg, notif_error);
+                    break;
+                }
+            }
+        }
+    }
+}
+
 /* Closes file transfer ft.
  *
  * Set CTRL to -1 if we don't want to send a control signal.
@@ -353,10 +731,27 @@ void close_file_transfer(ToxWindow *self, const Toxic *toxic, FileTransfer *ft,
         return;
     }
 
+    /* the reader must be closed first since it reads from the file on another thread */
+    file_reader_close(ft->reader);
+
     if (ft->file) {
         fclose(ft->file);
     }
 
+    /* completed transfers close their writer themselves so the file is synced to disk */
+    file_writer_close(ft->writer, false);
+
+    dir_transfers_on_file_closed(toxic, ft);
+
+    /* the transfer is over, so it can't be resumed */
+    if (ft->journaled) {
+        char path[TOXIC_MAX_PATH_LENGTH];
+
+        if (file_transfer_get_journal_path(toxic, ft, path, sizeof(path)) == 0) {
+            remove(path);
+        }
+    }
+
     if (CTRL >= 0) {
         Tox_Err_File_Control err;
 
@@ -385,8 +780,10 @@ void kill_avatar_file_transfers_friend(Toxic *toxic, uint32_t friendnumber)
         return;
     }
 
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        FileTransfer *ft = &toxic->friends->list[friendnumber].file_sender[i];
+    const FileTransferTable *senders = &toxic->friends->list[friendnumber].file_sender;
+
+    for (size_t i = 0; i < senders->size; ++i) {
+        FileTransfer *ft = senders->transfers[i];
 
         if (ft->file_type == TOX_FILE_KIND_AVATAR) {
             close_file_transfer(NULL, toxic, ft, TOX_FILE_CONTROL_CANCEL, NULL, silent);
@@ -401,13 +798,19 @@ void kill_all_file_transfers_friend(Toxic *toxic, uint32_t friendnumber)
         return;
     }
 
-    for (size_t i = 0; i < MAX_FILES; ++i) {
-        close_file_transfer(NULL, toxic, &toxic->friends->list[friendnumber].file_sender[i], TOX_FILE_CONTROL_CANCEL, NULL,
-                            silent);
-        close_file_transfer(NULL, toxic, &toxic->friends->list[friendnumber].file_receiver[i], TOX_FILE_CONTROL_CANCEL, NULL,
-                            silent);
-        file_send_queue_remove(toxic->friends, friendnumber, i);
+    ToxicFriend *friend = &toxic->friends->list[friendnumber];
+
+    dir_transfers_free_friend(toxic->friends, friendnumber);
+
+    for (size_t i = 0; i < friend->file_sender.size; ++i) {
+        close_file_transfer(NULL, toxic, friend->file_sender.transfers[i], TOX_FILE_CONTROL_CANCEL, NULL, silent);
     }
+
+    for (size_t i = 0; i < friend->file_receiver.size; ++i) {
+        close_file_transfer(NULL, toxic, friend->file_receiver.transfers[i], TOX_FILE_CONTROL_CANCEL, NULL, silent);
+    }
+
+    send_queue_clear(&friend->file_send_queue);
 }
 
 void kill_all_file_transfers(Toxic *toxic)
@@ -416,6 +819,21 @@ void kill_all_file_transfers(Toxic *toxic)
         return;
     }
 
+    /* save where each incoming transfer got to, and keep the records when the transfers are closed */
+    for (size_t i = 0; i < toxic->friends->max_idx; ++i) {
+        const FileTransferTable *receivers = &toxic->friends->list[i].file_receiver;
+
+        for (size_t j = 0; j < receivers->size; ++j) {
+            FileTransfer *ft = receivers->transfers[j];
+
+            if (ft->state != FILE_TRANSFER_INACTIVE && ft->file_type == TOX_FILE_KIND_DATA && ft->writer != NULL) {
+                file_transfer_save_journal(toxic, ft);
+            }
+
+            ft->journaled = false;
+        }
+    }
+
     for (size_t i = 0; i < toxic->friends->max_idx; ++i) {
         kill_all_file_transfers_friend(toxic, toxic->friends->list[i].num);
     }
@@ -432,8 +850,10 @@ bool file_transfer_recv_path_exists(const FriendsList *friends, const char *path
             continue;
         }
 
-        for (size_t i = 0; i < MAX_FILES; ++i) {
-            FileTransfer *ft = &friends->list[friendnumber].file_receiver[i];
+        const FileTransferTable *receivers = &friends->list[friendnumber].file_receiver;
+
+        for (size_t i = 0; i < receivers->size; ++i) {
+            const FileTransfer *ft = receivers->transfers[i];
 
             if (ft->state == FILE_TRANSFER_INACTIVE) {
                 continue;
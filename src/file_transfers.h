@@ -12,8 +12,12 @@
 #include <limits.h>
 #include <time.h>
 
+#include "file_reader.h"
+#include "file_writer.h"
 #include "notify.h"
+#include "send_queue.h"
 #include "toxic.h"
+#include "transfer_stats.h"
 #include "windows.h"
 
 #define KiB (uint32_t)  1024
@@ -22,7 +26,16 @@
 
 typedef struct FriendsList FriendsList;
 
-#define MAX_FILES 32
+/* toxcore's limit on the number of file transfers in each direction with a friend at once */
+#define MAX_FILE_TRANSFERS 256
+
+/* Maximum number of outgoing data file transfers with a friend that may be in progress at once. Files sent
+ * while this many are in progress wait in the friend's send queue and are started as the others finish.
+ */
+#define MAX_ACTIVE_FILE_SENDS 8
+
+/* Number of seconds between saves of the journal records of incoming file transfers */
+#define FILE_TRANSFER_JOURNAL_INTERVAL 5
 
 typedef enum FILE_TRANSFER_STATE {
     FILE_TRANSFER_INACTIVE,
@@ -39,41 +52,44 @@ typedef enum FILE_TRANSFER_DIRECTION {
 typedef struct FileTransfer {
     ToxWindow *window;
     FILE *file;
+    struct file_reader *reader;    /* Only used by senders of data files */
+    struct file_writer *writer;    /* Only used by receivers */
     FILE_TRANSFER_STATE state;
+    FILE_TRANSFER_DIRECTION direction;
     uint8_t file_type;
     char file_name[TOX_MAX_FILENAME_LENGTH + 1];
     char file_path[TOXIC_MAX_PATH_LENGTH + 1];    /* Not used by senders */
-    double   bps;
+    struct transfer_rate rate;    /* Sampled by file_transfers_get_stats() */
     uint32_t filenumber;
     uint32_t friendnumber;
     size_t   index;
     uint64_t file_size;
     uint64_t position;
-    time_t   last_line_progress;   /* The last time we updated the progress bar */
-    uint32_t line_id;
     uint8_t  file_id[TOX_FILE_ID_LENGTH];
+    bool     journaled;           /* Only used by receivers: a transfer journal record has been saved */
+    uint64_t journal_position;    /* The position in the saved journal record */
+    uint64_t journal_checksum;    /* The checksum in the saved journal record */
+    uint32_t dir_id;              /* The id of the directory transfer this file is part of, or 0 if it's on its own */
 } FileTransfer;
 
-typedef struct PendingFileTransfer {
-    char      file_path[TOX_MAX_FILENAME_LENGTH + 1];
-    size_t    length;
-    uint32_t  friendnumber;
-    bool      pending;
-} PendingFileTransfer;
-
-
-/* creates initial progress line that will be updated during file transfer.
-   progline must be at lesat MAX_STR_SIZE bytes */
-void init_progress_bar(char *progline);
-
-/* prints a progress bar for file transfers */
-void print_progress_bar(ToxWindow *self, double pct_done, double bps, uint32_t line_id);
-
-/* refreshes active file transfer status bars.
+/* The file transfers in one direction with a friend. Each transfer is allocated separately so that pointers to
+ * it stay valid as the table grows, and is kept for reuse once it's inactive; a transfer's index is its
+ * position in the table. A zeroed struct is an empty table.
+ */
+typedef struct FileTransferTable {
+    struct FileTransfer **transfers;
+    size_t size;
+    size_t next;    /* Only used by senders: the index of the transfer to be served first by file_transfers_send_pending() */
+} FileTransferTable;
+
+/* Puts a snapshot of each of `friendnumber`'s file transfers that are in progress in `stats`, up to `max` of
+ * them, and samples their rates at time `now` (see transfer_stats_now()). Files in a directory are left out,
+ * since they're shown as part of their directory.
  *
- * Return true if there is at least one active file transfer in either direction.
+ * Return the number of file transfers in progress, which may be more than `max`.
  */
-bool refresh_file_transfer_progress(FriendsList *friends, ToxWindow *self, uint32_t friendnumber);
+size_t file_transfers_get_stats(FriendsList *friends, uint32_t friendnumber, struct transfer_stat *stats, size_t max,
+                                uint64_t now);
 
 /* Returns a pointer to friendnumber's FileTransfer struct associated with filenumber.
  * Returns NULL if filenumber is invalid.
@@ -94,31 +110,80 @@ struct FileTransfer *new_file_transfer(FriendsList *friends, ToxWindow *window,
                                        uint32_t filenumber,
                                        FILE_TRANSFER_DIRECTION direction, uint8_t type);
 
+/* Frees the file transfer tables and send queue of `friendnumber`. Their transfers must already be closed. */
+void free_file_transfers_friend(FriendsList *friends, uint32_t friendnumber);
+
+/* Returns the number of outgoing data file transfers with `friendnumber` that are in progress or paused. */
+size_t file_transfer_num_active_sends(const FriendsList *friends, uint32_t friendnumber);
+
 /* Adds a file designated by `file_path` of length `length` to the file transfer queue.
  *
  * Items in this queue will be automatically sent to the contact designated by `friendnumber`
- * as soon as they appear online. The item will then be removed from the queue whether
- * or not the transfer successfully initiates.
+ * in the order they were added, as soon as they're online and fewer than MAX_ACTIVE_FILE_SENDS
+ * of their outgoing transfers are in progress. The item will then be removed from the queue
+ * whether or not the transfer successfully initiates.
  *
  * If the ToxWindow associated with this friend is closed, all queued items will be
  * discarded.
  *
- * Return the queue index on success.
+ * Return the queue index on success. Queue indices are never less than MAX_FILE_TRANSFERS, so
+ * they can't be mistaken for the index of a file transfer.
  * Return -1 if the length is invalid.
- * Return -2 if the send queue is full.
+ * Return -2 if the path is too long.
+ * Return -3 on memory allocation failure.
  */
 int file_send_queue_add(FriendsList *friends, uint32_t friendnumber, const char *file_path, size_t length);
 
-/* Initiates all file transfers from the file send queue for friend designated by `friendnumber`. */
+/* Initiates file transfers from the file send queue for friend designated by `friendnumber` until
+ * the queue is empty or MAX_ACTIVE_FILE_SENDS of their outgoing transfers are in progress.
+ */
 void file_send_queue_check(ToxWindow *self, Toxic *toxic, uint32_t friendnumber);
 
-/* Removes the `index`-th item from the file send queue for `friendnumber`.
+/* Removes the item with queue index `index` from the file send queue for `friendnumber`.
  *
  * Return 0 if a pending transfer was successfully removed
  * Return -1 if index does not designate a pending file transfer.
  */
 int file_send_queue_remove(FriendsList *friends, uint32_t friendnumber, size_t index);
 
+/* Starts queued file transfers, and the next files of directories being sent, for every online friend that
+ * has room for them.
+ */
+void file_transfers_schedule(Toxic *toxic);
+
+/* Sends the chunks that toxcore has asked for from `ft` whose data has been read from disk. Chunks that
+ * haven't been read yet are sent by file_transfers_send_pending() once they have.
+ */
+void file_transfer_send_chunks(const Toxic *toxic, struct FileTransfer *ft);
+
+/* Sends the chunks that were waiting on disk reads for every outgoing file transfer. Each friend's transfers
+ * take turns at being served first, so that one transfer can't take all of toxcore's send queue.
+ */
+void file_transfers_send_pending(const Toxic *toxic);
+
+/* Resumes incoming file transfers that were paused while their data was being written to disk, accepts
+ * resumed transfers once their saved data has been checked, and cancels those whose writes have failed.
+ */
+void file_transfers_check_writers(const Toxic *toxic);
+
+/* Looks for a journal record of an earlier attempt at receiving the file with `ft`'s file_id from its
+ * sender. If there is one, and the partial file it names is still there, `ft` is set up to save to
+ * that file and to resume from where the record left off once it's accepted.
+ *
+ * `ft`'s file_id and file_size must be set.
+ *
+ * Return true if the transfer will be resumed.
+ */
+bool file_transfer_load_journal(const Toxic *toxic, struct FileTransfer *ft);
+
+/* Saves how much of each incoming file transfer has been written to disk, so that they can be resumed
+ * if they're interrupted.
+ */
+void file_transfers_save_journals(const Toxic *toxic);
+
+/* Removes the journal records of every incoming file transfer from `friendnumber`. */
+void file_transfers_remove_journals(const Toxic *toxic, uint32_t friendnumber);
+
 /* Closes file transfer ft.
  *
  * Set CTRL to -1 if we don't want to send a control signal.
@@ -133,6 +198,8 @@ void kill_avatar_file_transfers_friend(Toxic *toxic, uint32_t friendnumber);
 /* Kills all active file transfers for friendnumber */
 void kill_all_file_transfers_friend(Toxic *toxic, uint32_t friendnumber);
 
+/* Kills all active file transfers. Incoming transfers keep their journal records so that they can be
+ * resumed the next time they're offered. */
 void kill_all_file_transfers(Toxic *toxic);
 
 /* Return true if any pending or active file receiver has the path `path`. */
@@ -0,0 +1,585 @@
+/*  file_writer.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE    /* needed for O_CLOEXEC and pread() */
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file_writer.h"
+
+typedef enum File_Write_Type {
+    FILE_WRITE_DATA,
+    FILE_WRITE_VERIFY,     /* checks the saved prefix of a resumed file */
+    FILE_WRITE_CLOSE,
+} File_Write_Type;
+
+struct file_write {
+    struct file_write *next;
+    struct file_writer *writer;
+    File_Write_Type type;
+    size_t length;
+    size_t capacity;
+    bool sync;             /* fsync the file before closing it */
+    uint64_t position;     /* length of the saved prefix to verify */
+    uint64_t checksum;     /* expected checksum of the saved prefix */
+    uint8_t data[];
+};
+
+struct file_writer {
+    int fd;
+
+    /* Only touched by the thread appending to the writer */
+    struct file_write *current;       /* block being filled */
+    size_t next_capacity;             /* size of the next block, which keeps blocks aligned to the file offset */
+    struct file_write *close_entry;   /* allocated up front so closing can't fail */
+
+    /* Guarded by the global lock */
+    size_t buffered;                  /* bytes appended that haven't been written yet */
+    uint64_t written;                 /* size of the file as of the last write */
+    uint64_t checksum;                /* checksum of the first `written` bytes of the file */
+    bool throttled;
+    bool verifying;                   /* a resumed file hasn't been reported ready yet */
+    bool verified;                    /* the saved prefix has been checked */
+    bool failed;
+};
+
+static struct file_writers {
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;    /* signalled when the queue becomes non-empty or the thread should stop */
+    pthread_t       tid;
+    bool            running;
+    bool            stop;
+    Reactor         *notify;
+
+    struct file_write *head;
+    struct file_write **tail;
+
+    size_t num_waiting;
+
+    struct file_writer_stats stats;
+} writers = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .tail = &writers.head,
+};
+
+/* Writes all `length` bytes of `data` to `fd`, retrying after partial writes.
+ *
+ * Return true on success.
+ */
+static bool file_writer_write_all(int fd, const uint8_t *data, size_t length, uint64_t *writes)
+{
+    while (length > 0) {
+        const ssize_t written = write(fd, data, length);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        ++*writes;
+        data += written;
+        length -= (size_t) written;
+    }
+
+    return true;
+}
+
+static void file_writer_notify(void)
+{
+    if (writers.notify != NULL) {
+        reactor_signal(writers.notify);
+    }
+}
+
+uint64_t file_writer_checksum(uint64_t checksum, const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; ++i) {
+        checksum = (checksum ^ data[i]) * 1099511628211ULL;
+    }
+
+    return checksum;
+}
+
+/* Checksums the first `position` bytes of `fd`.
+ *
+ * Return true if they were all read and match `checksum`.
+ */
+static bool file_writer_check_prefix(int fd, uint64_t position, uint64_t checksum)
+{
+    uint8_t *buf = malloc(FILE_WRITER_BLOCK_SIZE);
+
+    if (buf == NULL) {
+        return false;
+    }
+
+    uint64_t sum = FILE_WRITER_CHECKSUM_INIT;
+    uint64_t offset = 0;
+
+    while (offset < position) {
+        const size_t want = position - offset < FILE_WRITER_BLOCK_SIZE ? position - offset : FILE_WRITER_BLOCK_SIZE;
+        const ssize_t n = pread(fd, buf, want, (off_t) offset);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            break;
+        }
+
+        sum = file_writer_checksum(sum, buf, (size_t) n);
+        offset += (uint64_t) n;
+    }
+
+    free(buf);
+
+    return offset == position && sum == checksum;
+}
+
+static void file_writer_do_verify(struct file_write *entry)
+{
+    struct file_writer *writer = entry->writer;
+
+    const bool match = file_writer_check_prefix(writer->fd, entry->position, entry->checksum);
+    const uint64_t position = match ? entry->position : 0;
+    const bool ok = ftruncate(writer->fd, (off_t) position) == 0;
+
+    pthread_mutex_lock(&writers.lock);
+
+    writer->written = position;
+    writer->checksum = match ? entry->checksum : FILE_WRITER_CHECKSUM_INIT;
+    writer->verified = true;
+
+    if (!match) {
+        ++writers.stats.restarts;
+    }
+
+    if (!ok) {
+        writer->failed = true;
+        ++writers.stats.errors;
+    }
+
+    file_writer_notify();
+
+    pthread_mutex_unlock(&writers.lock);
+
+    free(entry);
+}
+
+static void file_writer_do_close(struct file_write *entry)
+{
+    struct file_writer *writer = entry->writer;
+
+    pthread_mutex_lock(&writers.lock);
+    const bool failed = writer->failed;
+    pthread_mutex_unlock(&writers.lock);
+
+    const bool sync = entry->sync && !failed && fsync(writer->fd) == 0;
+
+    close(writer->fd);
+
+    pthread_mutex_lock(&writers.lock);
+
+    if (sync) {
+        ++writers.stats.fsyncs;
+    }
+
+    if (writer->throttled || writer->verifying) {
+        --writers.num_waiting;
+    }
+
+    pthread_mutex_unlock(&writers.lock);
+
+    free(writer);
+    free(entry);
+}
+
+/* Carries out `entry` and frees it. Must be called without the lock held. */
+static void file_writer_process(struct file_write *entry)
+{
+    if (entry->type == FILE_WRITE_CLOSE) {
+        file_writer_do_close(entry);
+        return;
+    }
+
+    if (entry->type == FILE_WRITE_VERIFY) {
+        file_writer_do_verify(entry);
+        return;
+    }
+
+    struct file_writer *writer = entry->writer;
+
+    pthread_mutex_lock(&writers.lock);
+    const bool failed = writer->failed;
+    pthread_mutex_unlock(&writers.lock);
+
+    uint64_t writes = 0;
+    const bool ok = !failed && file_writer_write_all(writer->fd, entry->data, entry->length, &writes);
+
+    /* only this thread changes the checksum, so it can be read without the lock */
+    const uint64_t checksum = ok ? file_writer_checksum(writer->checksum, entry->data, entry->length) : 0;
+
+    pthread_mutex_lock(&writers.lock);
+
+    writers.stats.writes += writes;
+    writer->buffered -= entry->length;
+
+    if (ok) {
+        writers.stats.bytes += entry->length;
+        writer->written += entry->length;
+        writer->checksum = checksum;
+    } else if (!failed) {
+        writer->failed = true;
+        ++writers.stats.errors;
+        file_writer_notify();
+    }
+
+    if (writer->throttled && writer->buffered <= FILE_WRITER_LOW_WATER) {
+        file_writer_notify();
+    }
+
+    pthread_mutex_unlock(&writers.lock);
+
+    free(entry);
+}
+
+static void file_writer_queue(struct file_write *entry)
+{
+    pthread_mutex_lock(&writers.lock);
+
+    if (!writers.running) {
+        pthread_mutex_unlock(&writers.lock);
+        file_writer_process(entry);
+        return;
+    }
+
+    entry->next = NULL;
+    *writers.tail = entry;
+    writers.tail = &entry->next;
+
+    pthread_cond_signal(&writers.wake);
+    pthread_mutex_unlock(&writers.lock);
+}
+
+static void *file_writer_thread(void *data)
+{
+    (void) data;
+
+    pthread_mutex_lock(&writers.lock);
+
+    while (true) {
+        while (writers.head == NULL && !writers.stop) {
+            pthread_cond_wait(&writers.wake, &writers.lock);
+        }
+
+        if (writers.head == NULL) {
+            break;
+        }
+
+        struct file_write *batch = writers.head;
+        writers.head = NULL;
+        writers.tail = &writers.head;
+
+        pthread_mutex_unlock(&writers.lock);
+
+        while (batch != NULL) {
+            struct file_write *next = batch->next;
+            file_writer_process(batch);
+            batch = next;
+        }
+
+        pthread_mutex_lock(&writers.lock);
+    }
+
+    pthread_mutex_unlock(&writers.lock);
+
+    return NULL;
+}
+
+int file_writer_start(Reactor *notify)
+{
+    pthread_mutex_lock(&writers.lock);
+
+    if (writers.running) {
+        pthread_mutex_unlock(&writers.lock);
+        return 0;
+    }
+
+    writers.stop = false;
+    writers.notify = notify;
+
+    if (pthread_create(&writers.tid, NULL, file_writer_thread, NULL) != 0) {
+        writers.notify = NULL;
+        pthread_mutex_unlock(&writers.lock);
+        return -1;
+    }
+
+    writers.running = true;
+
+    pthread_mutex_unlock(&writers.lock);
+
+    return 0;
+}
+
+void file_writer_stop(void)
+{
+    pthread_mutex_lock(&writers.lock);
+
+    if (!writers.running) {
+        pthread_mutex_unlock(&writers.lock);
+        return;
+    }
+
+    writers.stop = true;
+    pthread_cond_signal(&writers.wake);
+    pthread_mutex_unlock(&writers.lock);
+
+    pthread_join(writers.tid, NULL);
+
+    pthread_mutex_lock(&writers.lock);
+    writers.running = false;
+    writers.notify = NULL;
+    pthread_mutex_unlock(&writers.lock);
+}
+
+/* Opens `path` for appending with `mode` (O_WRONLY or O_RDWR) and puts its size in `size`. */
+static struct file_writer *file_writer_new(const char *path, int mode, uint64_t *size)
+{
+    struct file_writer *writer = calloc(1, sizeof(struct file_writer));
+
+    if (writer == NULL) {
+        return NULL;
+    }
+
+    writer->close_entry = calloc(1, sizeof(struct file_write));
+
+    if (writer->close_entry == NULL) {
+        free(writer);
+        return NULL;
+    }
+
+    writer->fd = open(path, mode | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+
+    struct stat st;
+
+    if (writer->fd < 0 || fstat(writer->fd, &st) != 0) {
+        if (writer->fd >= 0) {
+            close(writer->fd);
+        }
+
+        free(writer->close_entry);
+        free(writer);
+        return NULL;
+    }
+
+    writer->checksum = FILE_WRITER_CHECKSUM_INIT;
+    *size = (uint64_t) st.st_size;
+
+    return writer;
+}
+
+struct file_writer *file_writer_open(const char *path)
+{
+    uint64_t size;
+    struct file_writer *writer = file_writer_new(path, O_WRONLY, &size);
+
+    if (writer == NULL) {
+        return NULL;
+    }
+
+    writer->written = size;
+    writer->next_capacity = FILE_WRITER_BLOCK_SIZE - (size_t) (size % FILE_WRITER_BLOCK_SIZE);
+
+    return writer;
+}
+
+struct file_writer *file_writer_resume(const char *path, uint64_t position, uint64_t checksum)
+{
+    /* the saved prefix is read back to check it */
+    uint64_t size;
+    struct file_writer *writer = file_writer_new(path, O_RDWR, &size);
+
+    if (writer == NULL) {
+        return NULL;
+    }
+
+    struct file_write *entry = calloc(1, sizeof(struct file_write));
+
+    if (entry == NULL) {
+        file_writer_close(writer, false);
+        return NULL;
+    }
+
+    entry->writer = writer;
+    entry->type = FILE_WRITE_VERIFY;
+    entry->position = position;
+    entry->checksum = checksum;
+
+    pthread_mutex_lock(&writers.lock);
+    writer->verifying = true;
+    ++writers.num_waiting;
+    pthread_mutex_unlock(&writers.lock);
+
+    file_writer_queue(entry);
+
+    return writer;
+}
+
+int file_writer_append(struct file_writer *writer, const uint8_t *data, size_t length)
+{
+    while (length > 0) {
+        struct file_write *block = writer->current;
+
+        if (block == NULL) {
+            block = malloc(sizeof(struct file_write) + writer->next_capacity);
+
+            if (block == NULL) {
+                return -1;
+            }
+
+            block->writer = writer;
+            block->type = FILE_WRITE_DATA;
+            block->length = 0;
+            block->capacity = writer->next_capacity;
+            block->sync = false;
+
+            writer->current = block;
+            writer->next_capacity = FILE_WRITER_BLOCK_SIZE;
+        }
+
+        const size_t n = length < block->capacity - block->length ? length : block->capacity - block->length;
+        memcpy(block->data + block->length, data, n);
+        block->length += n;
+        data += n;
+        length -= n;
+
+        if (block->length == block->capacity) {
+            writer->current = NULL;
+
+            pthread_mutex_lock(&writers.lock);
+            writer->buffered += block->length;
+            pthread_mutex_unlock(&writers.lock);
+
+            file_writer_queue(block);
+        }
+    }
+
+    pthread_mutex_lock(&writers.lock);
+
+    ++writers.stats.chunks;
+
+    const size_t buffered = writer->buffered + (writer->current != NULL ? writer->current->length : 0);
+
+    if (buffered > writers.stats.max_buffered) {
+        writers.stats.max_buffered = buffered;
+    }
+
+    int ret = 0;
+
+    if (writer->failed) {
+        ret = -1;
+    } else if (!writer->throttled && buffered >= FILE_WRITER_HIGH_WATER) {
+        writer->throttled = true;
+        ++writers.num_waiting;
+        ++writers.stats.throttles;
+        ret = 1;
+    }
+
+    pthread_mutex_unlock(&writers.lock);
+
+    return ret;
+}
+
+File_Writer_Event file_writer_poll(struct file_writer *writer)
+{
+    File_Writer_Event event = FILE_WRITER_EVENT_NONE;
+
+    pthread_mutex_lock(&writers.lock);
+
+    if (writer->failed) {
+        event = FILE_WRITER_EVENT_ERROR;
+    } else if (writer->verifying && writer->verified) {
+        writer->verifying = false;
+        --writers.num_waiting;
+        writer->next_capacity = FILE_WRITER_BLOCK_SIZE - (size_t) (writer->written % FILE_WRITER_BLOCK_SIZE);
+        event = FILE_WRITER_EVENT_READY;
+    } else if (writer->throttled && writer->buffered <= FILE_WRITER_LOW_WATER) {
+        writer->throttled = false;
+        --writers.num_waiting;
+        event = FILE_WRITER_EVENT_RESUME;
+    }
+
+    pthread_mutex_unlock(&writers.lock);
+
+    return event;
+}
+
+void file_writer_close(struct file_writer *writer, bool sync)
+{
+    if (writer == NULL) {
+        return;
+    }
+
+    struct file_write *block = writer->current;
+    writer->current = NULL;
+
+    if (block != NULL && block->length > 0) {
+        pthread_mutex_lock(&writers.lock);
+        writer->buffered += block->length;
+        pthread_mutex_unlock(&writers.lock);
+
+        file_writer_queue(block);
+    } else {
+        free(block);
+    }
+
+    struct file_write *entry = writer->close_entry;
+    writer->close_entry = NULL;
+
+    entry->writer = writer;
+    entry->type = FILE_WRITE_CLOSE;
+    entry->sync = sync;
+
+    file_writer_queue(entry);
+}
+
+void file_writer_get_progress(struct file_writer *writer, uint64_t *position, uint64_t *checksum)
+{
+    pthread_mutex_lock(&writers.lock);
+    *position = writer->written;
+    *checksum = writer->checksum;
+    pthread_mutex_unlock(&writers.lock);
+}
+
+size_t file_writer_num_waiting(void)
+{
+    pthread_mutex_lock(&writers.lock);
+    const size_t num_waiting = writers.num_waiting;
+    pthread_mutex_unlock(&writers.lock);
+
+    return num_waiting;
+}
+
+void file_writer_get_stats(struct file_writer_stats *stats)
+{
+    pthread_mutex_lock(&writers.lock);
+    *stats = writers.stats;
+    pthread_mutex_unlock(&writers.lock);
+}
@@ -0,0 +1,129 @@
+/*  file_writer.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef FILE_WRITER_H
+#define FILE_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "reactor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Received chunks are gathered into blocks of this size, aligned to the file offset, before being written */
+#define FILE_WRITER_BLOCK_SIZE (256 * 1024)
+
+/* A writer asks for its sender to be paused once it has this many bytes waiting to be written, and to be
+ * resumed once it's caught up to the low water mark */
+#define FILE_WRITER_HIGH_WATER (16 * FILE_WRITER_BLOCK_SIZE)
+#define FILE_WRITER_LOW_WATER  (4 * FILE_WRITER_BLOCK_SIZE)
+
+/* Starting value for file_writer_checksum() */
+#define FILE_WRITER_CHECKSUM_INIT 14695981039346656037ULL
+
+struct file_writer_stats {
+    uint64_t chunks;          /* number of chunks appended */
+    uint64_t writes;          /* number of write syscalls */
+    uint64_t bytes;           /* number of bytes written */
+    uint64_t fsyncs;          /* number of fsync calls */
+    uint64_t throttles;       /* number of times a writer asked for its sender to be paused */
+    uint64_t errors;          /* number of failed writes */
+    uint64_t restarts;        /* number of resumed files whose saved data didn't match its checksum */
+    uint64_t max_buffered;    /* most bytes any writer has had waiting to be written */
+};
+
+typedef enum File_Writer_Event {
+    FILE_WRITER_EVENT_NONE,
+    FILE_WRITER_EVENT_RESUME,    /* the writer has caught up, so its sender can be resumed */
+    FILE_WRITER_EVENT_READY,     /* a resumed file has been checked and is ready to be appended to */
+    FILE_WRITER_EVENT_ERROR,     /* a write failed */
+} File_Writer_Event;
+
+/*
+ * Writes incoming file transfers to disk on a background thread.
+ *
+ * Chunks are copied into blocks as they arrive, and full blocks are written by a single background thread,
+ * so a slow disk never stalls the thread receiving the chunks. A writer holds a bounded amount of data:
+ * once it's past the high water mark file_writer_append() asks the caller to pause the sender, and
+ * file_writer_poll() says when it can be resumed.
+ *
+ * If the background thread isn't running, blocks are written as soon as they're full instead.
+ */
+struct file_writer;
+
+/* Starts the background thread, which signals `notify` when a throttled writer has caught up or one of
+ * its writes has failed.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int file_writer_start(Reactor *notify);
+
+/* Writes everything that's been queued and stops the background thread. */
+void file_writer_stop(void);
+
+/* Opens the file at `path` for appending, creating it if it doesn't exist.
+ *
+ * Return NULL on failure.
+ */
+struct file_writer *file_writer_open(const char *path);
+
+/* Opens the file at `path` to resume a transfer that had saved `position` bytes with the given checksum.
+ *
+ * The saved bytes are checked on the background thread, and anything after them is cut off. Nothing may
+ * be appended until file_writer_poll() has returned FILE_WRITER_EVENT_READY, after which
+ * file_writer_get_progress() gives the position to resume from: `position` if the saved bytes matched,
+ * and 0 if they didn't, in which case the file is emptied.
+ *
+ * Return NULL on failure.
+ */
+struct file_writer *file_writer_resume(const char *path, uint64_t position, uint64_t checksum);
+
+/* Appends `length` bytes to the file.
+ *
+ * Return 0 on success.
+ * Return 1 on success if the writer has too much data waiting to be written and the sender should be paused.
+ * Return -1 if a write has failed.
+ */
+int file_writer_append(struct file_writer *writer, const uint8_t *data, size_t length);
+
+/* Returns FILE_WRITER_EVENT_ERROR if a write has failed, FILE_WRITER_EVENT_READY once after a resumed file
+ * has been checked, FILE_WRITER_EVENT_RESUME once after file_writer_append() has returned 1 and the writer
+ * has caught up, and FILE_WRITER_EVENT_NONE otherwise. */
+File_Writer_Event file_writer_poll(struct file_writer *writer);
+
+/* Puts the number of bytes in the file that have been written in `position`, and their checksum in
+ * `checksum`. Bytes that are still buffered aren't counted. */
+void file_writer_get_progress(struct file_writer *writer, uint64_t *position, uint64_t *checksum);
+
+/* Closes `writer` without waiting for it. Anything still buffered is written on the background thread,
+ * followed by a single fsync if `sync` is true. */
+void file_writer_close(struct file_writer *writer, bool sync);
+
+/* Returns the number of writers that have an event for file_writer_poll() to return, or will have one:
+ * those that have asked for their sender to be paused, and resumed files that haven't been reported
+ * ready yet. */
+size_t file_writer_num_waiting(void);
+
+/* Returns `checksum` updated with `length` bytes of `data`. Checksumming a file in pieces gives the same
+ * result however it's split. */
+uint64_t file_writer_checksum(uint64_t checksum, const uint8_t *data, size_t length);
+
+/* Puts a snapshot of the writer counters in `stats`. */
+void file_writer_get_stats(struct file_writer_stats *stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* FILE_WRITER_H */
@@ -0,0 +1,496 @@
+#include "file_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// The largest chunk toxcore delivers
+constexpr size_t kChunkSize = 1371;
+
+class FileWriter : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        std::snprintf(path_, sizeof(path_), "%s/toxic_file_writer_test_XXXXXX", testing::TempDir().c_str());
+        const int fd = mkstemp(path_);
+        ASSERT_NE(fd, -1);
+        close(fd);
+    }
+
+    void TearDown() override
+    {
+        file_writer_stop();
+
+        if (notify_started_) {
+            reactor_free(&notify_);
+        }
+
+        std::remove(path_);
+    }
+
+    void make_contents(size_t size)
+    {
+        contents_.resize(size);
+        uint32_t seed = 1;
+
+        for (size_t i = 0; i < size; ++i) {
+            seed = seed * 1103515245 + 12345;
+            contents_[i] = static_cast<uint8_t>(seed >> 16);
+        }
+    }
+
+    void start_thread()
+    {
+        ASSERT_EQ(reactor_init(&notify_), 0);
+        notify_started_ = true;
+        ASSERT_EQ(file_writer_start(&notify_), 0);
+    }
+
+    // Appends the contents a chunk at a time, starting at `offset`.
+    void append_all(struct file_writer *writer, size_t offset = 0)
+    {
+        for (size_t i = offset; i < contents_.size(); i += kChunkSize) {
+            const size_t length = std::min(kChunkSize, contents_.size() - i);
+            ASSERT_EQ(file_writer_append(writer, contents_.data() + i, length), 0);
+        }
+    }
+
+    std::vector<uint8_t> read_file() const
+    {
+        std::vector<uint8_t> data;
+        FILE *file = std::fopen(path_, "rb");
+
+        if (file == nullptr) {
+            return data;
+        }
+
+        uint8_t buf[4096];
+        size_t n;
+
+        while ((n = std::fread(buf, 1, sizeof(buf), file)) > 0) {
+            data.insert(data.end(), buf, buf + n);
+        }
+
+        std::fclose(file);
+        return data;
+    }
+
+    struct file_writer_stats stats_delta() const
+    {
+        struct file_writer_stats stats;
+        file_writer_get_stats(&stats);
+
+        stats.chunks -= initial_.chunks;
+        stats.writes -= initial_.writes;
+        stats.bytes -= initial_.bytes;
+        stats.fsyncs -= initial_.fsyncs;
+        stats.throttles -= initial_.throttles;
+        stats.errors -= initial_.errors;
+        stats.restarts -= initial_.restarts;
+        return stats;
+    }
+
+    void snapshot_stats()
+    {
+        file_writer_get_stats(&initial_);
+    }
+
+    char path_[PATH_MAX];
+    std::vector<uint8_t> contents_;
+    Reactor notify_;
+    bool notify_started_ = false;
+    struct file_writer_stats initial_ = {0};
+};
+
+TEST_F(FileWriter, WritesInOrderWithoutThread)
+{
+    make_contents(FILE_WRITER_BLOCK_SIZE * 3 + 1000);
+    snapshot_stats();
+
+    struct file_writer *writer = file_writer_open(path_);
+    ASSERT_NE(writer, nullptr);
+
+    append_all(writer);
+    file_writer_close(writer, true);
+
+    EXPECT_EQ(read_file(), contents_);
+
+    const struct file_writer_stats stats = stats_delta();
+    EXPECT_EQ(stats.bytes, contents_.size());
+    EXPECT_EQ(stats.writes, 4u);
+    EXPECT_EQ(stats.fsyncs, 1u);
+}
+
+TEST_F(FileWriter, CoalescesChunksOnBackgroundThread)
+{
+    make_contents(FILE_WRITER_BLOCK_SIZE * 8 + 77);
+    start_thread();
+    snapshot_stats();
+
+    struct file_writer *writer = file_writer_open(path_);
+    ASSERT_NE(writer, nullptr);
+
+    append_all(writer);
+    file_writer_close(writer, true);
+    file_writer_stop();
+
+    EXPECT_EQ(read_file(), contents_);
+
+    // thousands of chunks become one write per block and a single fsync
+    const struct file_writer_stats stats = stats_delta();
+    EXPECT_GT(stats.chunks, 1000u);
+    EXPECT_EQ(stats.writes, 9u);
+    EXPECT_EQ(stats.fsyncs, 1u);
+    EXPECT_EQ(stats.errors, 0u);
+}
+
+TEST_F(FileWriter, AppendsToExistingFileOnBlockBoundaries)
+{
+    make_contents(FILE_WRITER_BLOCK_SIZE * 2);
+
+    // a resumed transfer: part of the file was saved before
+    const size_t prefix = 1000;
+    FILE *file = std::fopen(path_, "wb");
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(std::fwrite(contents_.data(), 1, prefix, file), prefix);
+    std::fclose(file);
+
+    snapshot_stats();
+
+    struct file_writer *writer = file_writer_open(path_);
+    ASSERT_NE(writer, nullptr);
+
+    append_all(writer, prefix);
+    file_writer_close(writer, false);
+
+    EXPECT_EQ(read_file(), contents_);
+
+    // the first block is short so the rest end on block boundaries
+    const struct file_writer_stats stats = stats_delta();
+    EXPECT_EQ(stats.writes, 2u);
+    EXPECT_EQ(stats.fsyncs, 0u);
+}
+
+TEST_F(FileWriter, ThrottlesUntilCaughtUp)
+{
+    // a fifo can only hold a little, so the background thread blocks until the test reads from it
+    std::remove(path_);
+    ASSERT_EQ(mkfifo(path_, 0600), 0);
+
+    const int reader = open(path_, O_RDONLY | O_NONBLOCK);
+    ASSERT_NE(reader, -1);
+
+    start_thread();
+
+    struct file_writer *writer = file_writer_open(path_);
+    ASSERT_NE(writer, nullptr);
+
+    make_contents(FILE_WRITER_HIGH_WATER + FILE_WRITER_BLOCK_SIZE);
+
+    size_t appended = 0;
+    int ret = 0;
+
+    while (appended < contents_.size() && ret == 0) {
+        const size_t length = std::min(kChunkSize, contents_.size() - appended);
+        ret = file_writer_append(writer, contents_.data() + appended, length);
+        appended += length;
+    }
+
+    ASSERT_EQ(ret, 1);
+    EXPECT_EQ(file_writer_num_waiting(), 1u);
+    EXPECT_EQ(file_writer_poll(writer), FILE_WRITER_EVENT_NONE);
+
+    // drain the fifo until the writer says the sender can be resumed
+    std::vector<uint8_t> received;
+    File_Writer_Event event;
+
+    while ((event = file_writer_poll(writer)) == FILE_WRITER_EVENT_NONE) {
+        uint8_t buf[65536];
+        const ssize_t n = read(reader, buf, sizeof(buf));
+
+        if (n > 0) {
+            received.insert(received.end(), buf, buf + n);
+        } else {
+            reactor_wait(&notify_, -1, 10);
+        }
+    }
+
+    EXPECT_EQ(event, FILE_WRITER_EVENT_RESUME);
+    EXPECT_EQ(file_writer_num_waiting(), 0u);
+    EXPECT_EQ(file_writer_poll(writer), FILE_WRITER_EVENT_NONE);
+
+    file_writer_close(writer, false);
+
+    // the rest arrives in order once the writer is closed
+    while (true) {
+        uint8_t buf[65536];
+        const ssize_t n = read(reader, buf, sizeof(buf));
+
+        if (n > 0) {
+            received.insert(received.end(), buf, buf + n);
+        } else if (n == 0 && received.size() >= appended) {
+            break;
+        } else {
+            usleep(1000);
+        }
+    }
+
+    close(reader);
+
+    ASSERT_EQ(received.size(), appended);
+    EXPECT_EQ(std::memcmp(received.data(), contents_.data(), appended), 0);
+}
+
+TEST_F(FileWriter, WriteErrorIsReported)
+{
+    if (access("/dev/full", W_OK) != 0) {
+        GTEST_SKIP() << "/dev/full is not available";
+    }
+
+    start_thread();
+
+    struct file_writer *writer = file_writer_open("/dev/full");
+    ASSERT_NE(writer, nullptr);
+
+    make_contents(FILE_WRITER_BLOCK_SIZE * 2);
+
+    for (size_t i = 0; i < contents_.size(); i += kChunkSize) {
+        const size_t length = std::min(kChunkSize, contents_.size() - i);
+        ASSERT_NE(file_writer_append(writer, contents_.data() + i, length), 1);
+    }
+
+    File_Writer_Event event;
+
+    while ((event = file_writer_poll(writer)) == FILE_WRITER_EVENT_NONE) {
+        ASSERT_GE(reactor_wait(&notify_, -1, 1000), 0);
+    }
+
+    EXPECT_EQ(event, FILE_WRITER_EVENT_ERROR);
+    EXPECT_EQ(file_writer_append(writer, contents_.data(), kChunkSize), -1);
+
+    file_writer_close(writer, true);
+}
+
+TEST_F(FileWriter, CloseWhileThrottled)
+{
+    std::remove(path_);
+    ASSERT_EQ(mkfifo(path_, 0600), 0);
+
+    const int reader = open(path_, O_RDONLY | O_NONBLOCK);
+    ASSERT_NE(reader, -1);
+
+    start_thread();
+
+    struct file_writer *writer = file_writer_open(path_);
+    ASSERT_NE(writer, nullptr);
+
+    make_contents(FILE_WRITER_HIGH_WATER + FILE_WRITER_BLOCK_SIZE);
+
+    int ret = 0;
+
+    for (size_t i = 0; i < contents_.size() && ret == 0; i += kChunkSize) {
+        ret = file_writer_append(writer, contents_.data() + i, std::min(kChunkSize, contents_.size() - i));
+    }
+
+    ASSERT_EQ(ret, 1);
+
+    // the transfer is cancelled while its sender is paused
+    file_writer_close(writer, false);
+
+    uint8_t buf[65536];
+    ssize_t n;
+
+    while ((n = read(reader, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            usleep(1000);
+        }
+    }
+
+    close(reader);
+
+    file_writer_stop();
+    EXPECT_EQ(file_writer_num_waiting(), 0u);
+}
+
+TEST_F(FileWriter, ProgressTracksWrittenBytes)
+{
+    make_contents(FILE_WRITER_BLOCK_SIZE * 2 + 500);
+    start_thread();
+
+    struct file_writer *writer = file_writer_open(path_);
+    ASSERT_NE(writer, nullptr);
+
+    append_all(writer);
+
+    // wait for the full blocks to be written; the partial one stays buffered until close
+    uint64_t position;
+    uint64_t checksum;
+
+    do {
+        usleep(1000);
+        file_writer_get_progress(writer, &position, &checksum);
+    } while (position < FILE_WRITER_BLOCK_SIZE * 2);
+
+    EXPECT_EQ(position, FILE_WRITER_BLOCK_SIZE * 2u);
+    EXPECT_EQ(checksum, file_writer_checksum(FILE_WRITER_CHECKSUM_INIT, contents_.data(), position));
+
+    file_writer_close(writer, false);
+}
+
+TEST_F(FileWriter, ChecksumDoesNotDependOnSplit)
+{
+    make_contents(10000);
+
+    const uint64_t whole = file_writer_checksum(FILE_WRITER_CHECKSUM_INIT, contents_.data(), contents_.size());
+    uint64_t pieces = FILE_WRITER_CHECKSUM_INIT;
+
+    for (size_t i = 0; i < contents_.size(); i += 777) {
+        pieces = file_writer_checksum(pieces, contents_.data() + i, std::min<size_t>(777, contents_.size() - i));
+    }
+
+    EXPECT_EQ(whole, pieces);
+    EXPECT_NE(whole, file_writer_checksum(FILE_WRITER_CHECKSUM_INIT, contents_.data(), contents_.size() - 1));
+}
+
+class FileWriterResume : public FileWriter {
+protected:
+    // Saves the first `saved` bytes of the contents plus `junk` bytes of garbage, as a transfer that was
+    // interrupted after its journal was last saved would leave them.
+    void save_partial(size_t saved, size_t junk)
+    {
+        FILE *file = std::fopen(path_, "wb");
+        ASSERT_NE(file, nullptr);
+        ASSERT_EQ(std::fwrite(contents_.data(), 1, saved, file), saved);
+
+        for (size_t i = 0; i < junk; ++i) {
+            std::fputc(0xAA, file);
+        }
+
+        std::fclose(file);
+    }
+
+    // Resumes the transfer and waits for the writer to be ready, returning the position to resume from.
+    uint64_t resume(struct file_writer **writer, uint64_t position, uint64_t checksum)
+    {
+        *writer = file_writer_resume(path_, position, checksum);
+        EXPECT_NE(*writer, nullptr);
+
+        if (*writer == nullptr) {
+            return UINT64_MAX;
+        }
+
+        EXPECT_EQ(file_writer_num_waiting(), 1u);
+
+        File_Writer_Event event;
+
+        while ((event = file_writer_poll(*writer)) == FILE_WRITER_EVENT_NONE) {
+            EXPECT_GE(reactor_wait(&notify_, -1, 1000), 0);
+        }
+
+        EXPECT_EQ(event, FILE_WRITER_EVENT_READY);
+        EXPECT_EQ(file_writer_num_waiting(), 0u);
+
+        uint64_t resume_position;
+        uint64_t resume_checksum;
+        file_writer_get_progress(*writer, &resume_position, &resume_checksum);
+
+        return resume_position;
+    }
+};
+
+TEST_F(FileWriterResume, MatchingPrefixResumes)
+{
+    make_contents(FILE_WRITER_BLOCK_SIZE * 3 + 10);
+    const size_t saved = FILE_WRITER_BLOCK_SIZE + 4321;
+    save_partial(saved, 5000);
+    start_thread();
+    snapshot_stats();
+
+    struct file_writer *writer;
+    const uint64_t checksum = file_writer_checksum(FILE_WRITER_CHECKSUM_INIT, contents_.data(), saved);
+    ASSERT_EQ(resume(&writer, saved, checksum), saved);
+
+    append_all(writer, saved);
+    file_writer_close(writer, true);
+    file_writer_stop();
+
+    // the garbage after the saved prefix was cut off
+    EXPECT_EQ(read_file(), contents_);
+
+    const struct file_writer_stats stats = stats_delta();
+    EXPECT_EQ(stats.restarts, 0u);
+
+    // and the rest was written in whole blocks
+    EXPECT_EQ(stats.writes, 3u);
+}
+
+TEST_F(FileWriterResume, ChangedPrefixRestarts)
+{
+    make_contents(FILE_WRITER_BLOCK_SIZE * 2);
+    const size_t saved = 100000;
+    save_partial(saved, 0);
+    start_thread();
+    snapshot_stats();
+
+    uint64_t checksum = file_writer_checksum(FILE_WRITER_CHECKSUM_INIT, contents_.data(), saved);
+    ++checksum;
+
+    struct file_writer *writer;
+    ASSERT_EQ(resume(&writer, saved, checksum), 0u);
+
+    append_all(writer);
+    file_writer_close(writer, false);
+    file_writer_stop();
+
+    EXPECT_EQ(read_file(), contents_);
+    EXPECT_EQ(stats_delta().restarts, 1u);
+}
+
+TEST_F(FileWriterResume, ShortFileRestarts)
+{
+    make_contents(50000);
+    save_partial(1000, 0);
+    start_thread();
+
+    // the journal says more was saved than the file holds
+    const uint64_t checksum = file_writer_checksum(FILE_WRITER_CHECKSUM_INIT, contents_.data(), 2000);
+
+    struct file_writer *writer;
+    ASSERT_EQ(resume(&writer, 2000, checksum), 0u);
+
+    file_writer_close(writer, false);
+    file_writer_stop();
+
+    EXPECT_TRUE(read_file().empty());
+}
+
+TEST_F(FileWriterResume, CloseBeforeReady)
+{
+    make_contents(FILE_WRITER_BLOCK_SIZE);
+    save_partial(contents_.size(), 0);
+    start_thread();
+
+    const uint64_t checksum = file_writer_checksum(FILE_WRITER_CHECKSUM_INIT, contents_.data(), contents_.size());
+    struct file_writer *writer = file_writer_resume(path_, contents_.size(), checksum);
+    ASSERT_NE(writer, nullptr);
+
+    file_writer_close(writer, false);
+    file_writer_stop();
+
+    EXPECT_EQ(file_writer_num_waiting(), 0u);
+    EXPECT_EQ(read_file(), contents_);
+}
+
+}  // namespace
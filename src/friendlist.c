@@ -20,6 +20,7 @@
 #include "help.h"
 #include "line_info.h"
 #include "log.h"
+#include "message_queue.h"
 #include "misc_tools.h"
 #include "notify.h"
 #include "prompt.h"
@@ -37,8 +38,11 @@ struct BlockedList {
     int num_blocked;
     uint32_t *index;
     BlockedFriend *list;
+    Peer_Map keys;    /* indexes of the active entries in list keyed by public key */
 };
 
+static int friendlist_order_cmp(uint32_t index1, uint32_t index2, const void *userdata);
+
 void init_friendlist(Toxic *toxic)
 {
     toxic->friends = calloc(1, sizeof(FriendsList));
@@ -47,6 +51,8 @@ void init_friendlist(Toxic *toxic)
         exit_toxic_err(FATALERR_MEMORY, "failed in init_friendlist");
     }
 
+    peer_order_init(&toxic->friends->order, friendlist_order_cmp, toxic->friends);
+
     toxic->blocked = calloc(1, sizeof(BlockedList));
 
     if (toxic->blocked == NULL) {
@@ -98,21 +104,17 @@ static void realloc_friends(FriendsList *friends, int n)
 {
     if (n <= 0) {
         free(friends->list);
-        free(friends->index);
         friends->list = NULL;
-        friends->index = NULL;
         return;
     }
 
     ToxicFriend *f = realloc(friends->list, n * sizeof(ToxicFriend));
-    uint32_t *f_idx = realloc(friends->index, n * sizeof(uint32_t));
 
-    if (f == NULL || f_idx == NULL) {
+    if (f == NULL) {
         exit_toxic_err(FATALERR_MEMORY, "failed in realloc_friends");
     }
 
     friends->list = f;
-    friends->index = f_idx;
 }
 
 static void realloc_blocklist(BlockedList *blocked, int n)
@@ -152,10 +154,19 @@ void kill_friendlist(ToxWindow *self, FriendsList *friends, BlockedList *blocked
         }
 
         free(friends->list[i].group_invite.data);
+        free_file_transfers_friend(friends, i);
     }
 
     realloc_blocklist(blocked, 0);
+    peer_map_free(&blocked->keys);
     realloc_friends(friends, 0);
+    peer_order_free(&friends->order);
+    name_index_free(&friends->names);
+    name_index_free(&friends->folded_names);
+    free(friends->filter.matches);
+    peer_map_free(&friends->keys);
+    peer_map_free(&friends->key_idents);
+    peer_map_free(&friends->nicks);
     free(self->help);
     del_window(self, windows, c_config);
 }
@@ -175,6 +186,262 @@ static void clear_friendlist_index(FriendsList *friends, size_t idx)
     };
 }
 
+/* Compares friends in the friend list order, online friends first and then by name. */
+static int friendlist_order_cmp(uint32_t index1, uint32_t index2, const void *userdata)
+{
+    const FriendsList *friends = (const FriendsList *) userdata;
+    const ToxicFriend *friend1 = &friends->list[index1];
+    const ToxicFriend *friend2 = &friends->list[index2];
+
+    const bool online1 = friend1->connection_status != TOX_CONNECTION_NONE;
+    const bool online2 = friend2->connection_status != TOX_CONNECTION_NONE;
+
+    if (online1 != online2) {
+        return online1 ? -1 : 1;
+    }
+
+    return qsort_strcasecmp_hlpr(friend1->name, friend2->name);
+}
+
+/* Puts `name` with its ASCII letters in lower case in `buf`, the same way that the filter is folded. */
+static void fold_name(char *buf, size_t buf_size, const char *name)
+{
+    size_t i = 0;
+
+    for (; i + 1 < buf_size && name[i] != '\0'; ++i) {
+        const char ch = name[i];
+        buf[i] = ch >= 'A' && ch <= 'Z' ? ch + ('a' - 'A') : ch;
+    }
+
+    buf[i] = '\0';
+}
+
+/* Adds the active friend at `idx` in the friend list to the friend indexes. */
+static void friendlist_index_add(FriendsList *friends, uint32_t idx)
+{
+    const ToxicFriend *friend = &friends->list[idx];
+
+    char folded[TOXIC_MAX_NAME_LENGTH + 1];
+    fold_name(folded, sizeof(folded), friend->name);
+
+    if (peer_map_add(&friends->keys, peer_map_key_bytes(friend->pub_key, TOX_PUBLIC_KEY_SIZE), idx) != 0
+            || peer_map_add(&friends->key_idents, peer_map_key_bytes(friend->pub_key, KEY_IDENT_BYTES / 2), idx) != 0
+            || peer_map_add(&friends->nicks, peer_map_key_nick(friend->name, friend->namelength), idx) != 0
+            || peer_order_insert(&friends->order, idx) != 0
+            || name_index_add(&friends->names, friend->name, idx) != 0
+            || name_index_add(&friends->folded_names, folded, idx) != 0) {
+        exit_toxic_err(FATALERR_MEMORY, "failed in friendlist_index_add");
+    }
+
+    friends->filter.dirty = true;
+}
+
+/* Removes the friend at `idx` in the friend list from the friend indexes. Must be called before the
+ * friend is cleared.
+ */
+static void friendlist_index_remove(FriendsList *friends, uint32_t idx)
+{
+    const ToxicFriend *friend = &friends->list[idx];
+
+    peer_map_remove(&friends->keys, peer_map_key_bytes(friend->pub_key, TOX_PUBLIC_KEY_SIZE), idx);
+    peer_map_remove(&friends->key_idents, peer_map_key_bytes(friend->pub_key, KEY_IDENT_BYTES / 2), idx);
+    peer_map_remove(&friends->nicks, peer_map_key_nick(friend->name, friend->namelength), idx);
+    peer_order_remove(&friends->order, idx);
+    name_index_remove(&friends->names, friend->name, idx);
+
+    char folded[TOXIC_MAX_NAME_LENGTH + 1];
+    fold_name(folded, sizeof(folded), friend->name);
+    name_index_remove(&friends->folded_names, folded, idx);
+
+    friends->filter.dirty = true;
+}
+
+/* Sets the name of the friend at `idx` in the friend list, keeping the name indexes and friend order
+ * up to date.
+ */
+static void friendlist_set_name(FriendsList *friends, size_t idx, const char *name)
+{
+    ToxicFriend *friend = &friends->list[idx];
+    char folded[TOXIC_MAX_NAME_LENGTH + 1];
+
+    if (friend->active) {
+        fold_name(folded, sizeof(folded), friend->name);
+
+        peer_map_remove(&friends->nicks, peer_map_key_nick(friend->name, friend->namelength), idx);
+        peer_order_remove(&friends->order, idx);
+        name_index_remove(&friends->names, friend->name, idx);
+        name_index_remove(&friends->folded_names, folded, idx);
+    }
+
+    snprintf(friend->name, sizeof(friend->name), "%s", name);
+    friend->namelength = strlen(friend->name);
+
+    if (!friend->active) {
+        return;
+    }
+
+    fold_name(folded, sizeof(folded), friend->name);
+
+    if (peer_map_add(&friends->nicks, peer_map_key_nick(friend->name, friend->namelength), idx) != 0
+            || peer_order_insert(&friends->order, idx) != 0
+            || name_index_add(&friends->names, friend->name, idx) != 0
+            || name_index_add(&friends->folded_names, folded, idx) != 0) {
+        exit_toxic_err(FATALERR_MEMORY, "failed in friendlist_set_name");
+    }
+
+    friends->filter.dirty = true;
+}
+
+/* Sets the connection status of the friend at `idx` in the friend list, keeping the friend order up
+ * to date.
+ */
+static void friendlist_set_connection_status(FriendsList *friends, uint32_t idx, Tox_Connection connection_status)
+{
+    ToxicFriend *friend = &friends->list[idx];
+
+    if (!friend->active) {
+        friend->connection_status = connection_status;
+        return;
+    }
+
+    peer_order_remove(&friends->order, idx);
+
+    friend->connection_status = connection_status;
+
+    if (peer_order_insert(&friends->order, idx) != 0) {
+        exit_toxic_err(FATALERR_MEMORY, "failed in friendlist_set_connection_status");
+    }
+
+    friends->filter.dirty = true;
+}
+
+static int friendlist_filter_cmp(const void *n1, const void *n2, void *arg)
+{
+    const uint32_t index1 = *(const uint32_t *) n1;
+    const uint32_t index2 = *(const uint32_t *) n2;
+
+    const int cmp = friendlist_order_cmp(index1, index2, arg);
+
+    if (cmp != 0) {
+        return cmp;
+    }
+
+    return index1 < index2 ? -1 : index1 > index2;
+}
+
+/* Finds the friends that match the filter again if they've changed since it was last done. */
+static void friendlist_filter_update(FriendsList *friends)
+{
+    Friend_Filter *filter = &friends->filter;
+
+    if (!filter->dirty) {
+        return;
+    }
+
+    uint32_t first;
+    const uint32_t count = name_index_find_prefix(&friends->folded_names, filter->text, filter->length, &first);
+
+    if (count > filter->matches_size) {
+        uint32_t *new_matches = realloc(filter->matches, count * sizeof(uint32_t));
+
+        if (new_matches == NULL) {
+            exit_toxic_err(FATALERR_MEMORY, "failed in friendlist_filter_update");
+        }
+
+        filter->matches = new_matches;
+        filter->matches_size = count;
+    }
+
+    if (count > 0) {
+        memcpy(filter->matches, &friends->folded_names.ids[first], count * sizeof(uint32_t));
+        toxic_qsort_r(filter->matches, count, sizeof(uint32_t), friendlist_filter_cmp, friends);
+    }
+
+    filter->num_matches = count;
+    filter->dirty = false;
+}
+
+/* Returns the number of friends shown in the friend list. */
+static uint32_t friendlist_view_count(FriendsList *friends)
+{
+    if (friends->filter.length == 0) {
+        return peer_order_count(&friends->order);
+    }
+
+    friendlist_filter_update(friends);
+
+    return friends->filter.num_matches;
+}
+
+/* Returns the list index of the friend at position `pos` in the friend list, or PEER_ORDER_NONE if
+ * `pos` is past the last friend shown.
+ */
+static uint32_t friendlist_view_get(FriendsList *friends, uint32_t pos)
+{
+    if (friends->filter.length == 0) {
+        return peer_order_get(&friends->order, pos);
+    }
+
+    friendlist_filter_update(friends);
+
+    return pos < friends->filter.num_matches ? friends->filter.matches[pos] : PEER_ORDER_NONE;
+}
+
+/* Handles a key press that edits the friend list filter.
+ *
+ * Return true if the key was used.
+ */
+static bool friendlist_filter_onKey(FriendsList *friends, wint_t key, bool ltr)
+{
+    Friend_Filter *filter = &friends->filter;
+
+    if (!filter->editing) {
+        if (ltr && key == L'/') {
+            filter->editing = true;
+            return true;
+        }
+
+        return false;
+    }
+
+    if (key == L'\r') {
+        filter->editing = false;
+        return true;
+    }
+
+    if (key == 0x7f || key == KEY_BACKSPACE) {
+        if (filter->length == 0) {
+            filter->editing = false;
+            return true;
+        }
+
+        /* remove the whole multibyte character */
+        do {
+            --filter->length;
+        } while (filter->length > 0 && (filter->text[filter->length] & 0xc0) == 0x80);
+
+        filter->text[filter->length] = '\0';
+    } else if (ltr) {
+        const wchar_t wcs[2] = {(wchar_t) key, L'\0'};
+        char ch[MAX_STR_SIZE];
+        const int ch_len = wcs_to_mbs_buf(ch, wcs, sizeof(ch));
+
+        if (ch_len <= 0 || filter->length + ch_len >= sizeof(filter->text)) {
+            return true;
+        }
+
+        fold_name(&filter->text[filter->length], sizeof(filter->text) - filter->length, ch);
+        filter->length += ch_len;
+    } else {
+        return false;    /* arrow keys still move the selection */
+    }
+
+    filter->dirty = true;
+    friends->num_selected = 0;
+
+    return true;
+}
+
 /* Saves the blocklist to path. If there are no items in the blocklist the
  * empty file will be removed.
  *
@@ -321,6 +588,7 @@ int load_blocklist(const char *path, BlockedList *blocked)
     const int num = len / sizeof(BlockedFriend);
     blocked->max_idx = num;
     realloc_blocklist(blocked, num);
+    peer_map_clear(&blocked->keys);
 
     for (int i = 0; i < num; ++i) {
         BlockedFriend tmp = {0};
@@ -344,6 +612,10 @@ int load_blocklist(const char *path, BlockedList *blocked)
         net_to_host(lastonline, sizeof(uint64_t));
         memcpy(&blocked->list[i].last_on, lastonline, sizeof(uint64_t));
 
+        if (peer_map_add(&blocked->keys, peer_map_key_bytes(blocked->list[i].pub_key, TOX_PUBLIC_KEY_SIZE), i) != 0) {
+            exit_toxic_err(FATALERR_MEMORY, "failed in load_blocklist");
+        }
+
         ++blocked->num_blocked;
     }
 
@@ -354,37 +626,6 @@ int load_blocklist(const char *path, BlockedList *blocked)
     return 0;
 }
 
-#define S_WEIGHT 100000
-static int index_name_cmp(const void *n1, const void *n2, void *arg)
-{
-    FriendsList *friends = arg;
-    int res = qsort_strcasecmp_hlpr(friends->list[*(const uint32_t *) n1].name,
-                                    friends->list[*(const uint32_t *) n2].name);
-
-    /* Use weight to make qsort always put online friends before offline */
-    res = friends->list[*(const uint32_t *) n1].connection_status ? (res - S_WEIGHT) : (res + S_WEIGHT);
-    res = friends->list[*(const uint32_t *) n2].connection_status ? (res + S_WEIGHT) : (res - S_WEIGHT);
-
-    return res;
-}
-
-/* sorts friends->index first by connection status then alphabetically */
-void sort_friendlist_index(FriendsList *friends)
-{
-    size_t i;
-    uint32_t n = 0;
-
-    for (i = 0; i < friends->max_idx; ++i) {
-        if (friends->list[i].active) {
-            friends->index[n++] = friends->list[i].num;
-        }
-    }
-
-    if (friends->num_friends > 0) {
-        toxic_qsort_r(friends->index, friends->num_friends, sizeof(uint32_t), index_name_cmp, friends);
-    }
-}
-
 static int index_name_cmp_block(const void *n1, const void *n2, void *arg)
 {
     BlockedList *blocked = arg;
@@ -415,6 +656,8 @@ static void update_friend_last_online(FriendsList *friends, uint32_t num, time_t
     /* if the format changes make sure TIME_STR_SIZE is the correct size */
     format_time_str(friends->list[num].last_online.hour_min_str, TIME_STR_SIZE, timestamp_format,
                     &friends->list[num].last_online.tm);
+
+    friends->list[num].row.last_seen_valid = false;
 }
 
 static void friendlist_onMessage(ToxWindow *self, Toxic *toxic, uint32_t num, Tox_Message_Type type, const char *str,
@@ -472,10 +715,9 @@ static void friendlist_onConnectionChange(ToxWindow *self, Toxic *toxic, uint32_
         }
     }
 
-    friends->list[num].connection_status = connection_status;
+    friendlist_set_connection_status(friends, num, connection_status);
     update_friend_last_online(friends, num, get_unix_time(), toxic->c_config->timestamp_format);
     store_data(toxic);
-    sort_friendlist_index(friends);
 }
 
 static void friendlist_onNickChange(ToxWindow *self, Toxic *toxic, uint32_t num, const char *nick, size_t length)
@@ -494,8 +736,7 @@ static void friendlist_onNickChange(ToxWindow *self, Toxic *toxic, uint32_t num,
     snprintf(oldname, sizeof(oldname), "%s", friends->list[num].name);
 
     /* update name */
-    snprintf(friends->list[num].name, sizeof(friends->list[num].name), "%s", nick);
-    friends->list[num].namelength = strlen(friends->list[num].name);
+    friendlist_set_name(friends, num, nick);
 
     /* get data for chatlog renaming */
     char newnamecpy[TOXIC_MAX_NAME_LENGTH + 1];
@@ -509,15 +750,6 @@ static void friendlist_onNickChange(ToxWindow *self, Toxic *toxic, uint32_t num,
             fprintf(stderr, "Failed to rename friend chat log from `%s` to `%s`\n", oldname, newnamecpy);
         }
     }
-
-    sort_friendlist_index(friends);
-}
-
-static void friendlist_onNickRefresh(ToxWindow *self, Toxic *toxic)
-{
-    UNUSED_VAR(self);
-
-    sort_friendlist_index(toxic->friends);
 }
 
 static void friendlist_onStatusChange(ToxWindow *self, Toxic *toxic, uint32_t num, Tox_User_Status status)
@@ -550,11 +782,13 @@ static void friendlist_onStatusMessageChange(ToxWindow *self, Toxic *toxic, uint
 
     snprintf(friends->list[num].statusmsg, sizeof(friends->list[num].statusmsg), "%s", note);
     friends->list[num].statusmsg_len = strlen(friends->list[num].statusmsg);
+    friends->list[num].row.note_valid = false;
 }
 
 void friendlist_onFriendAdded(ToxWindow *self, Toxic *toxic, uint32_t num, bool sort)
 {
     UNUSED_VAR(self);
+    UNUSED_VAR(sort);    // the friend order is kept up to date as friends are added
 
     if (toxic == NULL) {
         fprintf(stderr, "friendlist_onFriendAdded null param\n");
@@ -599,20 +833,15 @@ void friendlist_onFriendAdded(ToxWindow *self, Toxic *toxic, uint32_t num, bool
 
         update_friend_last_online(friends, i, t, c_config->timestamp_format);
 
-        char tempname[TOXIC_MAX_NAME_LENGTH + 1];
-        const size_t name_len = get_nick_truncate(tox, tempname, sizeof(tempname), num);
+        get_nick_truncate(tox, friends->list[i].name, sizeof(friends->list[i].name), num);
+        friends->list[i].namelength = strlen(friends->list[i].name);
 
-        snprintf(friends->list[i].name, sizeof(friends->list[i].name), "%s", tempname);
-        friends->list[i].namelength = name_len;
+        friendlist_index_add(friends, i);
 
         if (i == friends->max_idx) {
             ++friends->max_idx;
         }
 
-        if (sort) {
-            sort_friendlist_index(friends);
-        }
-
 #ifdef AUDIO
 
         if (!init_friend_AV(toxic->call_control, i)) {
@@ -643,18 +872,19 @@ static void friendlist_add_blocked(FriendsList *friends, BlockedList *blocked, c
         friends->list[i].active = true;
         friends->list[i].window_id = -1;
         friends->list[i].status = TOX_USER_STATUS_NONE;
-        friends->list[i].namelength = blocked->list[bnum].namelength;
         update_friend_last_online(friends, i, blocked->list[bnum].last_on, c_config->timestamp_format);
-        memcpy(friends->list[i].name, blocked->list[bnum].name, friends->list[i].namelength + 1);
+        snprintf(friends->list[i].name, sizeof(friends->list[i].name), "%s", blocked->list[bnum].name);
+        friends->list[i].namelength = strlen(friends->list[i].name);
         memcpy(friends->list[i].pub_key, blocked->list[bnum].pub_key, TOX_PUBLIC_KEY_SIZE);
         set_default_friend_config_settings(&friends->list[i], c_config);
 
+        friendlist_index_add(friends, i);
+
         if (i == (int) friends->max_idx) {
             ++friends->max_idx;
         }
 
         sort_blocklist_index(blocked);
-        sort_friendlist_index(friends);
 
 #ifdef AUDIO
 
@@ -845,8 +1075,24 @@ static void delete_friend(Toxic *toxic, uint32_t f_num)
         }
     }
 
+    /* drop any messages that were still waiting to be sent */
+    uint8_t self_key[TOX_PUBLIC_KEY_SIZE];
+    tox_self_get_public_key(tox, self_key);
+
+    char journal_path[TOXIC_MAX_PATH_LENGTH];
+
+    if (cqueue_get_journal_path(toxic->paths, self_key, (const uint8_t *) friends->list[f_num].pub_key,
+                                journal_path, sizeof(journal_path)) == 0) {
+        remove(journal_path);
+    }
+
+    /* and any partly received files that could have been resumed */
+    file_transfers_remove_journals(toxic, f_num);
+
     free(friends->list[f_num].conference_invite.key);
+    free_file_transfers_friend(friends, f_num);
 
+    friendlist_index_remove(friends, f_num);
     clear_friendlist_index(friends, f_num);
 
     int i;
@@ -888,7 +1134,6 @@ static void del_friend_deactivate(Toxic *toxic, wint_t key)
     if (key == L'y') {
         if (toxic->blocklist_view == 0) {
             delete_friend(toxic, PendingDelete.num);
-            sort_friendlist_index(toxic->friends);
         } else {
             delete_blocked_friend(toxic, PendingDelete.num);
             sort_blocklist_index(toxic->blocked);
@@ -947,6 +1192,7 @@ static void delete_blocked_friend(Toxic *toxic, uint32_t bnum)
         }
     }
 
+    peer_map_remove(&blocked->keys, peer_map_key_bytes(blocked->list[bnum].pub_key, TOX_PUBLIC_KEY_SIZE), bnum);
     clear_blocklist_index(blocked, bnum);
 
     --blocked->num_blocked;
@@ -986,6 +1232,10 @@ static void block_friend(Toxic *toxic, uint32_t fnum)
         memcpy(blocked->list[i].pub_key, friends->list[fnum].pub_key, TOX_PUBLIC_KEY_SIZE);
         memcpy(blocked->list[i].name, friends->list[fnum].name, friends->list[fnum].namelength + 1);
 
+        if (peer_map_add(&blocked->keys, peer_map_key_bytes(blocked->list[i].pub_key, TOX_PUBLIC_KEY_SIZE), i) != 0) {
+            exit_toxic_err(FATALERR_MEMORY, "failed in block_friend");
+        }
+
         ++blocked->num_blocked;
 
         if (i == (int) blocked->max_idx) {
@@ -995,7 +1245,6 @@ static void block_friend(Toxic *toxic, uint32_t fnum)
         delete_friend(toxic, fnum);
         save_blocklist(toxic->client_data.block_path, blocked);
         sort_blocklist_index(blocked);
-        sort_friendlist_index(friends);
 
         return;
     }
@@ -1020,7 +1269,6 @@ static void unblock_friend(Toxic *toxic, uint32_t bnum)
     friendlist_add_blocked(toxic->friends, toxic->blocked, toxic->c_config, toxic->call_control, friendnum, bnum);
     delete_blocked_friend(toxic, bnum);
     sort_blocklist_index(toxic->blocked);
-    sort_friendlist_index(toxic->friends);
 }
 
 /*
@@ -1039,12 +1287,27 @@ static bool friendlist_onKey(ToxWindow *self, Toxic *toxic, wint_t key, bool ltr
         return true;
     }
 
-    if (key == L'h') {
+    if (key == L'h' && !friends->filter.editing) {
         help_init_menu(self);
         return true;
     }
 
-    if (!toxic->blocklist_view && !friends->num_friends && (key != KEY_RIGHT && key != KEY_LEFT)) {
+    /* lock screen and force decision on deletion popup */
+    if (PendingDelete.active) {
+        if (key == L'y' || key == L'n') {
+            del_friend_deactivate(toxic, key);
+        }
+
+        return true;
+    }
+
+    if (!toxic->blocklist_view && friendlist_filter_onKey(friends, key, ltr)) {
+        return true;
+    }
+
+    const uint32_t num_shown = friendlist_view_count(friends);
+
+    if (!toxic->blocklist_view && num_shown == 0 && (key != KEY_RIGHT && key != KEY_LEFT)) {
         return true;
     }
 
@@ -1056,17 +1319,18 @@ static bool friendlist_onKey(ToxWindow *self, Toxic *toxic, wint_t key, bool ltr
 
     if (toxic->blocklist_view == 1 && toxic->blocked->num_blocked) {
         f = toxic->blocked->index[toxic->blocked->num_selected];
-    } else if (friends->num_friends) {
-        f = friends->index[friends->num_selected];
-    }
+    } else if (num_shown > 0) {
+        if ((uint32_t) friends->num_selected >= num_shown) {
+            friends->num_selected = num_shown - 1;
+        }
 
-    /* lock screen and force decision on deletion popup */
-    if (PendingDelete.active) {
-        if (key == L'y' || key == L'n') {
-            del_friend_deactivate(toxic, key);
+        const uint32_t idx = friendlist_view_get(friends, friends->num_selected);
+
+        if (idx == PEER_ORDER_NONE) {
+            return true;
         }
 
-        return true;
+        f = idx;
     }
 
     if (key == ltr) {
@@ -1114,7 +1378,7 @@ static bool friendlist_onKey(ToxWindow *self, Toxic *toxic, wint_t key, bool ltr
 
         default:
             if (toxic->blocklist_view == 0) {
-                select_friend(key, &friends->num_selected, friends->num_friends);
+                select_friend(key, &friends->num_selected, num_shown);
             } else {
                 select_friend(key, &toxic->blocked->num_selected, toxic->blocked->num_blocked);
             }
@@ -1198,6 +1462,79 @@ static void blocklist_onDraw(ToxWindow *self, Toxic *toxic, int y2, int x2)
     }
 }
 
+/* Returns the "Last seen" text for the offline friend `friend`, formatting it again only when the
+ * day has changed since it was last formatted.
+ */
+static const char *friendlist_format_last_seen(ToxicFriend *friend, const struct tm *cur_tm)
+{
+    struct FriendRow *row = &friend->row;
+
+    if (row->last_seen_valid && row->last_seen_yday == cur_tm->tm_yday && row->last_seen_year == cur_tm->tm_year) {
+        return row->last_seen;
+    }
+
+    if (friend->last_online.last_on == 0) {
+        snprintf(row->last_seen, sizeof(row->last_seen), "Last seen: Never");
+    } else {
+        const int day_dist = cur_tm->tm_yday - friend->last_online.tm.tm_yday
+                             + ((cur_tm->tm_year - friend->last_online.tm.tm_year) * 365);
+        const char *hourmin = friend->last_online.hour_min_str;
+
+        switch (day_dist) {
+            case 0:
+                snprintf(row->last_seen, sizeof(row->last_seen), "Last seen: Today %s", hourmin);
+                break;
+
+            case 1:
+                snprintf(row->last_seen, sizeof(row->last_seen), "Last seen: Yesterday %s", hourmin);
+                break;
+
+            default:
+                snprintf(row->last_seen, sizeof(row->last_seen), "Last seen: %d days ago", day_dist);
+                break;
+        }
+    }
+
+    row->last_seen_yday = cur_tm->tm_yday;
+    row->last_seen_year = cur_tm->tm_year;
+    row->last_seen_valid = true;
+
+    return row->last_seen;
+}
+
+/* Returns the note of `friend` cut short with "..." if it's longer than `width` bytes, truncating
+ * it again only when the width or the note has changed. The friend's note itself is left whole.
+ */
+static const char *friendlist_format_note(ToxicFriend *friend, int width)
+{
+    struct FriendRow *row = &friend->row;
+
+    if (row->note_valid && row->note_width == width) {
+        return row->note;
+    }
+
+    if (width >= 0 && friend->statusmsg_len <= (size_t) width) {
+        snprintf(row->note, sizeof(row->note), "%s", friend->statusmsg);
+    } else if (width <= 3) {
+        row->note[0] = '\0';
+    } else {
+        size_t length = width - 3;
+
+        /* don't cut a multibyte character in half */
+        while (length > 0 && (friend->statusmsg[length] & 0xc0) == 0x80) {
+            --length;
+        }
+
+        memcpy(row->note, friend->statusmsg, length);
+        memcpy(&row->note[length], "...", 4);
+    }
+
+    row->note_width = width;
+    row->note_valid = true;
+
+    return row->note;
+}
+
 static void friendlist_onDraw(ToxWindow *self, Toxic *toxic)
 {
     if (toxic == NULL || self == NULL) {
@@ -1212,8 +1549,6 @@ static void friendlist_onDraw(ToxWindow *self, Toxic *toxic)
     int x2, y2;
     getmaxyx(self->window, y2, x2);
 
-    const bool fix_statuses = x2 != self->x;    /* true if window max x value has changed */
-
     wattron(self->window, COLOR_PAIR(CYAN));
     wprintw(self->window, " Press the");
     wattron(self->window, A_BOLD);
@@ -1232,187 +1567,127 @@ static void friendlist_onDraw(ToxWindow *self, Toxic *toxic)
     const time_t cur_time = get_unix_time();
     struct tm cur_loc_tm = *localtime((const time_t *) &cur_time);
 
+    pthread_mutex_lock(&Winthread.lock);
+
+    const uint32_t num_shown = friendlist_view_count(friends);
+
     wattron(self->window, A_BOLD);
     wprintw(self->window, " Online: ");
     wattroff(self->window, A_BOLD);
 
-    wprintw(self->window, "%zu/%zu \n\n", friends->num_online, friends->num_friends);
+    wprintw(self->window, "%zu/%zu", friends->num_online, friends->num_friends);
 
-    if ((y2 - FLIST_OFST) <= 0) {
-        return;
-    }
+    if (friends->filter.editing || friends->filter.length > 0) {
+        wattron(self->window, A_BOLD);
+        wprintw(self->window, "  Filter: ");
+        wattroff(self->window, A_BOLD);
 
-    uint32_t selected_num = 0;
+        wprintw(self->window, "%s", friends->filter.text);
 
-    /* Determine which portion of friendlist to draw based on current position */
-    pthread_mutex_lock(&Winthread.lock);
-    const int page = friends->num_selected / (y2 - FLIST_OFST);
-    pthread_mutex_unlock(&Winthread.lock);
+        if (friends->filter.editing) {
+            wattron(self->window, A_REVERSE);
+            wprintw(self->window, " ");
+            wattroff(self->window, A_REVERSE);
+        }
 
-    const int start = (y2 - FLIST_OFST) * page;
-    const int end = y2 - FLIST_OFST + start;
+        wprintw(self->window, " (%u shown)", num_shown);
+    }
 
-    pthread_mutex_lock(&Winthread.lock);
-    const size_t num_friends = friends->num_friends;
-    pthread_mutex_unlock(&Winthread.lock);
+    wprintw(self->window, "\n\n");
 
-    for (int i = start; i < num_friends && i < end; ++i) {
-        pthread_mutex_lock(&Winthread.lock);
-        uint32_t f = friends->index[i];
-        bool is_active = friends->list[f].active;
-        int num_selected = friends->num_selected;
+    if ((y2 - FLIST_OFST) <= 0) {
         pthread_mutex_unlock(&Winthread.lock);
+        return;
+    }
 
-        if (is_active) {
-            bool f_selected = false;
-
-            if (i == num_selected) {
-                wattron(self->window, A_BOLD);
-                wprintw(self->window, " > ");
-                wattroff(self->window, A_BOLD);
-                selected_num = f;
-                f_selected = true;
-            } else {
-                wprintw(self->window, "   ");
-            }
-
-            pthread_mutex_lock(&Winthread.lock);
-            Tox_Connection connection_status = friends->list[f].connection_status;
-            Tox_User_Status status = friends->list[f].status;
-            pthread_mutex_unlock(&Winthread.lock);
-
-            if (connection_status != TOX_CONNECTION_NONE) {
-                int colour;
-
-                switch (status) {
-                    case TOX_USER_STATUS_NONE:
-                        colour = GREEN;
-                        break;
-
-                    case TOX_USER_STATUS_AWAY:
-                        colour = YELLOW;
-                        break;
-
-                    case TOX_USER_STATUS_BUSY:
-                        colour = RED;
-                        break;
-
-                    default:
-                        colour = BAR_TEXT;
-                        break;
-                }
-
-                wattron(self->window, COLOR_PAIR(colour) | A_BOLD);
-                wprintw(self->window, "%s ", ONLINE_CHAR);
-                wattroff(self->window, COLOR_PAIR(colour) | A_BOLD);
-
-                if (f_selected) {
-                    wattron(self->window, COLOR_PAIR(BLUE));
-                }
-
-                wattron(self->window, A_BOLD);
-                pthread_mutex_lock(&Winthread.lock);
-                wprintw(self->window, "%s", friends->list[f].name);
-                pthread_mutex_unlock(&Winthread.lock);
-                wattroff(self->window, A_BOLD);
-
-                if (f_selected) {
-                    wattroff(self->window, COLOR_PAIR(BLUE));
-                }
-
-                /* Reset friends->list[f].statusmsg on window resize */
-                if (fix_statuses) {
-                    char statusmsg[TOX_MAX_STATUS_MESSAGE_LENGTH];
-
-                    pthread_mutex_lock(&Winthread.lock);
-                    tox_friend_get_status_message(toxic->tox, friends->list[f].num, (uint8_t *) statusmsg, NULL);
-                    const size_t s_len = tox_friend_get_status_message_size(toxic->tox, friends->list[f].num, NULL);
-                    pthread_mutex_unlock(&Winthread.lock);
-
-                    statusmsg[s_len] = '\0';
-
-                    filter_string(statusmsg, s_len, false);
-
-                    pthread_mutex_lock(&Winthread.lock);
-                    snprintf(friends->list[f].statusmsg, sizeof(friends->list[f].statusmsg), "%s", statusmsg);
-                    friends->list[f].statusmsg_len = strlen(friends->list[f].statusmsg);
-                    pthread_mutex_unlock(&Winthread.lock);
-                }
+    uint32_t selected_num = PEER_ORDER_NONE;
 
-                /* Truncate note if it doesn't fit on one line */
-                size_t maxlen = x2 - getcurx(self->window) - 2;
+    /* Determine which portion of friendlist to draw based on current position. Only the rows on
+     * this page are visited, however many friends there are. */
+    const int num_selected = friends->num_selected;
+    const int page = num_selected / (y2 - FLIST_OFST);
+    const uint32_t start = (y2 - FLIST_OFST) * page;
+    const uint32_t end = y2 - FLIST_OFST + start;
 
-                pthread_mutex_lock(&Winthread.lock);
+    for (uint32_t i = start; i < num_shown && i < end; ++i) {
+        const uint32_t f = friendlist_view_get(friends, i);
 
-                if (friends->list[f].statusmsg_len > maxlen) {
-                    friends->list[f].statusmsg[maxlen - 3] = '\0';
-                    strcat(friends->list[f].statusmsg, "...");
-                    friends->list[f].statusmsg[maxlen] = '\0';
-                    friends->list[f].statusmsg_len = maxlen;
-                }
+        if (f == PEER_ORDER_NONE || !friends->list[f].active) {
+            continue;
+        }
 
-                if (friends->list[f].statusmsg_len > 0) {
-                    wprintw(self->window, " %s", friends->list[f].statusmsg);
-                }
+        ToxicFriend *friend = &friends->list[f];
+        const bool f_selected = (int) i == num_selected;
 
-                pthread_mutex_unlock(&Winthread.lock);
+        if (f_selected) {
+            wattron(self->window, A_BOLD);
+            wprintw(self->window, " > ");
+            wattroff(self->window, A_BOLD);
+            selected_num = f;
+        } else {
+            wprintw(self->window, "   ");
+        }
 
-                wprintw(self->window, "\n");
-            } else {
-                wprintw(self->window, "%s ", OFFLINE_CHAR);
+        if (friend->connection_status != TOX_CONNECTION_NONE) {
+            int colour;
 
-                if (f_selected) {
-                    wattron(self->window, COLOR_PAIR(BLUE));
-                }
+            switch (friend->status) {
+                case TOX_USER_STATUS_NONE:
+                    colour = GREEN;
+                    break;
 
-                wattron(self->window, A_BOLD);
-                pthread_mutex_lock(&Winthread.lock);
-                wprintw(self->window, "%s", friends->list[f].name);
-                pthread_mutex_unlock(&Winthread.lock);
-                wattroff(self->window, A_BOLD);
+                case TOX_USER_STATUS_AWAY:
+                    colour = YELLOW;
+                    break;
 
-                if (f_selected) {
-                    wattroff(self->window, COLOR_PAIR(BLUE));
-                }
+                case TOX_USER_STATUS_BUSY:
+                    colour = RED;
+                    break;
 
-                pthread_mutex_lock(&Winthread.lock);
-                time_t last_seen = friends->list[f].last_online.last_on;
-                pthread_mutex_unlock(&Winthread.lock);
+                default:
+                    colour = BAR_TEXT;
+                    break;
+            }
 
-                if (last_seen != 0) {
-                    pthread_mutex_lock(&Winthread.lock);
+            wattron(self->window, COLOR_PAIR(colour) | A_BOLD);
+            wprintw(self->window, "%s ", ONLINE_CHAR);
+            wattroff(self->window, COLOR_PAIR(colour) | A_BOLD);
+        } else {
+            wprintw(self->window, "%s ", OFFLINE_CHAR);
+        }
 
-                    int day_dist = (
-                                       cur_loc_tm.tm_yday - friends->list[f].last_online.tm.tm_yday
-                                       + ((cur_loc_tm.tm_year - friends->list[f].last_online.tm.tm_year) * 365)
-                                   );
-                    const char *hourmin = friends->list[f].last_online.hour_min_str;
+        if (f_selected) {
+            wattron(self->window, COLOR_PAIR(BLUE));
+        }
 
-                    pthread_mutex_unlock(&Winthread.lock);
+        wattron(self->window, A_BOLD);
+        wprintw(self->window, "%s", friend->name);
+        wattroff(self->window, A_BOLD);
 
-                    switch (day_dist) {
-                        case 0:
-                            wprintw(self->window, " Last seen: Today %s\n", hourmin);
-                            break;
+        if (f_selected) {
+            wattroff(self->window, COLOR_PAIR(BLUE));
+        }
 
-                        case 1:
-                            wprintw(self->window, " Last seen: Yesterday %s\n", hourmin);
-                            break;
+        if (friend->connection_status != TOX_CONNECTION_NONE) {
+            /* Truncate note if it doesn't fit on one line */
+            const int maxlen = x2 - getcurx(self->window) - 2;
+            const char *note = friendlist_format_note(friend, maxlen);
 
-                        default:
-                            wprintw(self->window, " Last seen: %d days ago\n", day_dist);
-                            break;
-                    }
-                } else {
-                    wprintw(self->window, " Last seen: Never\n");
-                }
+            if (note[0] != '\0') {
+                wprintw(self->window, " %s", note);
             }
+        } else {
+            wprintw(self->window, " %s", friendlist_format_last_seen(friend, &cur_loc_tm));
         }
+
+        wprintw(self->window, "\n");
     }
 
+    pthread_mutex_unlock(&Winthread.lock);
+
     self->x = x2;
 
-    if (num_friends) {
+    if (selected_num != PEER_ORDER_NONE) {
         wmove(self->window, y2 - 1, 1);
 
         wattron(self->window, A_BOLD);
@@ -1469,19 +1744,6 @@ size_t friendlist_get_count(const FriendsList *friends)
     return friends->num_friends;
 }
 
-void friendlist_get_names(const FriendsList *friends, char **names, size_t max_names, size_t max_name_size)
-{
-    if (friends == NULL || friends->num_friends == 0) {
-        return;
-    }
-
-    const size_t bytes_to_copy = MIN(sizeof(friends->list[0].name), max_name_size);
-
-    for (size_t i = 0; i < max_names && i < friends->num_friends; ++i) {
-        snprintf(names[i], bytes_to_copy, "%s", friends->list[i].name);
-    }
-}
-
 #ifdef AUDIO
 static void friendlist_onAV(ToxWindow *self, Toxic *toxic, uint32_t friend_number, int state)
 {
@@ -1545,17 +1807,23 @@ int64_t get_friend_number_name(const FriendsList *friends, const char *name, uin
     int64_t num = -1;
     bool match_found = false;
 
-    for (size_t i = 0; i < friends->max_idx; ++i) {
-        if (length != friends->list[i].namelength) {
+    const uint64_t key = peer_map_key_nick(name, length);
+    Peer_Map_Iter iter = {0};
+
+    for (uint32_t i = peer_map_next(&friends->nicks, key, &iter); i != PEER_MAP_NONE;
+            i = peer_map_next(&friends->nicks, key, &iter)) {
+        const ToxicFriend *friend = &friends->list[i];
+
+        if (!friend->active || length != friend->namelength) {
             continue;
         }
 
-        if (memcmp(name, friends->list[i].name, length) == 0) {
+        if (memcmp(name, friend->name, length) == 0) {
             if (match_found) {
                 return -2;
             }
 
-            num = friends->list[i].num;
+            num = friend->num;
             match_found = true;
         }
     }
@@ -1570,7 +1838,11 @@ int64_t get_friend_number_name(const FriendsList *friends, const char *name, uin
  */
 bool friend_is_blocked(const BlockedList *blocked, const char *public_key)
 {
-    for (size_t i = 0; i < blocked->max_idx; ++i) {
+    const uint64_t key = peer_map_key_bytes(public_key, TOX_PUBLIC_KEY_SIZE);
+    Peer_Map_Iter iter = {0};
+
+    for (uint32_t i = peer_map_next(&blocked->keys, key, &iter); i != PEER_MAP_NONE;
+            i = peer_map_next(&blocked->keys, key, &iter)) {
         if (!blocked->list[i].active) {
             continue;
         }
@@ -1699,7 +1971,11 @@ static Friend_Settings *get_friend_settings_by_key(FriendsList *friends, const c
         return NULL;
     }
 
-    for (size_t i = 0; i < friends->max_idx; ++i) {
+    const uint64_t key = peer_map_key_bytes(pk_bin, sizeof(pk_bin));
+    Peer_Map_Iter iter = {0};
+
+    for (uint32_t i = peer_map_next(&friends->keys, key, &iter); i != PEER_MAP_NONE;
+            i = peer_map_next(&friends->keys, key, &iter)) {
         ToxicFriend *friend = &friends->list[i];
 
         if (!friend->active) {
@@ -1887,10 +2163,7 @@ bool friend_config_set_alias(FriendsList *friends, const char *public_key, const
         return false;
     }
 
-    ToxicFriend *friend = &friends->list[friendnumber];
-
-    snprintf(friend->name, sizeof(friend->name), "%s", tmp);
-    friend->namelength = strlen(friend->name);
+    friendlist_set_name(friends, friendnumber, tmp);
 
     settings->alias_set = true;
 
@@ -1910,7 +2183,6 @@ ToxWindow *new_friendlist(void)
     ret->onInit = &friendlist_onInit;
     ret->onKey = &friendlist_onKey;
     ret->onDraw = &friendlist_onDraw;
-    ret->onNickRefresh = &friendlist_onNickRefresh;
     ret->onFriendAdded = &friendlist_onFriendAdded;
     ret->onMessage = &friendlist_onMessage;
     ret->onConnectionChange = &friendlist_onConnectionChange;
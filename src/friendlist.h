@@ -11,7 +11,11 @@
 
 #include <time.h>
 
+#include "dir_transfers.h"
 #include "file_transfers.h"
+#include "name_index.h"
+#include "peer_map.h"
+#include "peer_order.h"
 #include "toxic.h"
 #include "windows.h"
 
@@ -25,6 +29,18 @@ struct LastOnline {
     char hour_min_str[TIME_STR_SIZE];    /* holds 12/24-hour time string e.g. "10:43 PM" */
 };
 
+/* The parts of a friend's row in the friend list that are formatted once and kept until they change */
+struct FriendRow {
+    char last_seen[TIME_STR_SIZE + 32];    /* e.g. "Last seen: Yesterday 10:43 PM" */
+    int  last_seen_yday;                   /* the day that `last_seen` is relative to */
+    int  last_seen_year;
+    bool last_seen_valid;
+
+    char note[TOX_MAX_STATUS_MESSAGE_LENGTH + 1];    /* the status message shortened to `note_width` bytes */
+    int  note_width;
+    bool note_valid;
+};
+
 struct ConferenceInvite {
     char *key;
     uint16_t length;
@@ -80,6 +96,7 @@ typedef struct {
     Tox_User_Status status;
 
     struct LastOnline last_online;
+    struct FriendRow row;
 
 #ifdef GAMES
     struct GameInvite game_invite;
@@ -88,9 +105,11 @@ typedef struct {
     struct ConferenceInvite conference_invite;
     struct GroupInvite group_invite;
 
-    struct FileTransfer file_receiver[MAX_FILES];
-    struct FileTransfer file_sender[MAX_FILES];
-    PendingFileTransfer file_send_queue[MAX_FILES];
+    FileTransferTable file_receiver;
+    FileTransferTable file_sender;
+    struct send_queue file_send_queue;
+    DirTransfer dir_send;
+    DirTransfer dir_recv;
 
     Friend_Settings settings;
 } ToxicFriend;
@@ -104,13 +123,32 @@ typedef struct {
     uint64_t last_on;
 } BlockedFriend;
 
+/* Limits the friend list to the friends whose names start with `text`, ignoring ASCII case. */
+typedef struct Friend_Filter {
+    char     text[TOXIC_MAX_NAME_LENGTH + 1];    /* in lower case */
+    size_t   length;
+    bool     editing;        /* keys pressed in the friend list are added to the filter */
+    bool     dirty;          /* the friends have changed since the matches were found */
+    uint32_t *matches;       /* list indices of the matching friends in friend list order */
+    uint32_t num_matches;
+    uint32_t matches_size;
+} Friend_Filter;
+
 typedef struct FriendsList {
     int num_selected;
     size_t num_friends;
     size_t num_online;
     size_t max_idx;    /* 1 + the index of the last friend in list */
-    uint32_t *index;
     ToxicFriend *list;
+    Peer_Order order;   /* the active friends sorted by connection status and then name, for the friend list */
+    Name_Index names;   /* the names of the active friends by list index, for tab completion */
+    Name_Index folded_names;    /* the same names in lower case, for filtering */
+    Friend_Filter filter;
+
+    /* Indexes of the active friends into list */
+    Peer_Map keys;          /* keyed by public key */
+    Peer_Map key_idents;    /* keyed by the bytes of the public key shown as its identifier */
+    Peer_Map nicks;         /* keyed by case-folded name */
 } FriendsList;
 
 typedef struct BlockedList BlockedList;
@@ -132,14 +170,6 @@ Tox_Connection get_friend_connection_status(const FriendsList *friends, uint32_t
  */
 size_t friendlist_get_count(const FriendsList *friends);
 
-/*
- * Copies names from the friends list into the `names` array.
- *
- * @max_names The maximum number of names to copy.
- * @max_name_size The maximum number of bytes to copy per name.
- */
-void friendlist_get_names(const FriendsList *friends, char **names, size_t max_names, size_t max_name_size);
-
 /*
  * Loads the list of blocked peers from `path`.
  *
@@ -149,9 +179,6 @@ void friendlist_get_names(const FriendsList *friends, char **names, size_t max_n
  */
 int load_blocklist(const char *path, BlockedList *blocked);
 
-/* sorts friendlist_index first by connection status then alphabetically */
-void sort_friendlist_index(FriendsList *friends);
-
 /*
  * Returns true if friend associated with `public_key` is in the block list.
  *
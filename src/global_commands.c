@@ -18,6 +18,7 @@
 #include "help.h"
 #include "line_info.h"
 #include "log.h"
+#include "log_writer.h"
 #include "misc_tools.h"
 #include "name_lookup.h"
 #include "prompt.h"
@@ -732,6 +733,25 @@ void cmd_log(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char (*arg
         return;
     }
 
+    if (!strcmp(swch, "stats")) {
+        struct log_writer_stats stats;
+        log_writer_get_stats(&stats);
+
+        const uint64_t avg_flush_us = stats.batches > 0 ? stats.total_flush_us / stats.batches : 0;
+
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                      "Log writer: %zu queued (max %zu), %llu lines / %llu bytes in %llu batches, %llu writes, %llu fsyncs, %llu errors",
+                      stats.queue_depth, stats.max_queue_depth, (unsigned long long) stats.appends,
+                      (unsigned long long) stats.bytes, (unsigned long long) stats.batches,
+                      (unsigned long long) stats.syscalls, (unsigned long long) stats.fsyncs,
+                      (unsigned long long) stats.errors);
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                      "Flush latency: last %llu us, avg %llu us, max %llu us",
+                      (unsigned long long) stats.last_flush_us, (unsigned long long) avg_flush_us,
+                      (unsigned long long) stats.max_flush_us);
+        return;
+    }
+
     line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
                   "Invalid option. Use \"/log on\" and \"/log off\" to toggle logging.");
 }
@@ -1017,6 +1037,62 @@ void cmd_requests(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char
     }
 }
 
+void cmd_search(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char (*argv)[MAX_STR_SIZE])
+{
+    UNUSED_VAR(window);
+
+    if (toxic == NULL || self == NULL) {
+        return;
+    }
+
+    const Client_Config *c_config = toxic->c_config;
+
+    if (argc < 1) {
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "Usage: /search <words>");
+        return;
+    }
+
+    const char *query = argv[1];
+    struct chatlog *log = self->chatwin->log;
+    const struct history *hst = self->chatwin->hst;
+
+    /* Repeating a search from a match moves on to the next older match */
+    int64_t before = log_next_line(log);
+
+    if (self->scroll_pause && hst->line_start != hst->line_root) {
+        before = hst->line_start->log_line;
+    }
+
+    int64_t line = 0;
+    const int ret = log_search_history(log, query, before, &line, NULL);
+
+    if (ret == -2) {
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                      "Search terms must be at least %d characters long.", LOG_SEARCH_MIN_TERM_LENGTH);
+        return;
+    }
+
+    if (ret < 0) {
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, RED, "Failed to search the chat log.");
+        return;
+    }
+
+    if (ret == 0) {
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "No %smatches for \"%s\".",
+                      before < log_next_line(log) ? "older " : "", query);
+        return;
+    }
+
+    if (!line_info_jump_to_log_line(self, c_config, line)) {
+        line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                      "Found a match for \"%s\", but it's too far back in the log to show.", query);
+        return;
+    }
+
+    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                  "Showing a match for \"%s\". Search again to find older matches.", query);
+}
+
 void cmd_status(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char (*argv)[MAX_STR_SIZE])
 {
     UNUSED_VAR(window);
@@ -1062,3 +1138,56 @@ void cmd_status(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char (*
 finish:
     unlock_status();
 }
+
+static void print_reactor_stats(ToxWindow *self, const Client_Config *c_config, const char *name, Reactor *reactor)
+{
+    Reactor_Stats stats;
+    reactor_get_stats(reactor, &stats);
+
+    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                  "%s: %llu waits, %llu woken (%llu signals, %llu input), %llu timed out", name,
+                  (unsigned long long) stats.waits, (unsigned long long) stats.wakeups,
+                  (unsigned long long) stats.signals, (unsigned long long) stats.fd_events,
+                  (unsigned long long) stats.timeouts);
+}
+
+void cmd_wakeups(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char (*argv)[MAX_STR_SIZE])
+{
+    UNUSED_VAR(window);
+    UNUSED_VAR(argc);
+    UNUSED_VAR(argv);
+
+    if (toxic == NULL || self == NULL) {
+        return;
+    }
+
+    const Client_Config *c_config = toxic->c_config;
+
+    print_reactor_stats(self, c_config, "Interface thread", &Winthread.reactor);
+    print_reactor_stats(self, c_config, "Tox thread", &tox_thread.reactor);
+    print_reactor_stats(self, c_config, "Message queue thread", &cqueue_thread.reactor);
+}
+
+void cmd_frames(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char (*argv)[MAX_STR_SIZE])
+{
+    UNUSED_VAR(window);
+    UNUSED_VAR(argc);
+    UNUSED_VAR(argv);
+
+    if (toxic == NULL || self == NULL) {
+        return;
+    }
+
+    const Client_Config *c_config = toxic->c_config;
+    const Frame_Stats *stats = &Winthread.frame_stats;
+
+    const double avg_ms = stats->frames > 0 ? (double) stats->total_usec / stats->frames / 1000 : 0;
+
+    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                  "Frames: %llu drawn, %.2f ms on average, %.2f ms at most",
+                  (unsigned long long) stats->frames, avg_ms, (double) stats->max_usec / 1000);
+    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0,
+                  "Chat history: %llu full redraws, %llu partial redraws, %llu lines drawn",
+                  (unsigned long long) stats->full_redraws, (unsigned long long) stats->partial_redraws,
+                  (unsigned long long) stats->lines_drawn);
+}
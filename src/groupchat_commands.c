@@ -304,12 +304,10 @@ void cmd_list(WINDOW *window, ToxWindow *self, Toxic *toxic, int argc, char (*ar
         return;
     }
 
-    for (size_t i = 0; i < chat->max_idx; ++i) {
-        GroupPeer *peer = &chat->peer_list[i];
+    const uint32_t num_peers = peer_order_count(&chat->peer_order);
 
-        if (!peer->active) {
-            continue;
-        }
+    for (uint32_t i = 0; i < num_peers; ++i) {
+        const GroupPeer *peer = &chat->peer_list[peer_order_get(&chat->peer_order, i)];
 
         char pk_string[TOX_GROUP_PEER_PUBLIC_KEY_SIZE * 2 + 1] = {0};
 
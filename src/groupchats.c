@@ -69,6 +69,7 @@ static const char *const group_cmd_list[] = {
     "/disconnect",
     "/decline",
     "/exit",
+    "/frames",
     "/group",
     "/help",
     "/ignore",
@@ -92,6 +93,7 @@ static const char *const group_cmd_list[] = {
     "/quit",
     "/rejoin",
     "/requests",
+    "/search",
 #ifdef PYTHON
     "/run",
 #endif /* PYTHON */
@@ -102,6 +104,7 @@ static const char *const group_cmd_list[] = {
     "/unmod",
     "/unsilence",
     "/voice",
+    "/wakeups",
     "/whisper",
     "/whois",
 };
@@ -110,7 +113,6 @@ static GroupChat groupchats[MAX_GROUPCHAT_NUM];
 
 static ToxWindow *new_group_chat(Tox *tox, uint32_t groupnumber, const char *groupname, int length);
 static void groupchat_set_group_name(ToxWindow *self, Toxic *toxic, uint32_t groupnumber);
-static void groupchat_update_name_list(uint32_t groupnumber);
 static void groupchat_onGroupPeerJoin(ToxWindow *self, Toxic *toxic, uint32_t groupnumber, uint32_t peer_id);
 static int realloc_peer_list(uint32_t groupnumber, uint32_t n);
 static void groupchat_onGroupNickChange(ToxWindow *self, Toxic *toxic, uint32_t groupnumber, uint32_t peer_id,
@@ -120,6 +122,8 @@ static void groupchat_onGroupStatusChange(ToxWindow *self, Toxic *toxic, uint32_
 static void groupchat_onGroupSelfNickChange(ToxWindow *self, Toxic *toxic, uint32_t groupnumber, const char *old_nick,
         size_t old_length, const char *new_nick, size_t length);
 static void ignore_list_cleanup(GroupChat *chat);
+static void group_peer_index_free(GroupChat *chat);
+static int group_peer_order_cmp(uint32_t index1, uint32_t index2, const void *userdata);
 
 /*
  * Return a GroupChat pointer associated with groupnumber.
@@ -216,8 +220,11 @@ void groupchat_rejoin(ToxWindow *self, Toxic *toxic)
         clear_peer(&chat->peer_list[i]);
     }
 
+    group_peer_index_free(chat);
+
     chat->num_peers = 0;
     chat->max_idx = 0;
+    chat->side_pos = 0;
     realloc_peer_list(self->num, 0);
 
     groupchat_onGroupPeerJoin(self, toxic, self->num, self_peer_id);
@@ -233,12 +240,11 @@ static void kill_groupchat_window(ToxWindow *self, Windows *windows, const Clien
     StatusBar *statusbar = self->stb;
 
     if (ctx != NULL) {
-        log_disable(ctx->log);
         line_info_cleanup(ctx->hst);
         delwin(ctx->linewin);
         delwin(ctx->history);
         delwin(ctx->sidebar);
-        free(ctx->log);
+        log_free(ctx->log);
         free(ctx);
     }
 
@@ -263,8 +269,7 @@ static void close_groupchat(ToxWindow *self, Toxic *toxic, uint32_t groupnumber)
     ignore_list_cleanup(chat);
 
     realloc_peer_list(groupnumber, 0);
-
-    free_ptr_array((void **) chat->name_list);
+    group_peer_index_free(chat);
 
     *chat = (GroupChat) {
         0
@@ -372,6 +377,7 @@ int init_groupchat_win(Toxic *toxic, uint32_t groupnumber, const char *groupname
             groupchats[i].groupnumber = groupnumber;
             groupchats[i].num_peers = 0;
             groupchats[i].time_connected = get_unix_time();
+            peer_order_init(&groupchats[i].peer_order, group_peer_order_cmp, &groupchats[i]);
 
             const int window_id = add_window(toxic, self);
 
@@ -548,26 +554,142 @@ static int peer_sort_cmp_weight(const struct GroupPeer *peer)
     return w;
 }
 
-static int peer_sort_cmp(const void *n1, const void *n2)
+static int peer_sort_cmp(const struct GroupPeer *peer1, const struct GroupPeer *peer2)
 {
-    const struct GroupPeer *peer1 = (const struct GroupPeer *) n1;
-    const struct GroupPeer *peer2 = (const struct GroupPeer *) n2;
+    const int weight1 = peer_sort_cmp_weight(peer1);
+    const int weight2 = peer_sort_cmp_weight(peer2);
 
-    int res = qsort_strcasecmp_hlpr(peer1->name, peer2->name);
-    return res - peer_sort_cmp_weight(peer1) + peer_sort_cmp_weight(peer2);
+    if (weight1 != weight2) {
+        return weight2 - weight1;
+    }
 
+    return qsort_strcasecmp_hlpr(peer1->name, peer2->name);
 }
 
-/* Sorts the peer list, first by role, then by name. */
-static void sort_peerlist(uint32_t groupnumber)
+/* Compares peers in the peer order, first by role, then by name. */
+static int group_peer_order_cmp(uint32_t index1, uint32_t index2, const void *userdata)
 {
-    GroupChat *chat = get_groupchat(groupnumber);
+    const GroupChat *chat = (const GroupChat *) userdata;
 
-    if (!chat) {
+    return peer_sort_cmp(&chat->peer_list[index1], &chat->peer_list[index2]);
+}
+
+/* Adds the peer at `index` in the peer list to the group's peer indexes. */
+static void group_peer_index_add(GroupChat *chat, uint32_t index)
+{
+    const GroupPeer *peer = &chat->peer_list[index];
+    const uint64_t key = peer_map_key_bytes(peer->public_key, TOX_GROUP_PEER_PUBLIC_KEY_SIZE);
+    const uint64_t nick = peer_map_key_nick(peer->name, peer->name_length);
+
+    if (peer_map_add(&chat->peer_ids, peer->peer_id, index) != 0
+            || peer_map_add(&chat->peer_keys, key, index) != 0
+            || peer_map_add(&chat->peer_nicks, nick, index) != 0
+            || peer_order_insert(&chat->peer_order, index) != 0
+            || name_index_add(&chat->peer_names, peer->name, index) != 0) {
+        exit_toxic_err(FATALERR_MEMORY, "failed in group_peer_index_add");
+    }
+}
+
+/* Removes the peer at `index` in the peer list from the group's peer indexes. Must be called
+ * before the peer is cleared.
+ */
+static void group_peer_index_remove(GroupChat *chat, uint32_t index)
+{
+    const GroupPeer *peer = &chat->peer_list[index];
+
+    peer_map_remove(&chat->peer_ids, peer->peer_id, index);
+    peer_map_remove(&chat->peer_keys, peer_map_key_bytes(peer->public_key, TOX_GROUP_PEER_PUBLIC_KEY_SIZE), index);
+    peer_map_remove(&chat->peer_nicks, peer_map_key_nick(peer->name, peer->name_length), index);
+    peer_order_remove(&chat->peer_order, index);
+    name_index_remove(&chat->peer_names, peer->name, index);
+}
+
+static void group_peer_index_free(GroupChat *chat)
+{
+    peer_map_free(&chat->peer_ids);
+    peer_map_free(&chat->peer_keys);
+    peer_map_free(&chat->peer_nicks);
+    peer_order_free(&chat->peer_order);
+    name_index_free(&chat->peer_names);
+
+    free(chat->free_slots);
+    chat->free_slots = NULL;
+    chat->num_free_slots = 0;
+    chat->free_slots_size = 0;
+}
+
+/* Pushes `index`, the peer list index of a peer that just left, on the group's stack of free slots. */
+static void group_free_slot_push(GroupChat *chat, uint32_t index)
+{
+    if (chat->num_free_slots == chat->free_slots_size) {
+        const uint32_t new_size = chat->free_slots_size > 0 ? chat->free_slots_size * 2 : 8;
+        uint32_t *tmp = realloc(chat->free_slots, new_size * sizeof(uint32_t));
+
+        /* the slot isn't reused until the peer list shrinks past it */
+        if (tmp == NULL) {
+            return;
+        }
+
+        chat->free_slots = tmp;
+        chat->free_slots_size = new_size;
+    }
+
+    chat->free_slots[chat->num_free_slots] = index;
+    ++chat->num_free_slots;
+}
+
+/* Returns the most recently freed slot in the peer list, or max_idx if there are none. */
+static uint32_t group_free_slot_pop(GroupChat *chat)
+{
+    while (chat->num_free_slots > 0) {
+        --chat->num_free_slots;
+        const uint32_t index = chat->free_slots[chat->num_free_slots];
+
+        if (index < chat->max_idx && !chat->peer_list[index].active) {
+            return index;
+        }
+    }
+
+    return chat->max_idx;
+}
+
+/* Sets the name of the peer at `index` in the peer list, keeping the nick indexes and peer order up to date. */
+static void group_peer_set_name(GroupChat *chat, uint32_t index, const char *name, size_t length)
+{
+    GroupPeer *peer = &chat->peer_list[index];
+
+    peer_map_remove(&chat->peer_nicks, peer_map_key_nick(peer->name, peer->name_length), index);
+    peer_order_remove(&chat->peer_order, index);
+    name_index_remove(&chat->peer_names, peer->name, index);
+
+    length = MIN(length, TOX_MAX_NAME_LENGTH - 1);
+    memcpy(peer->name, name, length);
+    peer->name[length] = '\0';
+    peer->name_length = length;
+
+    if (peer_map_add(&chat->peer_nicks, peer_map_key_nick(peer->name, peer->name_length), index) != 0
+            || peer_order_insert(&chat->peer_order, index) != 0
+            || name_index_add(&chat->peer_names, peer->name, index) != 0) {
+        exit_toxic_err(FATALERR_MEMORY, "failed in group_peer_set_name");
+    }
+}
+
+/* Sets the role of the peer at `index` in the peer list, keeping the peer order up to date. */
+static void group_peer_set_role(GroupChat *chat, uint32_t index, Tox_Group_Role role)
+{
+    GroupPeer *peer = &chat->peer_list[index];
+
+    if (peer->role == role) {
         return;
     }
 
-    qsort(chat->peer_list, chat->max_idx, sizeof(struct GroupPeer), peer_sort_cmp);
+    peer_order_remove(&chat->peer_order, index);
+
+    peer->role = role;
+
+    if (peer_order_insert(&chat->peer_order, index) != 0) {
+        exit_toxic_err(FATALERR_MEMORY, "failed in group_peer_set_role");
+    }
 }
 
 /* Puts the peer_id associated with nick in `peer_id`.
@@ -589,9 +711,12 @@ static int group_get_nick_peer_id(uint32_t groupnumber, const char *nick, uint32
     }
 
     size_t count = 0;
+    const uint64_t key = peer_map_key_nick(nick, strlen(nick));
+    Peer_Map_Iter iter = {0};
 
-    for (uint32_t i = 0; i < chat->max_idx; ++i) {
-        GroupPeer *peer = &chat->peer_list[i];
+    for (uint32_t i = peer_map_next(&chat->peer_nicks, key, &iter); i != PEER_MAP_NONE;
+            i = peer_map_next(&chat->peer_nicks, key, &iter)) {
+        const GroupPeer *peer = &chat->peer_list[i];
 
         if (!peer->active) {
             continue;
@@ -636,8 +761,12 @@ int group_get_public_key_peer_id(uint32_t groupnumber, const char *public_key, u
         return -1;
     }
 
-    for (uint32_t i = 0; i < chat->max_idx; ++i) {
-        GroupPeer *peer = &chat->peer_list[i];
+    const uint64_t key = peer_map_key_bytes(key_bin, sizeof(key_bin));
+    Peer_Map_Iter iter = {0};
+
+    for (uint32_t i = peer_map_next(&chat->peer_keys, key, &iter); i != PEER_MAP_NONE;
+            i = peer_map_next(&chat->peer_keys, key, &iter)) {
+        const GroupPeer *peer = &chat->peer_list[i];
 
         if (!peer->active) {
             continue;
@@ -725,7 +854,10 @@ int get_peer_index(uint32_t groupnumber, uint32_t peer_id)
         return -1;
     }
 
-    for (uint32_t i = 0; i < chat->max_idx; ++i) {
+    Peer_Map_Iter iter = {0};
+
+    for (uint32_t i = peer_map_next(&chat->peer_ids, peer_id, &iter); i != PEER_MAP_NONE;
+            i = peer_map_next(&chat->peer_ids, peer_id, &iter)) {
         if (!chat->peer_list[i].active) {
             continue;
         }
@@ -861,37 +993,6 @@ void group_toggle_peer_ignore(uint32_t groupnumber, int peer_id, bool ignore)
     }
 }
 
-static void groupchat_update_name_list(uint32_t groupnumber)
-{
-    GroupChat *chat = get_groupchat(groupnumber);
-
-    if (!chat) {
-        return;
-    }
-
-    free_ptr_array((void **) chat->name_list);
-
-    chat->name_list = (char **) malloc_ptr_array(chat->num_peers, TOX_MAX_NAME_LENGTH + 1);
-
-    if (!chat->name_list) {
-        fprintf(stderr, "WARNING: Out of memory in groupchat_update_name_list()\n");
-        return;
-    }
-
-    uint32_t count = 0;
-
-    for (uint32_t i = 0; i < chat->max_idx; ++i) {
-        if (chat->peer_list[i].active) {
-            size_t length = chat->peer_list[i].name_length;
-            memcpy(chat->name_list[count], chat->peer_list[i].name, length);
-            chat->name_list[count][length] = 0;
-            ++count;
-        }
-    }
-
-    sort_peerlist(groupnumber);
-}
-
 /* destroys and re-creates groupchat window */
 void redraw_groupchat_win(ToxWindow *self)
 {
@@ -1265,51 +1366,44 @@ static void groupchat_onGroupPeerJoin(ToxWindow *self, Toxic *toxic, uint32_t gr
         return;
     }
 
-    if (realloc_peer_list(groupnumber, chat->max_idx + 1) == -1) {
-        return;
-    }
+    const uint32_t i = group_free_slot_pop(chat);
 
-    clear_peer(&chat->peer_list[chat->max_idx]);
+    if (i == chat->max_idx) {
+        if (realloc_peer_list(groupnumber, chat->max_idx + 1) == -1) {
+            return;
+        }
 
-    for (uint32_t i = 0; i <= chat->max_idx; ++i) {
-        GroupPeer *peer = &chat->peer_list[i];
+        clear_peer(&chat->peer_list[i]);
+        ++chat->max_idx;
+    }
 
-        if (peer->active) {
-            continue;
-        }
+    GroupPeer *peer = &chat->peer_list[i];
 
-        ++chat->num_peers;
-
-        peer->active = true;
-        peer->peer_id = peer_id;
-        get_group_nick_truncate(tox, peer->name, sizeof(peer->name), peer_id, groupnumber);
-        peer->name_length = strlen(peer->name);
-        snprintf(peer->prev_name, sizeof(peer->prev_name), "%s", peer->name);
-        peer->status = tox_group_peer_get_status(tox, groupnumber, peer_id, NULL);
-        peer->role = tox_group_peer_get_role(tox, groupnumber, peer_id, NULL);
-        peer->last_active = get_unix_time();
-        tox_group_peer_get_public_key(tox, groupnumber, peer_id, (uint8_t *)peer->public_key, NULL);
-        peer->is_ignored = peer_is_ignored(chat, peer->public_key);
-
-        if (peer->is_ignored) {
-            tox_group_set_ignore(tox, groupnumber, peer_id, true, NULL);
-        }
+    ++chat->num_peers;
 
-        if (i == chat->max_idx) {
-            ++chat->max_idx;
-        }
+    peer->active = true;
+    peer->peer_id = peer_id;
+    get_group_nick_truncate(tox, peer->name, sizeof(peer->name), peer_id, groupnumber);
+    peer->name_length = strlen(peer->name);
+    snprintf(peer->prev_name, sizeof(peer->prev_name), "%s", peer->name);
+    peer->status = tox_group_peer_get_status(tox, groupnumber, peer_id, NULL);
+    peer->role = tox_group_peer_get_role(tox, groupnumber, peer_id, NULL);
+    peer->last_active = get_unix_time();
+    tox_group_peer_get_public_key(tox, groupnumber, peer_id, (uint8_t *)peer->public_key, NULL);
+    peer->is_ignored = peer_is_ignored(chat, peer->public_key);
 
-        /* ignore join messages when we first connect to the group */
-        if (timed_out(chat->time_connected, 60) && c_config->show_group_connection_msg) {
-            line_info_add(self, c_config, true, peer->name, NULL, CONNECTION, 0, GREEN, "has joined the room");
+    if (peer->is_ignored) {
+        tox_group_set_ignore(tox, groupnumber, peer_id, true, NULL);
+    }
 
-            write_to_log(ctx->log, c_config, "has joined the room", peer->name, LOG_HINT_CONNECT);
-            sound_notify(self, toxic, silent, NT_WNDALERT_2, NULL);
-        }
+    group_peer_index_add(chat, i);
 
-        groupchat_update_name_list(groupnumber);
+    /* ignore join messages when we first connect to the group */
+    if (timed_out(chat->time_connected, 60) && c_config->show_group_connection_msg) {
+        line_info_add(self, c_config, true, peer->name, NULL, CONNECTION, 0, GREEN, "has joined the room");
 
-        return;
+        write_to_log(ctx->log, c_config, "has joined the room", peer->name, LOG_HINT_CONNECT);
+        sound_notify(self, toxic, silent, NT_WNDALERT_2, NULL);
     }
 }
 
@@ -1361,6 +1455,7 @@ void groupchat_onGroupPeerExit(ToxWindow *self, Toxic *toxic, uint32_t groupnumb
         return;
     }
 
+    group_peer_index_remove(chat, peer_index);
     clear_peer(&chat->peer_list[peer_index]);
 
     uint32_t i;
@@ -1378,7 +1473,9 @@ void groupchat_onGroupPeerExit(ToxWindow *self, Toxic *toxic, uint32_t groupnumb
     --chat->num_peers;
     chat->max_idx = i;
 
-    groupchat_update_name_list(groupnumber);
+    if ((uint32_t) peer_index < chat->max_idx) {
+        group_free_slot_push(chat, peer_index);
+    }
 }
 
 static void groupchat_set_group_name(ToxWindow *self, Toxic *toxic, uint32_t groupnumber)
@@ -1486,9 +1583,7 @@ static void groupchat_onGroupSelfJoin(ToxWindow *self, Toxic *toxic, uint32_t gr
         return;
     }
 
-    chat->peer_list[idx].role = role;
-
-    sort_peerlist(groupnumber);
+    group_peer_set_role(chat, idx, role);
 }
 
 static void groupchat_onGroupRejected(ToxWindow *self, Toxic *toxic, uint32_t groupnumber, Tox_Group_Join_Fail type)
@@ -1529,7 +1624,7 @@ static void groupchat_update_roles(Tox *tox, uint32_t groupnumber)
     }
 
     for (uint32_t i = 0; i < chat->max_idx; ++i) {
-        GroupPeer *peer = &chat->peer_list[i];
+        const GroupPeer *peer = &chat->peer_list[i];
 
         if (!peer->active) {
             continue;
@@ -1539,7 +1634,7 @@ static void groupchat_update_roles(Tox *tox, uint32_t groupnumber)
         Tox_Group_Role role = tox_group_peer_get_role(tox, groupnumber, peer->peer_id, &err);
 
         if (err == TOX_ERR_GROUP_PEER_QUERY_OK) {
-            peer->role = role;
+            group_peer_set_role(chat, i, role);
         }
     }
 }
@@ -1588,24 +1683,21 @@ void groupchat_onGroupModeration(ToxWindow *self, Toxic *toxic, uint32_t groupnu
             break;
 
         case TOX_GROUP_MOD_EVENT_OBSERVER:
-            chat->peer_list[tgt_index].role = TOX_GROUP_ROLE_OBSERVER;
+            group_peer_set_role(chat, tgt_index, TOX_GROUP_ROLE_OBSERVER);
             snprintf(msg, sizeof(msg), "-!- %s has set %s's role to observer", src_name, tgt_name);
             line_info_add(self, c_config, true, NULL, NULL, SYS_MSG, 1, BLUE, "%s", msg);
-            sort_peerlist(groupnumber);
             break;
 
         case TOX_GROUP_MOD_EVENT_USER:
-            chat->peer_list[tgt_index].role = TOX_GROUP_ROLE_USER;
+            group_peer_set_role(chat, tgt_index, TOX_GROUP_ROLE_USER);
             snprintf(msg, sizeof(msg), "-!- %s has set %s's role to user", src_name, tgt_name);
             line_info_add(self, c_config, true, NULL, NULL, SYS_MSG, 1, BLUE, "%s", msg);
-            sort_peerlist(groupnumber);
             break;
 
         case TOX_GROUP_MOD_EVENT_MODERATOR:
-            chat->peer_list[tgt_index].role = TOX_GROUP_ROLE_MODERATOR;
+            group_peer_set_role(chat, tgt_index, TOX_GROUP_ROLE_MODERATOR);
             snprintf(msg, sizeof(msg), "-!- %s has set %s's role to moderator", src_name, tgt_name);
             line_info_add(self, c_config, true, NULL, NULL, SYS_MSG, 1, BLUE, "%s", msg);
-            sort_peerlist(groupnumber);
             break;
 
         default:
@@ -1650,16 +1742,12 @@ static void groupchat_onGroupSelfNickChange(ToxWindow *self, Toxic *toxic, uint3
         return;
     }
 
-    length = MIN(length, TOX_MAX_NAME_LENGTH - 1);
-    memcpy(chat->peer_list[peer_index].name, new_nick, length);
-    chat->peer_list[peer_index].name[length] = '\0';
-    chat->peer_list[peer_index].name_length = length;
+    group_peer_set_name(chat, peer_index, new_nick, length);
 
     line_info_add(self, toxic->c_config, true, old_nick, chat->peer_list[peer_index].name, NAME_CHANGE, 0,
                   MAGENTA, " is now known as ");
 
     groupchat_update_last_seen(groupnumber, peer_id);
-    groupchat_update_name_list(groupnumber);
 
     ChatContext *ctx = self->chatwin;
 
@@ -1695,10 +1783,7 @@ static void groupchat_onGroupNickChange(ToxWindow *self, Toxic *toxic, uint32_t
 
     GroupPeer *peer = &chat->peer_list[peer_index];
 
-    length = MIN(length, TOX_MAX_NAME_LENGTH - 1);
-    memcpy(peer->name, new_nick, length);
-    peer->name[length] = '\0';
-    peer->name_length = length;
+    group_peer_set_name(chat, peer_index, new_nick, length);
 
     line_info_add(self, toxic->c_config, true, peer->prev_name, peer->name, NAME_CHANGE, 0, MAGENTA,
                   " is now known as ");
@@ -1710,8 +1795,6 @@ static void groupchat_onGroupNickChange(ToxWindow *self, Toxic *toxic, uint32_t
     write_to_log(ctx->log, toxic->c_config, log_event, peer->prev_name, LOG_HINT_NAME);
 
     snprintf(peer->prev_name, sizeof(peer->prev_name), "%s", peer->name);
-
-    groupchat_update_name_list(groupnumber);
 }
 
 static void groupchat_onGroupStatusChange(ToxWindow *self, Toxic *toxic, uint32_t groupnumber, uint32_t peer_id,
@@ -1935,23 +2018,11 @@ static bool groupchat_onKey(ToxWindow *self, Toxic *toxic, wint_t key, bool ltr)
             int diff;
 
             if (wcsncmp(ctx->line, L"/invite ", wcslen(L"/invite ")) == 0) {
-                size_t num_friends = friendlist_get_count(toxic->friends);
-                char **friend_names = (char **) malloc_ptr_array(num_friends, TOX_MAX_NAME_LENGTH);
-
-                if (friend_names != NULL) {
-                    friendlist_get_names(toxic->friends, friend_names, num_friends, TOX_MAX_NAME_LENGTH);
-                    diff = complete_line(self, toxic, (const char *const *) friend_names, num_friends);
-                    free_ptr_array((void **) friend_names);
-                } else {
-                    diff = -1;
-                    num_friends = 0;
-                    fprintf(stderr, "Failed to allocate memory for friends name list\n");
-                }
-
+                diff = complete_line_index(self, toxic, &toxic->friends->names);
             } else if (wcsncmp(ctx->line, L"/avatar ", wcslen(L"/avatar ")) == 0) {
                 diff = dir_match(self, toxic, ctx->line, L"/avatar");
             } else if (ctx->line[0] != L'/' || wcschr(ctx->line, L' ') != NULL) {
-                diff = complete_line(self, toxic, (const char *const *) chat->name_list, chat->num_peers);
+                diff = complete_line_index(self, toxic, &chat->peer_names);
             } else {
                 diff = complete_line(self, toxic, group_cmd_list, sizeof(group_cmd_list) / sizeof(char *));
             }
@@ -2164,15 +2235,19 @@ static void groupchat_onDraw(ToxWindow *self, Toxic *toxic)
 
         pthread_mutex_lock(&Winthread.lock);
 
-        for (uint32_t i = chat->side_pos; i < chat->max_idx && offset < maxlines; ++i) {
-            if (!chat->peer_list[i].active) {
-                continue;
+        for (uint32_t i = chat->side_pos; i < chat->num_peers && offset < maxlines; ++i) {
+            const uint32_t peer_index = peer_order_get(&chat->peer_order, i);
+
+            if (peer_index == PEER_ORDER_NONE) {
+                break;
             }
 
+            const GroupPeer *peer = &chat->peer_list[peer_index];
+
             wmove(ctx->sidebar, offset + 2, 1);
 
-            const bool is_ignored = chat->peer_list[i].is_ignored;
-            uint16_t maxlen_offset = chat->peer_list[i].role == TOX_GROUP_ROLE_USER ? 2 : 3;
+            const bool is_ignored = peer->is_ignored;
+            uint16_t maxlen_offset = peer->role == TOX_GROUP_ROLE_USER ? 2 : 3;
 
             if (is_ignored) {
                 ++maxlen_offset;
@@ -2181,13 +2256,13 @@ static void groupchat_onDraw(ToxWindow *self, Toxic *toxic)
             /* truncate nick to fit in side panel without modifying list */
             char tmpnck[TOX_MAX_NAME_LENGTH];
             const size_t maxlen = SIDEBAR_WIDTH - maxlen_offset;
-            snprintf(tmpnck, maxlen + 1, "%s", chat->peer_list[i].name);
+            snprintf(tmpnck, maxlen + 1, "%s", peer->name);
 
             int namecolour = WHITE;
 
-            if (chat->peer_list[i].status == TOX_USER_STATUS_AWAY) {
+            if (peer->status == TOX_USER_STATUS_AWAY) {
                 namecolour = YELLOW;
-            } else if (chat->peer_list[i].status == TOX_USER_STATUS_BUSY) {
+            } else if (peer->status == TOX_USER_STATUS_BUSY) {
                 namecolour = RED;
             }
 
@@ -2195,13 +2270,13 @@ static void groupchat_onDraw(ToxWindow *self, Toxic *toxic)
             const char *rolesig = "";
             int rolecolour = WHITE;
 
-            if (chat->peer_list[i].role == TOX_GROUP_ROLE_FOUNDER) {
+            if (peer->role == TOX_GROUP_ROLE_FOUNDER) {
                 rolesig = "&";
                 rolecolour = BLUE;
-            } else if (chat->peer_list[i].role == TOX_GROUP_ROLE_MODERATOR) {
+            } else if (peer->role == TOX_GROUP_ROLE_MODERATOR) {
                 rolesig = "+";
                 rolecolour = GREEN;
-            } else if (chat->peer_list[i].role == TOX_GROUP_ROLE_OBSERVER) {
+            } else if (peer->role == TOX_GROUP_ROLE_OBSERVER) {
                 rolesig = "-";
                 rolecolour = MAGENTA;
             }
@@ -9,6 +9,9 @@
 #ifndef GROUPCHATS_H
 #define GROUPCHATS_H
 
+#include "name_index.h"
+#include "peer_map.h"
+#include "peer_order.h"
 #include "toxic.h"
 #include "windows.h"
 
@@ -40,9 +43,21 @@ typedef struct GroupPeer {
 typedef struct {
     char       chat_id[TOX_GROUP_CHAT_ID_SIZE];
     GroupPeer  *peer_list;
-    char       **name_list;   /* List of peer names, needed for tab completion */
-    uint32_t   num_peers;     /* Number of peers in the chat/name_list array */
+    uint32_t   num_peers;     /* Number of active peers in the peer list */
     uint32_t   max_idx;       /* Maximum peer list index - 1 */
+    Peer_Order peer_order;    /* The active peers sorted by role and then name, for the sidebar */
+    Name_Index peer_names;    /* The active peers' names by peer_list index, for tab completion */
+
+    /* Indexes into peer_list. A peer keeps its peer_list index for as long as it's in the group. */
+    Peer_Map   peer_ids;      /* keyed by peer_id */
+    Peer_Map   peer_keys;     /* keyed by public key */
+    Peer_Map   peer_nicks;    /* keyed by case-folded nick */
+
+    /* Stack of peer_list indexes freed by peers leaving, most recent last. An index may have been reused
+     * or dropped from the end of the list since it was pushed. */
+    uint32_t   *free_slots;
+    uint32_t   num_free_slots;
+    uint32_t   free_slots_size;
 
     uint8_t    **ignored_list; /* List of keys of peers that we're ignoring */
     uint16_t   num_ignored;
@@ -54,7 +69,7 @@ typedef struct {
     uint64_t   time_connected;    /* The time we successfully connected to the group */
 
     uint16_t   window_id;
-    int        side_pos;     /* current position of the sidebar - used for scrolling up and down */
+    int        side_pos;     /* current position of the sidebar in peer_order - used for scrolling up and down */
 } GroupChat;
 
 void exit_groupchat(ToxWindow *self, Toxic *toxic, uint32_t groupnumber, const char *partmessage, size_t length);
@@ -172,7 +172,10 @@ static void help_draw_global(ToxWindow *self)
     wprintw(win, "  /note <msg>                : Set a personal note\n");
     wprintw(win, "  /nick <name>               : Set your global name (doesn't affect groups)\n");
     wprintw(win, "  /nospam <value>            : Change part of your Tox ID to stop spam\n");
-    wprintw(win, "  /log <on>|<off>            : Enable/disable logging\n");
+    wprintw(win, "  /log <on>|<off>|<stats>    : Enable/disable logging or show log writer stats\n");
+    wprintw(win, "  /search <words>            : Jump to the last chat log line containing all words\n");
+    wprintw(win, "  /wakeups                   : Show how often each thread woke up and why\n");
+    wprintw(win, "  /frames                    : Show how long the interface takes to draw\n");
     wprintw(win, "  /myid                      : Print your Tox ID\n");
     wprintw(win, "  /group <name>              : Create a new group chat\n");
     wprintw(win, "  /join <chatid>             : Join a public groupchat using a Chat ID\n");
@@ -238,8 +241,8 @@ static void help_draw_chat(ToxWindow *self)
     wprintw(win, "  /cjoin                     : Join a pending conference\n");
     wprintw(win, "  /invite <group num>        : Invite contact to a groupchat \n");
     wprintw(win, "  /gaccept <password>        : Accept a pending groupchat invite\n");
-    wprintw(win, "  /sendfile <path>           : Send a file\n");
-    wprintw(win, "  /savefile <id>             : Receive a file\n");
+    wprintw(win, "  /sendfile [-r] <path>      : Send a file or directory\n");
+    wprintw(win, "  /savefile <id>|-r          : Receive a file or directory\n");
     wprintw(win, "  /cancel <type> <id>        : Cancel file transfer where type: in|out\n");
 
 #ifdef GAMES
@@ -409,6 +412,7 @@ static void help_draw_contacts(ToxWindow *self)
     wprintw(win, "  Enter                         : Open a chat window with selected contact\n");
     wprintw(win, "  Delete                        : Permanently delete a contact\n");
     wprintw(win, "  B                             : Block or unblock a contact\n");
+    wprintw(win, "  /                             : Filter contacts by name\n");
 
     help_draw_bottom_menu(win);
 
@@ -441,7 +445,7 @@ void help_onKey(ToxWindow *self, wint_t key)
             break;
 
         case L'g':
-            height = 25;
+            height = 28;
 #ifdef VIDEO
             height += 8;
 #elif AUDIO
@@ -475,7 +479,7 @@ void help_onKey(ToxWindow *self, wint_t key)
 #endif /* PYTHON */
 
         case L'f':
-            help_init_window(self, 10, 80);
+            help_init_window(self, 11, 80);
             self->help->type = HELP_CONTACTS;
             break;
 
@@ -303,6 +303,7 @@ bool input_handle(ToxWindow *self, Toxic *toxic, wint_t key, int x, int mx_x)
             break;
 
         case T_KEY_C_L:
+            self->chatwin->hst->redraw = true;
             force_refresh(self->chatwin->history);
             break;
 
@@ -13,12 +13,16 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "conference.h"
 #include "groupchats.h"
 #include "line_info.h"
+#include "line_layout.h"
+#include "log.h"
 #include "message_queue.h"
 #include "misc_tools.h"
 #include "notify.h"
@@ -26,17 +30,290 @@
 #include "toxic.h"
 #include "windows.h"
 
+/* Slabs are aligned to their own size so that the slab owning any record can be found by masking
+ * the record's address. A slab is freed as soon as the last record carved out of it is released, which
+ * in practice happens in FIFO order as old lines fall off the top of the history. */
+#define LINE_SLAB_SIZE (64 * 1024)
+#define LINE_SLAB_ALIGN _Alignof(struct line_info)
+#define LINE_INFO_PARSE_ERR "Failed to parse message"
+
+struct line_slab {
+    struct line_slab *next;
+    size_t used;    /* bytes of `data` handed out so far */
+    size_t live;    /* number of records in `data` that have not been released */
+    char data[];
+};
+
+#define LINE_SLAB_CAPACITY (LINE_SLAB_SIZE - offsetof(struct line_slab, data))
+
+/* The largest possible record must always fit in an empty slab */
+static_assert(TIME_STR_SIZE + 2 * (TOXIC_MAX_NAME_LENGTH + 1) + MAX_LINE_INFO_MSG_SIZE < LINE_SLAB_CAPACITY,
+              "LINE_SLAB_SIZE is too small");
+static_assert(TIME_STR_SIZE + 2 * (TOXIC_MAX_NAME_LENGTH + 1) <= UINT8_MAX, "line_info offsets overflow");
+
+static struct line_slab *line_slab_of(const void *record)
+{
+    return (struct line_slab *)((uintptr_t)record & ~(uintptr_t)(LINE_SLAB_SIZE - 1));
+}
+
+static void *line_arena_alloc(struct history *hst, size_t size)
+{
+    size = (size + LINE_SLAB_ALIGN - 1) & ~(LINE_SLAB_ALIGN - 1);
+
+    struct line_slab *slab = hst->slabs;
+
+    if (slab == NULL || slab->used + size > LINE_SLAB_CAPACITY) {
+        slab = aligned_alloc(LINE_SLAB_SIZE, LINE_SLAB_SIZE);
+
+        if (slab == NULL) {
+            return NULL;
+        }
+
+        slab->used = 0;
+        slab->live = 0;
+        slab->next = hst->slabs;
+        hst->slabs = slab;
+        ++hst->num_slabs;
+    }
+
+    void *record = slab->data + slab->used;
+    slab->used += size;
+    ++slab->live;
+
+    return record;
+}
+
+static void line_arena_release(struct history *hst, const void *record)
+{
+    struct line_slab *slab = line_slab_of(record);
+
+    if (--slab->live > 0) {
+        return;
+    }
+
+    if (slab == hst->slabs) {  // keep the slab we're filling and start over from the beginning
+        slab->used = 0;
+        return;
+    }
+
+    struct line_slab **pp = &hst->slabs;
+
+    while (*pp != slab) {
+        pp = &(*pp)->next;
+    }
+
+    *pp = slab->next;
+    free(slab);
+    --hst->num_slabs;
+}
+
+/* Copies `len` bytes of `str` plus a NUL terminator to `*p` and advances `*p` past them.
+ * Returns the new value of `*p`.
+ */
+static char *line_info_pack_str(char **p, const char *str, size_t len)
+{
+    if (len > 0) {
+        memcpy(*p, str, len);
+    }
+
+    (*p)[len] = '\0';
+    *p += len + 1;
+
+    return *p;
+}
+
+/* Packs `timestr`, `name1`, `name2` and `msg` into a new arena record and sets the offsets of `line`
+ * to match it. Any string may be NULL. Names and timestamps are truncated to their maximum lengths.
+ *
+ * Returns the new record on success.
+ * Returns NULL on failure.
+ */
+static char *line_info_pack(struct history *hst, struct line_info *line, const char *timestr, const char *name1,
+                            const char *name2, const char *msg)
+{
+    const size_t time_len = timestr != NULL ? strnlen(timestr, TIME_STR_SIZE - 1) : 0;
+    const size_t name1_len = name1 != NULL ? strnlen(name1, TOXIC_MAX_NAME_LENGTH) : 0;
+    const size_t name2_len = name2 != NULL ? strnlen(name2, TOXIC_MAX_NAME_LENGTH) : 0;
+    const size_t msg_len = msg != NULL ? strlen(msg) : 0;
+
+    if (msg_len >= MAX_LINE_INFO_MSG_SIZE) {
+        return NULL;
+    }
+
+    char *text = line_arena_alloc(hst, time_len + name1_len + name2_len + msg_len + 4);
+
+    if (text == NULL) {
+        return NULL;
+    }
+
+    char *p = text;
+
+    line->name1_offset = (uint8_t)(line_info_pack_str(&p, timestr, time_len) - text);
+    line->name2_offset = (uint8_t)(line_info_pack_str(&p, name1, name1_len) - text);
+    line->msg_offset = (uint8_t)(line_info_pack_str(&p, name2, name2_len) - text);
+    line_info_pack_str(&p, msg, msg_len);
+
+    return text;
+}
+
+struct line_info *line_info_alloc(struct history *hst, const char *timestr, const char *name1,
+                                  const char *name2, const char *msg)
+{
+    struct line_info *line = line_arena_alloc(hst, sizeof(struct line_info));
+
+    if (line == NULL) {
+        return NULL;
+    }
+
+    memset(line, 0, sizeof(struct line_info));
+
+    line->text = line_info_pack(hst, line, timestr, name1, name2, msg);
+
+    if (line->text == NULL) {
+        line_arena_release(hst, line);
+        return NULL;
+    }
+
+    return line;
+}
+
+void line_info_free(struct history *hst, struct line_info *line)
+{
+    line_layout_cache_invalidate(hst->layouts, line, line->id);
+    line_arena_release(hst, line->text);
+    line_arena_release(hst, line);
+}
+
+size_t line_info_arena_size(const struct history *hst)
+{
+    return hst->num_slabs * LINE_SLAB_SIZE;
+}
+
+const char *line_info_timestr(const struct line_info *line)
+{
+    return line->text;
+}
+
+const char *line_info_name1(const struct line_info *line)
+{
+    return line->text + line->name1_offset;
+}
+
+const char *line_info_name2(const struct line_info *line)
+{
+    return line->text + line->name2_offset;
+}
+
+const char *line_info_msg(const struct line_info *line)
+{
+    return line->text + line->msg_offset;
+}
+
+/* Minimum number of slots in a history's line index */
+#define LINE_INDEX_MIN_SIZE 64
+
+static void line_index_insert(struct history *hst, struct line_info *line)
+{
+    hst->index[line->id & (hst->index_size - 1)] = line;
+}
+
+static void line_index_remove(struct history *hst, const struct line_info *line)
+{
+    struct line_info **slot = &hst->index[line->id & (hst->index_size - 1)];
+
+    if (*slot == line) {
+        *slot = NULL;
+    }
+}
+
+/* Makes sure the index has room for one more line than the history currently holds. Line IDs wrap
+ * around at INT_MAX, which isn't a multiple of the index size, so we leave one spare slot for that.
+ *
+ * Return true on success.
+ */
+static bool line_index_reserve(struct history *hst)
+{
+    if (hst->num_lines + 2 <= hst->index_size) {
+        return true;
+    }
+
+    size_t new_size = MAX(hst->index_size, LINE_INDEX_MIN_SIZE);
+
+    while (hst->num_lines + 2 > new_size) {
+        new_size *= 2;
+    }
+    struct line_info **new_index = calloc(new_size, sizeof(struct line_info *));
+
+    if (new_index == NULL) {
+        return false;
+    }
+
+    free(hst->index);
+    hst->index = new_index;
+    hst->index_size = new_size;
+
+    for (struct line_info *line = hst->line_root; line != NULL; line = line->next) {
+        line_index_insert(hst, line);
+    }
+
+    return true;
+}
+
+struct line_info *line_info_find(const struct history *hst, uint32_t id)
+{
+    if (hst->index_size == 0) {
+        return NULL;
+    }
+
+    struct line_info *line = hst->index[id & (hst->index_size - 1)];
+
+    if (line == NULL || line->id != id) {
+        return NULL;
+    }
+
+    return line;
+}
+
+void line_info_append(struct history *hst, struct line_info *line)
+{
+    if (!line_index_reserve(hst)) {
+        exit_toxic_err(FATALERR_MEMORY, "line_index_reserve() failed in line_info_append()");
+    }
+
+    line->prev = hst->line_end;
+    line->next = NULL;
+    hst->line_end->next = line;
+    hst->line_end = line;
+
+    line_index_insert(hst, line);
+    ++hst->num_lines;
+}
+
 void line_info_init(struct history *hst)
 {
-    hst->line_root = calloc(1, sizeof(struct line_info));
+    hst->line_root = line_info_alloc(hst, NULL, NULL, NULL, NULL);
 
     if (hst->line_root == NULL) {
-        exit_toxic_err(FATALERR_MEMORY, "calloc() failed in line_info_init()");
+        exit_toxic_err(FATALERR_MEMORY, "line_info_alloc() failed in line_info_init()");
     }
 
     hst->line_start = hst->line_root;
     hst->line_end = hst->line_start;
     hst->queue_size = 0;
+    hst->num_lines = 1;
+    hst->redraw = true;
+
+    hst->layouts = line_layout_cache_new();
+
+    if (hst->layouts == NULL) {
+        exit_toxic_err(FATALERR_MEMORY, "line_layout_cache_new() failed in line_info_init()");
+    }
+
+    if (!line_index_reserve(hst)) {
+        exit_toxic_err(FATALERR_MEMORY, "line_index_reserve() failed in line_info_init()");
+    }
+
+    line_index_insert(hst, hst->line_root);
 }
 
 /* resets line_start (moves to end of chat history) */
@@ -74,35 +351,50 @@ void line_info_cleanup(struct history *hst)
         return;
     }
 
-    struct line_info *tmp1 = hst->line_root;
+    struct line_slab *slab = hst->slabs;
 
-    while (tmp1) {
-        struct line_info *tmp2 = tmp1->next;
-        free(tmp1);
-        tmp1 = tmp2;
-    }
-
-    for (size_t i = 0; i < hst->queue_size; ++i) {
-        free(hst->queue[i]);
+    while (slab) {
+        struct line_slab *next = slab->next;
+        free(slab);
+        slab = next;
     }
 
+    line_layout_cache_free(hst->layouts);
+    free(hst->index);
     free(hst);
 }
 
-/* moves root forward and frees previous root */
-static void line_info_root_fwd(struct history *hst)
+/* Frees the oldest line in the history. The root stays in place as the head of the list, and takes
+ * over the ID preceding the new oldest line so that IDs remain consecutive.
+ *
+ * Return false if there was nothing to free. The newest line is never freed.
+ */
+static bool line_info_root_fwd(struct history *hst)
 {
-    struct line_info *tmp = hst->line_root->next;
-    tmp->prev = NULL;
+    struct line_info *root = hst->line_root;
+    struct line_info *line = root->next;
 
-    if (hst->line_start->prev == NULL) {    /* if line_start is root move it forward as well */
-        hst->line_start = hst->line_start->next;
-        hst->line_start->prev = NULL;
-        ++hst->start_id;
+    if (line == NULL || line == hst->line_end) {
+        return false;
     }
 
-    free(hst->line_root);
-    hst->line_root = tmp;
+    root->next = line->next;
+    line->next->prev = root;
+
+    if (hst->line_start == line) {
+        hst->line_start = root;
+    }
+
+    line_index_remove(hst, root);
+    line_index_remove(hst, line);
+    line_info_free(hst, line);
+
+    root->id = line->id;
+    line_index_insert(hst, root);
+
+    --hst->num_lines;
+
+    return true;
 }
 
 /* returns ptr to queue item 0 and removes it from queue. Returns NULL if queue is empty. */
@@ -171,52 +463,7 @@ static int print_n_chars(WINDOW *win, const wchar_t *s, size_t n, int max_y)
     return newline;
 }
 
-/* Returns the index of the last space character in `s` found before `limit`.
- * Returns -1 if no space is found.
- */
-static int rspace_index(const wchar_t *s, int limit)
-{
-    for (int i = limit; i >= 0; --i) {
-        if (s[i] == L' ') {
-            return i;
-        }
-    }
-
-    return -1;
-}
-
-/* Returns the first index in `s` containing a newline byte found before `limit`.
- * Returns -1 if no newline  is found.
- */
-static int newline_index(const wchar_t *s, int limit)
-{
-    wchar_t ch;
-
-    for (int i = 0; i < limit && (ch = s[i]); ++i) {
-        if (ch == L'\n') {
-            return i;
-        }
-    }
-
-    return -1;
-}
-
-/* Returns the number of newline bytes in `s` */
-static unsigned int newline_count(const wchar_t *s)
-{
-    wchar_t ch;
-    unsigned int count = 0;
-
-    for (size_t i = 0; (ch = s[i]); ++i) {
-        if (ch == L'\n') {
-            ++count;
-        }
-    }
-
-    return count;
-}
-
-/* Prints `line` message to window, wrapping at the last word that fits on the current line.
+/* Prints the message of `line`, wrapped according to `layout`, to `win`.
  * This function updates the `format_lines` field of `line` according to current window dimensions.
  *
  * If `win` is null nothing will be printed to the window. This is useful to set the
@@ -225,98 +472,54 @@ static unsigned int newline_count(const wchar_t *s)
  * Return 0 on success.
  * Return -1 if not all characters in line's message were printed to screen.
  */
-static int print_wrap(WINDOW *win, struct line_info *line, const Client_Config *c_config, int max_x, int max_y)
+static int print_wrap(WINDOW *win, struct line_info *line, const struct line_layout *layout, int max_y)
 {
-    const wchar_t *msg = line->msg;
-    uint16_t length = line->msg_width;
-    uint16_t lines = 0;
-    const int x_start = line->len - line->msg_width - 1;  // manually keep track of x position because ncurses sucks
-    int x_limit = max_x - x_start;
-
-    if (x_limit <= 1) {
-        fprintf(stderr, "Warning: x_limit <= 0 in print_wrap(): %d\n", x_limit);
+    if (layout == NULL || !layout->wrapped) {
+        fprintf(stderr, "Warning: no room to wrap line %u in print_wrap()\n", line->id);
         return -1;
     }
 
-    int x;
-    int y;
-    UNUSED_VAR(y);
-
-    while (msg) {
-        getyx(win, y, x);
-
-        // next line would print past window limit so we abort; we don't want to update format_lines
-        if (x > x_start) {
-            return -1;
-        }
-
-        if (length < x_limit) {
-            const int p_ret = print_n_chars(win, msg, length, max_y);
-
-            if (p_ret == 1) {
-                lines += newline_count(msg);
-            } else if (p_ret == -1) {
-                return -1;
-            }
+    uint16_t lines = layout->lines;
 
-            ++lines;
-            break;
-        }
+    if (win == NULL) {
+        line->format_lines = lines;
+        return 0;
+    }
 
-        const int newline_idx = newline_index(msg, x_limit - 1);
+    const int x_start = layout->x_start;
 
-        if (newline_idx >= 0) {
-            if (print_n_chars(win, msg, newline_idx + 1, max_y) == -1) {
-                return -1;
-            }
+    for (uint16_t i = 0; i < layout->num_rows; ++i) {
+        const struct line_layout_row *row = &layout->rows[i];
 
-            msg += (newline_idx + 1);
-            length -= (newline_idx + 1);
-            x_limit = max_x; // if we find a newline we stop adding column padding for rest of message
-            ++lines;
-            continue;
+        // next line would print past window limit so we abort; we don't want to update format_lines
+        if (getcurx(win) > x_start) {
+            return -1;
         }
 
-        const int space_idx = rspace_index(msg, x_limit - 1);
-
-        if (space_idx >= 1) {
-            if (print_n_chars(win, msg, space_idx, max_y) == -1) {
-                return -1;
-            }
-
-            msg += space_idx + 1;
-            length -= (space_idx + 1);
-
-            if (win) {
-                waddch(win, '\n');
-            }
-        } else {
-            if (print_n_chars(win, msg, x_limit, max_y) == -1) {
-                return -1;
-            }
-
-            msg += x_limit;
-            length -= x_limit;
+        if (print_n_chars(win, layout->msg + row->offset, row->length, max_y) == -1) {
+            return -1;
         }
 
-        if (c_config && !c_config->line_padding) {
-            x_limit = max_x; // stop adding column padding for rest of message
+        if (row->flags & LINE_LAYOUT_ROW_NEWLINE) {
+            waddch(win, '\n');
         }
 
         // Add padding to the start of the next line
-        if (win && x_limit < max_x) {
-            for (size_t i = 0; i < x_start; ++i) {
+        if (row->flags & LINE_LAYOUT_ROW_PADDED) {
+            for (int j = 0; j < x_start; ++j) {
                 waddch(win, ' ');
             }
         }
-
-        ++lines;
     }
 
-    if (win && line->noread_flag) {
+    if (line->noread_flag) {
+        int x;
+        int y;
         getyx(win, y, x);
 
-        if (x >= max_x - 1 || x == x_start) {
+        UNUSED_VAR(y);
+
+        if (x >= layout->max_x - 1 || x == x_start) {
             ++lines;
         }
 
@@ -335,37 +538,117 @@ static int print_wrap(WINDOW *win, struct line_info *line, const Client_Config *
  *
  * `buf_size` is the number of wide characters that `buf` can hold.
  *
- * Returns the widechar width of the string.
+ * Returns the widechar width of the string on success.
+ * Returns -1 if `msg` cannot be converted.
  */
-uint16_t line_info_add_msg(wchar_t *buf, size_t buf_size, const char *msg)
+static int line_info_msg_to_wcs(wchar_t *buf, size_t buf_size, const char *msg)
 {
     if (msg == NULL || msg[0] == '\0') {
+        buf[0] = L'\0';
         return 0;
     }
 
     const int wc_msg_len = mbs_to_wcs_buf(buf, msg, buf_size);
 
-    if (wc_msg_len > 0 && wc_msg_len < buf_size) {
-        buf[wc_msg_len] = L'\0';
-        int width = wcswidth(buf, wc_msg_len);
+    if (wc_msg_len <= 0 || wc_msg_len >= buf_size) {
+        return -1;
+    }
+
+    buf[wc_msg_len] = L'\0';
+    int width = wcswidth(buf, wc_msg_len);
 
-        if (width < 0 || width > UINT16_MAX) {  // the best we can do on failure is to fall back to strlen
-            width = strlen(msg);
-        }
+    if (width < 0 || width > UINT16_MAX) {  // the best we can do on failure is to fall back to strlen
+        width = strlen(msg);
+    }
+
+    return width;
+}
+
+/* Converts the multibyte string `msg` into a wide character string and puts
+ * the result in `buf`.
+ *
+ * `buf_size` is the number of wide characters that `buf` can hold.
+ *
+ * Returns the widechar width of the string.
+ */
+uint16_t line_info_add_msg(wchar_t *buf, size_t buf_size, const char *msg)
+{
+    const int width = line_info_msg_to_wcs(buf, buf_size, msg);
 
+    if (width >= 0) {
         return (uint16_t)width;
-    } else {
-        fprintf(stderr, "Failed to convert string '%s' to widechar (len=%d, error=%s)\n",
-                msg, wc_msg_len, strerror(errno));
-        const wchar_t *err = L"Failed to parse message";
-        uint16_t width = (uint16_t)wcslen(err);
-        wmemcpy(buf, err, width);
-        buf[width] = L'\0';
-        return width;
     }
+
+    fprintf(stderr, "Failed to convert string '%s' to widechar (len=%zu, error=%s)\n",
+            msg, strlen(msg), strerror(errno));
+
+    return (uint16_t)line_info_msg_to_wcs(buf, buf_size, LINE_INFO_PARSE_ERR);
 }
 
-static void line_info_init_line(ToxWindow *self, struct line_info *line)
+/* Validates `msg` and puts its wide character form in `buf`. If `msg` cannot be converted, it's
+ * replaced with an error message so that the line's stored text always converts cleanly when drawn.
+ *
+ * Returns the message that should be stored for the line.
+ */
+static const char *line_info_prepare_msg(wchar_t *buf, size_t buf_size, const char *msg, uint16_t *msg_width)
+{
+    const int width = line_info_msg_to_wcs(buf, buf_size, msg);
+
+    if (width >= 0) {
+        *msg_width = (uint16_t)width;
+        return msg;
+    }
+
+    *msg_width = line_info_add_msg(buf, buf_size, msg);
+
+    return LINE_INFO_PARSE_ERR;
+}
+
+/* Returns the layout of `line`'s message wrapped for a history window `max_x` columns wide, from the
+ * layout cache if it's there. `msg` is the message in wide characters if the caller already has it, or NULL.
+ *
+ * Returns NULL if the message can't be wrapped.
+ */
+static const struct line_layout *line_info_layout(struct history *hst, const struct line_info *line,
+        const wchar_t *msg, const Client_Config *c_config, int max_x)
+{
+    const int x_start = line->len - line->msg_width - 1;
+    const bool line_padding = c_config == NULL || c_config->line_padding;
+
+    struct line_layout *layout = line_layout_cache_find(hst->layouts, line, line->id);
+
+    if (layout != NULL && line_layout_matches(layout, x_start, max_x, line_padding)) {
+        return layout;
+    }
+
+    if (layout == NULL) {
+        wchar_t buf[MAX_LINE_INFO_MSG_SIZE];
+
+        if (msg == NULL) {
+            if (line_info_msg_to_wcs(buf, MAX_LINE_INFO_MSG_SIZE, line_info_msg(line)) < 0) {
+                buf[0] = L'\0';
+            }
+
+            msg = buf;
+        }
+
+        layout = line_layout_cache_claim(hst->layouts, line, line->id);
+
+        if (line_layout_set_msg(layout, msg, wcslen(msg)) == -1) {
+            layout->key = NULL;
+            return NULL;
+        }
+    }
+
+    if (line_layout_wrap(layout, x_start, max_x, line_padding) == -1) {
+        return NULL;
+    }
+
+    return layout;
+}
+
+static void line_info_init_line(ToxWindow *self, const Client_Config *c_config, struct line_info *line,
+                                const wchar_t *msg)
 {
     int y2;
     int x2;
@@ -376,7 +659,9 @@ static void line_info_init_line(ToxWindow *self, struct line_info *line)
     const int max_y = y2 - CHATBOX_HEIGHT - WINDOW_BAR_HEIGHT;
     const int max_x = self->show_peerlist ? x2 - 1 - SIDEBAR_WIDTH : x2;
 
-    print_wrap(NULL, line, NULL, max_x, max_y);
+    const struct line_layout *layout = line_info_layout(self->chatwin->hst, line, msg, c_config, max_x);
+
+    print_wrap(NULL, line, layout, max_y);
 }
 
 /*
@@ -458,12 +743,6 @@ int line_info_add(ToxWindow *self, const Client_Config *c_config, bool show_time
         return -1;
     }
 
-    struct line_info *new_line = calloc(1, sizeof(struct line_info));
-
-    if (new_line == NULL) {
-        exit_toxic_err(FATALERR_MEMORY, "failed in line_info_add");
-    }
-
     char frmt_msg[MAX_LINE_INFO_MSG_SIZE];
     frmt_msg[0] = 0;
 
@@ -472,152 +751,461 @@ int line_info_add(ToxWindow *self, const Client_Config *c_config, bool show_time
     vsnprintf(frmt_msg, sizeof(frmt_msg), msg, args);
     va_end(args);
 
-    int len = line_info_type_length(c_config, type);
+    char timestr[TIME_STR_SIZE] = {0};
+
+    if (show_timestamp && c_config->show_timestamps) {
+        get_time_str(timestr, sizeof(timestr), c_config->timestamp_format);
+    }
 
-    const uint16_t msg_width = line_info_add_msg(new_line->msg, sizeof(new_line->msg) / sizeof(wchar_t), frmt_msg);
+    wchar_t wc_msg[MAX_LINE_INFO_MSG_SIZE];
+    uint16_t msg_width;
+    const char *line_msg = line_info_prepare_msg(wc_msg, MAX_LINE_INFO_MSG_SIZE, frmt_msg, &msg_width);
+
+    struct line_info *new_line = line_info_alloc(hst, timestr, name1, name2, line_msg);
+
+    if (new_line == NULL) {
+        exit_toxic_err(FATALERR_MEMORY, "failed in line_info_add");
+    }
+
+    int len = line_info_type_length(c_config, type);
     len += msg_width;
 
     if (show_timestamp)  {
-        if (c_config->show_timestamps) {
-            get_time_str(new_line->timestr, sizeof(new_line->timestr), c_config->timestamp_format);
+        len += strlen(line_info_timestr(new_line)) + 1;  // need the +1 regardless of client setting
+    }
+
+    len += strlen(line_info_name1(new_line));
+    len += strlen(line_info_name2(new_line));
+
+    new_line->id = (hst->line_end->id + 1 + hst->queue_size) % INT_MAX;
+    new_line->len = len;
+    new_line->msg_width = msg_width;
+    new_line->type = type;
+    new_line->bold = bold;
+    new_line->colour = colour;
+    new_line->noread_flag = false;
+    new_line->timestamp = get_unix_time();
+    new_line->log_line = log_next_line(self->chatwin->log);
+
+    if (type == OUT_MSG || type == OUT_ACTION) {
+        new_line->noread_flag = self->stb->connection == TOX_CONNECTION_NONE;
+    }
+
+    line_info_init_line(self, c_config, new_line, wc_msg);
+
+    hst->queue[hst->queue_size] = new_line;
+    ++hst->queue_size;
+
+    return new_line->id;
+}
+
+int line_info_load_history(ToxWindow *self, const Client_Config *c_config, const char *timestamp,
+                           const char *name, LINE_TYPE type, bool bold, int colour, const char *message,
+                           int64_t log_line)
+{
+    if (self == NULL) {
+        return -1;
+    }
+
+    struct history *hst = self->chatwin->hst;
+
+    if (hst->prepend_after == NULL && hst->queue_size >= MAX_LINE_INFO_QUEUE) {
+        return -1;
+    }
+
+    wchar_t wc_msg[MAX_LINE_INFO_MSG_SIZE];
+    uint16_t msg_width;
+    const char *line_msg = line_info_prepare_msg(wc_msg, MAX_LINE_INFO_MSG_SIZE, message, &msg_width);
+
+    struct line_info *new_line = line_info_alloc(hst, c_config->show_timestamps ? timestamp : NULL, name, NULL,
+                                 line_msg);
+
+    if (new_line == NULL) {
+        return -1;
+    }
+
+    int len = line_info_type_length(c_config, type);
+    len += msg_width;
+    len += strlen(line_info_name1(new_line));
+
+    if (timestamp != NULL) {
+        len += strlen(line_info_timestr(new_line)) + 1;
+    }
+
+    new_line->len = len;
+    new_line->msg_width = msg_width;
+    new_line->type = type;
+    new_line->bold = bold;
+    new_line->colour = colour;
+    new_line->noread_flag = false;
+    new_line->timestamp = get_unix_time();
+    new_line->log_line = log_line;
+
+    line_info_init_line(self, c_config, new_line, wc_msg);
+
+    /* The line is given its ID by line_info_load_older() once the whole page has been inserted */
+    if (hst->prepend_after != NULL) {
+        struct line_info *prev = hst->prepend_after;
+
+        new_line->prev = prev;
+        new_line->next = prev->next;
+
+        if (prev->next != NULL) {
+            prev->next->prev = new_line;
+        }
+
+        prev->next = new_line;
+        hst->prepend_after = new_line;
+        ++hst->num_lines;
+
+        return 0;
+    }
+
+    new_line->id = (hst->line_end->id + 1 + hst->queue_size) % INT_MAX;
+
+    hst->queue[hst->queue_size] = new_line;
+    ++hst->queue_size;
+
+    return new_line->id;
+}
+
+/* Number of lines loaded from the chat log each time the user scrolls past the top of the history */
+#define LINE_INFO_LOG_PAGE 100
+
+/* Loads the page of chat log lines that precedes the oldest line in the history and inserts it
+ * right after the root. If line_start is the root it's moved to the newest of the loaded lines.
+ *
+ * Return true if any lines were loaded.
+ */
+static bool line_info_load_older(ToxWindow *self, const Client_Config *c_config, struct history *hst)
+{
+    struct chatlog *log = self->chatwin->log;
+
+    if (log == NULL) {
+        return false;
+    }
+
+    struct line_info *root = hst->line_root;
+    struct line_info *oldest = root->next;
+    const int64_t before = oldest != NULL ? oldest->log_line : log_next_line(log);
+
+    hst->prepend_after = root;
+    log_load_page(log, self, c_config, before, LINE_INFO_LOG_PAGE);
+
+    struct line_info *newest = hst->prepend_after;
+    hst->prepend_after = NULL;
+
+    if (newest == root) {
+        return false;
+    }
+
+    /* the loaded lines take over the IDs below the old oldest line, and the root moves below them */
+    line_index_remove(hst, root);
+
+    uint32_t id = root->id;
+
+    for (struct line_info *line = newest; line != NULL; line = line->prev) {
+        line_layout_cache_invalidate(hst->layouts, line, line->id);
+        line->id = id;
+        id = id > 0 ? id - 1 : INT_MAX - 1;
+    }
+
+    if (!line_index_reserve(hst)) {
+        exit_toxic_err(FATALERR_MEMORY, "line_index_reserve() failed in line_info_load_older()");
+    }
+
+    for (struct line_info *line = root; line != oldest; line = line->next) {
+        line_index_insert(hst, line);
+    }
+
+    if (hst->line_end == root) {
+        hst->line_end = newest;
+    }
+
+    if (hst->line_start == root) {
+        hst->line_start = newest;
+    }
+
+    hst->redraw = true;
+
+    return true;
+}
+
+/* adds a single queue item to hst if possible. only called once per call to line_info_print() */
+static void line_info_check_queue(ToxWindow *self, const Client_Config *c_config)
+{
+    struct history *hst = self->chatwin->hst;
+
+    /* Lines that are dropped here can be paged back in from the chat log by scrolling up */
+    while (!self->scroll_pause && hst->num_lines > (size_t)c_config->history_size + 1) {
+        if (!line_info_root_fwd(hst)) {
+            break;
         }
+    }
+
+    struct line_info *line = line_info_ret_queue(hst);
 
-        len += strlen(new_line->timestr) + 1;  // need the +1 regardless of client setting
+    if (line == NULL) {
+        return;
+    }
+
+    line_info_append(hst, line);
+
+    if (!self->scroll_pause) {
+        line_info_reset_start(self, hst);
     }
+}
+
+/* Prints `line` to `win` at the cursor, followed by a newline. */
+static void line_info_print_line(WINDOW *win, struct history *hst, struct line_info *line,
+                                 const Client_Config *c_config, int max_x, int max_y)
+{
+    const struct line_layout *layout = line_info_layout(hst, line, NULL, c_config, max_x);
+    const wchar_t *msg = layout != NULL ? layout->msg : L"";
+
+    uint8_t type = line->type;
+
+    switch (type) {
+        case OUT_MSG:
+
+        /* fallthrough */
+        case OUT_MSG_READ:
+
+        /* fallthrough */
+        case IN_MSG: {
+            wattron(win, COLOR_PAIR(BLUE));
+            wprintw(win, "%s ", line_info_timestr(line));
+            wattroff(win, COLOR_PAIR(BLUE));
+
+            int nameclr = GREEN;
+
+            if (line->colour) {
+                nameclr = line->colour;
+            } else if (type == IN_MSG) {
+                nameclr = CYAN;
+            }
+
+            wattron(win, COLOR_PAIR(nameclr));
+            wprintw(win, "%s %s: ", c_config->line_normal, line_info_name1(line));
+            wattroff(win, COLOR_PAIR(nameclr));
+
+            if (msg[0] == L'\0') {
+                waddch(win, '\n');
+                break;
+            }
+
+            if (msg[0] == L'>') {
+                wattron(win, COLOR_PAIR(GREEN));
+            } else if (msg[0] == L'<') {
+                wattron(win, COLOR_PAIR(RED));
+            }
+
+            print_wrap(win, line, layout, max_y);
+
+            if (msg[0] == L'>') {
+                wattroff(win, COLOR_PAIR(GREEN));
+            } else if (msg[0] == L'<') {
+                wattroff(win, COLOR_PAIR(RED));
+            }
+
+            waddch(win, '\n');
+            break;
+        }
+
+        case IN_PRVT_MSG:
+
+        /* fallthrough */
+
+        case OUT_PRVT_MSG: {
+            wattron(win, COLOR_PAIR(BLUE));
+            wprintw(win, "%s ", line_info_timestr(line));
+            wattroff(win, COLOR_PAIR(BLUE));
+
+            const int nameclr = line->colour ? line->colour : GREEN;
+
+            wattron(win, COLOR_PAIR(nameclr));
+            wprintw(win, "%s %s: ", c_config->line_special, line_info_name1(line));
+            wattroff(win, COLOR_PAIR(nameclr));
+
+            if (msg[0] == '>') {
+                wattron(win, COLOR_PAIR(GREEN));
+            } else if (msg[0] == '<') {
+                wattron(win, COLOR_PAIR(RED));
+            }
+
+            print_wrap(win, line, layout, max_y);
+
+            if (msg[0] == '>') {
+                wattroff(win, COLOR_PAIR(GREEN));
+            } else if (msg[0] == '<') {
+                wattroff(win, COLOR_PAIR(RED));
+            }
+
+            waddch(win, '\n');
+            break;
+        }
+
+        case OUT_ACTION_READ:
+
+        /* fallthrough */
+        case OUT_ACTION:
+
+        /* fallthrough */
+        case IN_ACTION: {
+            wattron(win, COLOR_PAIR(BLUE));
+            wprintw(win, "%s ", line_info_timestr(line));
+            wattroff(win, COLOR_PAIR(BLUE));
+
+            wattron(win, COLOR_PAIR(YELLOW));
+            wprintw(win, "%s %s ", c_config->line_normal, line_info_name1(line));
+            print_wrap(win, line, layout, max_y);
+            wattroff(win, COLOR_PAIR(YELLOW));
+
+            waddch(win, '\n');
+            break;
+        }
+
+        case SYS_MSG: {
+            if (line_info_timestr(line)[0]) {
+                wattron(win, COLOR_PAIR(BLUE));
+                wprintw(win, "%s ", line_info_timestr(line));
+                wattroff(win, COLOR_PAIR(BLUE));
+            }
 
-    if (name1) {
-        snprintf(new_line->name1, sizeof(new_line->name1), "%s", name1);
-        len += strlen(new_line->name1);
-    }
+            if (line->bold) {
+                wattron(win, A_BOLD);
+            }
 
-    if (name2) {
-        snprintf(new_line->name2, sizeof(new_line->name2), "%s", name2);
-        len += strlen(new_line->name2);
-    }
+            if (line->colour) {
+                wattron(win, COLOR_PAIR(line->colour));
+            }
 
-    new_line->id = (hst->line_end->id + 1 + hst->queue_size) % INT_MAX;
-    new_line->len = len;
-    new_line->msg_width = msg_width;
-    new_line->type = type;
-    new_line->bold = bold;
-    new_line->colour = colour;
-    new_line->noread_flag = false;
-    new_line->timestamp = get_unix_time();
+            print_wrap(win, line, layout, max_y);
+            waddch(win, '\n');
 
-    if (type == OUT_MSG || type == OUT_ACTION) {
-        new_line->noread_flag = self->stb->connection == TOX_CONNECTION_NONE;
-    }
+            if (line->bold) {
+                wattroff(win, A_BOLD);
+            }
 
-    line_info_init_line(self, new_line);
+            if (line->colour) {
+                wattroff(win, COLOR_PAIR(line->colour));
+            }
 
-    hst->queue[hst->queue_size] = new_line;
-    ++hst->queue_size;
+            break;
+        }
 
-    return new_line->id;
-}
+        case PROMPT: {
+            wattron(win, COLOR_PAIR(GREEN));
+            wprintw(win, "$ ");
+            wattroff(win, COLOR_PAIR(GREEN));
 
-int line_info_load_history(ToxWindow *self, const Client_Config *c_config, const char *timestamp,
-                           const char *name, LINE_TYPE type, bool bold, int colour, const char *message)
-{
-    if (self == NULL) {
-        return -1;
-    }
+            if (msg[0] != L'\0') {
+                print_wrap(win, line, layout, max_y);
+            }
 
-    struct history *hst = self->chatwin->hst;
+            waddch(win, '\n');
+            break;
+        }
 
-    if (hst->queue_size >= MAX_LINE_INFO_QUEUE) {
-        return -1;
-    }
+        case CONNECTION: {
+            wattron(win, COLOR_PAIR(BLUE));
+            wprintw(win, "%s ", line_info_timestr(line));
+            wattroff(win, COLOR_PAIR(BLUE));
 
-    struct line_info *new_line = calloc(1, sizeof(struct line_info));
+            wattron(win, COLOR_PAIR(line->colour));
+            wprintw(win, "%s ", c_config->line_join);
 
-    if (new_line == NULL) {
-        return -1;
-    }
+            wattron(win, A_BOLD);
+            wprintw(win, "%s ", line_info_name1(line));
+            wattroff(win, A_BOLD);
 
-    int len = line_info_type_length(c_config, type);
+            print_wrap(win, line, layout, max_y);
+            waddch(win, '\n');
 
-    const uint16_t msg_width = line_info_add_msg(new_line->msg, sizeof(new_line->msg) / sizeof(wchar_t), message);
-    len += msg_width;
+            wattroff(win, COLOR_PAIR(line->colour));
 
-    if (c_config->show_timestamps) {
-        snprintf(new_line->timestr, sizeof(new_line->timestr), "%s", timestamp);
-    }
+            break;
+        }
 
-    len += strlen(new_line->timestr) + 1;
+        case DISCONNECTION: {
+            wattron(win, COLOR_PAIR(BLUE));
+            wprintw(win, "%s ", line_info_timestr(line));
+            wattroff(win, COLOR_PAIR(BLUE));
 
-    if (name != NULL) {
-        snprintf(new_line->name1, sizeof(new_line->name1), "%s", name);
-        len += strlen(new_line->name1);
-    }
+            wattron(win, COLOR_PAIR(line->colour));
+            wprintw(win, "%s ", c_config->line_quit);
 
-    new_line->id = (hst->line_end->id + 1 + hst->queue_size) % INT_MAX;
-    new_line->len = len;
-    new_line->msg_width = msg_width;
-    new_line->type = type;
-    new_line->bold = bold;
-    new_line->colour = colour;
-    new_line->noread_flag = false;
-    new_line->timestamp = get_unix_time();
+            wattron(win, A_BOLD);
+            wprintw(win, "%s ", line_info_name1(line));
+            wattroff(win, A_BOLD);
 
-    line_info_init_line(self, new_line);
+            print_wrap(win, line, layout, max_y);
+            waddch(win, '\n');
 
-    hst->queue[hst->queue_size] = new_line;
-    ++hst->queue_size;
+            wattroff(win, COLOR_PAIR(line->colour));
 
-    return new_line->id;
-}
+            break;
+        }
 
-/* adds a single queue item to hst if possible. only called once per call to line_info_print() */
-static void line_info_check_queue(ToxWindow *self, const Client_Config *c_config)
-{
-    struct history *hst = self->chatwin->hst;
-    struct line_info *line = line_info_ret_queue(hst);
+        case NAME_CHANGE: {
+            wattron(win, COLOR_PAIR(BLUE));
+            wprintw(win, "%s ", line_info_timestr(line));
+            wattroff(win, COLOR_PAIR(BLUE));
 
-    if (line == NULL) {
-        return;
-    }
+            wattron(win, COLOR_PAIR(MAGENTA));
+            wprintw(win, "%s ", c_config->line_alert);
+            wattron(win, A_BOLD);
+            wprintw(win, "%s", line_info_name1(line));
+            wattroff(win, A_BOLD);
 
-    if (hst->start_id > c_config->history_size) {
-        line_info_root_fwd(hst);
-    }
+            print_wrap(win, line, layout, max_y);
 
-    line->prev = hst->line_end;
-    hst->line_end->next = line;
-    hst->line_end = line;
-    hst->line_end->id = line->id;
+            wattron(win, A_BOLD);
+            wprintw(win, "%s\n", line_info_name2(line));
+            wattroff(win, A_BOLD);
+            wattroff(win, COLOR_PAIR(MAGENTA));
 
-    if (!self->scroll_pause) {
-        line_info_reset_start(self, hst);
+            break;
+        }
     }
 }
 
-void line_info_print(ToxWindow *self, const Client_Config *c_config)
+/* Returns true if the view of `hst` has been resized or flagged for a full redraw since it was last drawn. */
+static bool line_info_view_resized(const struct history *hst, int max_x, int max_y)
 {
-    ChatContext *ctx = self->chatwin;
+    return hst->redraw
+           || hst->drawn_max_x != max_x
+           || hst->drawn_max_y != max_y;
+}
 
-    if (ctx == NULL) {
-        return;
-    }
+/* Returns the row below the last line printed to `win`. A line that ends on the bottom row leaves the
+ * cursor there, past the last column, since the window doesn't scroll.
+ */
+static int line_info_row_below(WINDOW *win)
+{
+    return getcurx(win) > 0 ? getcury(win) + 1 : getcury(win);
+}
 
+/* Draws the whole view of the history of `self`, starting at line_start.
+ *
+ * Returns the number of lines drawn.
+ */
+static size_t line_info_draw_all(ToxWindow *self, const Client_Config *c_config, int max_x, int max_y)
+{
+    ChatContext *ctx = self->chatwin;
     struct history *hst = ctx->hst;
-
-    /* Only allow one new item to be added to chat window per call to this function */
-    line_info_check_queue(self, c_config);
-
     WINDOW *win = ctx->history;
 
     wclear(win);
 
-    int y2;
-
-    int x2;
-
-    getmaxyx(self->window, y2, x2);
-
-    if (x2 - 1 <= SIDEBAR_WIDTH) {  // leave room on x axis for sidebar padding
-        return;
-    }
+    hst->redraw = false;
+    hst->drawn_start = hst->line_start;
+    hst->drawn_start_id = hst->line_start->id;
+    hst->drawn_end = hst->line_end;
+    hst->drawn_end_id = hst->line_end->id;
+    hst->drawn_max_x = max_x;
+    hst->drawn_max_y = max_y;
+    hst->drawn_last = NULL;
 
     if (self->type == WINDOW_TYPE_CONFERENCE) {
         wmove(win, 0, 0);
@@ -628,234 +1216,227 @@ void line_info_print(ToxWindow *self, const Client_Config *c_config)
     struct line_info *line = hst->line_start->next;
 
     if (line == NULL) {
-        return;
+        return 0;
     }
 
-    const int max_y = y2 - CHATBOX_HEIGHT - WINDOW_BAR_HEIGHT;
-    const int max_x = self->show_peerlist ? x2 - 1 - SIDEBAR_WIDTH : x2;
     uint16_t numlines = line->format_lines;
+    size_t num_drawn = 0;
 
     while (line && numlines++ <= max_y) {
         int y;
         int x;
         getyx(win, y, x);
 
-        UNUSED_VAR(y);
-
         if (x > 0) { // Prevents us from printing off the screen
             break;
         }
 
-        uint8_t type = line->type;
+        line->drawn_row = (int16_t) y;
+        line->dirty = false;
 
-        switch (type) {
-            case OUT_MSG:
+        line_info_print_line(win, hst, line, c_config, max_x, max_y);
 
-            /* fallthrough */
-            case OUT_MSG_READ:
+        hst->drawn_last = line;
+        ++num_drawn;
 
-            /* fallthrough */
-            case IN_MSG: {
-                wattron(win, COLOR_PAIR(BLUE));
-                wprintw(win, "%s ", line->timestr);
-                wattroff(win, COLOR_PAIR(BLUE));
+        line = line->next;
+    }
 
-                int nameclr = GREEN;
+    hst->drawn_bottom = line_info_row_below(win);
 
-                if (line->colour) {
-                    nameclr = line->colour;
-                } else if (type == IN_MSG) {
-                    nameclr = CYAN;
-                }
+    return num_drawn;
+}
 
-                wattron(win, COLOR_PAIR(nameclr));
-                wprintw(win, "%s %s: ", c_config->line_normal, line->name1);
-                wattroff(win, COLOR_PAIR(nameclr));
+/* Draws the lines appended to the history of `self` since the view was last drawn, below the lines
+ * already on screen. If the view has moved down with them, the lines on screen are first scrolled up
+ * by the rows of the lines that left the top of the view. If the view stayed put and was already
+ * full, nothing is drawn; the window bar shows that the view is scrolled up.
+ *
+ * Return the number of lines drawn.
+ * Return -1 if the view has changed in some other way, in which case it must be redrawn in full.
+ */
+static int line_info_draw_appended(ToxWindow *self, const Client_Config *c_config, int max_x, int max_y)
+{
+    ChatContext *ctx = self->chatwin;
+    struct history *hst = ctx->hst;
+    WINDOW *win = ctx->history;
 
-                if (line->msg[0] == L'\0') {
-                    waddch(win, '\n');
-                    break;
-                }
+    if (hst->drawn_start == hst->line_start && hst->drawn_start_id == hst->line_start->id
+            && hst->drawn_end == hst->line_end && hst->drawn_end_id == hst->line_end->id) {
+        return 0;
+    }
 
-                if (line->msg[0] == L'>') {
-                    wattron(win, COLOR_PAIR(GREEN));
-                } else if (line->msg[0] == L'<') {
-                    wattron(win, COLOR_PAIR(RED));
-                }
+    /* the lines drawn last time must still be in the history */
+    if (hst->drawn_last == NULL || line_info_find(hst, hst->drawn_start_id) != hst->drawn_start
+            || line_info_find(hst, hst->drawn_end_id) != hst->drawn_end) {
+        return -1;
+    }
 
-                print_wrap(win, line, c_config, max_x, max_y);
+    const int bottom_row = getmaxy(win);
 
-                if (line->msg[0] == L'>') {
-                    wattroff(win, COLOR_PAIR(GREEN));
-                } else if (line->msg[0] == L'<') {
-                    wattroff(win, COLOR_PAIR(RED));
-                }
+    if (hst->drawn_start == hst->line_start
+            && (hst->drawn_last != hst->drawn_end || hst->drawn_bottom >= bottom_row)) {
+        hst->drawn_end = hst->line_end;
+        hst->drawn_end_id = hst->line_end->id;
+        return 0;
+    }
 
-                waddch(win, '\n');
-                break;
-            }
+    if (hst->drawn_last != hst->drawn_end) {
+        return -1;
+    }
 
-            case IN_PRVT_MSG:
+    /* the new first line must be one that's on screen, or there's nothing left to scroll */
+    const struct line_info *start = hst->drawn_start;
 
-            /* fallthrough */
+    while (start != hst->line_start && start != hst->drawn_end) {
+        start = start->next;
+    }
 
-            case OUT_PRVT_MSG: {
-                wattron(win, COLOR_PAIR(BLUE));
-                wprintw(win, "%s ", line->timestr);
-                wattroff(win, COLOR_PAIR(BLUE));
+    if (start != hst->line_start || start == hst->drawn_end) {
+        return -1;
+    }
 
-                const int nameclr = line->colour ? line->colour : GREEN;
+    const int top_row = hst->drawn_start->next->drawn_row;
+    const int shift = start->next->drawn_row - top_row;
 
-                wattron(win, COLOR_PAIR(nameclr));
-                wprintw(win, "%s %s: ", c_config->line_special, line->name1);
-                wattroff(win, COLOR_PAIR(nameclr));
+    if (shift > 0) {
+        wsetscrreg(win, top_row, bottom_row - 1);
+        scrollok(win, true);
+        wscrl(win, shift);
+        scrollok(win, false);
+        wsetscrreg(win, 0, bottom_row - 1);
 
-                if (line->msg[0] == '>') {
-                    wattron(win, COLOR_PAIR(GREEN));
-                } else if (line->msg[0] == '<') {
-                    wattron(win, COLOR_PAIR(RED));
-                }
+        for (struct line_info *line = start->next; line != hst->drawn_end->next; line = line->next) {
+            line->drawn_row = (int16_t)(line->drawn_row - shift);
+        }
 
-                print_wrap(win, line, c_config, max_x, max_y);
+        hst->drawn_bottom -= shift;
+    }
 
-                if (line->msg[0] == '>') {
-                    wattroff(win, COLOR_PAIR(GREEN));
-                } else if (line->msg[0] == '<') {
-                    wattroff(win, COLOR_PAIR(RED));
-                }
+    hst->drawn_start = hst->line_start;
+    hst->drawn_start_id = hst->line_start->id;
 
-                waddch(win, '\n');
-                break;
-            }
+    struct line_info *line = hst->drawn_end->next;
 
-            case OUT_ACTION_READ:
+    hst->drawn_end = hst->line_end;
+    hst->drawn_end_id = hst->line_end->id;
 
-            /* fallthrough */
-            case OUT_ACTION:
+    if (hst->drawn_bottom >= bottom_row) {
+        return 0;
+    }
 
-            /* fallthrough */
-            case IN_ACTION: {
-                wattron(win, COLOR_PAIR(BLUE));
-                wprintw(win, "%s ", line->timestr);
-                wattroff(win, COLOR_PAIR(BLUE));
+    wmove(win, hst->drawn_bottom, 0);
 
-                wattron(win, COLOR_PAIR(YELLOW));
-                wprintw(win, "%s %s ", c_config->line_normal, line->name1);
-                print_wrap(win, line, c_config, max_x, max_y);
-                wattroff(win, COLOR_PAIR(YELLOW));
+    int num_drawn = 0;
 
-                waddch(win, '\n');
-                break;
-            }
+    /* as in line_info_draw_all(), a line that runs off the bottom ends the view */
+    for (; line != NULL && getcurx(win) == 0; line = line->next) {
+        line->drawn_row = (int16_t) getcury(win);
+        line->dirty = false;
 
-            case SYS_MSG: {
-                if (line->timestr[0]) {
-                    wattron(win, COLOR_PAIR(BLUE));
-                    wprintw(win, "%s ", line->timestr);
-                    wattroff(win, COLOR_PAIR(BLUE));
-                }
+        line_info_print_line(win, hst, line, c_config, max_x, max_y);
 
-                if (line->bold) {
-                    wattron(win, A_BOLD);
-                }
+        hst->drawn_last = line;
+        ++num_drawn;
+    }
 
-                if (line->colour) {
-                    wattron(win, COLOR_PAIR(line->colour));
-                }
+    hst->drawn_bottom = line_info_row_below(win);
 
-                print_wrap(win, line, c_config, max_x, max_y);
-                waddch(win, '\n');
+    return num_drawn;
+}
 
-                if (line->bold) {
-                    wattroff(win, A_BOLD);
-                }
+/* Redraws the lines in the view of the history of `self` that have changed in place since the view was
+ * last drawn, such as messages that have been marked as read. Each line is cleared and redrawn over the
+ * rows it took up before.
+ *
+ * Return the number of lines redrawn.
+ * Return -1 if a line no longer takes up the same rows, in which case the whole view must be redrawn.
+ */
+static int line_info_draw_dirty(ToxWindow *self, const Client_Config *c_config, int max_x, int max_y)
+{
+    ChatContext *ctx = self->chatwin;
+    struct history *hst = ctx->hst;
+    WINDOW *win = ctx->history;
 
-                if (line->colour) {
-                    wattroff(win, COLOR_PAIR(line->colour));
-                }
+    if (hst->drawn_last == NULL) {
+        return 0;
+    }
 
-                break;
-            }
+    int num_drawn = 0;
 
-            case PROMPT: {
-                wattron(win, COLOR_PAIR(GREEN));
-                wprintw(win, "$ ");
-                wattroff(win, COLOR_PAIR(GREEN));
+    for (struct line_info *line = hst->line_start->next; line != NULL; line = line->next) {
+        const bool is_last = line == hst->drawn_last;
 
-                if (line->msg[0] != L'\0') {
-                    print_wrap(win, line, c_config, max_x, max_y);
-                }
+        if (line->dirty) {
+            const int top = line->drawn_row;
+            const int bottom = is_last ? hst->drawn_bottom : line->next->drawn_row;
 
-                waddch(win, '\n');
-                break;
+            for (int y = top; y < bottom; ++y) {
+                wmove(win, y, 0);
+                wclrtoeol(win);
             }
 
-            case CONNECTION: {
-                wattron(win, COLOR_PAIR(BLUE));
-                wprintw(win, "%s ", line->timestr);
-                wattroff(win, COLOR_PAIR(BLUE));
-
-                wattron(win, COLOR_PAIR(line->colour));
-                wprintw(win, "%s ", c_config->line_join);
-
-                wattron(win, A_BOLD);
-                wprintw(win, "%s ", line->name1);
-                wattroff(win, A_BOLD);
-
-                print_wrap(win, line, c_config, max_x, max_y);
-                waddch(win, '\n');
+            wmove(win, top, 0);
 
-                wattroff(win, COLOR_PAIR(line->colour));
+            line->dirty = false;
+            line_info_print_line(win, hst, line, c_config, max_x, max_y);
+            ++num_drawn;
 
-                break;
+            if (line_info_row_below(win) != bottom) {
+                return -1;
             }
+        }
 
-            case DISCONNECTION: {
-                wattron(win, COLOR_PAIR(BLUE));
-                wprintw(win, "%s ", line->timestr);
-                wattroff(win, COLOR_PAIR(BLUE));
-
-                wattron(win, COLOR_PAIR(line->colour));
-                wprintw(win, "%s ", c_config->line_quit);
+        if (is_last) {
+            break;
+        }
+    }
 
-                wattron(win, A_BOLD);
-                wprintw(win, "%s ", line->name1);
-                wattroff(win, A_BOLD);
+    return num_drawn;
+}
 
-                print_wrap(win, line, c_config, max_x, max_y);
-                waddch(win, '\n');
+void line_info_print(ToxWindow *self, const Client_Config *c_config)
+{
+    ChatContext *ctx = self->chatwin;
 
-                wattroff(win, COLOR_PAIR(line->colour));
+    if (ctx == NULL) {
+        return;
+    }
 
-                break;
-            }
+    struct history *hst = ctx->hst;
 
-            case NAME_CHANGE: {
-                wattron(win, COLOR_PAIR(BLUE));
-                wprintw(win, "%s ", line->timestr);
-                wattroff(win, COLOR_PAIR(BLUE));
+    /* Only allow one new item to be added to chat window per call to this function */
+    line_info_check_queue(self, c_config);
 
-                wattron(win, COLOR_PAIR(MAGENTA));
-                wprintw(win, "%s ", c_config->line_alert);
-                wattron(win, A_BOLD);
-                wprintw(win, "%s", line->name1);
-                wattroff(win, A_BOLD);
+    int y2;
+    int x2;
+    getmaxyx(self->window, y2, x2);
 
-                print_wrap(win, line, c_config, max_x, max_y);
+    if (x2 - 1 <= SIDEBAR_WIDTH) {  // leave room on x axis for sidebar padding
+        return;
+    }
 
-                wattron(win, A_BOLD);
-                wprintw(win, "%s\n", line->name2);
-                wattroff(win, A_BOLD);
-                wattroff(win, COLOR_PAIR(MAGENTA));
+    const int max_y = y2 - CHATBOX_HEIGHT - WINDOW_BAR_HEIGHT;
+    const int max_x = self->show_peerlist ? x2 - 1 - SIDEBAR_WIDTH : x2;
 
-                break;
-            }
-        }
+    /* the history is left as it is on screen unless something in view has changed */
+    int num_drawn = line_info_view_resized(hst, max_x, max_y) ? -1
+                    : line_info_draw_appended(self, c_config, max_x, max_y);
 
-        line = line->next;
+    if (num_drawn >= 0) {
+        const int num_dirty = line_info_draw_dirty(self, c_config, max_x, max_y);
+        num_drawn = num_dirty < 0 ? -1 : num_drawn + num_dirty;
     }
 
-    flag_interface_refresh();
+    if (num_drawn < 0) {
+        Winthread.frame_stats.lines_drawn += line_info_draw_all(self, c_config, max_x, max_y);
+        ++Winthread.frame_stats.full_redraws;
+        flag_interface_refresh();
+    } else if (num_drawn > 0) {
+        Winthread.frame_stats.lines_drawn += num_drawn;
+        ++Winthread.frame_stats.partial_redraws;
+        flag_interface_refresh();
+    }
 
     /* keep calling until queue is empty */
     if (hst->queue_size > 0) {
@@ -900,18 +1481,31 @@ void line_info_set(ToxWindow *self, uint32_t id, char *msg)
 {
     flag_interface_refresh();
 
-    struct line_info *line = self->chatwin->hst->line_end;
+    struct history *hst = self->chatwin->hst;
+    struct line_info *line = line_info_find(hst, id);
 
-    while (line) {
-        if (line->id == id) {
-            const uint16_t new_width = line_info_add_msg(line->msg, sizeof(line->msg) / sizeof(wchar_t), msg);
-            line->len = line->len - line->msg_width + new_width;
-            line->msg_width = new_width;
-            return;
-        }
+    if (line == NULL) {
+        return;
+    }
 
-        line = line->prev;
+    wchar_t wc_msg[MAX_LINE_INFO_MSG_SIZE];
+    uint16_t new_width;
+    const char *line_msg = line_info_prepare_msg(wc_msg, MAX_LINE_INFO_MSG_SIZE, msg, &new_width);
+
+    char *text = line_info_pack(hst, line, line_info_timestr(line), line_info_name1(line),
+                                line_info_name2(line), line_msg);
+
+    if (text == NULL) {
+        return;
     }
+
+    line_arena_release(hst, line->text);
+    line->text = text;
+    line->len = line->len - line->msg_width + new_width;
+    line->msg_width = new_width;
+    line->dirty = true;
+
+    line_layout_cache_invalidate(hst->layouts, line, line->id);
 }
 
 /* Return the line_info object associated with `id`.
@@ -919,24 +1513,49 @@ void line_info_set(ToxWindow *self, uint32_t id, char *msg)
  */
 struct line_info *line_info_get(ToxWindow *self, uint32_t id)
 {
-    struct line_info *line = self->chatwin->hst->line_end;
+    return line_info_find(self->chatwin->hst, id);
+}
 
-    while (line) {
-        if (line->id == id) {
-            return line;
+bool line_info_jump_to_log_line(ToxWindow *self, const Client_Config *c_config, int64_t log_line)
+{
+    struct history *hst = self->chatwin->hst;
+
+    /* pausing the scroll keeps the lines we page in from being trimmed again */
+    self->scroll_pause = true;
+
+    while (hst->queue_size > 0) {
+        line_info_check_queue(self, c_config);
+    }
+
+    while (hst->line_root->next == NULL || hst->line_root->next->log_line > log_line) {
+        if (hst->num_lines >= MAX_HISTORY || !line_info_load_older(self, c_config, hst)) {
+            return false;
         }
+    }
 
-        line = line->prev;
+    /* Lines that weren't logged share the number of the next logged line, so the last line with the
+     * number is the one that was loaded from it */
+    for (struct line_info *line = hst->line_end; line != hst->line_root; line = line->prev) {
+        if (line->log_line == log_line) {
+            hst->line_start = line;
+            return true;
+        }
+
+        if (line->log_line < log_line) {
+            break;
+        }
     }
 
-    return NULL;
+    return false;
 }
 
-static void line_info_scroll_up(ToxWindow *self, struct history *hst)
+static void line_info_scroll_up(ToxWindow *self, const Client_Config *c_config, struct history *hst)
 {
     if (hst->line_start->prev) {
         hst->line_start = hst->line_start->prev;
         self->scroll_pause = true;
+    } else if (line_info_load_older(self, c_config, hst)) {
+        self->scroll_pause = true;
     }
 }
 
@@ -955,7 +1574,7 @@ static void line_info_scroll_down(ToxWindow *self, struct history *hst)
     }
 }
 
-static void line_info_page_up(ToxWindow *self, struct history *hst)
+static void line_info_page_up(ToxWindow *self, const Client_Config *c_config, struct history *hst)
 {
     int x2;
     int y2;
@@ -967,8 +1586,12 @@ static void line_info_page_up(ToxWindow *self, struct history *hst)
     const int max_y = y2 - top_offset;
     size_t jump_dist = max_y / 2;
 
-    for (size_t i = 0; i < jump_dist && hst->line_start->prev; ++i) {
-        hst->line_start = hst->line_start->prev;
+    for (size_t i = 0; i < jump_dist; ++i) {
+        if (hst->line_start->prev != NULL) {
+            hst->line_start = hst->line_start->prev;
+        } else if (!line_info_load_older(self, c_config, hst)) {
+            break;
+        }
     }
 
     self->scroll_pause = true;
@@ -1009,11 +1632,11 @@ bool line_info_onKey(ToxWindow *self, const Client_Config *c_config, wint_t key)
     bool match = true;
 
     if (key == c_config->key_half_page_up) {
-        line_info_page_up(self, hst);
+        line_info_page_up(self, c_config, hst);
     } else if (key == c_config->key_half_page_down) {
         line_info_page_down(self, hst);
     } else if (key == c_config->key_scroll_line_up) {
-        line_info_scroll_up(self, hst);
+        line_info_scroll_up(self, c_config, hst);
     } else if (key == c_config->key_scroll_line_down) {
         line_info_scroll_down(self, hst);
     } else if (key == c_config->key_page_bottom) {
@@ -1032,5 +1655,4 @@ bool line_info_onKey(ToxWindow *self, const Client_Config *c_config, wint_t key)
 void line_info_clear(struct history *hst)
 {
     hst->line_start = hst->line_end;
-    hst->start_id = hst->line_start->id;
 }
@@ -40,35 +40,77 @@ typedef enum LINE_TYPE {
     NAME_CHANGE,
 } LINE_TYPE;
 
+/*
+ * A single line of chat history.
+ *
+ * The line's strings are packed into one variable-length UTF-8 record that lives in the
+ * history's arena: the timestamp, name1, name2 and the message, each NUL-terminated and
+ * in that order. The message is only converted to wide characters when the line is drawn.
+ */
 struct line_info {
-    char    timestr[TIME_STR_SIZE];
-    char    name1[TOXIC_MAX_NAME_LENGTH + 1];
-    char    name2[TOXIC_MAX_NAME_LENGTH + 1];
-    wchar_t msg[MAX_LINE_INFO_MSG_SIZE];
+    char    *text;         /* packed record; use the line_info_*() accessors below */
     time_t  timestamp;
+    int64_t log_line;      /* number of the chat log line this line was loaded from, or the next one at creation */
+    uint32_t id;
+    uint16_t len;          /* combined length of entire line */
+    uint16_t msg_width;    /* width of the message */
+    uint16_t format_lines;  /* number of lines the combined string takes up (dynamically set) */
+    int16_t drawn_row;     /* the row of the history window the line was last drawn at */
+    uint8_t name1_offset;  /* offset of name1 in `text` */
+    uint8_t name2_offset;  /* offset of name2 in `text` */
+    uint8_t msg_offset;    /* offset of the message in `text` */
     uint8_t type;
     uint8_t bold;
     uint8_t colour;
     bool    noread_flag;   /* true if a line should be flagged as unread */
     bool    read_flag;     /* true if a message has been flagged as read */
-    uint32_t id;
-    uint16_t len;        /* combined length of entire line */
-    uint16_t msg_width;    /* width of the message */
-    uint16_t format_lines;  /* number of lines the combined string takes up (dynamically set) */
+    bool    dirty;         /* true if the line has changed since it was last drawn */
 
     struct line_info *prev;
     struct line_info *next;
 };
 
+/* Fixed-size block of memory that history lines are carved out of. Opaque outside of line_info.c */
+struct line_slab;
+
+struct line_layout_cache;
+
 /* Linked list containing chat history lines */
 struct history {
     struct line_info *line_root;
     struct line_info *line_start;   /* the first line we want to start printing at */
     struct line_info *line_end;
-    uint32_t start_id;    /* keeps track of where line_start should be when at bottom of history */
 
     struct line_info *queue[MAX_LINE_INFO_QUEUE];
     size_t queue_size;
+
+    struct line_slab *slabs;   /* arena backing all lines; the head is the slab currently being filled */
+    size_t num_slabs;
+
+    struct line_layout_cache *layouts;   /* wrapped messages of the lines drawn most recently */
+
+    /* Ring of line pointers indexed by `id & (index_size - 1)`. Line IDs in the history are consecutive,
+     * so as long as the ring is larger than the history every line has its own slot. */
+    struct line_info **index;
+    size_t index_size;    /* always zero or a power of two */
+    size_t num_lines;     /* number of lines in the history, including line_root */
+
+    /* If non-NULL, lines loaded from the log are inserted after this line instead of being queued */
+    struct line_info *prepend_after;
+
+    /* The view as it was last drawn. The history window is only redrawn in full when it has been resized,
+     * `redraw` is set or the view has moved other than down to follow new lines. Otherwise lines appended
+     * below the view are drawn on their own, after scrolling the window if the view moved with them, and
+     * only the lines in view that are flagged as dirty are redrawn. */
+    bool redraw;
+    const struct line_info *drawn_start;
+    const struct line_info *drawn_end;
+    const struct line_info *drawn_last;   /* the last line that fit in the window */
+    uint32_t drawn_start_id;
+    uint32_t drawn_end_id;
+    int drawn_bottom;                     /* the row below the last line */
+    int drawn_max_x;
+    int drawn_max_y;
 };
 
 /* creates new line_info line and puts it in the queue.
@@ -81,13 +123,15 @@ int line_info_add(ToxWindow *self, const Client_Config *c_config, bool show_time
                   const char *name2, LINE_TYPE type, uint8_t bold, uint8_t colour, const char *msg, ...);
 
 /*
- * Similar to line_info_add() but uses lines from history.
+ * Similar to line_info_add() but uses lines from history. `log_line` is the number of the chat log
+ * line that the line was loaded from (see log.h).
  *
  * Returns the ID of the new line on success.
  * Returns -1 on failure.
  */
 int line_info_load_history(ToxWindow *self, const Client_Config *c_config, const char *timestamp,
-                           const char *name, LINE_TYPE type, bool bold, int colour, const char *message);
+                           const char *name, LINE_TYPE type, bool bold, int colour, const char *message,
+                           int64_t log_line);
 
 /* Prints a section of history starting at line_start */
 void line_info_print(ToxWindow *self, const Client_Config *c_config);
@@ -106,6 +150,19 @@ void line_info_set(ToxWindow *self, uint32_t id, char *msg);
  */
 struct line_info *line_info_get(ToxWindow *self, uint32_t id);
 
+/* Return the line in `hst` associated with `id`.
+ * Return NULL if id cannot be found
+ */
+struct line_info *line_info_find(const struct history *hst, uint32_t id);
+
+/* Scrolls the history of `self` so that the line that was loaded from chat log line `log_line` is
+ * at the top, paging older history in from the log as needed.
+ *
+ * Return true on success.
+ * Return false if the line isn't in the history and couldn't be paged in.
+ */
+bool line_info_jump_to_log_line(ToxWindow *self, const Client_Config *c_config, int64_t log_line);
+
 /* resets line_start (moves to end of chat history) */
 void line_info_reset_start(ToxWindow *self, struct history *hst);
 
@@ -114,6 +171,46 @@ void line_info_init(struct history *hst);
 /* returns true if key is a match */
 bool line_info_onKey(ToxWindow *self, const Client_Config *c_config, wint_t key);
 
+/* Accessors for the strings packed into a line's record. */
+const char *line_info_timestr(const struct line_info *line);
+const char *line_info_name1(const struct line_info *line);
+const char *line_info_name2(const struct line_info *line);
+const char *line_info_msg(const struct line_info *line);
+
+/**
+ * Allocates a new line from the arena of `hst` and packs the given strings into it.
+ * Any of the strings may be NULL, in which case they're stored as empty strings.
+ * All other fields of the returned line are zeroed.
+ *
+ * The line must be released with `line_info_free()`.
+ *
+ * @return the new line, or NULL if `msg` is too long to be stored.
+ * @private
+ */
+struct line_info *line_info_alloc(struct history *hst, const char *timestr, const char *name1,
+                                  const char *name2, const char *msg);
+
+/**
+ * Returns the memory used by `line` to the arena of `hst`.
+ *
+ * @private
+ */
+void line_info_free(struct history *hst, struct line_info *line);
+
+/**
+ * Appends `line` to the end of `hst` and indexes it by its ID.
+ *
+ * @private
+ */
+void line_info_append(struct history *hst, struct line_info *line);
+
+/**
+ * Returns the number of bytes the arena of `hst` currently holds.
+ *
+ * @private
+ */
+size_t line_info_arena_size(const struct history *hst);
+
 /**
  * Converts the multibyte string `msg` into a wide character string and puts
  * the result in `buf`.
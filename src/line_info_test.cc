@@ -2,6 +2,10 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
 namespace {
 
 TEST(LineInfo, TextWidth)
@@ -10,4 +14,145 @@ TEST(LineInfo, TextWidth)
     EXPECT_EQ(line_info_add_msg(buf, 100, "Hello, world!"), 13);
 }
 
+TEST(LineInfo, PackedStrings)
+{
+    struct history *hst = static_cast<struct history *>(calloc(1, sizeof(struct history)));
+    ASSERT_NE(hst, nullptr);
+    line_info_init(hst);
+
+    struct line_info *line = line_info_alloc(hst, "12:34", "Alice", nullptr, "Hello, world!");
+    ASSERT_NE(line, nullptr);
+    EXPECT_STREQ(line_info_timestr(line), "12:34");
+    EXPECT_STREQ(line_info_name1(line), "Alice");
+    EXPECT_STREQ(line_info_name2(line), "");
+    EXPECT_STREQ(line_info_msg(line), "Hello, world!");
+
+    line_info_free(hst, line);
+    line_info_cleanup(hst);
+}
+
+// Not a pass/fail benchmark: reports how much memory a realistic history costs per line
+// compared to the old layout, which stored every line in fixed-size buffers.
+TEST(LineInfo, DISABLED_MemoryPerLine)
+{
+    constexpr size_t num_lines = 100000;
+    constexpr size_t legacy_line_size = TIME_STR_SIZE + 2 * (TOXIC_MAX_NAME_LENGTH + 1)
+                                        + MAX_LINE_INFO_MSG_SIZE * sizeof(wchar_t) + 48;
+
+    struct history *hst = static_cast<struct history *>(calloc(1, sizeof(struct history)));
+    ASSERT_NE(hst, nullptr);
+    line_info_init(hst);
+
+    const char *msgs[] = {"ok", "lol", "did anyone try the new build yet?", "brb",
+                          "I pushed a fix for the crash on startup, can someone confirm it works for them?"
+                         };
+
+    struct line_info *prev = hst->line_root;
+
+    for (size_t i = 0; i < num_lines; ++i) {
+        struct line_info *line = line_info_alloc(hst, "[12:34:56]", "somebody", nullptr, msgs[i % 5]);
+        ASSERT_NE(line, nullptr);
+        line->prev = prev;
+        prev->next = line;
+        prev = line;
+    }
+
+    const size_t bytes_per_line = line_info_arena_size(hst) / num_lines;
+    std::printf("history memory: %zu bytes/line (fixed buffers: %zu bytes/line)\n", bytes_per_line,
+                legacy_line_size);
+
+    EXPECT_LT(bytes_per_line * 10, legacy_line_size);
+
+    // freeing every line in FIFO order must hand all but one slab back
+    struct line_info *line = hst->line_root;
+
+    while (line) {
+        struct line_info *next = line->next;
+        line_info_free(hst, line);
+        line = next;
+    }
+
+    EXPECT_EQ(hst->num_slabs, 1);
+
+    hst->line_root = nullptr;
+    line_info_cleanup(hst);
+}
+
+TEST(LineInfo, FindById)
+{
+    struct history *hst = static_cast<struct history *>(calloc(1, sizeof(struct history)));
+    ASSERT_NE(hst, nullptr);
+    line_info_init(hst);
+
+    for (uint32_t id = 1; id <= 1000; ++id) {
+        struct line_info *line = line_info_alloc(hst, nullptr, nullptr, nullptr, "msg");
+        ASSERT_NE(line, nullptr);
+        line->id = id;
+        line_info_append(hst, line);
+    }
+
+    EXPECT_EQ(line_info_find(hst, 0), hst->line_root);
+    EXPECT_EQ(line_info_find(hst, 1000), hst->line_end);
+    ASSERT_NE(line_info_find(hst, 500), nullptr);
+    EXPECT_EQ(line_info_find(hst, 500)->id, 500);
+    EXPECT_EQ(line_info_find(hst, 1001), nullptr);
+
+    line_info_cleanup(hst);
+}
+
+// Receipts and progress bar updates look lines up by ID. Compares the index against walking
+// back from the end of a full history, which is what line_info_get() used to do.
+TEST(LineInfo, DISABLED_FindByIdBenchmark)
+{
+    constexpr uint32_t num_lines = 100000;
+    constexpr uint32_t num_lookups = 2000;
+
+    struct history *hst = static_cast<struct history *>(calloc(1, sizeof(struct history)));
+    ASSERT_NE(hst, nullptr);
+    line_info_init(hst);
+
+    for (uint32_t id = 1; id <= num_lines; ++id) {
+        struct line_info *line = line_info_alloc(hst, nullptr, nullptr, nullptr, "msg");
+        ASSERT_NE(line, nullptr);
+        line->id = id;
+        line_info_append(hst, line);
+    }
+
+    const auto walk_start = std::chrono::steady_clock::now();
+    uint64_t walk_sum = 0;
+
+    for (uint32_t i = 0; i < num_lookups; ++i) {
+        const uint32_t id = 1 + (i * 7919) % num_lines;
+        struct line_info *line = hst->line_end;
+
+        while (line != nullptr && line->id != id) {
+            line = line->prev;
+        }
+
+        ASSERT_NE(line, nullptr);
+        walk_sum += line->id;
+    }
+
+    const auto index_start = std::chrono::steady_clock::now();
+    uint64_t index_sum = 0;
+
+    for (uint32_t i = 0; i < num_lookups; ++i) {
+        const uint32_t id = 1 + (i * 7919) % num_lines;
+        struct line_info *line = line_info_find(hst, id);
+        ASSERT_NE(line, nullptr);
+        index_sum += line->id;
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(walk_sum, index_sum);
+
+    using ns = std::chrono::nanoseconds;
+    std::printf("line lookup over %u lines: walk %lld ns/op, index %lld ns/op\n", num_lines,
+                static_cast<long long>(std::chrono::duration_cast<ns>(index_start - walk_start).count() / num_lookups),
+                static_cast<long long>(std::chrono::duration_cast<ns>(end - index_start).count() / num_lookups));
+
+    line_info_cleanup(hst);
+}
+
 }  // namespace
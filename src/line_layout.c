@@ -0,0 +1,282 @@
+/*  line_layout.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE    /* needed for wcwidth() */
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "line_layout.h"
+
+int line_layout_char_width(wchar_t ch)
+{
+    if (ch == L'\n') {
+        return 1;
+    }
+
+    const int width = wcwidth(ch);
+
+    /* non-printable characters are shown as a placeholder by the terminal */
+    return width >= 0 ? width : 1;
+}
+
+int line_layout_set_msg(struct line_layout *layout, const wchar_t *msg, size_t length)
+{
+    if (length + 1 > layout->msg_size) {
+        wchar_t *new_msg = realloc(layout->msg, (length + 1) * sizeof(wchar_t));
+
+        if (new_msg == NULL) {
+            return -1;
+        }
+
+        layout->msg = new_msg;
+        layout->msg_size = length + 1;
+    }
+
+    memcpy(layout->msg, msg, length * sizeof(wchar_t));
+    layout->msg[length] = L'\0';
+    layout->msg_length = length;
+    layout->wrapped = false;
+    layout->num_rows = 0;
+    layout->lines = 0;
+
+    return 0;
+}
+
+bool line_layout_matches(const struct line_layout *layout, int x_start, int max_x, bool line_padding)
+{
+    return layout->wrapped
+           && layout->x_start == x_start
+           && layout->max_x == max_x
+           && layout->line_padding == line_padding;
+}
+
+/* Appends a row to `layout`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+static int line_layout_add_row(struct line_layout *layout, size_t offset, size_t length, uint8_t flags)
+{
+    if (layout->num_rows == layout->rows_size) {
+        if (layout->rows_size >= UINT16_MAX / 2) {
+            return -1;
+        }
+
+        const uint16_t new_size = layout->rows_size > 0 ? layout->rows_size * 2 : 4;
+        struct line_layout_row *new_rows = realloc(layout->rows, new_size * sizeof(struct line_layout_row));
+
+        if (new_rows == NULL) {
+            return -1;
+        }
+
+        layout->rows = new_rows;
+        layout->rows_size = new_size;
+    }
+
+    struct line_layout_row *row = &layout->rows[layout->num_rows];
+    row->offset = (uint16_t) offset;
+    row->length = (uint16_t) length;
+    row->flags = flags;
+
+    ++layout->num_rows;
+
+    return 0;
+}
+
+int line_layout_wrap(struct line_layout *layout, int x_start, int max_x, bool line_padding)
+{
+    layout->wrapped = false;
+    layout->num_rows = 0;
+    layout->lines = 0;
+
+    int x_limit = max_x - x_start;
+
+    if (x_limit <= 1 || layout->msg_length > UINT16_MAX) {
+        return -1;
+    }
+
+    const wchar_t *msg = layout->msg;
+    const size_t length = layout->msg_length;
+
+    size_t rest_width = 0;
+
+    for (size_t i = 0; i < length; ++i) {
+        rest_width += line_layout_char_width(msg[i]);
+    }
+
+    size_t pos = 0;
+    uint16_t lines = 0;
+
+    while (true) {
+        /* the rest of the message fits, including any newlines it contains */
+        if (rest_width < (size_t) x_limit) {
+            if (line_layout_add_row(layout, pos, length - pos, 0) == -1) {
+                return -1;
+            }
+
+            for (size_t i = pos; i < length; ++i) {
+                if (msg[i] == L'\n') {
+                    ++lines;
+                }
+            }
+
+            ++lines;
+            break;
+        }
+
+        size_t newline = SIZE_MAX;
+        size_t space = SIZE_MAX;
+        size_t space_col = 0;
+        size_t end = pos;
+        int col = 0;
+
+        while (end < length) {
+            const int width = line_layout_char_width(msg[end]);
+
+            if (col + width > x_limit) {
+                break;
+            }
+
+            if (msg[end] == L'\n') {
+                newline = end;
+                break;
+            }
+
+            if (msg[end] == L' ' && end > pos) {
+                space = end;
+                space_col = col;
+            }
+
+            col += width;
+            ++end;
+        }
+
+        if (newline != SIZE_MAX) {
+            if (line_layout_add_row(layout, pos, newline - pos + 1, 0) == -1) {
+                return -1;
+            }
+
+            rest_width -= col + 1;
+            pos = newline + 1;
+            x_limit = max_x;  // if we find a newline we stop adding column padding for rest of message
+            ++lines;
+            continue;
+        }
+
+        uint8_t flags = 0;
+        size_t row_length;
+
+        if (space != SIZE_MAX) {
+            row_length = space - pos;
+            rest_width -= space_col + 1;
+            flags |= LINE_LAYOUT_ROW_NEWLINE;
+        } else {
+            if (end == pos) {  // a character wider than the whole row
+                col = line_layout_char_width(msg[end]);
+                ++end;
+            }
+
+            row_length = end - pos;
+            rest_width -= col;
+
+            /* a full row wraps by itself; one left short by a wide character has to be ended by hand */
+            if (col < x_limit) {
+                flags |= LINE_LAYOUT_ROW_NEWLINE;
+            }
+        }
+
+        if (!line_padding) {
+            x_limit = max_x; // stop adding column padding for rest of message
+        }
+
+        if (x_limit < max_x) {
+            flags |= LINE_LAYOUT_ROW_PADDED;
+        }
+
+        if (line_layout_add_row(layout, pos, row_length, flags) == -1) {
+            return -1;
+        }
+
+        pos += row_length + (space != SIZE_MAX ? 1 : 0);
+        ++lines;
+    }
+
+    layout->x_start = x_start;
+    layout->max_x = max_x;
+    layout->line_padding = line_padding;
+    layout->lines = lines;
+    layout->wrapped = true;
+
+    return 0;
+}
+
+void line_layout_free(struct line_layout *layout)
+{
+    free(layout->msg);
+    free(layout->rows);
+    memset(layout, 0, sizeof(struct line_layout));
+}
+
+struct line_layout_cache *line_layout_cache_new(void)
+{
+    return calloc(1, sizeof(struct line_layout_cache));
+}
+
+void line_layout_cache_free(struct line_layout_cache *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < LINE_LAYOUT_CACHE_SIZE; ++i) {
+        line_layout_free(&cache->entries[i]);
+    }
+
+    free(cache);
+}
+
+struct line_layout *line_layout_cache_find(struct line_layout_cache *cache, const void *key, uint32_t id)
+{
+    struct line_layout *layout = &cache->entries[id & (LINE_LAYOUT_CACHE_SIZE - 1)];
+
+    if (layout->key != key || layout->id != id) {
+        return NULL;
+    }
+
+    return layout;
+}
+
+struct line_layout *line_layout_cache_claim(struct line_layout_cache *cache, const void *key, uint32_t id)
+{
+    struct line_layout *layout = &cache->entries[id & (LINE_LAYOUT_CACHE_SIZE - 1)];
+
+    layout->key = key;
+    layout->id = id;
+    layout->msg_length = 0;
+    layout->wrapped = false;
+    layout->num_rows = 0;
+    layout->lines = 0;
+
+    return layout;
+}
+
+void line_layout_cache_invalidate(struct line_layout_cache *cache, const void *key, uint32_t id)
+{
+    if (cache == NULL) {
+        return;
+    }
+
+    struct line_layout *layout = line_layout_cache_find(cache, key, id);
+
+    if (layout != NULL) {
+        layout->key = NULL;
+    }
+}
@@ -0,0 +1,114 @@
+/*  line_layout.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef LINE_LAYOUT_H
+#define LINE_LAYOUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* The number of layouts a cache holds. Must be a power of two, and should be larger than the number of
+ * lines that can be on screen at once.
+ */
+#define LINE_LAYOUT_CACHE_SIZE 256
+
+#define LINE_LAYOUT_ROW_NEWLINE (1 << 0)  /* a newline has to be printed after the row */
+#define LINE_LAYOUT_ROW_PADDED  (1 << 1)  /* the next row is indented to line up with the start of the message */
+
+struct line_layout_row {
+    uint16_t offset;   /* index of the row's first character in the message */
+    uint16_t length;   /* number of characters in the row */
+    uint8_t  flags;    /* LINE_LAYOUT_ROW_* */
+};
+
+/* A message converted to wide characters and wrapped into rows for one window width. */
+struct line_layout {
+    const void *key;    /* the line the layout belongs to, or NULL if unused */
+    uint32_t id;
+
+    wchar_t *msg;
+    size_t   msg_length;
+    size_t   msg_size;
+
+    /* the parameters the message was wrapped with */
+    int  x_start;
+    int  max_x;
+    bool line_padding;
+    bool wrapped;
+
+    struct line_layout_row *rows;
+    uint16_t num_rows;
+    uint16_t rows_size;
+    uint16_t lines;     /* number of screen lines the message takes up */
+};
+
+/* Layouts of recently drawn lines, indexed by `id & (LINE_LAYOUT_CACHE_SIZE - 1)`. */
+struct line_layout_cache {
+    struct line_layout entries[LINE_LAYOUT_CACHE_SIZE];
+};
+
+/* Returns the number of columns `ch` takes up when it's wrapped. */
+int line_layout_char_width(wchar_t ch);
+
+/* Copies the first `length` characters of `msg` into `layout`, discarding its rows.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int line_layout_set_msg(struct line_layout *layout, const wchar_t *msg, size_t length);
+
+/* Returns true if `layout` has been wrapped with the given parameters. */
+bool line_layout_matches(const struct line_layout *layout, int x_start, int max_x, bool line_padding);
+
+/* Wraps the message of `layout` into rows that fit in a window `max_x` columns wide, where the message
+ * starts at column `x_start`. Rows are broken at a newline, or else after the last word that fits, or else
+ * after the last character that fits. If `line_padding` is true every row is indented to `x_start`;
+ * otherwise only the first row is. Character widths are taken into account, so that rows of double-width
+ * characters don't overflow the window.
+ *
+ * Return 0 on success.
+ * Return -1 if there is no room for the message or memory couldn't be allocated.
+ */
+int line_layout_wrap(struct line_layout *layout, int x_start, int max_x, bool line_padding);
+
+/* Frees the memory held by `layout`. */
+void line_layout_free(struct line_layout *layout);
+
+/* Returns a new empty cache, or NULL on failure. */
+struct line_layout_cache *line_layout_cache_new(void);
+
+/* Frees `cache` along with all of its layouts. */
+void line_layout_cache_free(struct line_layout_cache *cache);
+
+/* Returns the cached layout of the line identified by `key` and `id`, or NULL if it isn't cached. The
+ * layout's message is valid, but it may have been wrapped for other parameters.
+ */
+struct line_layout *line_layout_cache_find(struct line_layout_cache *cache, const void *key, uint32_t id);
+
+/* Returns the entry for the line identified by `key` and `id`, evicting whatever it held before. The
+ * caller must set its message with line_layout_set_msg().
+ */
+struct line_layout *line_layout_cache_claim(struct line_layout_cache *cache, const void *key, uint32_t id);
+
+/* Drops the layout of the line identified by `key` and `id` from `cache`, if it's cached. This must be
+ * called when a line's message changes or the line is freed.
+ */
+void line_layout_cache_invalidate(struct line_layout_cache *cache, const void *key, uint32_t id);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* LINE_LAYOUT_H */
@@ -0,0 +1,238 @@
+#include "line_layout.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+namespace {
+
+class LineLayout : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        if (std::setlocale(LC_ALL, "C.UTF-8") == nullptr && std::setlocale(LC_ALL, "en_US.UTF-8") == nullptr) {
+            GTEST_SKIP() << "no UTF-8 locale available";
+        }
+    }
+
+    void TearDown() override
+    {
+        line_layout_free(&layout_);
+        std::setlocale(LC_ALL, "C");
+    }
+
+    void wrap(const wchar_t *msg, int x_start, int max_x, bool line_padding)
+    {
+        ASSERT_EQ(line_layout_set_msg(&layout_, msg, std::wcslen(msg)), 0);
+        ASSERT_EQ(line_layout_wrap(&layout_, x_start, max_x, line_padding), 0);
+    }
+
+    std::wstring row(uint16_t i) const
+    {
+        const struct line_layout_row &r = layout_.rows[i];
+        return std::wstring(layout_.msg + r.offset, r.length);
+    }
+
+    int row_width(uint16_t i) const
+    {
+        const struct line_layout_row &r = layout_.rows[i];
+        int width = 0;
+
+        for (uint16_t j = 0; j < r.length; ++j) {
+            width += line_layout_char_width(layout_.msg[r.offset + j]);
+        }
+
+        return width;
+    }
+
+    struct line_layout layout_ = {};
+};
+
+TEST_F(LineLayout, ShortMessageIsOneRow)
+{
+    wrap(L"hello", 10, 80, true);
+
+    ASSERT_EQ(layout_.num_rows, 1);
+    EXPECT_EQ(row(0), L"hello");
+    EXPECT_EQ(layout_.rows[0].flags, 0);
+    EXPECT_EQ(layout_.lines, 1);
+}
+
+TEST_F(LineLayout, WrapsAtLastSpace)
+{
+    wrap(L"aaaa bbbb cccc", 0, 10, true);
+
+    ASSERT_EQ(layout_.num_rows, 2);
+    EXPECT_EQ(row(0), L"aaaa bbbb");
+    EXPECT_EQ(row(1), L"cccc");
+    EXPECT_TRUE(layout_.rows[0].flags & LINE_LAYOUT_ROW_NEWLINE);
+    EXPECT_EQ(layout_.lines, 2);
+}
+
+TEST_F(LineLayout, Padding)
+{
+    wrap(L"aaaa bbbb cccc dddd", 5, 15, true);
+
+    ASSERT_EQ(layout_.num_rows, 2);
+    EXPECT_TRUE(layout_.rows[0].flags & LINE_LAYOUT_ROW_PADDED);
+
+    wrap(L"aaaa bbbb cccc dddd", 5, 15, false);
+
+    ASSERT_EQ(layout_.num_rows, 2);
+    EXPECT_FALSE(layout_.rows[0].flags & LINE_LAYOUT_ROW_PADDED);
+    EXPECT_EQ(row(1), L"cccc dddd");
+}
+
+TEST_F(LineLayout, BreaksLongWords)
+{
+    wrap(L"abcdefghijklmnopqrstuvwxyz", 0, 10, true);
+
+    ASSERT_EQ(layout_.num_rows, 3);
+    EXPECT_EQ(row(0), L"abcdefghij");
+    EXPECT_EQ(layout_.rows[0].flags & LINE_LAYOUT_ROW_NEWLINE, 0);  // a full row wraps by itself
+    EXPECT_EQ(row(2), L"uvwxyz");
+}
+
+TEST_F(LineLayout, Newlines)
+{
+    wrap(L"first\nsecond", 0, 80, true);
+
+    ASSERT_EQ(layout_.num_rows, 1);
+    EXPECT_EQ(layout_.lines, 2);
+
+    wrap(L"a line that is too long\nto fit", 0, 20, true);
+
+    /* the newline is printed along with the rest of the message once it all fits */
+    ASSERT_EQ(layout_.num_rows, 2);
+    EXPECT_EQ(row(0), L"a line that is too");
+    EXPECT_EQ(row(1), L"long\nto fit");
+    EXPECT_EQ(layout_.lines, 3);
+}
+
+TEST_F(LineLayout, DoubleWidthCharacters)
+{
+    /* twenty CJK characters take up forty columns */
+    std::wstring msg(20, L'中');
+    wrap(msg.c_str(), 0, 15, true);
+
+    ASSERT_EQ(layout_.num_rows, 3);
+
+    for (uint16_t i = 0; i < layout_.num_rows; ++i) {
+        EXPECT_LE(row_width(i), 15);
+    }
+
+    /* seven characters fill 14 of 15 columns, so the row has to be ended by hand */
+    EXPECT_EQ(layout_.rows[0].length, 7);
+    EXPECT_TRUE(layout_.rows[0].flags & LINE_LAYOUT_ROW_NEWLINE);
+}
+
+TEST_F(LineLayout, NoRoom)
+{
+    ASSERT_EQ(line_layout_set_msg(&layout_, L"hi", 2), 0);
+    EXPECT_EQ(line_layout_wrap(&layout_, 10, 11, true), -1);
+    EXPECT_FALSE(layout_.wrapped);
+}
+
+TEST(LineLayoutCache, FindClaimInvalidate)
+{
+    struct line_layout_cache *cache = line_layout_cache_new();
+    ASSERT_NE(cache, nullptr);
+
+    int line_a;
+    int line_b;
+
+    EXPECT_EQ(line_layout_cache_find(cache, &line_a, 1), nullptr);
+
+    struct line_layout *layout = line_layout_cache_claim(cache, &line_a, 1);
+    ASSERT_EQ(line_layout_set_msg(layout, L"hello", 5), 0);
+    ASSERT_EQ(line_layout_wrap(layout, 0, 80, true), 0);
+
+    EXPECT_EQ(line_layout_cache_find(cache, &line_a, 1), layout);
+    EXPECT_TRUE(line_layout_matches(layout, 0, 80, true));
+    EXPECT_FALSE(line_layout_matches(layout, 0, 60, true));
+
+    /* a different line, or the same line under another id, doesn't match */
+    EXPECT_EQ(line_layout_cache_find(cache, &line_b, 1), nullptr);
+    EXPECT_EQ(line_layout_cache_find(cache, &line_a, 1 + LINE_LAYOUT_CACHE_SIZE), nullptr);
+
+    line_layout_cache_invalidate(cache, &line_a, 1);
+    EXPECT_EQ(line_layout_cache_find(cache, &line_a, 1), nullptr);
+
+    line_layout_cache_free(cache);
+}
+
+// Not a pass/fail benchmark: reports how long it takes to lay out a screen of multilingual history per
+// frame when every line is wrapped again, compared to looking the layouts up in the cache.
+TEST_F(LineLayout, DISABLED_WrapBenchmark)
+{
+    const std::vector<std::wstring> msgs = {
+        L"did anyone try the new build yet? it crashes for me on startup when the config is missing",
+        L"今天的构建在我的机器上运行得很"
+        L"好，但是文件传输还是有点慢。有"
+        L"人测试过大文件吗？",
+        L"\U0001F600\U0001F389\U0001F44D great, thanks! \U0001F680\U0001F680\U0001F680 shipping it",
+        L"Привет, как дела? "
+        L"Я проверил патч и "
+        L"он работает.",
+        L"ok",
+        L"日本語のメッセージも正しく折り"
+        L"返されますか？",
+    };
+
+    constexpr size_t num_visible = 50;
+    constexpr size_t num_frames = 2000;
+    constexpr int max_x = 80;
+    constexpr int x_start = 20;
+
+    struct line_layout_cache *cache = line_layout_cache_new();
+    ASSERT_NE(cache, nullptr);
+
+    std::vector<int> lines(num_visible);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t frame = 0; frame < num_frames; ++frame) {
+        for (size_t i = 0; i < num_visible; ++i) {
+            const std::wstring &msg = msgs[i % msgs.size()];
+            ASSERT_EQ(line_layout_set_msg(&layout_, msg.c_str(), msg.size()), 0);
+            ASSERT_EQ(line_layout_wrap(&layout_, x_start, max_x, true), 0);
+        }
+    }
+
+    const auto uncached = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+
+    for (size_t frame = 0; frame < num_frames; ++frame) {
+        for (size_t i = 0; i < num_visible; ++i) {
+            struct line_layout *layout = line_layout_cache_find(cache, &lines[i], i);
+
+            if (layout != nullptr && line_layout_matches(layout, x_start, max_x, true)) {
+                continue;
+            }
+
+            const std::wstring &msg = msgs[i % msgs.size()];
+            layout = line_layout_cache_claim(cache, &lines[i], i);
+            ASSERT_EQ(line_layout_set_msg(layout, msg.c_str(), msg.size()), 0);
+            ASSERT_EQ(line_layout_wrap(layout, x_start, max_x, true), 0);
+        }
+    }
+
+    const auto cached = std::chrono::steady_clock::now() - start;
+
+    const double uncached_ns = std::chrono::duration<double, std::nano>(uncached).count() / (num_frames * num_visible);
+    const double cached_ns = std::chrono::duration<double, std::nano>(cached).count() / (num_frames * num_visible);
+
+    std::printf("line layout: %.1f ns/line wrapped every frame, %.1f ns/line cached\n", uncached_ns, cached_ns);
+
+    EXPECT_LT(cached, uncached);
+
+    line_layout_cache_free(cache);
+}
+
+}  // namespace
@@ -6,6 +6,10 @@
  *  under the GNU General Public License 3.0.
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE    /* needed for fseeko() and ftello() */
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -14,6 +18,7 @@
 #include "configdir.h"
 #include "line_info.h"
 #include "log.h"
+#include "log_search.h"
 #include "misc_tools.h"
 #include "settings.h"
 #include "toxic.h"
@@ -106,8 +111,82 @@ static int init_logging_session(const Client_Config *c_config, const Paths *path
     return 0;
 }
 
-/* limits calls to fflush to a max of one per LOG_FLUSH_LIMIT seconds */
-#define LOG_FLUSH_LIMIT 1
+static bool log_offsets_push(off_t **offsets, size_t *count, size_t *size, off_t offset)
+{
+    if (*count == *size) {
+        const size_t new_size = *size > 0 ? *size * 2 : 64;
+        off_t *new_offsets = realloc(*offsets, new_size * sizeof(off_t));
+
+        if (new_offsets == NULL) {
+            return false;
+        }
+
+        *offsets = new_offsets;
+        *size = new_size;
+    }
+
+    (*offsets)[*count] = offset;
+    ++(*count);
+
+    return true;
+}
+
+static void log_index_clear(struct log_index *index)
+{
+    free(index->fwd);
+    free(index->back);
+    memset(index, 0, sizeof(struct log_index));
+}
+
+int log_index_init(struct chatlog *log)
+{
+    struct log_index *index = &log->index;
+
+    log_index_clear(index);
+
+    const off_t size = file_size(log->path);
+
+    index->origin = size;
+    index->end = size;
+    index->scan_pos = size;
+    index->scan_done = size == 0;
+    index->valid = true;
+
+    return 0;
+}
+
+int64_t log_next_line(const struct chatlog *log)
+{
+    return log != NULL ? log->index.next_line : 0;
+}
+
+/* Records that a line starting at `offset` has been appended to the file. */
+static void log_index_add_line(struct log_index *index, off_t offset)
+{
+    if (index->next_line % LOG_INDEX_STRIDE == 0) {
+        if (!log_offsets_push(&index->fwd, &index->fwd_count, &index->fwd_size, offset)) {
+            index->valid = false;
+        }
+    }
+
+    ++index->next_line;
+}
+
+/* Records that `msg`, written at the end of the file after `prefix_len` bytes of formatting, has been
+ * appended to the log. `msg` may span multiple lines.
+ */
+static void log_index_append(struct log_index *index, size_t prefix_len, const char *msg, size_t msg_len)
+{
+    const off_t start = index->end;
+
+    log_index_add_line(index, start);
+
+    for (const char *p = msg; (p = memchr(p, '\n', msg_len - (p - msg))) != NULL; ++p) {
+        log_index_add_line(index, start + prefix_len + (p - msg) + 1);
+    }
+
+    index->end += prefix_len + msg_len + 1;
+}
 
 /* We stop writing to the log after we've written at least this many bytes during the current session.
  * A new session is started with `log_enable()`, and ended with `log_disable()`.
@@ -125,7 +204,7 @@ int write_to_log(struct chatlog *log, const Client_Config *c_config, const char
         return 0;
     }
 
-    if (log->file == NULL) {
+    if (log->stream == NULL) {
         log->log_on = false;
         return -1;
     }
@@ -145,38 +224,60 @@ int write_to_log(struct chatlog *log, const Client_Config *c_config, const char
     char s[MAX_STR_SIZE];
     get_time_str(s, sizeof(s), t);
 
-    int bytes_written;
+    /* The prefix is formatted separately so that we know the offset of every line `msg` spans */
+    char prefix[MAX_STR_SIZE + sizeof(name_frmt) + 16];
+    int prefix_len;
 
     if (name == NULL) {
-        bytes_written = fprintf(log->file, "{%d} %s %s\n", log_hint, s, msg);
+        prefix_len = snprintf(prefix, sizeof(prefix), "{%d} %s ", log_hint, s);
     } else {
-        bytes_written = fprintf(log->file, "{%d} %s %s %s\n", log_hint, s, name_frmt, msg);
+        prefix_len = snprintf(prefix, sizeof(prefix), "{%d} %s %s ", log_hint, s, name_frmt);
     }
 
-    if (timed_out(log->lastwrite, LOG_FLUSH_LIMIT)) {
-        fflush(log->file);
-        log->lastwrite = get_unix_time();
+    if (prefix_len < 0 || (size_t)prefix_len >= sizeof(prefix)) {
+        return -1;
     }
 
-    if (bytes_written > 0) {
-        log->bytes_written += bytes_written;
+    const size_t msg_len = strlen(msg);
+    const off_t start = log->index.end;
+
+    /* The line is written by the log writer thread; see log_writer.h */
+    if (log_writer_append(log->stream, prefix, prefix_len, msg, msg_len) != 0) {
+        log->index.valid = false;
+        return 0;
     }
 
+    log_index_append(&log->index, prefix_len, msg, msg_len);
+    log_search_add(&log->search, log->path, start, prefix, prefix_len, msg, msg_len);
+    log->bytes_written += prefix_len + msg_len + 1;
+
     return 0;
 }
 
+void log_free(struct chatlog *log)
+{
+    if (log == NULL) {
+        return;
+    }
+
+    log_disable(log);
+    log_index_clear(&log->index);
+    log_search_close(&log->search, log->path);
+
+    free(log);
+}
+
 void log_disable(struct chatlog *log)
 {
     if (log == NULL) {
         return;
     }
 
-    if (log->file != NULL) {
-        fclose(log->file);
-        log->file = NULL;
+    if (log->stream != NULL) {
+        log_writer_close(log->stream);
+        log->stream = NULL;
     }
 
-    log->lastwrite = 0;
     log->log_on = false;
     log->bytes_written = 0;
 }
@@ -195,13 +296,13 @@ int log_enable(struct chatlog *log)
         return -1;
     }
 
-    if (log->file != NULL) {
+    if (log->stream != NULL) {
         return -1;
     }
 
-    log->file = fopen(log->path, "a+");
+    log->stream = log_writer_open(log->path);
 
-    if (log->file == NULL) {
+    if (log->stream == NULL) {
         return -1;
     }
 
@@ -222,7 +323,7 @@ int log_init(struct chatlog *log, const Client_Config *c_config, const Paths *pa
         return -1;
     }
 
-    if (log->file != NULL || log->log_on) {
+    if (log->stream != NULL || log->log_on) {
         fprintf(stderr, "Warning: Called log_init() on an already initialized log\n");
         return -1;
     }
@@ -232,6 +333,8 @@ int log_init(struct chatlog *log, const Client_Config *c_config, const Paths *pa
     }
 
     log_disable(log);
+    log_index_init(log);
+    log_search_open(&log->search, log->path);
 
     return 0;
 }
@@ -320,19 +423,19 @@ static int extract_log_name(const char *line, size_t length, char *buf, size_t b
 }
 
 static bool load_line_topic(ToxWindow *self, const Client_Config *c_config, const char *line, size_t length,
-                            const char *timestamp)
+                            const char *timestamp, int64_t log_line)
 {
     if (length <= 2) {
         return false;
     }
 
-    line_info_load_history(self, c_config, timestamp, NULL, SYS_MSG, true, MAGENTA, &line[2]);
+    line_info_load_history(self, c_config, timestamp, NULL, SYS_MSG, true, MAGENTA, &line[2], log_line);
 
     return true;
 }
 
 static bool load_line_name(ToxWindow *self, const Client_Config *c_config, const char *line, size_t length,
-                           const char *timestamp)
+                           const char *timestamp, int64_t log_line)
 {
     if (length <= 2) {
         return false;
@@ -345,26 +448,27 @@ static bool load_line_name(ToxWindow *self, const Client_Config *c_config, const
         return false;
     }
 
-    line_info_load_history(self, c_config, timestamp, name, NAME_CHANGE, true, MAGENTA, &line[end_name + 1]);
+    line_info_load_history(self, c_config, timestamp, name, NAME_CHANGE, true, MAGENTA, &line[end_name + 1],
+                           log_line);
 
     return true;
 }
 
 static bool load_line_moderation(ToxWindow *self, const Client_Config *c_config, const char *line, size_t length,
-                                 const char *timestamp)
+                                 const char *timestamp, int64_t log_line)
 {
     if (length <= 2) {
         return false;
     }
 
     const int colour = strstr(line, "has been kicked by") != NULL ? RED : BLUE;
-    line_info_load_history(self, c_config, timestamp, NULL, SYS_MSG, true, colour, &line[2]);
+    line_info_load_history(self, c_config, timestamp, NULL, SYS_MSG, true, colour, &line[2], log_line);
 
     return true;
 }
 
 static bool load_line_connection(ToxWindow *self, const Client_Config *c_config, const char *line, size_t length,
-                                 const char *timestamp, Log_Hint hint)
+                                 const char *timestamp, int64_t log_line, Log_Hint hint)
 {
     if (length <= 2) {
         return false;
@@ -388,13 +492,13 @@ static bool load_line_connection(ToxWindow *self, const Client_Config *c_config,
         type = DISCONNECTION;
     }
 
-    line_info_load_history(self, c_config, timestamp, name, type, true, colour, &line[end_name + 2]);
+    line_info_load_history(self, c_config, timestamp, name, type, true, colour, &line[end_name + 2], log_line);
 
     return true;
 }
 
 static bool load_line_message(ToxWindow *self, const Client_Config *c_config, const char *line, size_t length,
-                              const char *timestamp, Log_Hint hint)
+                              const char *timestamp, int64_t log_line, Log_Hint hint)
 {
     char name[TOXIC_MAX_NAME_LENGTH + 1];
 
@@ -409,27 +513,28 @@ static bool load_line_message(ToxWindow *self, const Client_Config *c_config, co
 
     switch (hint) {
         case LOG_HINT_NORMAL_I: {
-            line_info_load_history(self, c_config, timestamp, name, IN_MSG, false, 0, message);
+            line_info_load_history(self, c_config, timestamp, name, IN_MSG, false, 0, message, log_line);
             break;
         }
 
         case LOG_HINT_NORMAL_O: {
-            line_info_load_history(self, c_config, timestamp, name, OUT_MSG, false, 0, message);
+            line_info_load_history(self, c_config, timestamp, name, OUT_MSG, false, 0, message, log_line);
             break;
         }
 
         case LOG_HINT_PRIVATE_I: {
-            line_info_load_history(self, c_config, timestamp, name, IN_PRVT_MSG, false, MAGENTA, message);
+            line_info_load_history(self, c_config, timestamp, name, IN_PRVT_MSG, false, MAGENTA, message,
+                                   log_line);
             break;
         }
 
         case LOG_HINT_PRIVATE_O: {
-            line_info_load_history(self, c_config, timestamp, name, OUT_PRVT_MSG, false, 0, message);
+            line_info_load_history(self, c_config, timestamp, name, OUT_PRVT_MSG, false, 0, message, log_line);
             break;
         }
 
         case LOG_HINT_ACTION: {
-            line_info_load_history(self, c_config, timestamp, name, IN_ACTION, false, 0, message);
+            line_info_load_history(self, c_config, timestamp, name, IN_ACTION, false, 0, message, log_line);
             break;
         }
 
@@ -442,7 +547,7 @@ static bool load_line_message(ToxWindow *self, const Client_Config *c_config, co
     return true;
 }
 
-static void load_line(ToxWindow *self, const Client_Config *c_config, const char *line)
+static void load_line(ToxWindow *self, const Client_Config *c_config, const char *line, int64_t log_line)
 {
     const size_t line_length = strlen(line);
 
@@ -459,7 +564,7 @@ static void load_line(ToxWindow *self, const Client_Config *c_config, const char
     char timestamp[TIME_STR_SIZE];
     const int end_ts = extract_timestamp(line, line_length, timestamp, sizeof(timestamp));
 
-    if (end_ts >= line_length) {
+    if (end_ts < 0 || end_ts >= line_length) {
         goto on_error;
     }
 
@@ -480,7 +585,7 @@ static void load_line(ToxWindow *self, const Client_Config *c_config, const char
 
         /* fallthrough */
         case LOG_HINT_ACTION: {
-            if (load_line_message(self, c_config, line_start, length, timestamp, hint)) {
+            if (load_line_message(self, c_config, line_start, length, timestamp, log_line, hint)) {
                 return;
             }
 
@@ -488,7 +593,7 @@ static void load_line(ToxWindow *self, const Client_Config *c_config, const char
         }
 
         case LOG_HINT_NAME: {
-            if (load_line_name(self, c_config, line_start, length, timestamp)) {
+            if (load_line_name(self, c_config, line_start, length, timestamp, log_line)) {
                 return;
             }
 
@@ -496,7 +601,7 @@ static void load_line(ToxWindow *self, const Client_Config *c_config, const char
         }
 
         case LOG_HINT_TOPIC: {
-            if (load_line_topic(self, c_config, line_start, length, timestamp)) {
+            if (load_line_topic(self, c_config, line_start, length, timestamp, log_line)) {
                 return;
             }
 
@@ -507,7 +612,7 @@ static void load_line(ToxWindow *self, const Client_Config *c_config, const char
 
         /* fallthrough */
         case LOG_HINT_MOD_EVENT: {
-            if (load_line_moderation(self, c_config, line_start, length, timestamp)) {
+            if (load_line_moderation(self, c_config, line_start, length, timestamp, log_line)) {
                 return;
             }
 
@@ -518,7 +623,7 @@ static void load_line(ToxWindow *self, const Client_Config *c_config, const char
 
         /* fallthrough */
         case LOG_HINT_DISCONNECT: {
-            if (load_line_connection(self, c_config, line_start, length, timestamp, hint)) {
+            if (load_line_connection(self, c_config, line_start, length, timestamp, log_line, hint)) {
                 return;
             }
 
@@ -530,28 +635,157 @@ static void load_line(ToxWindow *self, const Client_Config *c_config, const char
     }
 
 on_error:
-    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, 0, "%s", line);
+    line_info_load_history(self, c_config, NULL, NULL, SYS_MSG, false, 0, line, log_line);
 }
 
-/* Loads chat log history and prints it to `self` window.
+/* Logs are read in blocks of this many bytes */
+#define LOG_READ_BLOCK_SIZE (64 * 1024)
+
+/* Scans the file backwards from the earliest indexed line until the offsets of at least `needed`
+ * lines before line 0 have been recorded, or the start of the file has been reached.
  *
- * Return 0 on success or if log file doesn't exist.
+ * Return 0 on success.
  * Return -1 on failure.
  */
-int load_chat_history(struct chatlog *log, ToxWindow *self, const Client_Config *c_config)
+static int log_index_scan_back(struct log_index *index, FILE *fp, size_t needed)
 {
-    if (log == NULL) {
+    if (index->scan_done || index->back_count >= needed) {
+        return 0;
+    }
+
+    char *block = malloc(LOG_READ_BLOCK_SIZE);
+
+    if (block == NULL) {
         return -1;
     }
 
-    if (*log->path == 0) {
+    /* skip the newline that terminates the line before the one at `scan_pos` */
+    off_t search_end = index->scan_pos - 1;
+
+    while (index->back_count < needed) {
+        /* The first line of the file isn't recorded; lookups fall back to offset 0 once the scan is done */
+        if (search_end <= 0) {
+            --index->scan_line;
+            index->scan_pos = 0;
+            index->scan_done = true;
+            break;
+        }
+
+        const off_t block_start = MAX(0, search_end - LOG_READ_BLOCK_SIZE);
+        const size_t block_size = search_end - block_start;
+
+        if (fseeko(fp, block_start, SEEK_SET) != 0 || fread(block, block_size, 1, fp) != 1) {
+            break;
+        }
+
+        for (size_t i = block_size; i-- > 0 && index->back_count < needed;) {
+            if (block[i] != '\n') {
+                continue;
+            }
+
+            --index->scan_line;
+            index->scan_pos = block_start + i + 1;
+
+            if (-index->scan_line % LOG_INDEX_STRIDE == 0) {
+                if (!log_offsets_push(&index->back, &index->back_count, &index->back_size, index->scan_pos)) {
+                    free(block);
+                    return -1;
+                }
+            }
+        }
+
+        search_end = block_start;
+    }
+
+    free(block);
+
+    return index->back_count >= needed || index->scan_done ? 0 : -1;
+}
+
+/* Returns the offset of the line that comes `count` lines after the line starting at `offset`,
+ * or -1 on failure.
+ */
+static off_t log_skip_lines(FILE *fp, off_t offset, int64_t count)
+{
+    if (count == 0) {
+        return offset;
+    }
+
+    if (fseeko(fp, offset, SEEK_SET) != 0) {
         return -1;
     }
 
-    const off_t sz = file_size(log->path);
+    char block[4096];
+    size_t read;
 
-    if (sz <= 0) {
-        return 0;
+    while ((read = fread(block, 1, sizeof(block), fp)) > 0) {
+        for (size_t i = 0; i < read; ++i) {
+            if (block[i] == '\n' && --count == 0) {
+                return offset + i + 1;
+            }
+        }
+
+        offset += read;
+    }
+
+    return -1;
+}
+
+/* Returns the offset of line `line_num` in the file, scanning backwards to index it if necessary.
+ *
+ * Returns -2 if the line comes before the start of the file.
+ * Returns -1 on any other failure.
+ */
+static off_t log_index_line_offset(struct log_index *index, FILE *fp, int64_t line_num)
+{
+    if (line_num >= index->next_line) {
+        return line_num == index->next_line ? index->end : -1;
+    }
+
+    if (line_num >= 0) {
+        const size_t i = line_num / LOG_INDEX_STRIDE;
+
+        if (i >= index->fwd_count) {
+            return -1;
+        }
+
+        return log_skip_lines(fp, index->fwd[i], line_num % LOG_INDEX_STRIDE);
+    }
+
+    const size_t needed = (-line_num + LOG_INDEX_STRIDE - 1) / LOG_INDEX_STRIDE;
+
+    if (log_index_scan_back(index, fp, needed) != 0) {
+        return -1;
+    }
+
+    if (index->back_count >= needed) {
+        const int64_t base_line = -(int64_t)needed * LOG_INDEX_STRIDE;
+        return log_skip_lines(fp, index->back[needed - 1], line_num - base_line);
+    }
+
+    /* we reached the start of the file before finding a recorded line at or before `line_num` */
+    if (line_num < index->scan_line) {
+        return -2;
+    }
+
+    return log_skip_lines(fp, 0, line_num - index->scan_line);
+}
+
+int log_read_lines(struct chatlog *log, int64_t before, size_t max_lines, char **lines, size_t *length,
+                   int64_t *first_line)
+{
+    *lines = NULL;
+    *length = 0;
+    *first_line = before;
+
+    struct log_index *index = &log->index;
+
+    if (!index->valid || *log->path == '\0' || max_lines == 0) {
+        return -1;
+    }
+
+    if (log->stream != NULL && log_writer_sync(log->stream) != 0) {
+        log->index.valid = false;
     }
 
     FILE *fp = fopen(log->path, "r");
@@ -560,20 +794,34 @@ int load_chat_history(struct chatlog *log, ToxWindow *self, const Client_Config
         return -1;
     }
 
-    char *buf = malloc(sz + 1);
+    const off_t end = log_index_line_offset(index, fp, before);
+    int64_t first = before - (int64_t)max_lines;
+    off_t start = log_index_line_offset(index, fp, first);
 
-    if (buf == NULL) {
+    if (start == -2) {
+        first = index->scan_line;
+        start = first < before ? 0 : end;
+    }
+
+    if (end < 0 || start < 0 || start > end) {
         fclose(fp);
         return -1;
     }
 
-    if (fseek(fp, 0L, SEEK_SET) == -1) {
-        free(buf);
+    if (start == end) {
+        fclose(fp);
+        return 0;
+    }
+
+    const size_t size = end - start;
+    char *buf = malloc(size + 1);
+
+    if (buf == NULL) {
         fclose(fp);
         return -1;
     }
 
-    if (fread(buf, sz, 1, fp) != 1) {
+    if (fseeko(fp, start, SEEK_SET) != 0 || fread(buf, size, 1, fp) != 1) {
         free(buf);
         fclose(fp);
         return -1;
@@ -581,41 +829,161 @@ int load_chat_history(struct chatlog *log, ToxWindow *self, const Client_Config
 
     fclose(fp);
 
-    buf[sz] = '\0';
+    buf[size] = '\0';
 
-    /* Number of history lines to load: must not be larger than MAX_LINE_INFO_QUEUE - 2 */
-    int L = MIN(MAX_LINE_INFO_QUEUE - 2, c_config->history_size);
+    *lines = buf;
+    *length = size;
+    *first_line = first;
+
+    return 0;
+}
+
+int log_load_page(struct chatlog *log, ToxWindow *self, const Client_Config *c_config, int64_t before,
+                  size_t max_lines)
+{
+    if (log == NULL) {
+        return -1;
+    }
+
+    char *buf = NULL;
+    size_t length = 0;
+    int64_t log_line = 0;
+
+    if (log_read_lines(log, before, max_lines, &buf, &length, &log_line) != 0) {
+        return -1;
+    }
 
-    int start = 0;
+    if (buf == NULL) {
+        return 0;
+    }
+
+    char *end = buf + length;
+    char *line = buf;
     int count = 0;
 
-    /* start at end and backtrace L lines or to the beginning of buffer */
-    for (start = sz - 1; start >= 0 && count < L; --start) {
-        if (buf[start] == '\n') {
+    while (line < end) {
+        char *newline = memchr(line, '\n', end - line);
+
+        if (newline != NULL) {
+            *newline = '\0';
+        }
+
+        if (*line != '\0') {
+            load_line(self, c_config, line, log_line);
             ++count;
         }
+
+        ++log_line;
+        line = newline != NULL ? newline + 1 : end;
     }
 
-    char *tmp = NULL;
-    const char *line = strtok_r(&buf[start + 1], "\n", &tmp);
+    free(buf);
 
-    if (line == NULL) {
-        free(buf);
+    return count;
+}
+
+/* Loads chat log history and prints it to `self` window.
+ *
+ * Return 0 on success or if log file doesn't exist.
+ * Return -1 on failure.
+ */
+int load_chat_history(struct chatlog *log, ToxWindow *self, const Client_Config *c_config)
+{
+    if (log == NULL) {
+        return -1;
+    }
+
+    if (*log->path == 0) {
         return -1;
     }
 
-    while (line != NULL && count--) {
-        load_line(self, c_config, line);
-        line = strtok_r(NULL, "\n", &tmp);
+    if (log->index.origin <= 0) {
+        return 0;
     }
 
-    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, YELLOW, "---");
+    /* Number of history lines to load: must not be larger than MAX_LINE_INFO_QUEUE - 2 */
+    const int L = MIN(MAX_LINE_INFO_QUEUE - 2, c_config->history_size);
 
-    free(buf);
+    const int loaded = log_load_page(log, self, c_config, log_next_line(log), L);
+
+    if (loaded < 0) {
+        return -1;
+    }
+
+    if (loaded == 0) {
+        return 0;
+    }
+
+    line_info_add(self, c_config, false, NULL, NULL, SYS_MSG, 0, YELLOW, "---");
 
     return 0;
 }
 
+int log_search_history(struct chatlog *log, const char *query, int64_t before, int64_t *line, size_t *total)
+{
+    if (log == NULL || *log->path == '\0') {
+        return -1;
+    }
+
+    if (log->stream != NULL && log_writer_sync(log->stream) != 0) {
+        log->index.valid = false;
+    }
+
+    struct log_search *search = &log->search;
+
+    if (log_search_open(search, log->path) != 0 || log_search_update(search, log->path) != 0) {
+        return -1;
+    }
+
+    /* The search index numbers lines from the start of the file, and the log index from its origin */
+    if (!log->index.valid || search->indexed_end != (uint64_t)log->index.end) {
+        return -1;
+    }
+
+    const int64_t origin_line = (int64_t)search->line_count - log->index.next_line;
+    const int64_t search_before = before + origin_line;
+
+    if (search_before <= 0) {
+        return 0;
+    }
+
+    uint32_t result;
+    const int found = log_search_query(search, query, (uint32_t)MIN(search_before, UINT32_MAX), &result, 1, total);
+
+    if (found < 0) {
+        return -2;
+    }
+
+    if (found == 0) {
+        return 0;
+    }
+
+    *line = (int64_t)result - origin_line;
+
+    return 1;
+}
+
+/* Renames the search index of the log at `src` along with the log. */
+static void rename_log_search_index(const char *src, const char *dest, bool replaced)
+{
+    char src_index[TOXIC_MAX_PATH_LENGTH + sizeof(LOG_SEARCH_SUFFIX)];
+    char dest_index[TOXIC_MAX_PATH_LENGTH + sizeof(LOG_SEARCH_SUFFIX)];
+
+    snprintf(src_index, sizeof(src_index), "%s%s", src, LOG_SEARCH_SUFFIX);
+    snprintf(dest_index, sizeof(dest_index), "%s%s", dest, LOG_SEARCH_SUFFIX);
+
+    /* a merge left running by log_search_close() may still be writing the index */
+    log_search_wait();
+
+    if (!file_exists(src_index)) {
+        return;
+    }
+
+    if (replaced || rename(src_index, dest_index) != 0) {
+        remove(src_index);
+    }
+}
+
 /* Renames chatlog file `src` to `dest`.
  *
  * Return 0 on success or if no log exists.
@@ -643,6 +1011,10 @@ int rename_logfile(Windows *windows, const Client_Config *c_config, const Paths
         log_disable(log);
     }
 
+    if (log != NULL) {
+        log_search_close(&log->search, log->path);
+    }
+
     char newpath[TOXIC_MAX_PATH_LENGTH];
     char oldpath[TOXIC_MAX_PATH_LENGTH];
 
@@ -652,6 +1024,12 @@ int rename_logfile(Windows *windows, const Client_Config *c_config, const Paths
 
     if (!file_exists(oldpath)) {  // still need to rename path
         init_logging_session(c_config, paths, dest, selfkey, otherkey, log, LOG_TYPE_CHAT);
+
+        if (log != NULL) {
+            log_index_init(log);
+            log_search_open(&log->search, log->path);
+        }
+
         return 0;
     }
 
@@ -661,7 +1039,9 @@ int rename_logfile(Windows *windows, const Client_Config *c_config, const Paths
         goto on_error;
     }
 
-    if (file_exists(newpath)) {
+    const bool replaced = file_exists(newpath);
+
+    if (replaced) {
         if (remove(oldpath) != 0) {
             fprintf(stderr, "Warning: remove() failed to remove log path `%s`\n", oldpath);
         }
@@ -669,10 +1049,19 @@ int rename_logfile(Windows *windows, const Client_Config *c_config, const Paths
         goto on_error;
     }
 
+    rename_log_search_index(oldpath, newpath, replaced);
+
     if (log != NULL) {
         memcpy(log->path, newpath, new_path_len);
         log->path[new_path_len] = '\0';
 
+        /* the lines in the file we're switching to are not the ones we indexed */
+        if (replaced) {
+            log_index_init(log);
+        }
+
+        log_search_open(&log->search, log->path);
+
         if (log_on) {
             log_enable(log);
         }
@@ -682,6 +1071,10 @@ int rename_logfile(Windows *windows, const Client_Config *c_config, const Paths
 
 on_error:
 
+    if (log != NULL) {
+        log_search_open(&log->search, log->path);
+    }
+
     if (log_on) {
         log_enable(log);
     }
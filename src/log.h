@@ -9,15 +9,58 @@
 #ifndef LOG_H
 #define LOG_H
 
+#include <stdio.h>
+#include <time.h>
+
+#include "log_search.h"
+#include "log_writer.h"
 #include "paths.h"
 #include "settings.h"
+#include "windows.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Number of lines between the offsets recorded by a log index */
+#define LOG_INDEX_STRIDE 64
+
+/*
+ * Offset index over the lines of a log file, used to page old history in from disk.
+ *
+ * Lines are numbered relative to the end of the file at the time the log was initialized: line 0
+ * is the first line appended afterwards, and line -1 is the last line that was already in the file.
+ * Lines at or after the origin are indexed by `write_to_log()` as they're appended, and lines before it
+ * are indexed lazily, backwards, the first time they're paged in. In both directions the offset of every
+ * LOG_INDEX_STRIDE'th line is recorded, so no part of the file is ever scanned twice.
+ */
+struct log_index {
+    off_t   origin;       /* offset of line 0 */
+    off_t   end;          /* offset of the end of the file */
+    int64_t next_line;    /* number of the next line to be appended */
+
+    off_t   *fwd;         /* fwd[i] is the offset of line i * LOG_INDEX_STRIDE */
+    size_t  fwd_count;
+    size_t  fwd_size;
+
+    off_t   *back;        /* back[i] is the offset of line -(i + 1) * LOG_INDEX_STRIDE */
+    size_t  back_count;
+    size_t  back_size;
+
+    off_t   scan_pos;     /* lines before this offset have not been indexed yet */
+    int64_t scan_line;    /* number of the line that starts at `scan_pos` */
+    bool    scan_done;    /* true once the backwards scan has reached the start of the file */
+
+    bool    valid;        /* false if the index could not be kept up to date */
+};
 
 struct chatlog {
-    FILE *file;
-    time_t lastwrite;
+    struct log_writer_stream *stream;
     char path[TOXIC_MAX_PATH_LENGTH];
     bool log_on;    /* specific to current chat window */
     uint32_t bytes_written;
+    struct log_index index;
+    struct log_search search;
 };
 
 typedef enum Log_Type {
@@ -70,6 +113,9 @@ int write_to_log(struct chatlog *log, const Client_Config *c_config, const char
  */
 int log_enable(struct chatlog *log);
 
+/* Frees all memory associated with `log`, closing the file if it's open. */
+void log_free(struct chatlog *log);
+
 /* Disables logging for specified log and closes file.
  *
  * Calling this function on a log that's already disabled has no effect.
@@ -83,6 +129,56 @@ void log_disable(struct chatlog *log);
  */
 int load_chat_history(struct chatlog *log, ToxWindow *self, const Client_Config *c_config);
 
+/**
+ * Resets the index of `log` so that line 0 starts at the current end of the file at `log->path`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ * @private
+ */
+int log_index_init(struct chatlog *log);
+
+/* Returns the number of the next line that will be appended to `log`. */
+int64_t log_next_line(const struct chatlog *log);
+
+/* Loads up to `max_lines` lines of history that precede line number `before` from the log and adds
+ * them to `self` window.
+ *
+ * Return the number of lines loaded on success.
+ * Return -1 on failure.
+ */
+int log_load_page(struct chatlog *log, ToxWindow *self, const Client_Config *c_config, int64_t before,
+                  size_t max_lines);
+
+/**
+ * Reads up to `max_lines` lines of the log that precede line number `before`. Lines that haven't been
+ * indexed yet are found by reading the file backwards in fixed-size blocks, so the cost is proportional
+ * to the number of lines read rather than to the size of the file.
+ *
+ * On success `*lines` is set to a NUL-terminated, newline-separated buffer holding the lines, which the
+ * caller must free, `*length` to its length and `*first_line` to the number of the first line in it.
+ * If there are no lines before `before`, `*lines` is set to NULL.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ * @private
+ */
+int log_read_lines(struct chatlog *log, int64_t before, size_t max_lines, char **lines, size_t *length,
+                   int64_t *first_line);
+
+/* Finds the newest line of the log before line number `before` that contains every word in `query`.
+ * Any lines that the search index is missing are indexed first.
+ *
+ * On success `*line` is set to the number of the line that was found. If `total` is non-NULL it's
+ * set to the number of matching lines in the whole log, which costs a walk over all of their postings.
+ *
+ * Return 1 if a line was found.
+ * Return 0 if there are no matching lines before `before`.
+ * Return -1 on failure.
+ * Return -2 if `query` doesn't contain any searchable words.
+ */
+int log_search_history(struct chatlog *log, const char *query, int64_t before, int64_t *line, size_t *total);
+
 /* Renames chatlog file `src` to `dest`.
  *
  * Return 0 on success or if no log exists.
@@ -91,4 +187,9 @@ int load_chat_history(struct chatlog *log, ToxWindow *self, const Client_Config
 int rename_logfile(Windows *windows, const Client_Config *c_config, const Paths *paths, const char *src,
                    const char *dest, const char *selfkey, const char *otherkey, uint16_t window_id);
 
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
 #endif /* LOG_H */
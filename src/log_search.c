@@ -0,0 +1,1239 @@
+/*  log_search.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE    /* needed for fseeko() and getline() */
+#endif
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log_search.h"
+
+#define LOG_SEARCH_MAGIC "TOXICIDX"
+#define LOG_SEARCH_VERSION 1
+
+/* Header of an index file. The file is a local cache in host byte order; an index that doesn't
+ * validate (including one written on a machine with a different byte order) is rebuilt from the log.
+ */
+struct log_search_header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t term_count;
+    uint64_t posting_count;
+    uint64_t indexed_end;
+    uint32_t line_count;
+    uint32_t reserved;
+};
+
+/* If the index is behind the log by at most this many bytes when it's opened, it's caught up right
+ * away. Otherwise that's left to the first query.
+ */
+#define LOG_SEARCH_CATCH_UP_LIMIT (1024 * 1024)
+
+/* Pending postings are merged into the index file once there are at least this many of them, and at
+ * least 1 / LOG_SEARCH_FLUSH_RATIO as many as there are in the file.
+ */
+#define LOG_SEARCH_FLUSH_MIN (1 << 20)
+#define LOG_SEARCH_FLUSH_RATIO 4
+
+/* The "{hint} [timestamp]" prefix of a log line isn't indexed. We give up looking for its end after
+ * this many bytes.
+ */
+#define LOG_SEARCH_PREFIX_LIMIT 128
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static void log_search_index_path(char *buf, size_t buf_size, const char *log_path)
+{
+    snprintf(buf, buf_size, "%s%s", log_path, LOG_SEARCH_SUFFIX);
+}
+
+/* Bytes that make up terms: ASCII letters, digits and underscores, plus all non-ASCII bytes so that
+ * UTF-8 encoded words are kept whole.
+ */
+static bool log_search_is_term_byte(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+/* State of the tokenizer as it moves through a line, which may be fed to it in several pieces. */
+struct log_search_tokenizer {
+    uint64_t hash;
+    size_t   term_len;
+    size_t   line_pos;
+    bool     in_prefix;
+    bool     skip_prefix;
+
+    /* terms are handed to this function as they're completed */
+    void (*on_term)(void *ctx, uint64_t hash);
+    void *ctx;
+};
+
+static void tokenizer_init(struct log_search_tokenizer *tok, bool skip_prefix, void (*on_term)(void *, uint64_t),
+                           void *ctx)
+{
+    tok->hash = FNV_OFFSET_BASIS;
+    tok->term_len = 0;
+    tok->line_pos = 0;
+    tok->in_prefix = false;
+    tok->skip_prefix = skip_prefix;
+    tok->on_term = on_term;
+    tok->ctx = ctx;
+}
+
+static void tokenizer_end_term(struct log_search_tokenizer *tok)
+{
+    if (tok->term_len >= LOG_SEARCH_MIN_TERM_LENGTH) {
+        tok->on_term(tok->ctx, tok->hash != 0 ? tok->hash : 1);
+    }
+
+    tok->hash = FNV_OFFSET_BASIS;
+    tok->term_len = 0;
+}
+
+static void tokenizer_feed(struct log_search_tokenizer *tok, const char *buf, size_t length)
+{
+    for (size_t i = 0; i < length; ++i, ++tok->line_pos) {
+        const unsigned char c = buf[i];
+
+        if (tok->line_pos == 0 && c == '{' && tok->skip_prefix) {
+            tok->in_prefix = true;
+        }
+
+        if (tok->in_prefix) {
+            if (c == ']' || tok->line_pos >= LOG_SEARCH_PREFIX_LIMIT) {
+                tok->in_prefix = false;
+            }
+
+            continue;
+        }
+
+        if (!log_search_is_term_byte(c)) {
+            tokenizer_end_term(tok);
+            continue;
+        }
+
+        if (tok->term_len < LOG_SEARCH_MAX_TERM_LENGTH) {
+            tok->hash ^= (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+            tok->hash *= FNV_PRIME;
+            ++tok->term_len;
+        }
+    }
+}
+
+static void tokenizer_end_line(struct log_search_tokenizer *tok)
+{
+    tokenizer_end_term(tok);
+    tok->line_pos = 0;
+    tok->in_prefix = false;
+}
+
+static struct log_search_pending *pending_find(const struct log_search_table *table, uint64_t hash)
+{
+    if (table->size == 0) {
+        return NULL;
+    }
+
+    const size_t mask = table->size - 1;
+
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        struct log_search_pending *entry = &table->entries[i];
+
+        if (entry->hash == hash || entry->hash == 0) {
+            return entry;
+        }
+    }
+}
+
+static bool pending_reserve(struct log_search_table *table)
+{
+    if ((table->terms + 1) * 4 <= table->size * 3) {
+        return true;
+    }
+
+    const size_t new_size = table->size > 0 ? table->size * 2 : 1024;
+    struct log_search_pending *new_entries = calloc(new_size, sizeof(struct log_search_pending));
+
+    if (new_entries == NULL) {
+        return false;
+    }
+
+    struct log_search_pending *old_entries = table->entries;
+    const size_t old_size = table->size;
+
+    table->entries = new_entries;
+    table->size = new_size;
+
+    for (size_t i = 0; i < old_size; ++i) {
+        if (old_entries[i].hash != 0) {
+            *pending_find(table, old_entries[i].hash) = old_entries[i];
+        }
+    }
+
+    free(old_entries);
+
+    return true;
+}
+
+static void pending_clear(struct log_search_table *table)
+{
+    for (size_t i = 0; i < table->size; ++i) {
+        free(table->entries[i].lines);
+    }
+
+    free(table->entries);
+
+    table->entries = NULL;
+    table->size = 0;
+    table->terms = 0;
+    table->postings = 0;
+}
+
+/* Adds the line currently being indexed to the postings of term `hash`. */
+static void pending_add(void *ctx, uint64_t hash)
+{
+    struct log_search *search = ctx;
+    struct log_search_table *table = &search->pending;
+    const uint32_t line = search->line_count;
+
+    if (!pending_reserve(table)) {
+        return;
+    }
+
+    struct log_search_pending *entry = pending_find(table, hash);
+
+    if (entry->hash == 0) {
+        entry->hash = hash;
+        ++table->terms;
+    }
+
+    /* a term that appears several times in a line is only recorded once */
+    if (entry->count > 0 && entry->lines[entry->count - 1] == line) {
+        return;
+    }
+
+    if (entry->count == entry->size) {
+        const uint32_t new_size = entry->size > 0 ? entry->size * 2 : 4;
+        uint32_t *new_lines = realloc(entry->lines, new_size * sizeof(uint32_t));
+
+        if (new_lines == NULL) {
+            return;
+        }
+
+        entry->lines = new_lines;
+        entry->size = new_size;
+    }
+
+    entry->lines[entry->count] = line;
+    ++entry->count;
+    ++table->postings;
+}
+
+static void log_search_unmap(struct log_search *search)
+{
+    if (search->map != NULL) {
+        munmap(search->map, search->map_size);
+    }
+
+    search->map = NULL;
+    search->map_size = 0;
+    search->terms = NULL;
+    search->term_count = 0;
+    search->postings = NULL;
+    search->posting_count = 0;
+    search->indexed_end = 0;
+    search->line_count = 0;
+}
+
+/* Maps the index file at `path` and validates it against the log, which is `log_size` bytes long.
+ * If `log_size` is negative the index isn't checked against the log.
+ *
+ * Return true if the index was mapped.
+ */
+static bool log_search_map(struct log_search *search, const char *path, off_t log_size)
+{
+    log_search_unmap(search);
+
+    const int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct log_search_header)) {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    const struct log_search_header *hdr = map;
+    const uint64_t expected_size = sizeof(struct log_search_header)
+                                   + (uint64_t)hdr->term_count * sizeof(struct log_search_term)
+                                   + hdr->posting_count * sizeof(uint32_t);
+
+    if (memcmp(hdr->magic, LOG_SEARCH_MAGIC, sizeof(hdr->magic)) != 0 || hdr->version != LOG_SEARCH_VERSION
+            || expected_size != (uint64_t)st.st_size || (log_size >= 0 && hdr->indexed_end > (uint64_t)log_size)) {
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    search->map = map;
+    search->map_size = st.st_size;
+    search->terms = (const struct log_search_term *)(hdr + 1);
+    search->term_count = hdr->term_count;
+    search->postings = (const uint32_t *)(search->terms + hdr->term_count);
+    search->posting_count = hdr->posting_count;
+    search->indexed_end = hdr->indexed_end;
+    search->line_count = hdr->line_count;
+
+    return true;
+}
+
+static off_t log_search_file_size(const char *path)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+
+    return st.st_size;
+}
+
+/* Returns the number of bytes of the log covered by the mapped index file. */
+static uint64_t log_search_file_end(const struct log_search *search)
+{
+    return search->map != NULL ? ((const struct log_search_header *)search->map)->indexed_end : 0;
+}
+
+/* Pending postings being merged into an index file by the merge thread. */
+struct log_search_merge {
+    char     path[PATH_MAX];           /* path of the index file */
+    struct log_search_table pending;
+    bool     has_base;                 /* true if the postings are merged with the existing index file */
+    uint64_t base_end;                 /* bytes of the log that the existing index file must cover */
+    uint64_t indexed_end;
+    uint32_t line_count;
+
+    int      result;
+    bool     done;
+    bool     detached;                 /* nobody waits for the result, so the merge thread frees it */
+
+    struct log_search_merge *next;
+};
+
+static struct log_search_merger {
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;    /* signalled when a merge is queued or the thread should stop */
+    pthread_cond_t  idle;    /* signalled when a merge is done */
+    pthread_t       tid;
+    bool            running;
+    bool            stop;
+    bool            busy;    /* true while the thread is doing a merge */
+
+    struct log_search_merge *head;
+    struct log_search_merge **tail;
+} merger = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .idle = PTHREAD_COND_INITIALIZER,
+    .tail = &merger.head,
+};
+
+static void log_search_merge_free(struct log_search_merge *merge)
+{
+    pending_clear(&merge->pending);
+    free(merge);
+}
+
+/* Moves the pending postings of `search` to a new merge into the index file of the log at
+ * `log_path`. `base_end` is the number of bytes of the log that the index file will cover when the
+ * merge is done, if `has_base` is true.
+ *
+ * Returns NULL on failure, in which case the pending postings are left where they are.
+ */
+static struct log_search_merge *log_search_merge_new(struct log_search *search, const char *log_path, bool has_base,
+        uint64_t base_end)
+{
+    struct log_search_merge *merge = calloc(1, sizeof(struct log_search_merge));
+
+    if (merge == NULL) {
+        return NULL;
+    }
+
+    log_search_index_path(merge->path, sizeof(merge->path), log_path);
+    merge->pending = search->pending;
+    merge->has_base = has_base;
+    merge->base_end = base_end;
+    merge->indexed_end = search->indexed_end;
+    merge->line_count = search->line_count;
+
+    memset(&search->pending, 0, sizeof(search->pending));
+
+    return merge;
+}
+
+/* Queues `merge` for the merge thread.
+ *
+ * Return true if it was queued.
+ * Return false if the merge thread isn't running.
+ */
+static bool log_search_merge_queue(struct log_search_merge *merge)
+{
+    pthread_mutex_lock(&merger.lock);
+
+    if (!merger.running) {
+        pthread_mutex_unlock(&merger.lock);
+        return false;
+    }
+
+    merge->next = NULL;
+    *merger.tail = merge;
+    merger.tail = &merge->next;
+
+    pthread_cond_signal(&merger.wake);
+    pthread_mutex_unlock(&merger.lock);
+
+    return true;
+}
+
+/* Takes the merge of the pending postings of `search` back from the merge thread once it's done,
+ * waiting for it if `wait` is true, and maps the index file it wrote.
+ */
+static void log_search_merge_finish(struct log_search *search, bool wait)
+{
+    struct log_search_merge *merge = search->merge;
+
+    if (merge == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&merger.lock);
+
+    while (wait && !merge->done) {
+        pthread_cond_wait(&merger.idle, &merger.lock);
+    }
+
+    const bool done = merge->done;
+
+    pthread_mutex_unlock(&merger.lock);
+
+    if (!done) {
+        return;
+    }
+
+    search->merge = NULL;
+
+    const uint64_t indexed_end = search->indexed_end;
+    const uint32_t line_count = search->line_count;
+
+    if (merge->result != 0) {
+        /* The index file is unchanged; the lines it's missing are read back from the log by the next update */
+        pending_clear(&search->pending);
+        search->indexed_end = log_search_file_end(search);
+        search->line_count = search->map != NULL ? ((const struct log_search_header *)search->map)->line_count : 0;
+    } else if (!log_search_map(search, merge->path, -1) || search->indexed_end != merge->indexed_end
+               || search->line_count != merge->line_count) {
+        /* We lost the index that was just written; the next update will rebuild it */
+        pending_clear(&search->pending);
+        log_search_unmap(search);
+    } else {
+        /* the lines added since the merge was queued are still pending */
+        search->indexed_end = indexed_end;
+        search->line_count = line_count;
+    }
+
+    log_search_merge_free(merge);
+}
+
+/* Leaves the merge of the pending postings of `search`, if there is one, to the merge thread. */
+static void log_search_merge_detach(struct log_search *search)
+{
+    struct log_search_merge *merge = search->merge;
+
+    if (merge == NULL) {
+        return;
+    }
+
+    search->merge = NULL;
+
+    pthread_mutex_lock(&merger.lock);
+
+    const bool done = merge->done;
+    merge->detached = true;
+
+    pthread_mutex_unlock(&merger.lock);
+
+    if (done) {
+        log_search_merge_free(merge);
+    }
+}
+
+int log_search_open(struct log_search *search, const char *log_path)
+{
+    if (search->open) {
+        return 0;
+    }
+
+    memset(search, 0, sizeof(struct log_search));
+
+    char path[PATH_MAX];
+    log_search_index_path(path, sizeof(path), log_path);
+
+    const off_t log_size = log_search_file_size(log_path);
+
+    log_search_map(search, path, log_size > 0 ? log_size : 0);
+    search->open = true;
+
+    if (log_size > 0 && (uint64_t)log_size - search->indexed_end <= LOG_SEARCH_CATCH_UP_LIMIT) {
+        return log_search_update(search, log_path);
+    }
+
+    return 0;
+}
+
+void log_search_close(struct log_search *search, const char *log_path)
+{
+    if (!search->open) {
+        return;
+    }
+
+    log_search_merge_finish(search, false);
+
+    /* if a merge is still being done, the rest is merged into the index file it writes */
+    const bool has_base = search->merge != NULL || search->map != NULL;
+    const uint64_t base_end = search->merge != NULL ? search->merge->indexed_end : log_search_file_end(search);
+
+    if (search->pending.postings > 0 || search->indexed_end != base_end) {
+        struct log_search_merge *merge = log_search_merge_new(search, log_path, has_base, base_end);
+
+        if (merge != NULL) {
+            merge->detached = true;
+
+            if (!log_search_merge_queue(merge)) {
+                search->pending = merge->pending;
+                free(merge);
+                merge = NULL;
+            }
+        }
+
+        if (merge == NULL) {
+            log_search_flush(search, log_path);
+        }
+    }
+
+    log_search_merge_detach(search);
+
+    pending_clear(&search->pending);
+    log_search_unmap(search);
+
+    search->open = false;
+}
+
+static bool log_search_should_flush(const struct log_search *search)
+{
+    return search->pending.postings >= LOG_SEARCH_FLUSH_MIN
+           && search->pending.postings >= search->posting_count / LOG_SEARCH_FLUSH_RATIO;
+}
+
+void log_search_add(struct log_search *search, const char *log_path, off_t offset, const char *head,
+                    size_t head_len, const char *tail, size_t tail_len)
+{
+    if (!search->open || offset < 0 || (uint64_t)offset != search->indexed_end) {
+        return;
+    }
+
+    struct log_search_tokenizer tok;
+    tokenizer_init(&tok, true, pending_add, search);
+
+    tokenizer_feed(&tok, head, head_len);
+    size_t line_len = head_len;
+
+    for (size_t i = 0; tail != NULL && i < tail_len;) {
+        const char *newline = memchr(tail + i, '\n', tail_len - i);
+        const size_t len = newline != NULL ? (size_t)(newline - (tail + i)) : tail_len - i;
+
+        tokenizer_feed(&tok, tail + i, len);
+        line_len += len;
+        i += len;
+
+        if (newline != NULL) {
+            tokenizer_end_line(&tok);
+            search->indexed_end += line_len + 1;
+            ++search->line_count;
+            line_len = 0;
+            ++i;
+        }
+    }
+
+    tokenizer_end_line(&tok);
+    search->indexed_end += line_len + 1;
+    ++search->line_count;
+
+    if (log_search_should_flush(search)) {
+        log_search_merge(search, log_path);
+    }
+}
+
+int log_search_update(struct log_search *search, const char *log_path)
+{
+    if (!search->open) {
+        return -1;
+    }
+
+    const off_t log_size = log_search_file_size(log_path);
+
+    if (log_size < 0) {
+        return -1;
+    }
+
+    /* the log was truncated or replaced; start over */
+    if ((uint64_t)log_size < search->indexed_end) {
+        log_search_merge_finish(search, true);
+        pending_clear(&search->pending);
+        log_search_unmap(search);
+    }
+
+    if ((uint64_t)log_size == search->indexed_end) {
+        return 0;
+    }
+
+    FILE *fp = fopen(log_path, "r");
+
+    if (fp == NULL) {
+        return -1;
+    }
+
+    if (fseeko(fp, search->indexed_end, SEEK_SET) != 0) {
+        fclose(fp);
+        return -1;
+    }
+
+    struct log_search_tokenizer tok;
+    tokenizer_init(&tok, true, pending_add, search);
+
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+
+    /* a line without a newline may still be being written, so it's left for the next update */
+    while ((len = getline(&line, &line_size, fp)) > 0 && line[len - 1] == '\n') {
+        tokenizer_feed(&tok, line, len - 1);
+        tokenizer_end_line(&tok);
+
+        search->indexed_end += len;
+        ++search->line_count;
+
+        if (log_search_should_flush(search)) {
+            log_search_merge(search, log_path);
+        }
+    }
+
+    free(line);
+    fclose(fp);
+
+    return 0;
+}
+
+static int pending_cmp(const void *a, const void *b)
+{
+    const uint64_t ha = (*(const struct log_search_pending *const *)a)->hash;
+    const uint64_t hb = (*(const struct log_search_pending *const *)b)->hash;
+
+    return ha < hb ? -1 : ha > hb;
+}
+
+/* Writes the terms of the mapped index merged with the pending terms in `pending` to `fp`. If
+ * `postings` is true the postings are written, otherwise the directory is.
+ */
+static bool log_search_write_merged(const struct log_search *search, struct log_search_pending *const *pending,
+                                    size_t num_pending, FILE *fp, bool postings)
+{
+    size_t i = 0;
+    size_t j = 0;
+    uint64_t first = 0;
+
+    while (i < search->term_count || j < num_pending) {
+        const struct log_search_term *base = NULL;
+        const struct log_search_pending *added = NULL;
+
+        if (j == num_pending || (i < search->term_count && search->terms[i].hash < pending[j]->hash)) {
+            base = &search->terms[i++];
+        } else if (i == search->term_count || pending[j]->hash < search->terms[i].hash) {
+            added = pending[j++];
+        } else {
+            base = &search->terms[i++];
+            added = pending[j++];
+        }
+
+        const uint32_t base_count = base != NULL ? base->count : 0;
+        const uint32_t new_count = added != NULL ? added->count : 0;
+
+        if (postings) {
+            /* every pending line comes after every line in the file, so the merged postings stay sorted */
+            if (base_count > 0 && fwrite(&search->postings[base->first], sizeof(uint32_t), base_count, fp) != base_count) {
+                return false;
+            }
+
+            if (new_count > 0 && fwrite(added->lines, sizeof(uint32_t), new_count, fp) != new_count) {
+                return false;
+            }
+        } else {
+            const struct log_search_term term = {
+                .hash = base != NULL ? base->hash : added->hash,
+                .first = first,
+                .count = base_count + new_count,
+            };
+
+            if (fwrite(&term, sizeof(term), 1, fp) != 1) {
+                return false;
+            }
+        }
+
+        first += base_count + new_count;
+    }
+
+    return true;
+}
+
+/* Writes the terms of the index `base` merged with the postings in `table` to the index file at
+ * `path`, covering `indexed_end` bytes and `line_count` lines of the log.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+static int log_search_write(const struct log_search *base, const struct log_search_table *table, const char *path,
+                            uint64_t indexed_end, uint32_t line_count)
+{
+    struct log_search_pending **pending = malloc((table->terms + 1) * sizeof(struct log_search_pending *));
+
+    if (pending == NULL) {
+        return -1;
+    }
+
+    size_t num_pending = 0;
+
+    for (size_t i = 0; i < table->size; ++i) {
+        if (table->entries[i].hash != 0) {
+            pending[num_pending] = &table->entries[i];
+            ++num_pending;
+        }
+    }
+
+    qsort(pending, num_pending, sizeof(struct log_search_pending *), pending_cmp);
+
+    uint32_t term_count = 0;
+
+    for (size_t i = 0, j = 0; i < base->term_count || j < num_pending; ++term_count) {
+        if (j == num_pending || (i < base->term_count && base->terms[i].hash < pending[j]->hash)) {
+            ++i;
+        } else if (i == base->term_count || pending[j]->hash < base->terms[i].hash) {
+            ++j;
+        } else {
+            ++i;
+            ++j;
+        }
+    }
+
+    char tmp_path[PATH_MAX + 4];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "wb");
+
+    if (fp == NULL) {
+        free(pending);
+        return -1;
+    }
+
+    struct log_search_header hdr = {
+        .version = LOG_SEARCH_VERSION,
+        .term_count = term_count,
+        .posting_count = base->posting_count + table->postings,
+        .indexed_end = indexed_end,
+        .line_count = line_count,
+    };
+    memcpy(hdr.magic, LOG_SEARCH_MAGIC, sizeof(hdr.magic));
+
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1
+              && log_search_write_merged(base, pending, num_pending, fp, false)
+              && log_search_write_merged(base, pending, num_pending, fp, true)
+              && fflush(fp) == 0
+              && fsync(fileno(fp)) == 0;
+
+    ok = fclose(fp) == 0 && ok;
+    free(pending);
+
+    if (!ok || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+int log_search_flush(struct log_search *search, const char *log_path)
+{
+    if (!search->open) {
+        return -1;
+    }
+
+    log_search_merge_finish(search, true);
+
+    if (search->pending.postings == 0 && log_search_file_end(search) == search->indexed_end) {
+        return 0;
+    }
+
+    char path[PATH_MAX];
+    log_search_index_path(path, sizeof(path), log_path);
+
+    if (log_search_write(search, &search->pending, path, search->indexed_end, search->line_count) != 0) {
+        return -1;
+    }
+
+    const uint64_t indexed_end = search->indexed_end;
+    const uint32_t line_count = search->line_count;
+
+    pending_clear(&search->pending);
+
+    /* The log may still have buffered writes that the index already covers, so its size can't be checked */
+    if (!log_search_map(search, path, -1)) {
+        /* We lost the index we just wrote; the next update will rebuild it */
+        search->indexed_end = 0;
+        search->line_count = 0;
+        return -1;
+    }
+
+    if (search->indexed_end != indexed_end || search->line_count != line_count) {
+        return -1;
+    }
+
+    return 0;
+}
+
+void log_search_merge(struct log_search *search, const char *log_path)
+{
+    if (!search->open) {
+        return;
+    }
+
+    log_search_merge_finish(search, false);
+
+    /* the postings pending now are merged once the merge that's being done is finished */
+    if (search->merge != NULL) {
+        return;
+    }
+
+    if (search->pending.postings == 0 && log_search_file_end(search) == search->indexed_end) {
+        return;
+    }
+
+    struct log_search_merge *merge = log_search_merge_new(search, log_path, search->map != NULL,
+                                     log_search_file_end(search));
+
+    if (merge != NULL && log_search_merge_queue(merge)) {
+        search->merge = merge;
+        return;
+    }
+
+    if (merge != NULL) {
+        search->pending = merge->pending;
+        free(merge);
+    }
+
+    log_search_flush(search, log_path);
+}
+
+/* Does the merges queued by log_search_merge() and log_search_close(), one at a time. */
+static void *log_search_merge_thread(void *data)
+{
+    (void) data;
+
+    pthread_mutex_lock(&merger.lock);
+
+    while (true) {
+        while (merger.head == NULL && !merger.stop) {
+            pthread_cond_wait(&merger.wake, &merger.lock);
+        }
+
+        /* merges that are still queued when the thread is stopped are done first */
+        if (merger.head == NULL) {
+            break;
+        }
+
+        struct log_search_merge *merge = merger.head;
+        merger.head = merge->next;
+
+        if (merger.head == NULL) {
+            merger.tail = &merger.head;
+        }
+
+        merger.busy = true;
+
+        pthread_mutex_unlock(&merger.lock);
+
+        struct log_search base = {0};
+        int result = 0;
+
+        /* the index file may have been replaced since the merge was queued */
+        if (merge->has_base && (!log_search_map(&base, merge->path, -1) || base.indexed_end != merge->base_end)) {
+            result = -1;
+        } else {
+            result = log_search_write(&base, &merge->pending, merge->path, merge->indexed_end, merge->line_count);
+        }
+
+        log_search_unmap(&base);
+
+        pthread_mutex_lock(&merger.lock);
+
+        merger.busy = false;
+        merge->result = result;
+        merge->done = true;
+
+        if (merge->detached) {
+            log_search_merge_free(merge);
+        }
+
+        pthread_cond_broadcast(&merger.idle);
+    }
+
+    pthread_mutex_unlock(&merger.lock);
+
+    return NULL;
+}
+
+int log_search_start(void)
+{
+    pthread_mutex_lock(&merger.lock);
+
+    if (merger.running) {
+        pthread_mutex_unlock(&merger.lock);
+        return 0;
+    }
+
+    merger.stop = false;
+
+    if (pthread_create(&merger.tid, NULL, log_search_merge_thread, NULL) != 0) {
+        pthread_mutex_unlock(&merger.lock);
+        return -1;
+    }
+
+    merger.running = true;
+
+    pthread_mutex_unlock(&merger.lock);
+
+    return 0;
+}
+
+void log_search_stop(void)
+{
+    pthread_mutex_lock(&merger.lock);
+
+    if (!merger.running) {
+        pthread_mutex_unlock(&merger.lock);
+        return;
+    }
+
+    merger.stop = true;
+    pthread_cond_signal(&merger.wake);
+
+    pthread_mutex_unlock(&merger.lock);
+
+    pthread_join(merger.tid, NULL);
+
+    pthread_mutex_lock(&merger.lock);
+    merger.running = false;
+    pthread_mutex_unlock(&merger.lock);
+}
+
+void log_search_wait(void)
+{
+    pthread_mutex_lock(&merger.lock);
+
+    while (merger.head != NULL || merger.busy) {
+        pthread_cond_wait(&merger.idle, &merger.lock);
+    }
+
+    pthread_mutex_unlock(&merger.lock);
+}
+
+/* The postings of a query term: the ones in the index file, then the ones being merged into it, then
+ * the pending ones.
+ */
+struct log_search_list {
+    const uint32_t *parts[3];
+    uint32_t counts[3];
+};
+
+static uint32_t list_size(const struct log_search_list *list)
+{
+    return list->counts[0] + list->counts[1] + list->counts[2];
+}
+
+static uint32_t list_get(const struct log_search_list *list, uint32_t i)
+{
+    size_t part = 0;
+
+    while (i >= list->counts[part]) {
+        i -= list->counts[part];
+        ++part;
+    }
+
+    return list->parts[part][i];
+}
+
+static bool list_contains(const struct log_search_list *list, uint32_t line)
+{
+    uint32_t lo = 0;
+    uint32_t hi = list_size(list);
+
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const uint32_t value = list_get(list, mid);
+
+        if (value == line) {
+            return true;
+        }
+
+        if (value < line) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return false;
+}
+
+static void log_search_lookup(const struct log_search *search, uint64_t hash, struct log_search_list *list)
+{
+    memset(list, 0, sizeof(struct log_search_list));
+
+    uint32_t lo = 0;
+    uint32_t hi = search->term_count;
+
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const struct log_search_term *term = &search->terms[mid];
+
+        if (term->hash == hash) {
+            list->parts[0] = &search->postings[term->first];
+            list->counts[0] = term->count;
+            break;
+        }
+
+        if (term->hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const struct log_search_table *tables[2] = {
+        search->merge != NULL ? &search->merge->pending : NULL,
+        &search->pending,
+    };
+
+    for (size_t i = 0; i < 2; ++i) {
+        const struct log_search_pending *entry = tables[i] != NULL ? pending_find(tables[i], hash) : NULL;
+
+        if (entry != NULL && entry->hash == hash) {
+            list->parts[i + 1] = entry->lines;
+            list->counts[i + 1] = entry->count;
+        }
+    }
+}
+
+struct log_search_query_terms {
+    uint64_t hashes[LOG_SEARCH_MAX_QUERY_TERMS];
+    size_t count;
+};
+
+static void query_add_term(void *ctx, uint64_t hash)
+{
+    struct log_search_query_terms *terms = ctx;
+
+    for (size_t i = 0; i < terms->count; ++i) {
+        if (terms->hashes[i] == hash) {
+            return;
+        }
+    }
+
+    if (terms->count < LOG_SEARCH_MAX_QUERY_TERMS) {
+        terms->hashes[terms->count] = hash;
+        ++terms->count;
+    }
+}
+
+int log_search_query(const struct log_search *search, const char *query, uint32_t before, uint32_t *results,
+                     size_t max_results, size_t *total)
+{
+    if (total != NULL) {
+        *total = 0;
+    }
+
+    struct log_search_query_terms terms = {0};
+    struct log_search_tokenizer tok;
+    tokenizer_init(&tok, false, query_add_term, &terms);
+    tokenizer_feed(&tok, query, strlen(query));
+    tokenizer_end_line(&tok);
+
+    if (terms.count == 0) {
+        return -1;
+    }
+
+    struct log_search_list lists[LOG_SEARCH_MAX_QUERY_TERMS];
+    size_t shortest = 0;
+
+    for (size_t i = 0; i < terms.count; ++i) {
+        log_search_lookup(search, terms.hashes[i], &lists[i]);
+
+        if (list_size(&lists[i]) < list_size(&lists[shortest])) {
+            shortest = i;
+        }
+    }
+
+    /* walk the shortest list from the newest line back and look every line up in the others */
+    const struct log_search_list *driver = &lists[shortest];
+    size_t num_results = 0;
+    size_t num_matches = 0;
+    uint32_t start = list_size(driver);
+
+    /* without a total the lines from `before` on don't matter, so start at the newest one before it */
+    if (total == NULL) {
+        uint32_t lo = 0;
+
+        while (lo < start) {
+            const uint32_t mid = lo + (start - lo) / 2;
+
+            if (list_get(driver, mid) < before) {
+                lo = mid + 1;
+            } else {
+                start = mid;
+            }
+        }
+    }
+
+    for (uint32_t i = start; i-- > 0;) {
+        const uint32_t line = list_get(driver, i);
+        bool match = true;
+
+        for (size_t j = 0; j < terms.count && match; ++j) {
+            match = j == shortest || list_contains(&lists[j], line);
+        }
+
+        if (!match) {
+            continue;
+        }
+
+        ++num_matches;
+
+        if (line < before && num_results < max_results) {
+            results[num_results] = line;
+            ++num_results;
+        }
+
+        if (total == NULL && num_results == max_results) {
+            break;
+        }
+    }
+
+    if (total != NULL) {
+        *total = num_matches;
+    }
+
+    return num_results;
+}
+
+int log_search_rebuild(const char *log_path)
+{
+    char path[PATH_MAX];
+    log_search_index_path(path, sizeof(path), log_path);
+
+    if (remove(path) != 0 && access(path, F_OK) == 0) {
+        return -1;
+    }
+
+    struct log_search search = {0};
+
+    if (log_search_open(&search, log_path) != 0) {
+        log_search_close(&search, log_path);
+        return -1;
+    }
+
+    int ret = log_search_update(&search, log_path);
+
+    if (ret == 0) {
+        ret = log_search_flush(&search, log_path);
+    }
+
+    log_search_close(&search, log_path);
+
+    return ret;
+}
+
+int log_search_rebuild_dir(const char *dir)
+{
+    DIR *dp = opendir(dir);
+
+    if (dp == NULL) {
+        return -1;
+    }
+
+    const char *suffix = ".log";
+    const size_t suffix_len = strlen(suffix);
+    const char *sep = dir[0] != '\0' && dir[strlen(dir) - 1] == '/' ? "" : "/";
+
+    int failed = 0;
+    struct dirent *entry;
+
+    while ((entry = readdir(dp)) != NULL) {
+        const size_t name_len = strlen(entry->d_name);
+
+        if (name_len <= suffix_len || strcmp(entry->d_name + name_len - suffix_len, suffix) != 0) {
+            continue;
+        }
+
+        char log_path[PATH_MAX];
+        const int len = snprintf(log_path, sizeof(log_path), "%s%s%s", dir, sep, entry->d_name);
+
+        if (len < 0 || (size_t)len >= sizeof(log_path) - strlen(LOG_SEARCH_SUFFIX ".tmp")) {
+            ++failed;
+            continue;
+        }
+
+        if (log_search_rebuild(log_path) == 0) {
+            printf("Indexed %s\n", log_path);
+        } else {
+            printf("Failed to index %s\n", log_path);
+            ++failed;
+        }
+    }
+
+    closedir(dp);
+
+    return failed;
+}
@@ -0,0 +1,183 @@
+/*  log_search.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef LOG_SEARCH_H
+#define LOG_SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Suffix appended to a log's path to get the path of its search index */
+#define LOG_SEARCH_SUFFIX ".idx"
+
+/* Terms longer than this many bytes are truncated, both when indexed and when queried */
+#define LOG_SEARCH_MAX_TERM_LENGTH 64
+
+/* Terms shorter than this many bytes are not indexed */
+#define LOG_SEARCH_MIN_TERM_LENGTH 2
+
+/* Maximum number of distinct terms in a query */
+#define LOG_SEARCH_MAX_QUERY_TERMS 16
+
+/* A term of the on-disk index and the location of its postings */
+struct log_search_term {
+    uint64_t hash;
+    uint64_t first;    /* index of the term's first posting */
+    uint32_t count;    /* number of postings */
+    uint32_t reserved;
+};
+
+/* Postings that have been added since the on-disk index was last written */
+struct log_search_pending {
+    uint64_t hash;     /* 0 marks an empty slot */
+    uint32_t *lines;
+    uint32_t count;
+    uint32_t size;
+};
+
+/* Hash table of pending postings keyed by term */
+struct log_search_table {
+    struct log_search_pending *entries;
+    size_t size;        /* always zero or a power of two */
+    size_t terms;
+    size_t postings;
+};
+
+/* Pending postings handed to the merge thread. Opaque outside of log_search.c */
+struct log_search_merge;
+
+/*
+ * Inverted index over the lines of a chat log, kept in a file next to the log.
+ *
+ * Every term maps to the sorted list of (zero-based, absolute) numbers of the lines it appears in.
+ * The index covers the first `indexed_end` bytes of the log. Lines appended by `write_to_log()` are
+ * added to an in-memory table while the index is caught up with the log, and any lines it missed
+ * (e.g. after a crash, or for logs written before the index existed) are read back from the log the
+ * next time it's queried. The table is merged into the index file once it grows large enough
+ * relative to it, and when the log is closed.
+ *
+ * If the merge thread is running, merges are done by it: the table is handed over and a new one is
+ * started, and queries look at both until the merged index file replaces the mapped one. Otherwise
+ * merges are done by the thread that triggers them.
+ *
+ * The index file is a header followed by a directory of terms sorted by hash and the postings, and
+ * is memory-mapped so a query only touches the pages of the terms it looks up.
+ */
+struct log_search {
+    void   *map;             /* the mapped index file, or NULL if there is none */
+    size_t map_size;
+
+    const struct log_search_term *terms;
+    uint32_t term_count;
+    const uint32_t *postings;
+    uint64_t posting_count;
+
+    uint64_t indexed_end;    /* number of bytes of the log covered by the index */
+    uint32_t line_count;     /* number of lines of the log covered by the index */
+
+    struct log_search_table pending;
+    struct log_search_merge *merge;    /* postings being merged by the merge thread, or NULL */
+
+    bool   open;
+};
+
+/* Starts the merge thread.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int log_search_start(void);
+
+/* Finishes all queued merges and stops the merge thread. */
+void log_search_stop(void);
+
+/* Waits until the merge thread has finished all queued merges, e.g. before an index file is moved. */
+void log_search_wait(void);
+
+/* Opens the search index of the log at `log_path`. If the index is behind the log by a small
+ * amount, the missing lines are indexed right away so that appended lines can be indexed as they're
+ * written.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int log_search_open(struct log_search *search, const char *log_path);
+
+/* Writes any pending postings to the index file of the log at `log_path`, in the background if the
+ * merge thread is running, and frees all memory associated with `search`.
+ */
+void log_search_close(struct log_search *search, const char *log_path);
+
+/* Indexes a line that was appended to the log at byte `offset`. The line consists of `head` followed
+ * by `tail`, which may be NULL. `tail` may contain newlines, in which case every line it spans is
+ * indexed.
+ *
+ * Lines that don't start where the index ends are ignored; they'll be read back from the log by
+ * `log_search_update()`.
+ */
+void log_search_add(struct log_search *search, const char *log_path, off_t offset, const char *head,
+                    size_t head_len, const char *tail, size_t tail_len);
+
+/* Indexes any complete lines in the log at `log_path` that aren't covered by the index yet.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int log_search_update(struct log_search *search, const char *log_path);
+
+/* Merges pending postings into the index file of the log at `log_path`, waiting for any merge that
+ * the merge thread is doing first.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int log_search_flush(struct log_search *search, const char *log_path);
+
+/* Hands pending postings to the merge thread to be merged into the index file of the log at
+ * `log_path`, unless it's already merging postings of `search`. If the merge thread isn't running
+ * this is the same as log_search_flush().
+ */
+void log_search_merge(struct log_search *search, const char *log_path);
+
+/* Finds the lines that contain every term in `query`, ignoring ASCII case.
+ *
+ * Up to `max_results` of the matching lines with a number less than `before` are put in `results`,
+ * newest first. If `total` is non-NULL it's set to the number of matching lines in the whole log,
+ * which means looking at every posting of a term. If it's NULL the query stops at the last result.
+ *
+ * Return the number of lines put in `results`.
+ * Return -1 if `query` doesn't contain any searchable terms.
+ */
+int log_search_query(const struct log_search *search, const char *query, uint32_t before, uint32_t *results,
+                     size_t max_results, size_t *total);
+
+/* Rebuilds the search index of the log at `log_path` from scratch.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int log_search_rebuild(const char *log_path);
+
+/* Rebuilds the search index of every log in `dir`, printing progress to stdout.
+ *
+ * Return the number of logs that failed to be indexed, or -1 if `dir` couldn't be read.
+ */
+int log_search_rebuild_dir(const char *dir);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* LOG_SEARCH_H */
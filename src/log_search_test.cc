@@ -0,0 +1,232 @@
+#include "log_search.h"
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+class LogSearch : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        std::snprintf(path_, sizeof(path_), "%s/toxic_log_search_test_XXXXXX", testing::TempDir().c_str());
+        const int fd = mkstemp(path_);
+        ASSERT_NE(fd, -1);
+        close(fd);
+    }
+
+    void TearDown() override
+    {
+        log_search_close(&search_, path_);
+        log_search_stop();
+        std::remove(path_);
+        std::remove((std::string(path_) + LOG_SEARCH_SUFFIX).c_str());
+    }
+
+    // Appends `line` to the log and indexes it the way write_to_log() does.
+    void append(const std::string &line)
+    {
+        FILE *fp = std::fopen(path_, "a");
+        ASSERT_NE(fp, nullptr);
+        const off_t offset = ftello(fp);
+        ASSERT_EQ(std::fwrite(line.data(), 1, line.size(), fp), line.size());
+        std::fputc('\n', fp);
+        std::fclose(fp);
+
+        log_search_add(&search_, path_, offset, line.data(), line.size(), nullptr, 0);
+    }
+
+    void write_file(const std::string &contents)
+    {
+        FILE *fp = std::fopen(path_, "w");
+        ASSERT_NE(fp, nullptr);
+        ASSERT_EQ(std::fwrite(contents.data(), 1, contents.size(), fp), contents.size());
+        std::fclose(fp);
+    }
+
+    std::vector<uint32_t> query(const char *q, uint32_t before = UINT32_MAX, size_t max = 100)
+    {
+        std::vector<uint32_t> results(max);
+        const int n = log_search_query(&search_, q, before, results.data(), max, nullptr);
+        results.resize(n > 0 ? n : 0);
+        return results;
+    }
+
+    char path_[PATH_MAX];
+    struct log_search search_ {};
+};
+
+TEST_F(LogSearch, AppendedLines)
+{
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+
+    append("{0} [2026/01/01 12:00:00] alice: hello world");
+    append("{0} [2026/01/01 12:00:01] bob: Hello there");
+    append("{0} [2026/01/01 12:00:02] alice: goodbye world");
+
+    EXPECT_EQ(query("hello"), (std::vector<uint32_t> {1, 0}));
+    EXPECT_EQ(query("WORLD"), (std::vector<uint32_t> {2, 0}));
+    EXPECT_EQ(query("alice world"), (std::vector<uint32_t> {2, 0}));
+    EXPECT_EQ(query("hello alice"), (std::vector<uint32_t> {0}));
+    EXPECT_EQ(query("missing"), (std::vector<uint32_t> {}));
+}
+
+TEST_F(LogSearch, PrefixIsNotIndexed)
+{
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+
+    append("{0} [2026/01/01 12:00:00] alice: the year 2026");
+    append("{0} [2026/01/01 12:00:00] alice: nothing");
+
+    EXPECT_EQ(query("2026"), (std::vector<uint32_t> {0}));
+    EXPECT_EQ(query("12"), (std::vector<uint32_t> {}));
+}
+
+TEST_F(LogSearch, MultiLineMessage)
+{
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+
+    const std::string head = "{3} [ts] ";
+    const std::string msg = "first\nsecond part\nthird";
+
+    FILE *fp = std::fopen(path_, "a");
+    ASSERT_NE(fp, nullptr);
+    std::fprintf(fp, "%s%s\n", head.c_str(), msg.c_str());
+    std::fclose(fp);
+
+    log_search_add(&search_, path_, 0, head.data(), head.size(), msg.data(), msg.size());
+    append("{0} [ts] bob: part");
+
+    EXPECT_EQ(query("first"), (std::vector<uint32_t> {0}));
+    EXPECT_EQ(query("part"), (std::vector<uint32_t> {3, 1}));
+    EXPECT_EQ(query("third"), (std::vector<uint32_t> {2}));
+}
+
+TEST_F(LogSearch, ShortTermsAreIgnored)
+{
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+
+    append("a b c");
+
+    std::vector<uint32_t> results(1);
+    EXPECT_EQ(log_search_query(&search_, "a", UINT32_MAX, results.data(), 1, nullptr), -1);
+}
+
+TEST_F(LogSearch, Before)
+{
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+
+    for (int i = 0; i < 10; ++i) {
+        append("needle " + std::to_string(i));
+    }
+
+    size_t total = 0;
+    std::vector<uint32_t> results(3);
+    EXPECT_EQ(log_search_query(&search_, "needle", 5, results.data(), 3, &total), 3);
+    EXPECT_EQ(results, (std::vector<uint32_t> {4, 3, 2}));
+    EXPECT_EQ(total, 10);
+
+    // without a total the query starts at the newest match before `before`
+    EXPECT_EQ(query("needle", 5, 3), (std::vector<uint32_t> {4, 3, 2}));
+    EXPECT_EQ(query("needle", 1, 3), (std::vector<uint32_t> {0}));
+    EXPECT_TRUE(query("needle", 0, 3).empty());
+}
+
+TEST_F(LogSearch, CatchesUpWithExistingLog)
+{
+    write_file("{0} [ts] alice: one\n{0} [ts] bob: two\n{0} [ts] alice: three\npartial");
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+
+    EXPECT_EQ(search_.line_count, 3);
+    EXPECT_EQ(query("alice"), (std::vector<uint32_t> {2, 0}));
+    EXPECT_EQ(query("partial"), (std::vector<uint32_t> {}));
+}
+
+TEST_F(LogSearch, FlushedIndexIsReused)
+{
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+
+    append("{0} [ts] alice: first");
+    append("{0} [ts] bob: second");
+    log_search_close(&search_, path_);
+
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+    EXPECT_NE(search_.map, nullptr);
+    EXPECT_EQ(search_.pending.postings, 0);
+
+    // new lines go to the pending table and are returned together with the flushed ones
+    append("{0} [ts] alice: third");
+
+    EXPECT_EQ(query("alice"), (std::vector<uint32_t> {2, 0}));
+    EXPECT_EQ(query("second"), (std::vector<uint32_t> {1}));
+
+    ASSERT_EQ(log_search_flush(&search_, path_), 0);
+    EXPECT_EQ(search_.pending.postings, 0);
+    EXPECT_EQ(query("alice"), (std::vector<uint32_t> {2, 0}));
+}
+
+TEST_F(LogSearch, MergedByMergeThread)
+{
+    ASSERT_EQ(log_search_start(), 0);
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+
+    append("{0} [ts] alice: first");
+    append("{0} [ts] bob: second");
+    log_search_merge(&search_, path_);
+
+    // lines being merged and lines added since are returned while the merge is being done
+    append("{0} [ts] alice: third");
+    EXPECT_EQ(query("alice"), (std::vector<uint32_t> {2, 0}));
+
+    log_search_wait();
+    EXPECT_EQ(query("alice"), (std::vector<uint32_t> {2, 0}));
+    EXPECT_EQ(query("second"), (std::vector<uint32_t> {1}));
+
+    // the merged index file is picked up by the next merge
+    log_search_merge(&search_, path_);
+    EXPECT_EQ(search_.posting_count, 4);
+    EXPECT_EQ(search_.pending.postings, 0);
+
+    append("{0} [ts] carol: fourth");
+    log_search_close(&search_, path_);
+    log_search_stop();
+
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+    EXPECT_EQ(search_.pending.postings, 0);
+    EXPECT_EQ(query("alice"), (std::vector<uint32_t> {2, 0}));
+    EXPECT_EQ(query("carol"), (std::vector<uint32_t> {3}));
+}
+
+TEST_F(LogSearch, TruncatedLogIsReindexed)
+{
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+
+    append("{0} [ts] alice: first");
+    append("{0} [ts] bob: second");
+    log_search_close(&search_, path_);
+
+    write_file("{0} [ts] carol: new\n");
+
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+    EXPECT_EQ(query("alice"), (std::vector<uint32_t> {}));
+    EXPECT_EQ(query("carol"), (std::vector<uint32_t> {0}));
+}
+
+TEST_F(LogSearch, Rebuild)
+{
+    write_file("{0} [ts] alice: one\n{0} [ts] bob: two\n");
+    ASSERT_EQ(log_search_rebuild(path_), 0);
+
+    ASSERT_EQ(log_search_open(&search_, path_), 0);
+    EXPECT_NE(search_.map, nullptr);
+    EXPECT_EQ(query("bob"), (std::vector<uint32_t> {1}));
+}
+
+}  // namespace
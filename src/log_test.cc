@@ -0,0 +1,206 @@
+#include "log.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+namespace {
+
+class LogReadLines : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        std::snprintf(log_.path, sizeof(log_.path), "%s/toxic_log_test_XXXXXX", testing::TempDir().c_str());
+        const int fd = mkstemp(log_.path);
+        ASSERT_NE(fd, -1);
+        close(fd);
+    }
+
+    void TearDown() override
+    {
+        log_disable(&log_);
+        std::free(log_.index.fwd);
+        std::free(log_.index.back);
+        std::remove(log_.path);
+    }
+
+    void write_file(const std::string &contents)
+    {
+        FILE *fp = std::fopen(log_.path, "w");
+        ASSERT_NE(fp, nullptr);
+        ASSERT_EQ(std::fwrite(contents.data(), 1, contents.size(), fp), contents.size());
+        std::fclose(fp);
+        ASSERT_EQ(log_index_init(&log_), 0);
+    }
+
+    std::string read_lines(int64_t before, size_t max_lines, int64_t *first_line = nullptr)
+    {
+        char *buf = nullptr;
+        size_t len = 0;
+        int64_t first = 0;
+        EXPECT_EQ(log_read_lines(&log_, before, max_lines, &buf, &len, &first), 0);
+
+        if (first_line != nullptr) {
+            *first_line = first;
+        }
+
+        if (buf == nullptr) {
+            return "";
+        }
+
+        std::string lines(buf, len);
+        std::free(buf);
+        return lines;
+    }
+
+    struct chatlog log_ {};
+};
+
+TEST_F(LogReadLines, EmptyFile)
+{
+    write_file("");
+    EXPECT_EQ(read_lines(0, 10), "");
+}
+
+TEST_F(LogReadLines, FewerLinesThanRequested)
+{
+    write_file("one\ntwo\nthree\n");
+
+    int64_t first = 0;
+    EXPECT_EQ(read_lines(0, 10, &first), "one\ntwo\nthree\n");
+    EXPECT_EQ(first, -3);
+}
+
+TEST_F(LogReadLines, LastLines)
+{
+    write_file("one\ntwo\nthree\n");
+    EXPECT_EQ(read_lines(0, 2), "two\nthree\n");
+    EXPECT_EQ(read_lines(0, 1), "three\n");
+}
+
+TEST_F(LogReadLines, NoTrailingNewline)
+{
+    write_file("one\ntwo\nthree");
+    EXPECT_EQ(read_lines(0, 2), "two\nthree");
+}
+
+TEST_F(LogReadLines, LinesSpanningBlocks)
+{
+    const std::string long_line(100000, 'x');
+    write_file("first\n" + long_line + "\n" + long_line + "\nlast\n");
+    EXPECT_EQ(read_lines(0, 2), long_line + "\nlast\n");
+    EXPECT_EQ(read_lines(0, 4), "first\n" + long_line + "\n" + long_line + "\nlast\n");
+}
+
+TEST_F(LogReadLines, Pages)
+{
+    std::string contents;
+
+    for (int i = 0; i < 1000; ++i) {
+        contents += std::to_string(i) + "\n";
+    }
+
+    write_file(contents);
+
+    // page backwards in uneven steps so that pages straddle the recorded offsets
+    std::string paged;
+    int64_t before = 0;
+
+    while (true) {
+        int64_t first = 0;
+        const std::string page = read_lines(before, 37, &first);
+
+        if (page.empty()) {
+            break;
+        }
+
+        paged = page + paged;
+        before = first;
+    }
+
+    EXPECT_EQ(paged, contents);
+    EXPECT_EQ(before, -1000);
+    EXPECT_EQ(read_lines(-500, 2), "498\n499\n");
+}
+
+TEST_F(LogReadLines, AppendedLines)
+{
+    write_file("old\n");
+
+    Client_Config c_config {};
+    std::snprintf(c_config.log_timestamp_format, sizeof(c_config.log_timestamp_format), "ts");
+
+    ASSERT_EQ(log_enable(&log_), 0);
+
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(write_to_log(&log_, &c_config, std::to_string(i).c_str(), "name", LOG_HINT_NORMAL_I), 0);
+    }
+
+    ASSERT_EQ(write_to_log(&log_, &c_config, "multi\nline", nullptr, LOG_HINT_SYSTEM), 0);
+
+    EXPECT_EQ(log_next_line(&log_), 102);
+    EXPECT_EQ(read_lines(1, 2), "old\n{0} ts name: 0\n");
+    EXPECT_EQ(read_lines(71, 1), "{0} ts name: 70\n");
+    EXPECT_EQ(read_lines(102, 2), "{3} ts multi\nline\n");
+}
+
+TEST_F(LogReadLines, MissingFile)
+{
+    std::snprintf(log_.path, sizeof(log_.path), "/nonexistent/toxic.log");
+    ASSERT_EQ(log_index_init(&log_), 0);
+
+    char *buf = nullptr;
+    size_t len = 0;
+    int64_t first = 0;
+    EXPECT_EQ(log_read_lines(&log_, -1, 10, &buf, &len, &first), -1);
+    EXPECT_EQ(buf, nullptr);
+}
+
+// Opening a window should cost time proportional to the history shown rather than the log size.
+TEST_F(LogReadLines, DISABLED_Benchmark)
+{
+    constexpr size_t log_size = static_cast<size_t>(1) << 30;
+
+    FILE *fp = std::fopen(log_.path, "w");
+    ASSERT_NE(fp, nullptr);
+
+    size_t written = 0;
+
+    for (size_t i = 0; written < log_size; ++i) {
+        const int ret = std::fprintf(fp, "{0} [2026/01/01 12:00:00] somebody: synthetic message number %zu\n", i);
+        ASSERT_GT(ret, 0);
+        written += ret;
+    }
+
+    std::fclose(fp);
+    ASSERT_EQ(log_index_init(&log_), 0);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    char *buf = nullptr;
+    size_t len = 0;
+    int64_t first = 0;
+    ASSERT_EQ(log_read_lines(&log_, 0, 700, &buf, &len, &first), 0);
+
+    const auto end = std::chrono::steady_clock::now();
+
+    ASSERT_NE(buf, nullptr);
+    size_t num_lines = 0;
+
+    for (size_t i = 0; i < len; ++i) {
+        num_lines += buf[i] == '\n';
+    }
+
+    EXPECT_EQ(num_lines, 700);
+    std::free(buf);
+
+    std::printf("read last 700 lines of a %zu MiB log in %lld us\n", written >> 20,
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()));
+}
+
+}  // namespace
@@ -0,0 +1,598 @@
+/*  log_writer.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE    /* needed for pthread_condattr_setclock() */
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log_writer.h"
+
+/* Maximum number of buffers handed to a single writev() call */
+#define LOG_WRITER_MAX_IOV 256
+
+struct log_writer_stream {
+    int fd;
+    bool synced;           /* fsynced after every batch that writes to it */
+    bool dirty;            /* written to since it was last fsynced */
+    bool failed;           /* an append has failed since the last sync; guarded by the writer's lock */
+    uint64_t last_ticket;  /* ticket of the last entry queued for the stream; guarded by the writer's lock */
+};
+
+struct log_write {
+    struct log_write *next;
+    struct log_writer_stream *stream;
+    uint64_t ticket;
+    size_t length;
+    bool close;            /* if true this entry closes the stream instead of writing to it */
+    bool failed;
+    char data[];
+};
+
+static struct log_writer {
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;      /* signalled when the queue becomes non-empty or the writer should stop */
+    pthread_cond_t  done;      /* broadcast whenever a batch has been written */
+    pthread_t       tid;
+    bool            running;
+    bool            stop;
+
+    struct log_write *head;
+    struct log_write **tail;
+
+    uint64_t next_ticket;
+    uint64_t written;          /* every entry with a ticket at or below this has been written */
+
+    int fsync_interval;
+
+    /* Streams that have been written to since the last fsync. Only touched by the writer thread */
+    struct log_writer_stream **dirty;
+    size_t num_dirty;
+    size_t dirty_size;
+    struct timespec next_fsync;
+
+    /* Synced streams that have been written to in the current batch. Only touched by the writer thread */
+    struct log_writer_stream **synced;
+    size_t num_synced;
+    size_t synced_size;
+
+    struct log_writer_stats stats;
+} writer = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+    .tail = &writer.head,
+};
+
+static uint64_t timespec_to_us(const struct timespec *ts)
+{
+    return (uint64_t)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+static bool timespec_reached(const struct timespec *now, const struct timespec *deadline)
+{
+    return now->tv_sec > deadline->tv_sec || (now->tv_sec == deadline->tv_sec && now->tv_nsec >= deadline->tv_nsec);
+}
+
+/* Writes all of the `iovcnt` buffers in `iov` to `fd`, retrying after partial writes. `iov` is modified.
+ *
+ * Return true on success.
+ */
+static bool log_writer_write_all(int fd, struct iovec *iov, int iovcnt, uint64_t *syscalls)
+{
+    while (iovcnt > 0) {
+        ssize_t written = writev(fd, iov, iovcnt);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        ++*syscalls;
+
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return true;
+}
+
+/* Adds `stream` to the list of `count` streams in `list`.
+ *
+ * Return true on success.
+ */
+static bool log_writer_list_add(struct log_writer_stream ***list, size_t *count, size_t *size,
+                                struct log_writer_stream *stream)
+{
+    if (*count == *size) {
+        const size_t new_size = *size > 0 ? *size * 2 : 16;
+        struct log_writer_stream **new_list = realloc(*list, new_size * sizeof(struct log_writer_stream *));
+
+        if (new_list == NULL) {
+            return false;
+        }
+
+        *list = new_list;
+        *size = new_size;
+    }
+
+    (*list)[*count] = stream;
+    ++*count;
+
+    return true;
+}
+
+static void log_writer_list_remove(struct log_writer_stream **list, size_t *count, const struct log_writer_stream *stream)
+{
+    for (size_t i = 0; i < *count; ++i) {
+        if (list[i] == stream) {
+            list[i] = list[*count - 1];
+            --*count;
+            return;
+        }
+    }
+}
+
+static void log_writer_fsync(struct log_writer_stream *stream, uint64_t *fsyncs)
+{
+    if (!stream->dirty) {
+        return;
+    }
+
+    fsync(stream->fd);
+    stream->dirty = false;
+    ++*fsyncs;
+}
+
+static void log_writer_mark_dirty(struct log_writer_stream *stream, const struct timespec *now, uint64_t *fsyncs)
+{
+    if (stream->dirty) {
+        return;
+    }
+
+    if (stream->synced) {
+        stream->dirty = true;
+
+        if (!log_writer_list_add(&writer.synced, &writer.num_synced, &writer.synced_size, stream)) {
+            log_writer_fsync(stream, fsyncs);
+        }
+
+        return;
+    }
+
+    if (writer.fsync_interval <= 0) {
+        return;
+    }
+
+    if (!log_writer_list_add(&writer.dirty, &writer.num_dirty, &writer.dirty_size, stream)) {
+        return;
+    }
+
+    if (writer.num_dirty == 1) {
+        writer.next_fsync = *now;
+        writer.next_fsync.tv_sec += writer.fsync_interval;
+    }
+
+    stream->dirty = true;
+}
+
+static void log_writer_fsync_all(uint64_t *fsyncs)
+{
+    for (size_t i = 0; i < writer.num_dirty; ++i) {
+        log_writer_fsync(writer.dirty[i], fsyncs);
+    }
+
+    writer.num_dirty = 0;
+}
+
+/* Fsyncs the synced streams written to by the current batch, once each however many appends it had. */
+static void log_writer_fsync_synced(uint64_t *fsyncs)
+{
+    for (size_t i = 0; i < writer.num_synced; ++i) {
+        log_writer_fsync(writer.synced[i], fsyncs);
+    }
+
+    writer.num_synced = 0;
+}
+
+static void log_writer_close_stream(struct log_writer_stream *stream, uint64_t *fsyncs)
+{
+    log_writer_list_remove(writer.dirty, &writer.num_dirty, stream);
+    log_writer_list_remove(writer.synced, &writer.num_synced, stream);
+
+    log_writer_fsync(stream, fsyncs);
+    close(stream->fd);
+    stream->fd = -1;
+}
+
+/* Writes the entries in `batch`, coalescing consecutive entries for the same stream into one writev(). */
+static void log_writer_write_batch(struct log_write *batch, struct log_writer_stats *stats)
+{
+    struct iovec iov[LOG_WRITER_MAX_IOV];
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    struct log_write *entry = batch;
+
+    while (entry != NULL) {
+        struct log_writer_stream *stream = entry->stream;
+
+        if (entry->close) {
+            log_writer_close_stream(stream, &stats->fsyncs);
+            entry = entry->next;
+            continue;
+        }
+
+        struct log_write *run = entry;
+        int iovcnt = 0;
+        size_t length = 0;
+
+        while (entry != NULL && entry->stream == stream && !entry->close && iovcnt < LOG_WRITER_MAX_IOV) {
+            iov[iovcnt].iov_base = entry->data;
+            iov[iovcnt].iov_len = entry->length;
+            length += entry->length;
+            ++iovcnt;
+            entry = entry->next;
+        }
+
+        const bool ok = log_writer_write_all(stream->fd, iov, iovcnt, &stats->syscalls);
+
+        for (struct log_write *e = run; e != entry; e = e->next) {
+            e->failed = !ok;
+        }
+
+        if (ok) {
+            stats->appends += iovcnt;
+            stats->bytes += length;
+            log_writer_mark_dirty(stream, &now, &stats->fsyncs);
+        } else {
+            stats->errors += iovcnt;
+        }
+    }
+}
+
+static void *log_writer_thread(void *data)
+{
+    (void) data;
+
+    pthread_mutex_lock(&writer.lock);
+
+    while (true) {
+        while (writer.head == NULL && !writer.stop) {
+            if (writer.num_dirty == 0) {
+                pthread_cond_wait(&writer.wake, &writer.lock);
+            } else if (pthread_cond_timedwait(&writer.wake, &writer.lock, &writer.next_fsync) == ETIMEDOUT) {
+                break;
+            }
+        }
+
+        if (writer.head == NULL && writer.stop) {
+            break;
+        }
+
+        struct log_write *batch = writer.head;
+        writer.head = NULL;
+        writer.tail = &writer.head;
+        writer.stats.queue_depth = 0;
+
+        pthread_mutex_unlock(&writer.lock);
+
+        struct log_writer_stats stats = {0};
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        log_writer_write_batch(batch, &stats);
+        log_writer_fsync_synced(&stats.fsyncs);
+
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (writer.num_dirty > 0 && timespec_reached(&end, &writer.next_fsync)) {
+            log_writer_fsync_all(&stats.fsyncs);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+        }
+
+        const uint64_t flush_us = timespec_to_us(&end) - timespec_to_us(&start);
+
+        pthread_mutex_lock(&writer.lock);
+
+        struct log_writer_stats *s = &writer.stats;
+        s->appends += stats.appends;
+        s->bytes += stats.bytes;
+        s->syscalls += stats.syscalls;
+        s->fsyncs += stats.fsyncs;
+        s->errors += stats.errors;
+
+        if (batch != NULL) {
+            ++s->batches;
+            s->last_flush_us = flush_us;
+            s->max_flush_us = flush_us > s->max_flush_us ? flush_us : s->max_flush_us;
+            s->total_flush_us += flush_us;
+        }
+
+        while (batch != NULL) {
+            struct log_write *next = batch->next;
+
+            if (batch->failed) {
+                batch->stream->failed = true;
+            }
+
+            writer.written = batch->ticket;
+            free(batch);
+            batch = next;
+        }
+
+        pthread_cond_broadcast(&writer.done);
+    }
+
+    log_writer_fsync_all(&writer.stats.fsyncs);
+
+    pthread_mutex_unlock(&writer.lock);
+
+    return NULL;
+}
+
+int log_writer_start(int fsync_interval)
+{
+    if (writer.running) {
+        return 0;
+    }
+
+    pthread_condattr_t attr;
+
+    if (pthread_condattr_init(&attr) != 0) {
+        return -1;
+    }
+
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    const int ret = pthread_cond_init(&writer.wake, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (ret != 0) {
+        return -1;
+    }
+
+    writer.fsync_interval = fsync_interval;
+    writer.stop = false;
+    memset(&writer.stats, 0, sizeof(writer.stats));
+
+    if (pthread_create(&writer.tid, NULL, log_writer_thread, NULL) != 0) {
+        pthread_cond_destroy(&writer.wake);
+        return -1;
+    }
+
+    pthread_mutex_lock(&writer.lock);
+    writer.running = true;
+    pthread_mutex_unlock(&writer.lock);
+
+    return 0;
+}
+
+void log_writer_stop(void)
+{
+    pthread_mutex_lock(&writer.lock);
+
+    if (!writer.running) {
+        pthread_mutex_unlock(&writer.lock);
+        return;
+    }
+
+    writer.stop = true;
+    pthread_cond_signal(&writer.wake);
+    pthread_mutex_unlock(&writer.lock);
+
+    pthread_join(writer.tid, NULL);
+
+    pthread_mutex_lock(&writer.lock);
+    writer.running = false;
+    pthread_cond_broadcast(&writer.done);
+    pthread_mutex_unlock(&writer.lock);
+
+    pthread_cond_destroy(&writer.wake);
+
+    free(writer.dirty);
+    writer.dirty = NULL;
+    writer.dirty_size = 0;
+    writer.num_dirty = 0;
+
+    free(writer.synced);
+    writer.synced = NULL;
+    writer.synced_size = 0;
+    writer.num_synced = 0;
+}
+
+struct log_writer_stream *log_writer_open(const char *path)
+{
+    struct log_writer_stream *stream = calloc(1, sizeof(struct log_writer_stream));
+
+    if (stream == NULL) {
+        return NULL;
+    }
+
+    stream->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+
+    if (stream->fd < 0) {
+        free(stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+struct log_writer_stream *log_writer_open_synced(const char *path)
+{
+    struct log_writer_stream *stream = log_writer_open(path);
+
+    if (stream != NULL) {
+        stream->synced = true;
+    }
+
+    return stream;
+}
+
+int log_writer_append(struct log_writer_stream *stream, const char *head, size_t head_len, const char *tail,
+                      size_t tail_len)
+{
+    const size_t length = head_len + tail_len + 1;
+    struct log_write *entry = malloc(sizeof(struct log_write) + length);
+
+    if (entry == NULL) {
+        return -1;
+    }
+
+    memcpy(entry->data, head, head_len);
+
+    if (tail_len > 0) {
+        memcpy(entry->data + head_len, tail, tail_len);
+    }
+
+    entry->data[length - 1] = '\n';
+    entry->next = NULL;
+    entry->stream = stream;
+    entry->length = length;
+    entry->close = false;
+    entry->failed = false;
+
+    pthread_mutex_lock(&writer.lock);
+
+    if (!writer.running) {
+        pthread_mutex_unlock(&writer.lock);
+
+        struct iovec iov = { .iov_base = entry->data, .iov_len = length };
+        uint64_t syscalls = 0;
+        const bool ok = log_writer_write_all(stream->fd, &iov, 1, &syscalls);
+
+        free(entry);
+
+        if (!ok) {
+            return -1;
+        }
+
+        if (stream->synced) {
+            fsync(stream->fd);
+        } else {
+            stream->dirty = true;
+        }
+
+        return 0;
+    }
+
+    entry->ticket = ++writer.next_ticket;
+    stream->last_ticket = entry->ticket;
+
+    const bool was_empty = writer.head == NULL;
+
+    *writer.tail = entry;
+    writer.tail = &entry->next;
+
+    struct log_writer_stats *s = &writer.stats;
+    ++s->queue_depth;
+    s->max_queue_depth = s->queue_depth > s->max_queue_depth ? s->queue_depth : s->max_queue_depth;
+
+    if (was_empty) {
+        pthread_cond_signal(&writer.wake);
+    }
+
+    pthread_mutex_unlock(&writer.lock);
+
+    return 0;
+}
+
+int log_writer_sync(struct log_writer_stream *stream)
+{
+    pthread_mutex_lock(&writer.lock);
+
+    while (writer.running && writer.written < stream->last_ticket) {
+        pthread_cond_wait(&writer.done, &writer.lock);
+    }
+
+    const bool failed = stream->failed;
+    stream->failed = false;
+
+    pthread_mutex_unlock(&writer.lock);
+
+    return failed ? -1 : 0;
+}
+
+void log_writer_close(struct log_writer_stream *stream)
+{
+    if (stream == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&writer.lock);
+
+    if (writer.running) {
+        struct log_write *entry = calloc(1, sizeof(struct log_write));
+
+        if (entry != NULL) {
+            entry->stream = stream;
+            entry->close = true;
+            const uint64_t ticket = ++writer.next_ticket;
+            entry->ticket = ticket;
+            stream->last_ticket = ticket;
+
+            if (writer.head == NULL) {
+                pthread_cond_signal(&writer.wake);
+            }
+
+            *writer.tail = entry;
+            writer.tail = &entry->next;
+            ++writer.stats.queue_depth;
+
+            /* the writer thread frees the entry once it's processed */
+            while (writer.running && writer.written < ticket) {
+                pthread_cond_wait(&writer.done, &writer.lock);
+            }
+
+            pthread_mutex_unlock(&writer.lock);
+            free(stream);
+            return;
+        }
+
+        /* we can't queue the close, so wait for the stream's writes before closing it ourselves */
+        while (writer.running && writer.written < stream->last_ticket) {
+            pthread_cond_wait(&writer.done, &writer.lock);
+        }
+    }
+
+    pthread_mutex_unlock(&writer.lock);
+
+    if ((writer.fsync_interval > 0 || stream->synced) && stream->dirty) {
+        fsync(stream->fd);
+    }
+
+    close(stream->fd);
+    free(stream);
+}
+
+void log_writer_get_stats(struct log_writer_stats *stats)
+{
+    pthread_mutex_lock(&writer.lock);
+    *stats = writer.stats;
+    pthread_mutex_unlock(&writer.lock);
+}
@@ -0,0 +1,99 @@
+/*  log_writer.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Background writer for chat logs.
+ *
+ * Appends are copied into a queue and written by a dedicated thread, which takes the whole queue at
+ * once and writes each log's share of it with a single writev(). Callers only hold the queue's lock
+ * long enough to link in an entry, so logging never waits for the disk. Logs that have been written
+ * to are fsynced every `fsync_interval` seconds, or never if it's zero.
+ *
+ * If the writer thread isn't running, appends are written synchronously.
+ */
+
+/* An append-only file that's written by the log writer. Opaque outside of log_writer.c */
+struct log_writer_stream;
+
+struct log_writer_stats {
+    size_t   queue_depth;       /* number of appends waiting to be written */
+    size_t   max_queue_depth;
+    uint64_t appends;           /* number of appends written */
+    uint64_t bytes;             /* number of bytes written */
+    uint64_t batches;           /* number of times the writer thread emptied the queue */
+    uint64_t syscalls;          /* number of writev() calls */
+    uint64_t fsyncs;
+    uint64_t errors;            /* number of appends that failed to be written */
+    uint64_t last_flush_us;     /* time it took to write the last batch, including any fsyncs */
+    uint64_t max_flush_us;
+    uint64_t total_flush_us;
+};
+
+/* Starts the writer thread and resets its counters.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int log_writer_start(int fsync_interval);
+
+/* Writes everything that's queued and stops the writer thread. */
+void log_writer_stop(void);
+
+/* Opens the file at `path` for appending, creating it if it doesn't exist.
+ *
+ * Return NULL on failure.
+ */
+struct log_writer_stream *log_writer_open(const char *path);
+
+/* Like log_writer_open(), but the stream is fsynced after each batch that writes to it, whatever the
+ * fsync interval is. A batch holds everything queued while the previous one was being written, so
+ * any number of appends cost one fsync.
+ *
+ * Return NULL on failure.
+ */
+struct log_writer_stream *log_writer_open_synced(const char *path);
+
+/* Queues a line consisting of `head` followed by `tail`, which may be NULL, to be appended to `stream`.
+ * A newline is appended after `tail`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int log_writer_append(struct log_writer_stream *stream, const char *head, size_t head_len, const char *tail,
+                      size_t tail_len);
+
+/* Waits until everything that's been queued for `stream` has been written.
+ *
+ * Return 0 on success.
+ * Return -1 if any append to `stream` has failed since the last call.
+ */
+int log_writer_sync(struct log_writer_stream *stream);
+
+/* Writes everything that's queued for `stream`, fsyncs it if fsyncs are enabled, and closes it. */
+void log_writer_close(struct log_writer_stream *stream);
+
+/* Puts a snapshot of the writer's counters in `stats`. */
+void log_writer_get_stats(struct log_writer_stats *stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* LOG_WRITER_H */
@@ -0,0 +1,159 @@
+#include "log_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+class LogWriter : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        std::snprintf(path_, sizeof(path_), "%s/toxic_log_writer_test_XXXXXX", testing::TempDir().c_str());
+        const int fd = mkstemp(path_);
+        ASSERT_NE(fd, -1);
+        close(fd);
+    }
+
+    void TearDown() override
+    {
+        log_writer_stop();
+        std::remove(path_);
+    }
+
+    std::string read_file()
+    {
+        std::ifstream in(path_);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+
+    static int append(struct log_writer_stream *stream, const std::string &head, const std::string &tail = "")
+    {
+        return log_writer_append(stream, head.data(), head.size(), tail.empty() ? nullptr : tail.data(),
+                                 tail.size());
+    }
+
+    char path_[PATH_MAX];
+};
+
+TEST_F(LogWriter, WritesSynchronouslyWithoutThread)
+{
+    struct log_writer_stream *stream = log_writer_open(path_);
+    ASSERT_NE(stream, nullptr);
+
+    EXPECT_EQ(append(stream, "one "), 0);
+    EXPECT_EQ(append(stream, "two ", "three"), 0);
+    EXPECT_EQ(read_file(), "one \ntwo three\n");
+
+    EXPECT_EQ(log_writer_sync(stream), 0);
+    log_writer_close(stream);
+}
+
+TEST_F(LogWriter, AppendsInOrder)
+{
+    ASSERT_EQ(log_writer_start(0), 0);
+
+    struct log_writer_stream *stream = log_writer_open(path_);
+    ASSERT_NE(stream, nullptr);
+
+    std::string expected;
+
+    for (int i = 0; i < 1000; ++i) {
+        const std::string head = "{0} [ts] line ";
+        const std::string tail = std::to_string(i);
+        ASSERT_EQ(append(stream, head, tail), 0);
+        expected += head + tail + "\n";
+    }
+
+    EXPECT_EQ(log_writer_sync(stream), 0);
+    EXPECT_EQ(read_file(), expected);
+
+    log_writer_close(stream);
+}
+
+TEST_F(LogWriter, CloseWritesEverything)
+{
+    ASSERT_EQ(log_writer_start(1), 0);
+
+    struct log_writer_stream *stream = log_writer_open(path_);
+    ASSERT_NE(stream, nullptr);
+
+    ASSERT_EQ(append(stream, "first"), 0);
+    ASSERT_EQ(append(stream, "second"), 0);
+    log_writer_close(stream);
+
+    EXPECT_EQ(read_file(), "first\nsecond\n");
+
+    struct log_writer_stats stats;
+    log_writer_get_stats(&stats);
+    EXPECT_EQ(stats.queue_depth, 0);
+    EXPECT_GE(stats.fsyncs, 1);
+}
+
+TEST_F(LogWriter, ConcurrentStreams)
+{
+    ASSERT_EQ(log_writer_start(0), 0);
+
+    constexpr int kThreads = 4;
+    constexpr int kLines = 500;
+
+    std::vector<std::string> paths;
+
+    for (int t = 0; t < kThreads; ++t) {
+        paths.push_back(std::string(path_) + "." + std::to_string(t));
+    }
+
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&paths, t]() {
+            struct log_writer_stream *stream = log_writer_open(paths[t].c_str());
+            ASSERT_NE(stream, nullptr);
+
+            for (int i = 0; i < kLines; ++i) {
+                append(stream, std::to_string(i));
+            }
+
+            log_writer_close(stream);
+        });
+    }
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (const std::string &path : paths) {
+        std::ifstream in(path);
+        std::string line;
+        int expected = 0;
+
+        while (std::getline(in, line)) {
+            EXPECT_EQ(line, std::to_string(expected));
+            ++expected;
+        }
+
+        EXPECT_EQ(expected, kLines);
+        std::remove(path.c_str());
+    }
+
+    struct log_writer_stats stats;
+    log_writer_get_stats(&stats);
+    EXPECT_EQ(stats.appends, kThreads * kLines);
+    EXPECT_EQ(stats.errors, 0);
+    EXPECT_LE(stats.syscalls, stats.appends);
+    EXPECT_EQ(stats.fsyncs, 0);
+}
+
+}  // namespace
@@ -34,9 +34,12 @@
 #include <tox/tox.h>
 
 #include "audio_device.h"
+#include "autocomplete.h"
 #include "bootstrap.h"
+#include "chat.h"
 #include "conference.h"
 #include "configdir.h"
+#include "dir_cache.h"
 #include "execute.h"
 #include "file_transfers.h"
 #include "friendlist.h"
@@ -44,6 +47,8 @@
 #include "init_queue.h"
 #include "line_info.h"
 #include "log.h"
+#include "log_search.h"
+#include "log_writer.h"
 #include "message_queue.h"
 #include "misc_tools.h"
 #include "name_lookup.h"
@@ -75,8 +80,6 @@
 #define DATANAME  "toxic_profile.tox"
 #define BLOCKNAME "toxic_blocklist"
 
-static struct cqueue_thread cqueue_thread;
-
 #ifdef AUDIO
 static struct av_thread av_thread;
 #endif
@@ -90,6 +93,7 @@ static void catch_SIGINT(int sig)
 
     if (difftime(cur_time, last_signal_time) <= 1) {
         Winthread.sig_exit_toxic = 1;
+        reactor_signal(&Winthread.reactor);
     } else {
         last_signal_time = cur_time;
     }
@@ -113,6 +117,7 @@ static void flag_window_resize(int sig)
     UNUSED_VAR(sig);
 
     Winthread.flag_resize = 1;
+    reactor_signal(&Winthread.reactor);
 }
 
 static void init_signal_catchers(void)
@@ -180,8 +185,6 @@ static void load_friendlist(Toxic *toxic)
     for (size_t i = 0; i < numfriends; ++i) {
         friendlist_onFriendAdded(NULL, toxic, i, false);
     }
-
-    sort_friendlist_index(toxic->friends);
 }
 
 static void load_groups(Toxic *toxic)
@@ -738,6 +741,15 @@ static bool load_toxic(Toxic *toxic, Init_Queue *init_q)
     return true;
 }
 
+static void init_reactors(void)
+{
+    if (reactor_init(&Winthread.reactor) != 0
+            || reactor_init(&cqueue_thread.reactor) != 0
+            || reactor_init(&tox_thread.reactor) != 0) {
+        exit_toxic_err(FATALERR_REACTOR_INIT, "failed in init_reactors");
+    }
+}
+
 static void do_toxic(Toxic *toxic)
 {
     pthread_mutex_lock(&Winthread.lock);
@@ -748,6 +760,9 @@ static void do_toxic(Toxic *toxic)
     }
 
     tox_iterate(toxic->tox, (void *) toxic);
+    file_transfers_send_pending(toxic);
+    file_transfers_check_writers(toxic);
+    file_transfers_schedule(toxic);
     do_tox_connection(toxic);
 
     pthread_mutex_unlock(&Winthread.lock);
@@ -772,28 +787,59 @@ static void poll_interface_refresh_flag(void)
     }
 }
 
+/* How often we refresh windows that aren't focused, in seconds. This is also how often the UI
+ * thread wakes up when nothing is happening. */
+#define INACTIVE_WIN_REFRESH_INTERVAL 1
+
+/* Returns how long the UI thread may sleep before it has to redraw something, in milliseconds. */
+static int interface_wait_timeout(const Windows *windows)
+{
+    pthread_mutex_lock(&Winthread.lock);
+    const bool busy = Winthread.flag_refresh;
+    pthread_mutex_unlock(&Winthread.lock);
+
+    if (busy) {
+        return Winthread.refresh_rate;
+    }
+
+#ifdef GAMES
+    const ToxWindow *active = windows->list[windows->active_index];
+
+    if (active != NULL && active->type == WINDOW_TYPE_GAME) {
+        return Winthread.refresh_rate;
+    }
 
-/* How often we refresh windows that aren't focused */
-#define INACTIVE_WIN_REFRESH_RATE 10
+#else
+    UNUSED_VAR(windows);
+#endif /* GAMES */
+
+    return INACTIVE_WIN_REFRESH_INTERVAL * 1000;
+}
 
 static void *thread_winref(void *data)
 {
     Toxic *toxic = (Toxic *) data;
 
-    uint8_t draw_count = 0;
+    time_t last_inactive_refresh = get_unix_time();
+    bool more_input = false;
 
     init_signal_catchers();
 
     while (true) {
-        draw_count++;
-        draw_active_window(toxic);
+        /* sleep until there's input, a redraw or resize is requested, or something is due for a redraw */
+        if (!more_input) {
+            reactor_wait(&Winthread.reactor, STDIN_FILENO, interface_wait_timeout(toxic->windows));
+        }
+
+        more_input = draw_active_window(toxic);
+        dir_match_poll(toxic);
 
         if (Winthread.flag_resize) {
             on_window_resize(toxic->windows);
             Winthread.flag_resize = 0;
-        } else if (draw_count >= INACTIVE_WIN_REFRESH_RATE) {
+        } else if (timed_out(last_inactive_refresh, INACTIVE_WIN_REFRESH_INTERVAL)) {
             refresh_inactive_windows(toxic->windows, toxic->c_config);
-            draw_count = 0;
+            last_inactive_refresh = get_unix_time();
         }
 
         if (Winthread.sig_exit_toxic) {
@@ -805,12 +851,63 @@ static void *thread_winref(void *data)
     }
 }
 
+/* How often the message queue thread checks queued messages for timeouts while there are any, in milliseconds */
+#define CQUEUE_CHECK_INTERVAL 750
+
+/* Opens a chat window for each friend who has undelivered messages journaled from a previous session,
+ * which replays the messages into the window's send queue.
+ *
+ * Return 0 on success.
+ * Return -1 if a window couldn't be opened.
+ */
+static int open_queued_chats(Toxic *toxic)
+{
+    FriendsList *friends = toxic->friends;
+
+    uint8_t self_key[TOX_PUBLIC_KEY_SIZE];
+    tox_self_get_public_key(toxic->tox, self_key);
+
+    int ret = 0;
+
+    for (size_t i = 0; i < friends->max_idx; ++i) {
+        ToxicFriend *f = &friends->list[i];
+
+        if (!f->active || f->window_id >= 0) {
+            continue;
+        }
+
+        char path[TOXIC_MAX_PATH_LENGTH];
+
+        if (cqueue_get_journal_path(toxic->paths, self_key, (const uint8_t *) f->pub_key, path, sizeof(path)) != 0) {
+            continue;
+        }
+
+        if (message_journal_count(path) == 0) {
+            continue;
+        }
+
+        const int window_id = add_window(toxic, new_chat(friends, f->num));
+
+        if (window_id < 0) {
+            ret = -1;
+            continue;
+        }
+
+        f->window_id = window_id;
+    }
+
+    return ret;
+}
+
 _Noreturn static void *thread_cqueue(void *data)
 {
     Toxic *toxic = (Toxic *) data;
     Windows *windows = toxic->windows;
 
     while (true) {
+        bool pending = false;
+        struct message_journal_compaction *compaction = NULL;
+
         pthread_mutex_lock(&Winthread.lock);
 
         for (uint16_t i = 2; i < windows->count; ++i) {
@@ -820,14 +917,41 @@ _Noreturn static void *thread_cqueue(void *data)
                 cqueue_check_unread(w);
 
                 if (get_friend_connection_status(toxic->friends, w->num) != TOX_CONNECTION_NONE) {
-                    cqueue_try_send(w, toxic->tox);
+                    cqueue_try_send(w, toxic->tox, toxic->c_config->message_queue_window);
+                }
+
+                if (w->chatwin->cqueue->root != NULL) {
+                    pending = true;
+                }
+
+                /* one journal per pass; the rest are compacted on the next one */
+                if (compaction == NULL) {
+                    compaction = cqueue_compact_journal(w->chatwin->cqueue);
                 }
             }
         }
 
         pthread_mutex_unlock(&Winthread.lock);
 
-        sleep_thread(750000L); // 0.75 seconds
+        /* the new journal is written and the old one closed without holding up the interface */
+        if (compaction != NULL) {
+            message_journal_compact_write(compaction);
+
+            pthread_mutex_lock(&Winthread.lock);
+            message_journal_compact_finish(compaction);
+            pthread_mutex_unlock(&Winthread.lock);
+
+            message_journal_compact_free(compaction);
+        }
+
+        if (pending) {
+            /* get the messages we just handed to toxcore out on the wire without waiting for its interval */
+            reactor_signal(&tox_thread.reactor);
+        }
+
+        /* with nothing queued there's nothing to time out, so sleep until a message is queued
+         * or a friend comes online */
+        reactor_wait(&cqueue_thread.reactor, -1, pending || compaction != NULL ? CQUEUE_CHECK_INTERVAL : -1);
     }
 }
 
@@ -858,6 +982,7 @@ static void print_usage(void)
     fprintf(stderr, "  -e, --encrypt-data       Encrypt an unencrypted data file\n");
     fprintf(stderr, "  -f, --file               Use specified data file\n");
     fprintf(stderr, "  -h, --help               Show this message and exit\n");
+    fprintf(stderr, "  -i, --index-logs         Rebuild the search indexes of chat logs and exit: Requires [log_dir]\n");
     fprintf(stderr, "  -l, --logging            Enable toxcore logging: Requires [log_path | stderr]\n");
     fprintf(stderr, "  -L, --no-lan             Disable local discovery\n");
     fprintf(stderr, "  -n, --nodes              Use specified DHTnodes file\n");
@@ -995,6 +1120,7 @@ static void parse_args(Toxic *toxic, Init_Queue *init_q, int argc, char *argv[])
         {"no-lan", no_argument, 0, 'L'},
         {"nodes", required_argument, 0, 'n'},
         {"help", no_argument, 0, 'h'},
+        {"index-logs", required_argument, 0, 'i'},
         {"noconnect", no_argument, 0, 'o'},
         {"namelist", required_argument, 0, 'r'},
 #ifdef TOX_EXPERIMENTAL
@@ -1010,9 +1136,9 @@ static void parse_args(Toxic *toxic, Init_Queue *init_q, int argc, char *argv[])
     };
 
 #ifdef TOX_EXPERIMENTAL
-    const char *opts_str = "4bdehLotuxvc:f:l:n:r:s:p:P:T:";
+    const char *opts_str = "4bdehLotuxvc:f:i:l:n:r:s:p:P:T:";
 #else
-    const char *opts_str = "4bdehLotuxvc:f:l:n:r:p:P:T:";
+    const char *opts_str = "4bdehLotuxvc:f:i:l:n:r:p:P:T:";
 #endif // TOX_EXPERIMENTAL
 
     int opt = 0;
@@ -1052,6 +1178,18 @@ static void parse_args(Toxic *toxic, Init_Queue *init_q, int argc, char *argv[])
                 break;
             }
 
+            case 'i': {
+                const int failed = log_search_rebuild_dir(optarg);
+
+                if (failed < 0) {
+                    fprintf(stderr, "Failed to read log directory '%s'\n", optarg);
+                } else if (failed > 0) {
+                    fprintf(stderr, "Failed to index %d logs in '%s'\n", failed, optarg);
+                }
+
+                exit(failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+
             case 'l': {
                 if (optarg) {
                     handle_opt_logging(run_opts, init_q, optarg);
@@ -1291,6 +1429,8 @@ int main(int argc, char **argv)
 
     srand(time(NULL)); // We use rand() for trivial/non-security related things
 
+    init_reactors();
+
     Toxic *toxic = toxic_init();
 
     if (toxic == NULL) {
@@ -1379,6 +1519,31 @@ int main(int argc, char **argv)
 
     init_term(c_config, init_q, run_opts->default_locale);
 
+    /* must be started before any logs are opened so that no window waits on disk writes */
+    if (log_writer_start(c_config->log_sync_interval) != 0) {
+        exit_toxic_err(FATALERR_THREAD_CREATE, "failed in main");
+    }
+
+    /* wakes the Tox thread when file data it's waiting to send has been read from disk */
+    if (file_reader_start(&tox_thread.reactor) != 0) {
+        exit_toxic_err(FATALERR_THREAD_CREATE, "failed in main");
+    }
+
+    /* wakes the Tox thread when a file transfer that was paused for disk writes to catch up can resume */
+    if (file_writer_start(&tox_thread.reactor) != 0) {
+        exit_toxic_err(FATALERR_THREAD_CREATE, "failed in main");
+    }
+
+    /* wakes the interface when a directory listing for tab completion has been loaded */
+    if (dir_cache_start(&Winthread.reactor) != 0) {
+        exit_toxic_err(FATALERR_THREAD_CREATE, "failed in main");
+    }
+
+    /* merges search index postings so that the interface doesn't wait on index file writes */
+    if (log_search_start() != 0) {
+        exit_toxic_err(FATALERR_THREAD_CREATE, "failed in main");
+    }
+
     init_windows(toxic);
     ToxWindow *home_window = toxic->home_window;
 
@@ -1393,6 +1558,10 @@ int main(int argc, char **argv)
         init_queue_add(init_q, "Failed to load friend config settings: error %d", fs_ret);
     }
 
+    if (open_queued_chats(toxic) != 0) {
+        init_queue_add(init_q, "Failed to open chat windows for queued messages");
+    }
+
     const int gs_ret = settings_load_groups(windows, run_opts);
 
     if (gs_ret != 0) {
@@ -1494,6 +1663,7 @@ int main(int argc, char **argv)
     execute(home_window->chatwin->history, home_window, toxic, avatarstr, GLOBAL_COMMAND_MODE);
 
     time_t last_save = get_unix_time();
+    time_t last_journal_save = last_save;
 
     while (true) {
         do_toxic(toxic);
@@ -1513,7 +1683,16 @@ int main(int argc, char **argv)
             last_save = cur_time;
         }
 
-        const long int sleep_duration = tox_iteration_interval(toxic->tox) * 1000;
-        sleep_thread(sleep_duration);
+        if (timed_out(last_journal_save, FILE_TRANSFER_JOURNAL_INTERVAL)) {
+            pthread_mutex_lock(&Winthread.lock);
+            file_transfers_save_journals(toxic);
+            pthread_mutex_unlock(&Winthread.lock);
+
+            last_journal_save = cur_time;
+        }
+
+        /* toxcore doesn't expose its sockets, so we iterate on its timer, or earlier if another
+         * thread has handed it something to send */
+        reactor_wait(&tox_thread.reactor, -1, (int) tox_iteration_interval(toxic->tox));
     }
 }
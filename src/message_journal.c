@@ -0,0 +1,667 @@
+/*  message_journal.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE    /* needed for O_CLOEXEC */
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log_writer.h"
+#include "message_journal.h"
+
+/*
+ * Records are written as a header, terminated by a colon, followed by the message and a newline:
+ *
+ *   A <id> <type> <length> <checksum>:<message>\n
+ *   D <id> <checksum>:\n
+ *
+ * The length is that of the message, which may itself contain newlines.
+ */
+#define MESSAGE_JOURNAL_MAX_HEADER 96
+
+struct message_journal {
+    char *path;
+    struct log_writer_stream *stream;
+    struct message_journal_compaction *compaction;    /* the compaction in progress, or NULL */
+    uint64_t next_id;
+    size_t live;       /* number of messages added and not yet removed */
+    size_t dead;       /* number of records that compaction would drop */
+};
+
+/*
+ * While a journal is being compacted its records are appended to both the old file and the new one, so
+ * whichever of them is at the journal's path has every record.
+ */
+struct message_journal_compaction {
+    pthread_mutex_t lock;                    /* held while the new file is renamed into place */
+    struct message_journal *journal;         /* NULL once the journal has been closed */
+    char *path;
+    char *tmp_path;
+    struct log_writer_stream *stream;        /* the new file */
+    struct log_writer_stream *old_stream;    /* the file being replaced */
+    size_t dead;                             /* number of dead records when the compaction began */
+    int result;
+};
+
+struct journal_record {
+    uint64_t id;
+    uint8_t type;
+    const char *message;
+    size_t length;
+    bool removed;
+};
+
+static uint32_t journal_checksum(uint64_t id, uint8_t type, const char *message, size_t length)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < sizeof(id); ++i) {
+        hash = (hash ^ (uint8_t)(id >> (i * 8))) * 16777619u;
+    }
+
+    hash = (hash ^ type) * 16777619u;
+
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ (uint8_t) message[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+static int journal_add_header(char *buf, size_t size, uint64_t id, uint8_t type, const char *message, size_t length)
+{
+    return snprintf(buf, size, "A %" PRIu64 " %u %zu %08" PRIx32 ":", id, (unsigned int) type, length,
+                    journal_checksum(id, type, message, length));
+}
+
+static int journal_remove_header(char *buf, size_t size, uint64_t id)
+{
+    return snprintf(buf, size, "D %" PRIu64 " %08" PRIx32 ":", id, journal_checksum(id, 0, NULL, 0));
+}
+
+/* Reads the whole file at `path` into a NUL-terminated buffer and puts its size in `size`.
+ *
+ * Returns NULL if the file doesn't exist or can't be read.
+ */
+static char *journal_read_file(const char *path, size_t *size)
+{
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_size < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    char *data = malloc((size_t) st.st_size + 1);
+
+    if (data == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t total = 0;
+
+    while (total < (size_t) st.st_size) {
+        const ssize_t ret = read(fd, data + total, (size_t) st.st_size - total);
+
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (ret <= 0) {
+            break;
+        }
+
+        total += (size_t) ret;
+    }
+
+    close(fd);
+
+    data[total] = '\0';
+    *size = total;
+
+    return data;
+}
+
+/* Returns the record with `id` in the `count` records in `records`, which are sorted by id, or NULL. */
+static struct journal_record *journal_find(struct journal_record *records, size_t count, uint64_t id)
+{
+    size_t lo = 0;
+    size_t hi = count;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+
+        if (records[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo < count && records[lo].id == id ? &records[lo] : NULL;
+}
+
+/* Parses the `size` bytes of journal in `data` into `records`, which the caller must free.
+ * Puts the number of add records in `count`, the number of bytes up to the end of the last valid
+ * record in `valid`, and the number of records compaction would drop in `dead`.
+ *
+ * Return 0 on success.
+ * Return -1 on allocation failure.
+ */
+static int journal_parse(const char *data, size_t size, struct journal_record **records, size_t *count,
+                         size_t *valid, size_t *dead)
+{
+    struct journal_record *list = NULL;
+    size_t list_count = 0;
+    size_t list_size = 0;
+    size_t num_dead = 0;
+    size_t pos = 0;
+
+    while (pos < size) {
+        const char *colon = memchr(data + pos, ':', size - pos);
+
+        if (colon == NULL || (size_t)(colon - (data + pos)) >= MESSAGE_JOURNAL_MAX_HEADER) {
+            break;
+        }
+
+        char header[MESSAGE_JOURNAL_MAX_HEADER];
+        const size_t header_len = (size_t)(colon - (data + pos));
+        memcpy(header, data + pos, header_len);
+        header[header_len] = '\0';
+
+        const size_t body = pos + header_len + 1;
+        uint64_t id;
+        unsigned int type;
+        size_t length;
+        uint32_t checksum;
+
+        if (header[0] == 'A' && sscanf(header, "A %" SCNu64 " %u %zu %" SCNx32, &id, &type, &length, &checksum) == 4) {
+            if (type > UINT8_MAX || length >= size - body || data[body + length] != '\n'
+                    || checksum != journal_checksum(id, (uint8_t) type, data + body, length)
+                    || (list_count > 0 && id <= list[list_count - 1].id)) {
+                break;
+            }
+
+            if (list_count == list_size) {
+                const size_t new_size = list_size > 0 ? list_size * 2 : 16;
+                struct journal_record *new_list = realloc(list, new_size * sizeof(struct journal_record));
+
+                if (new_list == NULL) {
+                    free(list);
+                    return -1;
+                }
+
+                list = new_list;
+                list_size = new_size;
+            }
+
+            list[list_count] = (struct journal_record) {
+                id, (uint8_t) type, data + body, length, false
+            };
+            ++list_count;
+
+            pos = body + length + 1;
+            continue;
+        }
+
+        if (header[0] == 'D' && sscanf(header, "D %" SCNu64 " %" SCNx32, &id, &checksum) == 2) {
+            if (body >= size || data[body] != '\n' || checksum != journal_checksum(id, 0, NULL, 0)) {
+                break;
+            }
+
+            struct journal_record *record = journal_find(list, list_count, id);
+
+            if (record != NULL && !record->removed) {
+                record->removed = true;
+                ++num_dead;
+            }
+
+            ++num_dead;
+            pos = body + 1;
+            continue;
+        }
+
+        break;
+    }
+
+    *records = list;
+    *count = list_count;
+    *valid = pos;
+    *dead = num_dead;
+
+    return 0;
+}
+
+struct message_journal *message_journal_open(const char *path, message_journal_replay_cb *replay, void *userdata)
+{
+    struct message_journal *journal = calloc(1, sizeof(struct message_journal));
+
+    if (journal == NULL) {
+        return NULL;
+    }
+
+    journal->path = strdup(path);
+
+    if (journal->path == NULL) {
+        free(journal);
+        return NULL;
+    }
+
+    journal->next_id = 1;
+
+    size_t size = 0;
+    char *data = journal_read_file(path, &size);
+
+    if (data != NULL) {
+        struct journal_record *records = NULL;
+        size_t count = 0;
+        size_t valid = 0;
+
+        if (journal_parse(data, size, &records, &count, &valid, &journal->dead) != 0) {
+            free(data);
+            free(journal->path);
+            free(journal);
+            return NULL;
+        }
+
+        /* drop a torn or corrupt tail so that new records aren't appended after it */
+        if (valid < size && truncate(path, (off_t) valid) != 0) {
+            free(records);
+            free(data);
+            free(journal->path);
+            free(journal);
+            return NULL;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            if (records[i].removed) {
+                continue;
+            }
+
+            ++journal->live;
+
+            if (replay != NULL) {
+                replay(records[i].id, records[i].type, records[i].message, records[i].length, userdata);
+            }
+        }
+
+        if (count > 0) {
+            journal->next_id = records[count - 1].id + 1;
+        }
+
+        free(records);
+        free(data);
+    }
+
+    journal->stream = log_writer_open_synced(path);
+
+    if (journal->stream == NULL) {
+        free(journal->path);
+        free(journal);
+        return NULL;
+    }
+
+    return journal;
+}
+
+/* Queues a record for the journal's file, and for the new file if the journal is being compacted.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+static int journal_append(struct message_journal *journal, const char *header, int header_len, const char *message,
+                          size_t length)
+{
+    if (journal->stream == NULL || header_len < 0
+            || log_writer_append(journal->stream, header, header_len, message, length) != 0) {
+        return -1;
+    }
+
+    struct message_journal_compaction *compaction = journal->compaction;
+
+    if (compaction != NULL && log_writer_append(compaction->stream, header, header_len, message, length) != 0) {
+        /* the new file would be missing a record, so it mustn't replace the old one */
+        pthread_mutex_lock(&compaction->lock);
+        compaction->result = -1;
+        pthread_mutex_unlock(&compaction->lock);
+    }
+
+    return 0;
+}
+
+uint64_t message_journal_add(struct message_journal *journal, uint8_t type, const char *message, size_t length)
+{
+    char header[MESSAGE_JOURNAL_MAX_HEADER];
+    const uint64_t id = journal->next_id;
+    const int header_len = journal_add_header(header, sizeof(header), id, type, message, length);
+
+    if (journal_append(journal, header, header_len, message, length) != 0) {
+        return 0;
+    }
+
+    ++journal->next_id;
+    ++journal->live;
+
+    return id;
+}
+
+int message_journal_remove(struct message_journal *journal, uint64_t id)
+{
+    char header[MESSAGE_JOURNAL_MAX_HEADER];
+    const int header_len = journal_remove_header(header, sizeof(header), id);
+
+    if (journal_append(journal, header, header_len, NULL, 0) != 0) {
+        return -1;
+    }
+
+    if (journal->live > 0) {
+        --journal->live;
+    }
+
+    /* the add record and this one */
+    journal->dead += 2;
+
+    return 0;
+}
+
+bool message_journal_needs_compaction(const struct message_journal *journal)
+{
+    return journal->compaction == NULL && journal->dead >= MESSAGE_JOURNAL_COMPACT_MIN && journal->dead >= journal->live;
+}
+
+/* Puts the records of the messages returned by `next` in a new buffer, which the caller must free, and
+ * its length in `length`.
+ *
+ * Returns NULL on failure.
+ */
+static char *journal_snapshot(message_journal_next_cb *next, void *userdata, size_t *length)
+{
+    char *data = NULL;
+    size_t data_len = 0;
+    size_t data_size = 0;
+    uint64_t id;
+    uint8_t type;
+    const char *message;
+    size_t message_len;
+
+    while (next(userdata, &id, &type, &message, &message_len)) {
+        char header[MESSAGE_JOURNAL_MAX_HEADER];
+        const int header_len = journal_add_header(header, sizeof(header), id, type, message, message_len);
+
+        if (header_len < 0) {
+            free(data);
+            return NULL;
+        }
+
+        const size_t record_len = (size_t) header_len + message_len + 1;
+
+        if (data_len + record_len > data_size) {
+            size_t new_size = data_size > 0 ? data_size : 1024;
+
+            while (new_size < data_len + record_len) {
+                new_size *= 2;
+            }
+
+            char *new_data = realloc(data, new_size);
+
+            if (new_data == NULL) {
+                free(data);
+                return NULL;
+            }
+
+            data = new_data;
+            data_size = new_size;
+        }
+
+        memcpy(data + data_len, header, (size_t) header_len);
+        memcpy(data + data_len + header_len, message, message_len);
+        data[data_len + record_len - 1] = '\n';
+        data_len += record_len;
+    }
+
+    *length = data_len;
+
+    /* an empty snapshot still needs a buffer so that NULL means failure */
+    return data != NULL ? data : malloc(1);
+}
+
+/* Fsyncs the directory containing `path` so that a rename into it is durable. */
+static void journal_sync_dir(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+
+    if (slash == NULL) {
+        return;
+    }
+
+    const size_t dir_len = slash == path ? 1 : (size_t)(slash - path);
+    char *dir = malloc(dir_len + 1);
+
+    if (dir == NULL) {
+        return;
+    }
+
+    memcpy(dir, path, dir_len);
+    dir[dir_len] = '\0';
+
+    const int fd = open(dir, O_RDONLY | O_CLOEXEC);
+
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+
+    free(dir);
+}
+
+struct message_journal_compaction *message_journal_compact_begin(struct message_journal *journal,
+        message_journal_next_cb *next, void *userdata)
+{
+    if (journal->compaction != NULL || journal->stream == NULL) {
+        return NULL;
+    }
+
+    struct message_journal_compaction *compaction = calloc(1, sizeof(struct message_journal_compaction));
+
+    if (compaction == NULL) {
+        return NULL;
+    }
+
+    const size_t tmp_len = strlen(journal->path) + sizeof(".tmp");
+    compaction->path = strdup(journal->path);
+    compaction->tmp_path = malloc(tmp_len);
+
+    if (compaction->path == NULL || compaction->tmp_path == NULL) {
+        free(compaction->path);
+        free(compaction->tmp_path);
+        free(compaction);
+        return NULL;
+    }
+
+    snprintf(compaction->tmp_path, tmp_len, "%s.tmp", journal->path);
+    pthread_mutex_init(&compaction->lock, NULL);
+
+    size_t length = 0;
+    char *data = journal_snapshot(next, userdata, &length);
+
+    /* the new file must start out empty; anything left over from an earlier attempt is garbage */
+    unlink(compaction->tmp_path);
+
+    if (data != NULL) {
+        compaction->stream = log_writer_open_synced(compaction->tmp_path);
+    }
+
+    if (compaction->stream == NULL
+            || (length > 0 && log_writer_append(compaction->stream, data, length - 1, NULL, 0) != 0)) {
+        free(data);
+        compaction->result = -1;
+        message_journal_compact_free(compaction);
+        return NULL;
+    }
+
+    free(data);
+
+    compaction->journal = journal;
+    compaction->old_stream = journal->stream;
+    compaction->dead = journal->dead;
+    journal->compaction = compaction;
+
+    return compaction;
+}
+
+void message_journal_compact_write(struct message_journal_compaction *compaction)
+{
+    const bool synced = log_writer_sync(compaction->stream) == 0;
+
+    pthread_mutex_lock(&compaction->lock);
+
+    /* once the journal is closed it may be opened again, so the file at its path has to stay put */
+    const bool renamed = synced && compaction->result == 0 && compaction->journal != NULL
+                         && rename(compaction->tmp_path, compaction->path) == 0;
+
+    if (!renamed) {
+        compaction->result = -1;
+    }
+
+    pthread_mutex_unlock(&compaction->lock);
+
+    if (renamed) {
+        journal_sync_dir(compaction->path);
+    } else {
+        unlink(compaction->tmp_path);
+    }
+}
+
+int message_journal_compact_finish(struct message_journal_compaction *compaction)
+{
+    struct message_journal *journal = compaction->journal;
+
+    if (journal == NULL) {
+        return -1;
+    }
+
+    journal->compaction = NULL;
+
+    if (compaction->result != 0) {
+        compaction->old_stream = NULL;
+        return -1;
+    }
+
+    /* every record added since the compaction began is in the new file, and none of the dead ones before */
+    journal->stream = compaction->stream;
+    journal->dead -= compaction->dead;
+    compaction->stream = NULL;
+
+    return 0;
+}
+
+void message_journal_compact_free(struct message_journal_compaction *compaction)
+{
+    if (compaction == NULL) {
+        return;
+    }
+
+    log_writer_close(compaction->stream);
+    log_writer_close(compaction->old_stream);
+
+    if (compaction->result != 0) {
+        unlink(compaction->tmp_path);
+    }
+
+    pthread_mutex_destroy(&compaction->lock);
+    free(compaction->path);
+    free(compaction->tmp_path);
+    free(compaction);
+}
+
+int message_journal_compact(struct message_journal *journal, message_journal_next_cb *next, void *userdata)
+{
+    struct message_journal_compaction *compaction = message_journal_compact_begin(journal, next, userdata);
+
+    if (compaction == NULL) {
+        return -1;
+    }
+
+    message_journal_compact_write(compaction);
+
+    const int ret = message_journal_compact_finish(compaction);
+
+    message_journal_compact_free(compaction);
+
+    return ret;
+}
+
+void message_journal_close(struct message_journal *journal)
+{
+    if (journal == NULL) {
+        return;
+    }
+
+    struct message_journal_compaction *compaction = journal->compaction;
+
+    if (compaction != NULL) {
+        /* the compaction closes both files once it's done, but the journal may be reopened before then */
+        log_writer_sync(compaction->old_stream);
+        log_writer_sync(compaction->stream);
+
+        pthread_mutex_lock(&compaction->lock);
+        compaction->journal = NULL;
+        pthread_mutex_unlock(&compaction->lock);
+    } else {
+        log_writer_close(journal->stream);
+    }
+
+    free(journal->path);
+    free(journal);
+}
+
+size_t message_journal_count(const char *path)
+{
+    size_t size = 0;
+    char *data = journal_read_file(path, &size);
+
+    if (data == NULL) {
+        return 0;
+    }
+
+    struct journal_record *records = NULL;
+    size_t count = 0;
+    size_t valid = 0;
+    size_t dead = 0;
+    size_t live = 0;
+
+    if (journal_parse(data, size, &records, &count, &valid, &dead) == 0) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!records[i].removed) {
+                ++live;
+            }
+        }
+
+        free(records);
+    }
+
+    free(data);
+
+    return live;
+}
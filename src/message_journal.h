@@ -0,0 +1,126 @@
+/*  message_journal.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef MESSAGE_JOURNAL_H
+#define MESSAGE_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* A journal isn't compacted until it holds at least this many dead records */
+#define MESSAGE_JOURNAL_COMPACT_MIN 64
+
+/*
+ * Append-only on-disk record of the messages waiting in a friend's send queue.
+ *
+ * Queueing a message appends an add record and delivering it appends a remove record. Records are
+ * written by the log writer, which fsyncs the journal once per batch, so neither costs the caller any
+ * disk I/O. Every record carries a checksum, and a torn or corrupt record ends the journal when it's
+ * replayed, so a crash loses at most the last batch.
+ *
+ * Once dead records outnumber live ones the journal can be compacted, which rewrites it with only the
+ * live messages and atomically replaces the old file.
+ */
+struct message_journal;
+
+/* Called for each message that's still in the journal when it's opened, in the order they were added. */
+typedef void message_journal_replay_cb(uint64_t id, uint8_t type, const char *message, size_t length,
+                                       void *userdata);
+
+/* Puts the next live message in `id`, `type`, `message` and `length`.
+ *
+ * Return true on success.
+ * Return false if there are no more messages.
+ */
+typedef bool message_journal_next_cb(void *userdata, uint64_t *id, uint8_t *type, const char **message,
+                                     size_t *length);
+
+/* Opens the journal at `path`, creating it if it doesn't exist, and calls `replay` for each message in it.
+ * Anything after the first torn or corrupt record is discarded.
+ *
+ * Return NULL on failure.
+ */
+struct message_journal *message_journal_open(const char *path, message_journal_replay_cb *replay, void *userdata);
+
+/* Appends a message of `length` bytes to `journal`.
+ *
+ * Returns the message's id on success.
+ * Returns 0 on failure.
+ */
+uint64_t message_journal_add(struct message_journal *journal, uint8_t type, const char *message, size_t length);
+
+/* Appends a record marking the message with `id` as delivered.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int message_journal_remove(struct message_journal *journal, uint64_t id);
+
+/* Returns true if `journal` has enough dead records that it should be compacted. */
+bool message_journal_needs_compaction(const struct message_journal *journal);
+
+/* Replaces the contents of `journal` with the live messages returned by `next`, which must return every
+ * message that's been added and not removed, in the order they were added.
+ *
+ * Return 0 on success.
+ * Return -1 on failure, in which case the journal is left as it was.
+ */
+int message_journal_compact(struct message_journal *journal, message_journal_next_cb *next, void *userdata);
+
+/*
+ * A compaction done in steps, so that the caller only needs to hold the lock that guards `journal` while
+ * the live messages are copied and while the new file takes over from the old one:
+ *
+ *   message_journal_compact_begin()   with the lock held
+ *   message_journal_compact_write()   without it; waits for the new file to be written and renames it
+ *   message_journal_compact_finish()  with the lock held
+ *   message_journal_compact_free()    without it; waits for the old file to be written and closes it
+ *
+ * Records added in the meantime are written to both files. If the journal is closed before the
+ * compaction is done, the old file is kept.
+ */
+struct message_journal_compaction;
+
+/* Starts a compaction of `journal` with the live messages returned by `next`, as for
+ * message_journal_compact().
+ *
+ * Returns NULL on failure or if a compaction is already in progress.
+ */
+struct message_journal_compaction *message_journal_compact_begin(struct message_journal *journal,
+        message_journal_next_cb *next, void *userdata);
+
+/* Waits until the new file holds every live message and moves it to the journal's path. */
+void message_journal_compact_write(struct message_journal_compaction *compaction);
+
+/* Switches the journal over to the new file.
+ *
+ * Return 0 on success.
+ * Return -1 on failure, in which case the journal is left as it was.
+ */
+int message_journal_compact_finish(struct message_journal_compaction *compaction);
+
+/* Closes whichever file the journal no longer uses and frees `compaction`. */
+void message_journal_compact_free(struct message_journal_compaction *compaction);
+
+/* Writes everything that's been appended to `journal` and closes it. */
+void message_journal_close(struct message_journal *journal);
+
+/* Returns the number of live messages in the journal at `path`, or 0 if it doesn't exist. */
+size_t message_journal_count(const char *path);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* MESSAGE_JOURNAL_H */
@@ -0,0 +1,306 @@
+#include "message_journal.h"
+#include "log_writer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+struct Replayed {
+    uint64_t id;
+    uint8_t type;
+    std::string message;
+
+    bool operator==(const Replayed &other) const
+    {
+        return id == other.id && type == other.type && message == other.message;
+    }
+};
+
+void collect(uint64_t id, uint8_t type, const char *message, size_t length, void *userdata)
+{
+    static_cast<std::vector<Replayed> *>(userdata)->push_back({id, type, std::string(message, length)});
+}
+
+class MessageJournal : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        std::snprintf(path_, sizeof(path_), "%s/toxic_message_journal_test_XXXXXX", testing::TempDir().c_str());
+        const int fd = mkstemp(path_);
+        ASSERT_NE(fd, -1);
+        close(fd);
+
+        ASSERT_EQ(log_writer_start(0), 0);
+    }
+
+    void TearDown() override
+    {
+        log_writer_stop();
+        std::remove(path_);
+    }
+
+    std::vector<Replayed> reopen(struct message_journal **journal)
+    {
+        if (*journal != nullptr) {
+            message_journal_close(*journal);
+        }
+
+        std::vector<Replayed> replayed;
+        *journal = message_journal_open(path_, collect, &replayed);
+        return replayed;
+    }
+
+    static uint64_t add(struct message_journal *journal, const std::string &message, uint8_t type = 0)
+    {
+        return message_journal_add(journal, type, message.data(), message.size());
+    }
+
+    std::string read_file() const
+    {
+        std::ifstream in(path_);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+
+    void write_file(const std::string &contents) const
+    {
+        std::ofstream out(path_, std::ios::trunc);
+        out << contents;
+    }
+
+    char path_[PATH_MAX];
+};
+
+TEST_F(MessageJournal, ReplaysUndeliveredMessagesInOrder)
+{
+    struct message_journal *journal = nullptr;
+    EXPECT_TRUE(reopen(&journal).empty());
+    ASSERT_NE(journal, nullptr);
+
+    EXPECT_EQ(add(journal, "hello"), 1u);
+    EXPECT_EQ(add(journal, "delivered"), 2u);
+    EXPECT_EQ(add(journal, "two\nlines: with a colon", 1), 3u);
+    EXPECT_EQ(message_journal_remove(journal, 2), 0);
+
+    const std::vector<Replayed> replayed = reopen(&journal);
+    ASSERT_NE(journal, nullptr);
+    EXPECT_EQ(replayed, (std::vector<Replayed> {{1, 0, "hello"}, {3, 1, "two\nlines: with a colon"}}));
+
+    // ids carry on from the replayed journal
+    EXPECT_EQ(add(journal, "after"), 4u);
+
+    message_journal_close(journal);
+    EXPECT_EQ(message_journal_count(path_), 3u);
+}
+
+TEST_F(MessageJournal, TornTailIsDiscarded)
+{
+    struct message_journal *journal = nullptr;
+    reopen(&journal);
+    add(journal, "one");
+    add(journal, "two");
+    message_journal_close(journal);
+    journal = nullptr;
+
+    const std::string good = read_file();
+    write_file(good + "A 3 0 100 12345678:only part of a mess");
+
+    EXPECT_EQ(reopen(&journal), (std::vector<Replayed> {{1, 0, "one"}, {2, 0, "two"}}));
+    ASSERT_NE(journal, nullptr);
+    EXPECT_EQ(read_file(), good);
+
+    EXPECT_EQ(add(journal, "three"), 3u);
+    EXPECT_EQ(reopen(&journal).size(), 3u);
+
+    message_journal_close(journal);
+}
+
+TEST_F(MessageJournal, CorruptRecordEndsReplay)
+{
+    struct message_journal *journal = nullptr;
+    reopen(&journal);
+    add(journal, "first");
+    add(journal, "second");
+    add(journal, "third");
+    message_journal_close(journal);
+    journal = nullptr;
+
+    std::string contents = read_file();
+    contents[contents.find("second")] = 'S';
+    write_file(contents);
+
+    EXPECT_EQ(reopen(&journal), (std::vector<Replayed> {{1, 0, "first"}}));
+    message_journal_close(journal);
+}
+
+TEST_F(MessageJournal, MissingFileIsEmpty)
+{
+    std::remove(path_);
+    EXPECT_EQ(message_journal_count(path_), 0u);
+
+    struct message_journal *journal = nullptr;
+    EXPECT_TRUE(reopen(&journal).empty());
+    ASSERT_NE(journal, nullptr);
+    message_journal_close(journal);
+}
+
+struct Live_Messages {
+    std::vector<Replayed> messages;
+    size_t pos = 0;
+};
+
+bool next_live(void *userdata, uint64_t *id, uint8_t *type, const char **message, size_t *length)
+{
+    auto *live = static_cast<Live_Messages *>(userdata);
+
+    if (live->pos == live->messages.size()) {
+        return false;
+    }
+
+    const Replayed &msg = live->messages[live->pos++];
+    *id = msg.id;
+    *type = msg.type;
+    *message = msg.message.data();
+    *length = msg.message.size();
+    return true;
+}
+
+TEST_F(MessageJournal, CompactionKeepsOnlyLiveMessages)
+{
+    struct message_journal *journal = nullptr;
+    reopen(&journal);
+
+    Live_Messages live;
+
+    for (int i = 0; i < 100; ++i) {
+        const std::string msg = "message " + std::to_string(i);
+        const uint64_t id = add(journal, msg);
+        ASSERT_NE(id, 0u);
+
+        if (i % 10 == 0) {
+            live.messages.push_back({id, 0, msg});
+        } else {
+            ASSERT_EQ(message_journal_remove(journal, id), 0);
+        }
+    }
+
+    ASSERT_TRUE(message_journal_needs_compaction(journal));
+
+    ASSERT_EQ(message_journal_compact(journal, next_live, &live), 0);
+    EXPECT_FALSE(message_journal_needs_compaction(journal));
+
+    // the compacted journal holds one add record per live message and nothing else
+    const std::string contents = read_file();
+    EXPECT_EQ(std::count(contents.begin(), contents.end(), '\n'), 10);
+    EXPECT_EQ(contents.find("D "), std::string::npos);
+
+    // appends go to the compacted file
+    EXPECT_EQ(add(journal, "new"), 101u);
+
+    std::vector<Replayed> expected = live.messages;
+    expected.push_back({101, 0, "new"});
+
+    EXPECT_EQ(reopen(&journal), expected);
+    message_journal_close(journal);
+}
+
+TEST_F(MessageJournal, RecordsAddedDuringCompactionAreKept)
+{
+    struct message_journal *journal = nullptr;
+    reopen(&journal);
+
+    Live_Messages live;
+
+    for (int i = 0; i < 100; ++i) {
+        const uint64_t id = add(journal, "message " + std::to_string(i));
+
+        if (i == 0) {
+            live.messages.push_back({id, 0, "message 0"});
+        } else {
+            ASSERT_EQ(message_journal_remove(journal, id), 0);
+        }
+    }
+
+    struct message_journal_compaction *compaction = message_journal_compact_begin(journal, next_live, &live);
+    ASSERT_NE(compaction, nullptr);
+    EXPECT_FALSE(message_journal_needs_compaction(journal));
+
+    // these go to both files, so they survive whether or not the new one has replaced the old one yet
+    EXPECT_EQ(add(journal, "during"), 101u);
+    ASSERT_EQ(message_journal_remove(journal, 1), 0);
+
+    message_journal_compact_write(compaction);
+    EXPECT_EQ(add(journal, "after write"), 102u);
+
+    EXPECT_EQ(message_journal_compact_finish(compaction), 0);
+    message_journal_compact_free(compaction);
+
+    EXPECT_EQ(add(journal, "after finish"), 103u);
+
+    EXPECT_EQ(reopen(&journal), (std::vector<Replayed> {{101, 0, "during"}, {102, 0, "after write"},
+        {103, 0, "after finish"}
+    }));
+    const std::string contents = read_file();
+    EXPECT_EQ(std::count(contents.begin(), contents.end(), '\n'), 5);
+    message_journal_close(journal);
+}
+
+TEST_F(MessageJournal, JournalClosedDuringCompactionKeepsOldFile)
+{
+    struct message_journal *journal = nullptr;
+    reopen(&journal);
+
+    Live_Messages live;
+
+    for (int i = 0; i < 100; ++i) {
+        const uint64_t id = add(journal, "message " + std::to_string(i));
+
+        if (i == 0) {
+            live.messages.push_back({id, 0, "message 0"});
+        } else {
+            ASSERT_EQ(message_journal_remove(journal, id), 0);
+        }
+    }
+
+    struct message_journal_compaction *compaction = message_journal_compact_begin(journal, next_live, &live);
+    ASSERT_NE(compaction, nullptr);
+
+    EXPECT_EQ(add(journal, "during"), 101u);
+    message_journal_close(journal);
+    journal = nullptr;
+
+    message_journal_compact_write(compaction);
+    EXPECT_EQ(message_journal_compact_finish(compaction), -1);
+    message_journal_compact_free(compaction);
+
+    EXPECT_EQ(reopen(&journal), (std::vector<Replayed> {{1, 0, "message 0"}, {101, 0, "during"}}));
+    EXPECT_EQ(access((std::string(path_) + ".tmp").c_str(), F_OK), -1);
+    message_journal_close(journal);
+}
+
+TEST_F(MessageJournal, FewDeadRecordsDontNeedCompaction)
+{
+    struct message_journal *journal = nullptr;
+    reopen(&journal);
+
+    for (int i = 0; i < 10; ++i) {
+        message_journal_remove(journal, add(journal, "x"));
+    }
+
+    EXPECT_FALSE(message_journal_needs_compaction(journal));
+    message_journal_close(journal);
+}
+
+}  // namespace
@@ -7,7 +7,9 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
+#include "configdir.h"
 #include "line_info.h"
 #include "log.h"
 #include "message_queue.h"
@@ -25,28 +27,39 @@ void cqueue_cleanup(struct chat_queue *q)
         tmp1 = tmp2;
     }
 
+    if (q->journal != NULL) {
+        message_journal_close(q->journal);
+    }
+
+    peer_map_free(&q->receipts);
+    free(q->slots);
     free(q);
 }
 
-void cqueue_add(struct chat_queue *q, const char *msg, size_t len, uint8_t type, int line_id)
+/* Appends a new unsent message to the end of the queue and returns it. */
+static struct cqueue_msg *cqueue_push(struct chat_queue *q, const char *msg, size_t len, uint8_t type,
+                                      int line_id)
 {
-    if (line_id < 0) {
-        return;
-    }
-
     struct cqueue_msg *new_m = calloc(1, sizeof(struct cqueue_msg));
 
     if (new_m == NULL) {
         exit_toxic_err(FATALERR_MEMORY, "failed in cqueue_message");
     }
 
-    snprintf(new_m->message, sizeof(new_m->message), "%s", msg);
+    if (len >= sizeof(new_m->message)) {
+        len = sizeof(new_m->message) - 1;
+    }
+
+    memcpy(new_m->message, msg, len);
+    new_m->message[len] = '\0';
     new_m->len = len;
     new_m->type = type;
     new_m->line_id = line_id;
     new_m->last_send_try = 0;
     new_m->time_added = get_unix_time();
     new_m->receipt = -1;
+    new_m->slot = CQUEUE_NO_SLOT;
+    new_m->journal_id = 0;
     new_m->next = NULL;
     new_m->noread_flag = false;
 
@@ -59,6 +72,244 @@ void cqueue_add(struct chat_queue *q, const char *msg, size_t len, uint8_t type,
     }
 
     q->end = new_m;
+
+    if (q->next_unsent == NULL) {
+        q->next_unsent = new_m;
+    }
+
+    return new_m;
+}
+
+void cqueue_add(struct chat_queue *q, const char *msg, size_t len, uint8_t type, int line_id)
+{
+    if (line_id < 0) {
+        return;
+    }
+
+    struct cqueue_msg *new_m = cqueue_push(q, msg, len, type, line_id);
+
+    if (q->journal != NULL) {
+        new_m->journal_id = message_journal_add(q->journal, type, new_m->message, new_m->len);
+    }
+
+    reactor_signal(&cqueue_thread.reactor);
+}
+
+int cqueue_get_journal_path(const Paths *paths, const uint8_t *self_key, const uint8_t *friend_key, char *buf,
+                            size_t buf_size)
+{
+    char self_str[TOX_PUBLIC_KEY_SIZE * 2 + 1];
+    char friend_str[TOX_PUBLIC_KEY_SIZE * 2 + 1];
+
+    if (tox_pk_bytes_to_str(self_key, TOX_PUBLIC_KEY_SIZE, self_str, sizeof(self_str)) != 0
+            || tox_pk_bytes_to_str(friend_key, TOX_PUBLIC_KEY_SIZE, friend_str, sizeof(friend_str)) != 0) {
+        return -1;
+    }
+
+    char *user_config_dir = get_user_config_dir(paths);
+
+    if (user_config_dir == NULL) {
+        return -1;
+    }
+
+    const int len = snprintf(buf, buf_size, "%s%s%s-%s.journal", user_config_dir, QUEUEDIR, self_str, friend_str);
+
+    free(user_config_dir);
+
+    if (len < 0 || (size_t) len >= buf_size) {
+        return -1;
+    }
+
+    return 0;
+}
+
+struct cqueue_replay_ctx {
+    struct chat_queue *q;
+    cqueue_replay_cb *replay;
+    void *userdata;
+};
+
+static void cqueue_replay_message(uint64_t id, uint8_t type, const char *message, size_t length, void *userdata)
+{
+    const struct cqueue_replay_ctx *ctx = (const struct cqueue_replay_ctx *) userdata;
+
+    /* the message stays queued even if it can't be shown, since it's still waiting to be delivered */
+    struct cqueue_msg *msg = cqueue_push(ctx->q, message, length, type, -1);
+    msg->journal_id = id;
+    msg->line_id = ctx->replay(msg, ctx->userdata);
+}
+
+int cqueue_load_journal(struct chat_queue *q, const char *path, cqueue_replay_cb *replay, void *userdata)
+{
+    if (q->journal != NULL) {
+        return -1;
+    }
+
+    struct cqueue_replay_ctx ctx = {
+        q,
+        replay,
+        userdata,
+    };
+
+    q->journal = message_journal_open(path, cqueue_replay_message, &ctx);
+
+    if (q->journal == NULL) {
+        return -1;
+    }
+
+    if (q->root != NULL) {
+        reactor_signal(&cqueue_thread.reactor);
+    }
+
+    return 0;
+}
+
+static bool cqueue_next_journaled(void *userdata, uint64_t *id, uint8_t *type, const char **message,
+                                  size_t *length)
+{
+    const struct cqueue_msg **cursor = (const struct cqueue_msg **) userdata;
+
+    while (*cursor != NULL && (*cursor)->journal_id == 0) {
+        *cursor = (*cursor)->next;
+    }
+
+    const struct cqueue_msg *msg = *cursor;
+
+    if (msg == NULL) {
+        return false;
+    }
+
+    *id = msg->journal_id;
+    *type = msg->type;
+    *message = msg->message;
+    *length = msg->len;
+
+    *cursor = msg->next;
+
+    return true;
+}
+
+struct message_journal_compaction *cqueue_compact_journal(struct chat_queue *q)
+{
+    if (q->journal == NULL || !message_journal_needs_compaction(q->journal)) {
+        return NULL;
+    }
+
+    const struct cqueue_msg *cursor = q->root;
+    struct message_journal_compaction *compaction = message_journal_compact_begin(q->journal, cqueue_next_journaled,
+            &cursor);
+
+    if (compaction == NULL) {
+        fprintf(stderr, "Failed to compact message queue journal\n");
+    }
+
+    return compaction;
+}
+
+/* Makes room for at least `window` messages awaiting receipts. */
+static void cqueue_grow_slots(struct chat_queue *q, uint32_t window)
+{
+    if (q->slots_size >= window) {
+        return;
+    }
+
+    struct cqueue_msg **new_slots = realloc(q->slots, window * sizeof(struct cqueue_msg *));
+
+    if (new_slots == NULL) {
+        exit_toxic_err(FATALERR_MEMORY, "failed in cqueue_grow_slots");
+    }
+
+    for (uint32_t i = q->slots_size; i < window; ++i) {
+        new_slots[i] = NULL;
+    }
+
+    q->slots = new_slots;
+    q->slots_size = window;
+}
+
+/* Records that `msg` is awaiting `receipt`. There must be a free slot. */
+static void cqueue_track(struct chat_queue *q, struct cqueue_msg *msg, uint32_t receipt)
+{
+    uint32_t slot = q->slots_cursor % q->slots_size;
+
+    while (q->slots[slot] != NULL) {
+        slot = (slot + 1) % q->slots_size;
+    }
+
+    if (peer_map_add(&q->receipts, receipt, slot) != 0) {
+        exit_toxic_err(FATALERR_MEMORY, "failed in cqueue_track");
+    }
+
+    q->slots[slot] = msg;
+    q->slots_cursor = slot + 1;
+    ++q->in_flight;
+
+    msg->receipt = receipt;
+    msg->slot = slot;
+}
+
+/* Forgets that `msg` is awaiting a receipt. */
+static void cqueue_untrack(struct chat_queue *q, struct cqueue_msg *msg)
+{
+    if (msg->slot == CQUEUE_NO_SLOT) {
+        return;
+    }
+
+    peer_map_remove(&q->receipts, (uint64_t) msg->receipt, msg->slot);
+
+    q->slots[msg->slot] = NULL;
+    --q->in_flight;
+
+    msg->receipt = -1;
+    msg->slot = CQUEUE_NO_SLOT;
+}
+
+void cqueue_reset_sent(struct chat_queue *q)
+{
+    for (struct cqueue_msg *msg = q->root; msg != q->next_unsent; msg = msg->next) {
+        cqueue_untrack(q, msg);
+    }
+
+    q->next_unsent = q->root;
+}
+
+struct cqueue_msg *cqueue_take_receipt(struct chat_queue *q, uint32_t receipt)
+{
+    Peer_Map_Iter iter = {0};
+    uint32_t slot;
+
+    while ((slot = peer_map_next(&q->receipts, receipt, &iter)) != PEER_MAP_NONE) {
+        struct cqueue_msg *msg = q->slots[slot];
+
+        if (msg->receipt != receipt) {
+            continue;
+        }
+
+        cqueue_untrack(q, msg);
+
+        if (q->journal != NULL && msg->journal_id != 0) {
+            message_journal_remove(q->journal, msg->journal_id);
+        }
+
+        if (msg->prev == NULL) {
+            q->root = msg->next;
+        } else {
+            msg->prev->next = msg->next;
+        }
+
+        if (msg->next == NULL) {
+            q->end = msg->prev;
+        } else {
+            msg->next->prev = msg->prev;
+        }
+
+        msg->prev = NULL;
+        msg->next = NULL;
+
+        return msg;
+    }
+
+    return NULL;
 }
 
 /* update line to show receipt was received after queue removal */
@@ -75,6 +326,7 @@ static void cqueue_mark_read(ToxWindow *self, struct cqueue_msg *msg)
     if (line->noread_flag) {
         line->noread_flag = false;
         line->read_flag = true;
+        line->dirty = true;
         flag_interface_refresh();
     }
 }
@@ -84,47 +336,34 @@ void cqueue_remove(ToxWindow *self, Toxic *toxic, uint32_t receipt)
 {
     struct chatlog *log = self->chatwin->log;
     struct chat_queue *q = self->chatwin->cqueue;
-    struct cqueue_msg *msg = q->root;
 
     Tox *tox = toxic->tox;
     const Client_Config *c_config = toxic->c_config;
 
-    while (msg) {
-        if (msg->receipt != receipt) {
-            msg = msg->next;
-            continue;
-        }
-
-        if (log->log_on) {
-            char selfname[TOX_MAX_NAME_LENGTH + 1];
-            tox_self_get_name(tox, (uint8_t *) selfname);
-
-            const size_t len = tox_self_get_name_size(tox);
-            selfname[len] = '\0';
+    struct cqueue_msg *msg = cqueue_take_receipt(q, receipt);
 
-            write_to_log(log, c_config, msg->message, selfname,
-                         msg->type == OUT_MSG ? LOG_HINT_NORMAL_O : LOG_HINT_ACTION);
-        }
+    if (msg == NULL) {
+        return;
+    }
 
-        cqueue_mark_read(self, msg);
+    if (log->log_on) {
+        char selfname[TOX_MAX_NAME_LENGTH + 1];
+        tox_self_get_name(tox, (uint8_t *) selfname);
 
-        struct cqueue_msg *next = msg->next;
+        const size_t len = tox_self_get_name_size(tox);
+        selfname[len] = '\0';
 
-        if (msg->prev == NULL) {    /* root */
-            if (next) {
-                next->prev = NULL;
-            }
+        write_to_log(log, c_config, msg->message, selfname,
+                     msg->type == OUT_MSG ? LOG_HINT_NORMAL_O : LOG_HINT_ACTION);
+    }
 
-            q->root = next;
-        } else {
-            struct cqueue_msg *prev = msg->prev;
-            prev->next = next;
-            next->prev = prev;
-        }
+    cqueue_mark_read(self, msg);
 
-        free(msg);
+    free(msg);
 
-        return;
+    /* a slot in the send window just opened up, or the journal is due for compaction */
+    if (q->next_unsent != NULL || (q->journal != NULL && message_journal_needs_compaction(q->journal))) {
+        reactor_signal(&cqueue_thread.reactor);
     }
 }
 
@@ -133,16 +372,21 @@ void cqueue_remove(ToxWindow *self, Toxic *toxic, uint32_t receipt)
 #define TRY_SEND_TIMEOUT 32
 
 /*
- * Marks all timed out messages in queue as unsent.
+ * Sends the oldest message awaiting a receipt and everything after it again if it has timed out.
+ *
+ * Messages are sent in queue order and resent from the first one onward, so no message awaiting a
+ * receipt can time out before the one at the root of the queue.
  */
-static void cqueue_check_timeouts(struct cqueue_msg *msg)
+static void cqueue_check_timeouts(struct chat_queue *q, time_t now)
 {
-    while (msg) {
-        if (timed_out(msg->last_send_try, TRY_SEND_TIMEOUT)) {
-            msg->receipt = -1;
-        }
+    const struct cqueue_msg *oldest = q->root;
 
-        msg = msg->next;
+    if (oldest == NULL || oldest == q->next_unsent) {
+        return;
+    }
+
+    if (oldest->last_send_try + TRY_SEND_TIMEOUT <= now) {
+        cqueue_reset_sent(q);
     }
 }
 
@@ -167,6 +411,7 @@ void cqueue_check_unread(ToxWindow *self)
         if (line != NULL) {
             if (timed_out(msg->time_added, NOREAD_TIMEOUT)) {
                 line->noread_flag = true;
+                line->dirty = true;
                 msg->noread_flag = true;
                 flag_interface_refresh();
             }
@@ -176,34 +421,70 @@ void cqueue_check_unread(ToxWindow *self)
     }
 }
 
-/*
- * Tries to send all messages in the send queue in sequential order.
- * If a message fails to send the function will immediately return.
- */
-void cqueue_try_send(ToxWindow *self, Tox *tox)
+uint32_t cqueue_send_pending(struct chat_queue *q, uint32_t window, time_t now, cqueue_send_cb *send,
+                             void *userdata)
 {
-    struct chat_queue *q = self->chatwin->cqueue;
-    struct cqueue_msg *msg = q->root;
+    if (window == 0) {
+        window = 1;
+    } else if (window > CQUEUE_MAX_WINDOW) {
+        window = CQUEUE_MAX_WINDOW;
+    }
 
-    while (msg) {
-        if (msg->receipt != -1) {
-            // we can no longer try to send unsent messages until we get receipts for our previous sent
-            // messages, but we continue to iterate the list, checking timestamps for any further
-            // successfully sent messages that have not yet gotten a receipt.
-            cqueue_check_timeouts(msg);
-            return;
-        }
+    cqueue_check_timeouts(q, now);
 
-        Tox_Err_Friend_Send_Message err;
-        Tox_Message_Type type = msg->type == OUT_MSG ? TOX_MESSAGE_TYPE_NORMAL : TOX_MESSAGE_TYPE_ACTION;
-        uint32_t receipt = tox_friend_send_message(tox, self->num, type, (uint8_t *) msg->message, msg->len, &err);
+    uint32_t sent = 0;
 
-        if (err != TOX_ERR_FRIEND_SEND_MESSAGE_OK) {
-            return;
+    while (q->next_unsent != NULL && q->in_flight < window) {
+        struct cqueue_msg *msg = q->next_unsent;
+        const int64_t receipt = send(msg, userdata);
+
+        if (receipt < 0) {
+            break;
         }
 
-        msg->receipt = receipt;
-        msg->last_send_try = get_unix_time();
-        msg = msg->next;
+        cqueue_grow_slots(q, window);
+        cqueue_track(q, msg, (uint32_t) receipt);
+
+        msg->last_send_try = now;
+        q->next_unsent = msg->next;
+        ++sent;
     }
+
+    return sent;
+}
+
+struct cqueue_send_ctx {
+    Tox *tox;
+    uint32_t friendnumber;
+};
+
+static int64_t cqueue_send_message(const struct cqueue_msg *msg, void *userdata)
+{
+    const struct cqueue_send_ctx *ctx = (const struct cqueue_send_ctx *) userdata;
+
+    Tox_Err_Friend_Send_Message err;
+    const Tox_Message_Type type = msg->type == OUT_MSG ? TOX_MESSAGE_TYPE_NORMAL : TOX_MESSAGE_TYPE_ACTION;
+    const uint32_t receipt = tox_friend_send_message(ctx->tox, ctx->friendnumber, type, (const uint8_t *) msg->message,
+                             msg->len, &err);
+
+    if (err != TOX_ERR_FRIEND_SEND_MESSAGE_OK) {
+        return -1;
+    }
+
+    return receipt;
+}
+
+/*
+ * Tries to send the messages in the send queue in sequential order, keeping up to `window` messages
+ * awaiting read receipts at a time. If a message fails to send the function will immediately return.
+ */
+void cqueue_try_send(ToxWindow *self, Tox *tox, int window)
+{
+    struct cqueue_send_ctx ctx = {
+        tox,
+        self->num,
+    };
+
+    cqueue_send_pending(self->chatwin->cqueue, window > 0 ? (uint32_t) window : 1, get_unix_time(),
+                        cqueue_send_message, &ctx);
 }
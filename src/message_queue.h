@@ -9,6 +9,20 @@
 #ifndef MESSAGE_QUEUE_H
 #define MESSAGE_QUEUE_H
 
+#include "message_journal.h"
+#include "peer_map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Default and maximum number of messages we send to a friend before waiting for read receipts */
+#define CQUEUE_DEFAULT_WINDOW 16
+#define CQUEUE_MAX_WINDOW 256
+
+/* Marks a message that isn't awaiting a read receipt */
+#define CQUEUE_NO_SLOT UINT32_MAX
+
 struct cqueue_msg {
     char message[MAX_STR_SIZE];
     size_t len;
@@ -17,24 +31,108 @@ struct cqueue_msg {
     time_t time_added;
     uint8_t type;
     int64_t receipt;
+    uint32_t slot;    /* index in the queue's in-flight slots, or CQUEUE_NO_SLOT if unsent */
+    uint64_t journal_id;    /* id of the message in the queue's journal, or 0 if it isn't journaled */
     bool noread_flag;
     struct cqueue_msg *next;
     struct cqueue_msg *prev;
 };
 
+/*
+ * Messages are kept in the order they were queued. Sent messages that are awaiting a read receipt
+ * always form a prefix of the queue, so messages are handed to toxcore (and thus delivered) in order
+ * even though receipts may come back in any order.
+ */
 struct chat_queue {
     struct cqueue_msg *root;
     struct cqueue_msg *end;
+    struct cqueue_msg *next_unsent;    /* first message that hasn't been sent, or NULL */
+
+    struct cqueue_msg **slots;         /* messages awaiting a read receipt */
+    uint32_t slots_size;
+    uint32_t slots_cursor;
+    uint32_t in_flight;
+    Peer_Map receipts;                 /* maps receipts to indices in `slots` */
+
+    struct message_journal *journal;   /* on-disk copy of the queue, or NULL */
 };
 
+/*
+ * Hands `msg` to toxcore.
+ *
+ * Returns the message receipt on success.
+ * Returns -1 if the message could not be sent.
+ */
+typedef int64_t cqueue_send_cb(const struct cqueue_msg *msg, void *userdata);
+
+/*
+ * Adds a message that was replayed from a journal to the chat window.
+ *
+ * Returns the message's line id, or -1 if it wasn't added.
+ */
+typedef int cqueue_replay_cb(const struct cqueue_msg *msg, void *userdata);
+
+/* Frees `q`. Messages that haven't been delivered are left in its journal. */
 void cqueue_cleanup(struct chat_queue *q);
 void cqueue_add(struct chat_queue *q, const char *msg, size_t len, uint8_t type, int line_id);
 
 /*
- * Tries to send all messages in the send queue in sequential order.
- * If a message fails to send the function will immediately return.
+ * Puts the path of the journal for messages queued by `self_key` to `friend_key` in `buf`. Both keys
+ * must be TOX_PUBLIC_KEY_SIZE bytes.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int cqueue_get_journal_path(const Paths *paths, const uint8_t *self_key, const uint8_t *friend_key, char *buf,
+                            size_t buf_size);
+
+/*
+ * Opens the journal at `path` for `q` and queues the messages still in it, calling `replay` for each one.
+ * From then on every message added to `q` is journaled until it's delivered.
+ *
+ * Return 0 on success.
+ * Return -1 on failure, in which case messages are only queued in memory.
  */
-void cqueue_try_send(ToxWindow *self, Tox *tox);
+int cqueue_load_journal(struct chat_queue *q, const char *path, cqueue_replay_cb *replay, void *userdata);
+
+/*
+ * Starts rewriting the journal for `q` with only the messages that are still queued if enough
+ * delivered messages have piled up in it. The caller finishes the rewrite as described for
+ * message_journal_compact_begin().
+ *
+ * Returns NULL if the journal doesn't need compacting or the rewrite couldn't be started.
+ */
+struct message_journal_compaction *cqueue_compact_journal(struct chat_queue *q);
+
+/*
+ * Sends queued messages in order with `send` until `window` messages are awaiting read receipts or
+ * a message fails to send. If the oldest message awaiting a receipt has timed out at time `now`, it and
+ * every message after it are sent again.
+ *
+ * Returns the number of messages sent.
+ */
+uint32_t cqueue_send_pending(struct chat_queue *q, uint32_t window, time_t now, cqueue_send_cb *send,
+                             void *userdata);
+
+/*
+ * Removes the message awaiting `receipt` from the queue and returns it. The caller is responsible
+ * for freeing it.
+ *
+ * Returns NULL if no message is awaiting `receipt`.
+ */
+struct cqueue_msg *cqueue_take_receipt(struct chat_queue *q, uint32_t receipt);
+
+/*
+ * Marks every message awaiting a read receipt as unsent. This should be called when the friend
+ * goes offline, since toxcore forgets its receipts when the connection is lost.
+ */
+void cqueue_reset_sent(struct chat_queue *q);
+
+/*
+ * Tries to send the messages in the send queue in sequential order, keeping up to `window` messages
+ * awaiting read receipts at a time. If a message fails to send the function will immediately return.
+ */
+void cqueue_try_send(ToxWindow *self, Tox *tox, int window);
 
 /*
  * Sets the noread flag for messages sent to the peer associated with `self` which have not
@@ -45,4 +143,9 @@ void cqueue_check_unread(ToxWindow *self);
 /* removes message with matching receipt from queue, writes to log and updates line to show the message was received. */
 void cqueue_remove(ToxWindow *self, Toxic *toxic, uint32_t receipt);
 
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
 #endif /* MESSAGE_QUEUE_H */
@@ -0,0 +1,377 @@
+#include "windows.h"
+#include "line_info.h"
+#include "log_writer.h"
+#include "message_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+class MessageQueue : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        // cqueue_add() wakes the message queue thread
+        ASSERT_EQ(reactor_init(&cqueue_thread.reactor), 0);
+        queue_ = static_cast<struct chat_queue *>(std::calloc(1, sizeof(struct chat_queue)));
+        ASSERT_NE(queue_, nullptr);
+    }
+
+    void TearDown() override
+    {
+        cqueue_cleanup(queue_);
+        reactor_free(&cqueue_thread.reactor);
+    }
+
+    void add(int n)
+    {
+        for (int i = 0; i < n; ++i) {
+            const std::string msg = "message " + std::to_string(next_line_id_);
+            cqueue_add(queue_, msg.c_str(), msg.size(), OUT_MSG, next_line_id_);
+            ++next_line_id_;
+        }
+    }
+
+    static int64_t record_send(const struct cqueue_msg *msg, void *userdata)
+    {
+        auto *test = static_cast<MessageQueue *>(userdata);
+
+        if (test->fail_sends_) {
+            return -1;
+        }
+
+        test->sent_.push_back(msg->line_id);
+        return test->next_receipt_++;
+    }
+
+    uint32_t send_pending(uint32_t window, time_t now = 0)
+    {
+        return cqueue_send_pending(queue_, window, now, record_send, this);
+    }
+
+    // Takes the message awaiting `receipt` and returns its line id, or -1 if there isn't one.
+    int take(uint32_t receipt)
+    {
+        struct cqueue_msg *msg = cqueue_take_receipt(queue_, receipt);
+
+        if (msg == nullptr) {
+            return -1;
+        }
+
+        const int line_id = msg->line_id;
+        std::free(msg);
+        return line_id;
+    }
+
+    std::vector<int> queued() const
+    {
+        std::vector<int> result;
+
+        for (const struct cqueue_msg *msg = queue_->root; msg != nullptr; msg = msg->next) {
+            result.push_back(msg->line_id);
+        }
+
+        return result;
+    }
+
+    struct chat_queue *queue_ = nullptr;
+    std::vector<int> sent_;
+    uint32_t next_receipt_ = 100;
+    int next_line_id_ = 0;
+    bool fail_sends_ = false;
+};
+
+TEST_F(MessageQueue, SendsUpToWindowInOrder)
+{
+    add(10);
+
+    EXPECT_EQ(send_pending(4), 4u);
+    EXPECT_EQ(send_pending(4), 0u);
+    EXPECT_EQ(sent_, (std::vector<int> {0, 1, 2, 3}));
+    EXPECT_EQ(queue_->in_flight, 4u);
+
+    // a receipt for a message in the middle of the window frees a slot for the next message in line
+    EXPECT_EQ(take(102), 2);
+    EXPECT_EQ(send_pending(4), 1u);
+    EXPECT_EQ(sent_, (std::vector<int> {0, 1, 2, 3, 4}));
+    EXPECT_EQ(queued(), (std::vector<int> {0, 1, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST_F(MessageQueue, WindowOfOneWaitsForEachReceipt)
+{
+    add(3);
+
+    EXPECT_EQ(send_pending(1), 1u);
+    EXPECT_EQ(send_pending(1), 0u);
+    EXPECT_EQ(take(100), 0);
+    EXPECT_EQ(send_pending(1), 1u);
+    EXPECT_EQ(sent_, (std::vector<int> {0, 1}));
+}
+
+TEST_F(MessageQueue, UnknownReceiptIsIgnored)
+{
+    add(2);
+    send_pending(2);
+
+    EXPECT_EQ(take(99), -1);
+    EXPECT_EQ(take(100), 0);
+    EXPECT_EQ(take(100), -1);
+    EXPECT_EQ(queued(), (std::vector<int> {1}));
+}
+
+TEST_F(MessageQueue, ReceiptsInAnyOrderEmptyTheQueue)
+{
+    add(8);
+    EXPECT_EQ(send_pending(8), 8u);
+
+    for (uint32_t receipt : {107, 100, 103, 104, 101, 106, 102, 105}) {
+        EXPECT_EQ(take(receipt), static_cast<int>(receipt - 100));
+    }
+
+    EXPECT_EQ(queue_->root, nullptr);
+    EXPECT_EQ(queue_->end, nullptr);
+    EXPECT_EQ(queue_->in_flight, 0u);
+
+    // the queue is still usable after removing its last message
+    add(1);
+    EXPECT_EQ(send_pending(8), 1u);
+    EXPECT_EQ(queued(), (std::vector<int> {8}));
+}
+
+TEST_F(MessageQueue, FailedSendStopsAndRetriesLater)
+{
+    add(3);
+
+    fail_sends_ = true;
+    EXPECT_EQ(send_pending(4), 0u);
+
+    fail_sends_ = false;
+    EXPECT_EQ(send_pending(4), 3u);
+    EXPECT_EQ(sent_, (std::vector<int> {0, 1, 2}));
+}
+
+TEST_F(MessageQueue, TimeoutResendsFromOldestInOrder)
+{
+    add(4);
+    EXPECT_EQ(send_pending(3, 0), 3u);
+    EXPECT_EQ(take(101), 1);
+
+    // nothing has timed out yet, and the window still has a free slot
+    EXPECT_EQ(send_pending(3, 10), 1u);
+    EXPECT_EQ(sent_, (std::vector<int> {0, 1, 2, 3}));
+
+    sent_.clear();
+    EXPECT_EQ(send_pending(3, 1000), 3u);
+    EXPECT_EQ(sent_, (std::vector<int> {0, 2, 3}));
+
+    // the old receipts are forgotten
+    EXPECT_EQ(take(100), -1);
+    EXPECT_EQ(take(104), 0);
+}
+
+TEST_F(MessageQueue, ResetSentResendsEverythingInFlight)
+{
+    add(5);
+    EXPECT_EQ(send_pending(2), 2u);
+
+    cqueue_reset_sent(queue_);
+    EXPECT_EQ(queue_->in_flight, 0u);
+
+    sent_.clear();
+    EXPECT_EQ(send_pending(16), 5u);
+    EXPECT_EQ(sent_, (std::vector<int> {0, 1, 2, 3, 4}));
+}
+
+TEST_F(MessageQueue, RepeatedReceiptNumbersMatchTheRightMessage)
+{
+    add(2);
+    EXPECT_EQ(send_pending(2), 2u);
+
+    // toxcore may hand out the same receipt number again after a reconnect
+    cqueue_reset_sent(queue_);
+    next_receipt_ = 100;
+    EXPECT_EQ(send_pending(2), 2u);
+
+    EXPECT_EQ(take(101), 1);
+    EXPECT_EQ(take(100), 0);
+}
+
+class MessageQueueJournal : public MessageQueue {
+protected:
+    void SetUp() override
+    {
+        MessageQueue::SetUp();
+
+        std::snprintf(path_, sizeof(path_), "%s/toxic_message_queue_test_XXXXXX", testing::TempDir().c_str());
+        const int fd = mkstemp(path_);
+        ASSERT_NE(fd, -1);
+        close(fd);
+
+        ASSERT_EQ(log_writer_start(0), 0);
+        ASSERT_EQ(cqueue_load_journal(queue_, path_, replay, this), 0);
+    }
+
+    void TearDown() override
+    {
+        MessageQueue::TearDown();
+        log_writer_stop();
+        std::remove(path_);
+    }
+
+    // Simulates closing toxic and opening the chat window again.
+    void restart()
+    {
+        cqueue_cleanup(queue_);
+        queue_ = static_cast<struct chat_queue *>(std::calloc(1, sizeof(struct chat_queue)));
+        ASSERT_NE(queue_, nullptr);
+
+        replayed_.clear();
+        ASSERT_EQ(cqueue_load_journal(queue_, path_, replay, this), 0);
+    }
+
+    static int replay(const struct cqueue_msg *msg, void *userdata)
+    {
+        auto *test = static_cast<MessageQueueJournal *>(userdata);
+        test->replayed_.push_back(msg->message);
+        return test->next_line_id_++;
+    }
+
+    std::vector<std::string> replayed_;
+    char path_[PATH_MAX];
+};
+
+TEST_F(MessageQueueJournal, UndeliveredMessagesAreReplayed)
+{
+    add(4);
+    EXPECT_EQ(send_pending(4), 4u);
+    EXPECT_EQ(take(101), 1);
+    EXPECT_EQ(take(103), 3);
+
+    restart();
+
+    EXPECT_EQ(replayed_, (std::vector<std::string> {"message 0", "message 2"}));
+    EXPECT_EQ(queued(), (std::vector<int> {4, 5}));
+
+    // replayed messages are sent again and leave the journal once they're delivered
+    sent_.clear();
+    EXPECT_EQ(send_pending(4), 2u);
+    EXPECT_EQ(sent_, (std::vector<int> {4, 5}));
+    EXPECT_EQ(take(104), 4);
+
+    restart();
+    EXPECT_EQ(replayed_, (std::vector<std::string> {"message 2"}));
+}
+
+TEST_F(MessageQueueJournal, CompactionKeepsQueuedMessages)
+{
+    add(200);
+    EXPECT_EQ(send_pending(CQUEUE_MAX_WINDOW), 200u);
+
+    for (uint32_t receipt = 100; receipt < 290; ++receipt) {
+        take(receipt);
+    }
+
+    struct message_journal_compaction *compaction = cqueue_compact_journal(queue_);
+    ASSERT_NE(compaction, nullptr);
+    message_journal_compact_write(compaction);
+    EXPECT_EQ(message_journal_compact_finish(compaction), 0);
+    message_journal_compact_free(compaction);
+    EXPECT_FALSE(message_journal_needs_compaction(queue_->journal));
+
+    add(1);
+    restart();
+
+    std::vector<std::string> expected;
+
+    for (int i = 190; i <= 200; ++i) {
+        expected.push_back("message " + std::to_string(i));
+    }
+
+    EXPECT_EQ(replayed_, expected);
+}
+
+// Simulates draining a backlog of queued messages to a friend who has just come online, in virtual time.
+// The old sender sent one message per receipt and was only run every 750 ms by the message queue thread.
+// The new one keeps a window of messages in flight and runs again as soon as a receipt frees a slot.
+// Receipts take the round trip time plus up to 50 ms of jitter, so they come back out of order.
+class MessageQueueDrain : public MessageQueue {
+protected:
+    struct Friend {
+        std::multimap<int64_t, uint32_t> receipts;    // arrival time -> receipt
+        int64_t now_ms = 0;
+        int64_t rtt_ms = 0;
+        uint32_t next_receipt = 0;
+        uint32_t seed = 1;
+    };
+
+    static int64_t friend_send(const struct cqueue_msg *msg, void *userdata)
+    {
+        (void) msg;
+
+        auto *f = static_cast<Friend *>(userdata);
+        f->seed = f->seed * 1103515245 + 12345;
+        f->receipts.emplace(f->now_ms + f->rtt_ms + (f->seed >> 8) % 50, f->next_receipt);
+        return f->next_receipt++;
+    }
+
+    // Returns how long it took in virtual milliseconds to get a receipt for every message.
+    int64_t drain(uint32_t num_messages, int64_t rtt_ms, uint32_t window, int64_t poll_ms, bool wake_on_receipt)
+    {
+        add(static_cast<int>(num_messages));
+
+        Friend f;
+        f.rtt_ms = rtt_ms;
+
+        int64_t next_poll = 0;
+
+        while (queue_->root != nullptr) {
+            const int64_t next_receipt = f.receipts.empty() ? INT64_MAX : f.receipts.begin()->first;
+
+            if (next_poll <= next_receipt) {
+                f.now_ms = next_poll;
+                cqueue_send_pending(queue_, window, static_cast<time_t>(f.now_ms / 1000), friend_send, &f);
+                next_poll += poll_ms;
+                continue;
+            }
+
+            f.now_ms = next_receipt;
+            const uint32_t receipt = f.receipts.begin()->second;
+            f.receipts.erase(f.receipts.begin());
+
+            std::free(cqueue_take_receipt(queue_, receipt));
+
+            if (wake_on_receipt) {
+                cqueue_send_pending(queue_, window, static_cast<time_t>(f.now_ms / 1000), friend_send, &f);
+            }
+        }
+
+        return f.now_ms;
+    }
+};
+
+// A backlog of 200 messages with a 200 ms round trip.
+TEST_F(MessageQueueDrain, DISABLED_Benchmark)
+{
+    constexpr uint32_t num_messages = 200;
+    constexpr int64_t rtt_ms = 200;
+
+    const int64_t old_ms = drain(num_messages, rtt_ms, 1, 750, false);
+    const int64_t new_ms = drain(num_messages, rtt_ms, CQUEUE_DEFAULT_WINDOW, 750, true);
+
+    EXPECT_LT(new_ms, old_ms);
+
+    std::printf("%u messages at %lld ms round trip: one at a time %lld ms, window of %d %lld ms\n", num_messages,
+                static_cast<long long>(rtt_ms), static_cast<long long>(old_ms), CQUEUE_DEFAULT_WINDOW,
+                static_cast<long long>(new_ms));
+}
+
+}  // namespace
@@ -845,6 +845,11 @@ size_t format_time_str(char *s, size_t max, const char *format, const struct tm
 
 bool string_contains_blocked_word(const char *line, const Client_Data *client_data)
 {
+    if (client_data->blocked_words_filter.num_states > 0) {
+        return word_filter_match(&client_data->blocked_words_filter, line);
+    }
+
+    /* only reached if the list couldn't be compiled */
     for (size_t i = 0; i < client_data->num_blocked_words; ++i) {
         if (strcasestr(line, client_data->blocked_words[i]) != NULL) {
             return true;
@@ -0,0 +1,292 @@
+/*  name_index.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "name_index.h"
+
+/* Compares `name` with `id` to the entry at position `pos`, in the order that the index is kept in. */
+static int name_index_cmp(const Name_Index *index, uint32_t pos, const char *name, uint32_t id)
+{
+    const int cmp = strcmp(index->names[pos], name);
+
+    if (cmp != 0) {
+        return cmp;
+    }
+
+    if (index->ids[pos] == id) {
+        return 0;
+    }
+
+    return index->ids[pos] < id ? -1 : 1;
+}
+
+/* Returns the position of the first entry that doesn't sort before `name` with `id`. */
+static uint32_t name_index_lower_bound(const Name_Index *index, const char *name, uint32_t id)
+{
+    uint32_t low = 0;
+    uint32_t high = index->count;
+
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+
+        if (name_index_cmp(index, mid, name, id) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static int name_index_grow(Name_Index *index)
+{
+    const uint32_t new_size = index->size > 0 ? index->size * 2 : 16;
+
+    if (new_size <= index->size) {
+        return -1;
+    }
+
+    char **new_names = realloc(index->names, new_size * sizeof(char *));
+
+    if (new_names == NULL) {
+        return -1;
+    }
+
+    index->names = new_names;
+
+    uint32_t *new_ids = realloc(index->ids, new_size * sizeof(uint32_t));
+
+    if (new_ids == NULL) {
+        return -1;
+    }
+
+    index->ids = new_ids;
+    index->size = new_size;
+
+    return 0;
+}
+
+static char *name_index_copy(const char *name)
+{
+    const size_t length = strlen(name);
+    char *copy = malloc(length + 1);
+
+    if (copy != NULL) {
+        memcpy(copy, name, length + 1);
+    }
+
+    return copy;
+}
+
+int name_index_add(Name_Index *index, const char *name, uint32_t id)
+{
+    if (index->count == index->size && name_index_grow(index) != 0) {
+        return -1;
+    }
+
+    char *copy = name_index_copy(name);
+
+    if (copy == NULL) {
+        return -1;
+    }
+
+    const uint32_t pos = name_index_lower_bound(index, name, id);
+    const uint32_t num_after = index->count - pos;
+
+    memmove(&index->names[pos + 1], &index->names[pos], num_after * sizeof(char *));
+    memmove(&index->ids[pos + 1], &index->ids[pos], num_after * sizeof(uint32_t));
+
+    index->names[pos] = copy;
+    index->ids[pos] = id;
+    ++index->count;
+
+    return 0;
+}
+
+int name_index_append(Name_Index *index, const char *name, uint32_t id)
+{
+    if (index->count == index->size && name_index_grow(index) != 0) {
+        return -1;
+    }
+
+    char *copy = name_index_copy(name);
+
+    if (copy == NULL) {
+        return -1;
+    }
+
+    index->names[index->count] = copy;
+    index->ids[index->count] = id;
+    ++index->count;
+
+    return 0;
+}
+
+struct name_index_entry {
+    char *name;
+    uint32_t id;
+};
+
+static int name_index_entry_cmp(const void *a, const void *b)
+{
+    const struct name_index_entry *entry1 = (const struct name_index_entry *) a;
+    const struct name_index_entry *entry2 = (const struct name_index_entry *) b;
+
+    const int cmp = strcmp(entry1->name, entry2->name);
+
+    if (cmp != 0) {
+        return cmp;
+    }
+
+    if (entry1->id == entry2->id) {
+        return 0;
+    }
+
+    return entry1->id < entry2->id ? -1 : 1;
+}
+
+void name_index_sort(Name_Index *index)
+{
+    if (index->count < 2) {
+        return;
+    }
+
+    struct name_index_entry *entries = malloc(index->count * sizeof(struct name_index_entry));
+
+    if (entries == NULL) {
+        /* fall back to sorting in place, which doesn't need any memory */
+        for (uint32_t i = 1; i < index->count; ++i) {
+            char *name = index->names[i];
+            const uint32_t id = index->ids[i];
+            uint32_t j = i;
+
+            while (j > 0 && (strcmp(index->names[j - 1], name) > 0
+                             || (strcmp(index->names[j - 1], name) == 0 && index->ids[j - 1] > id))) {
+                index->names[j] = index->names[j - 1];
+                index->ids[j] = index->ids[j - 1];
+                --j;
+            }
+
+            index->names[j] = name;
+            index->ids[j] = id;
+        }
+
+        return;
+    }
+
+    for (uint32_t i = 0; i < index->count; ++i) {
+        entries[i].name = index->names[i];
+        entries[i].id = index->ids[i];
+    }
+
+    qsort(entries, index->count, sizeof(struct name_index_entry), name_index_entry_cmp);
+
+    for (uint32_t i = 0; i < index->count; ++i) {
+        index->names[i] = entries[i].name;
+        index->ids[i] = entries[i].id;
+    }
+
+    free(entries);
+}
+
+bool name_index_remove(Name_Index *index, const char *name, uint32_t id)
+{
+    const uint32_t pos = name_index_lower_bound(index, name, id);
+
+    if (pos == index->count || name_index_cmp(index, pos, name, id) != 0) {
+        return false;
+    }
+
+    free(index->names[pos]);
+
+    const uint32_t num_after = index->count - pos - 1;
+
+    memmove(&index->names[pos], &index->names[pos + 1], num_after * sizeof(char *));
+    memmove(&index->ids[pos], &index->ids[pos + 1], num_after * sizeof(uint32_t));
+
+    --index->count;
+
+    return true;
+}
+
+uint32_t name_index_find_prefix(const Name_Index *index, const char *prefix, size_t prefix_length, uint32_t *first)
+{
+    /* the first name that doesn't sort before the prefix */
+    uint32_t low = 0;
+    uint32_t high = index->count;
+
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+
+        if (strncmp(index->names[mid], prefix, prefix_length) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    *first = low;
+
+    /* the first name after it that doesn't start with the prefix */
+    high = index->count;
+
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+
+        if (strncmp(index->names[mid], prefix, prefix_length) == 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low - *first;
+}
+
+size_t name_index_common_prefix(const Name_Index *index, uint32_t first, uint32_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    /* in a sorted range the first and last names share the shortest prefix */
+    const char *name1 = index->names[first];
+    const char *name2 = index->names[first + count - 1];
+
+    size_t length = 0;
+
+    while (name1[length] != '\0' && name1[length] == name2[length]) {
+        ++length;
+    }
+
+    return length;
+}
+
+void name_index_clear(Name_Index *index)
+{
+    for (uint32_t i = 0; i < index->count; ++i) {
+        free(index->names[i]);
+    }
+
+    index->count = 0;
+}
+
+void name_index_free(Name_Index *index)
+{
+    name_index_clear(index);
+
+    free(index->names);
+    free(index->ids);
+
+    index->names = NULL;
+    index->ids = NULL;
+    index->size = 0;
+}
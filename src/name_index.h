@@ -0,0 +1,81 @@
+/*  name_index.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A set of names kept in byte order, for finding every name that starts with a prefix.
+ *
+ * Each name is stored along with an id chosen by the caller (e.g. a peer list index), so that the same
+ * name may be in the index more than once. Names that are equal are ordered by id.
+ *
+ * The names that start with a prefix are always next to each other, so they're found with two binary
+ * searches and can be used directly as a list of strings through `names`. Must be zero-initialized.
+ */
+typedef struct Name_Index {
+    char     **names;
+    uint32_t *ids;
+    uint32_t count;
+    uint32_t size;
+} Name_Index;
+
+/* Adds a copy of the null terminated string `name` with `id` to `index`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int name_index_add(Name_Index *index, const char *name, uint32_t id);
+
+/* Adds a copy of `name` with `id` to the end of `index` without keeping it sorted, which is much faster
+ * when adding many names at once. name_index_sort() must be called before the index is used again.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int name_index_append(Name_Index *index, const char *name, uint32_t id);
+
+/* Sorts `index` after names have been added to it with name_index_append(). */
+void name_index_sort(Name_Index *index);
+
+/* Removes `name` with `id` from `index`.
+ *
+ * Return true if it was found.
+ */
+bool name_index_remove(Name_Index *index, const char *name, uint32_t id);
+
+/* Finds the names in `index` whose first `prefix_length` bytes are equal to `prefix`. They're at
+ * positions `*first` to `*first` + the return value - 1 of `names`.
+ *
+ * Returns the number of names found.
+ */
+uint32_t name_index_find_prefix(const Name_Index *index, const char *prefix, size_t prefix_length, uint32_t *first);
+
+/* Returns the length of the longest prefix shared by the `count` names starting at position `first`. */
+size_t name_index_common_prefix(const Name_Index *index, uint32_t first, uint32_t count);
+
+/* Removes all names from `index`. */
+void name_index_clear(Name_Index *index);
+
+/* Frees all memory associated with `index` and empties it. */
+void name_index_free(Name_Index *index);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* NAME_INDEX_H */
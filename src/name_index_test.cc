@@ -0,0 +1,136 @@
+#include "name_index.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> prefix_matches(const Name_Index &index, const char *prefix)
+{
+    uint32_t first;
+    const uint32_t count = name_index_find_prefix(&index, prefix, std::strlen(prefix), &first);
+
+    std::vector<std::string> names;
+
+    for (uint32_t i = first; i < first + count; ++i) {
+        names.push_back(index.names[i]);
+    }
+
+    return names;
+}
+
+TEST(NameIndex, KeepsNamesSorted)
+{
+    Name_Index index = {};
+
+    for (const char *name : {"mallory", "alice", "bob", "alicia", "Zed", "al"}) {
+        ASSERT_EQ(name_index_add(&index, name, 0), 0);
+    }
+
+    ASSERT_EQ(index.count, 6);
+
+    for (uint32_t i = 1; i < index.count; ++i) {
+        EXPECT_LT(std::strcmp(index.names[i - 1], index.names[i]), 0);
+    }
+
+    name_index_free(&index);
+}
+
+TEST(NameIndex, FindPrefix)
+{
+    Name_Index index = {};
+
+    for (const char *name : {"alice", "alicia", "al", "bob", "albert", "Alice"}) {
+        ASSERT_EQ(name_index_add(&index, name, 0), 0);
+    }
+
+    EXPECT_EQ(prefix_matches(index, "al"), (std::vector<std::string> {"al", "albert", "alice", "alicia"}));
+    EXPECT_EQ(prefix_matches(index, "ali"), (std::vector<std::string> {"alice", "alicia"}));
+    EXPECT_EQ(prefix_matches(index, "b"), (std::vector<std::string> {"bob"}));
+    EXPECT_EQ(prefix_matches(index, "A"), (std::vector<std::string> {"Alice"}));
+    EXPECT_TRUE(prefix_matches(index, "c").empty());
+    EXPECT_TRUE(prefix_matches(index, "bobby").empty());
+    EXPECT_EQ(prefix_matches(index, "").size(), 6);
+
+    name_index_free(&index);
+}
+
+TEST(NameIndex, CommonPrefix)
+{
+    Name_Index index = {};
+
+    for (const char *name : {"foo", "foobar", "foe", "bar"}) {
+        ASSERT_EQ(name_index_add(&index, name, 0), 0);
+    }
+
+    uint32_t first;
+    uint32_t count = name_index_find_prefix(&index, "fo", 2, &first);
+    ASSERT_EQ(count, 3);
+    EXPECT_EQ(name_index_common_prefix(&index, first, count), 2);
+
+    count = name_index_find_prefix(&index, "foo", 3, &first);
+    ASSERT_EQ(count, 2);
+    EXPECT_EQ(name_index_common_prefix(&index, first, count), 3);
+
+    count = name_index_find_prefix(&index, "b", 1, &first);
+    ASSERT_EQ(count, 1);
+    EXPECT_EQ(name_index_common_prefix(&index, first, count), 3);
+
+    name_index_free(&index);
+}
+
+TEST(NameIndex, DuplicateNamesAreKeptApartById)
+{
+    Name_Index index = {};
+
+    ASSERT_EQ(name_index_add(&index, "guest", 7), 0);
+    ASSERT_EQ(name_index_add(&index, "guest", 3), 0);
+    ASSERT_EQ(name_index_add(&index, "guest", 5), 0);
+
+    ASSERT_EQ(index.count, 3);
+    EXPECT_EQ(index.ids[0], 3);
+    EXPECT_EQ(index.ids[1], 5);
+    EXPECT_EQ(index.ids[2], 7);
+
+    EXPECT_FALSE(name_index_remove(&index, "guest", 4));
+    EXPECT_TRUE(name_index_remove(&index, "guest", 5));
+    EXPECT_FALSE(name_index_remove(&index, "guest", 5));
+
+    ASSERT_EQ(index.count, 2);
+    EXPECT_EQ(index.ids[0], 3);
+    EXPECT_EQ(index.ids[1], 7);
+
+    name_index_free(&index);
+    EXPECT_EQ(index.count, 0);
+}
+
+TEST(NameIndex, AppendThenSort)
+{
+    Name_Index index = {};
+
+    ASSERT_EQ(name_index_append(&index, "src", 2), 0);
+    ASSERT_EQ(name_index_append(&index, "README.md", 0), 0);
+    ASSERT_EQ(name_index_append(&index, "Makefile", 1), 0);
+    ASSERT_EQ(name_index_append(&index, "src", 1), 0);
+
+    name_index_sort(&index);
+
+    ASSERT_EQ(index.count, 4);
+    EXPECT_STREQ(index.names[0], "Makefile");
+    EXPECT_STREQ(index.names[1], "README.md");
+    EXPECT_STREQ(index.names[2], "src");
+    EXPECT_EQ(index.ids[2], 1);
+    EXPECT_EQ(index.ids[3], 2);
+
+    /* a sorted index can be added to as usual */
+    ASSERT_EQ(name_index_add(&index, "doc", 3), 0);
+    EXPECT_EQ(prefix_matches(index, "d"), (std::vector<std::string> {"doc"}));
+    EXPECT_STREQ(index.names[2], "doc");
+
+    name_index_free(&index);
+}
+
+}  // namespace
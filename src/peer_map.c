@@ -0,0 +1,213 @@
+/*  peer_map.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <stdlib.h>
+
+#include "peer_map.h"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint32_t peer_map_slot(uint64_t key, uint32_t mask)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t)key & mask;
+}
+
+static void peer_map_init_entries(struct peer_map_entry *entries, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; ++i) {
+        entries[i] = (struct peer_map_entry) {
+            0, PEER_MAP_NONE, false
+        };
+    }
+}
+
+/* Rehashes the live entries of `map` into a table of `new_size` slots, dropping deleted ones. */
+static int peer_map_resize(Peer_Map *map, uint32_t new_size)
+{
+    struct peer_map_entry *new_entries = malloc(new_size * sizeof(struct peer_map_entry));
+
+    if (new_entries == NULL) {
+        return -1;
+    }
+
+    peer_map_init_entries(new_entries, new_size);
+
+    const uint32_t mask = new_size - 1;
+
+    for (uint32_t i = 0; i < map->size; ++i) {
+        const struct peer_map_entry *entry = &map->entries[i];
+
+        if (entry->index == PEER_MAP_NONE || entry->deleted) {
+            continue;
+        }
+
+        uint32_t j = peer_map_slot(entry->key, mask);
+
+        while (new_entries[j].index != PEER_MAP_NONE) {
+            j = (j + 1) & mask;
+        }
+
+        new_entries[j] = *entry;
+    }
+
+    free(map->entries);
+    map->entries = new_entries;
+    map->size = new_size;
+    map->used = map->count;
+
+    return 0;
+}
+
+int peer_map_add(Peer_Map *map, uint64_t key, uint32_t index)
+{
+    if (index == PEER_MAP_NONE) {
+        return -1;
+    }
+
+    /* keep the load factor, counting deleted entries, at or below 1/2. Rehashing at the same size is
+     * enough to clear out deleted entries when peers come and go without the group growing. */
+    if ((map->used + 1) * 2 > map->size) {
+        uint32_t new_size = map->size > 0 ? map->size : 16;
+
+        while ((uint64_t)(map->count + 1) * 4 > new_size) {
+            if (new_size > UINT32_MAX / 2) {
+                return -1;
+            }
+
+            new_size *= 2;
+        }
+
+        if (peer_map_resize(map, new_size) != 0) {
+            return -1;
+        }
+    }
+
+    const uint32_t mask = map->size - 1;
+    uint32_t i = peer_map_slot(key, mask);
+
+    while (map->entries[i].index != PEER_MAP_NONE && !map->entries[i].deleted) {
+        i = (i + 1) & mask;
+    }
+
+    if (map->entries[i].index == PEER_MAP_NONE) {
+        ++map->used;
+    }
+
+    map->entries[i] = (struct peer_map_entry) {
+        key, index, false
+    };
+    ++map->count;
+
+    return 0;
+}
+
+bool peer_map_remove(Peer_Map *map, uint64_t key, uint32_t index)
+{
+    if (map->size == 0) {
+        return false;
+    }
+
+    const uint32_t mask = map->size - 1;
+
+    for (uint32_t i = peer_map_slot(key, mask), probes = 0; probes < map->size; i = (i + 1) & mask, ++probes) {
+        struct peer_map_entry *entry = &map->entries[i];
+
+        if (entry->index == PEER_MAP_NONE) {
+            return false;
+        }
+
+        if (!entry->deleted && entry->key == key && entry->index == index) {
+            entry->deleted = true;
+            --map->count;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t peer_map_next(const Peer_Map *map, uint64_t key, Peer_Map_Iter *iter)
+{
+    if (map->size == 0) {
+        return PEER_MAP_NONE;
+    }
+
+    const uint32_t mask = map->size - 1;
+
+    if (iter->probes == 0) {
+        iter->pos = peer_map_slot(key, mask);
+    }
+
+    while (iter->probes < map->size) {
+        const struct peer_map_entry *entry = &map->entries[iter->pos];
+
+        if (entry->index == PEER_MAP_NONE) {
+            iter->probes = map->size;
+            break;
+        }
+
+        iter->pos = (iter->pos + 1) & mask;
+        ++iter->probes;
+
+        if (!entry->deleted && entry->key == key) {
+            return entry->index;
+        }
+    }
+
+    return PEER_MAP_NONE;
+}
+
+void peer_map_clear(Peer_Map *map)
+{
+    peer_map_init_entries(map->entries, map->size);
+    map->count = 0;
+    map->used = 0;
+}
+
+void peer_map_free(Peer_Map *map)
+{
+    free(map->entries);
+    *map = (Peer_Map) {
+        0
+    };
+}
+
+uint64_t peer_map_key_bytes(const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t *) data;
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+uint64_t peer_map_key_nick(const char *nick, size_t length)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < length && nick[i] != '\0'; ++i) {
+        uint8_t c = (uint8_t) nick[i];
+
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+
+        hash ^= c;
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
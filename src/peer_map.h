@@ -0,0 +1,81 @@
+/*  peer_map.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef PEER_MAP_H
+#define PEER_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Returned by peer_map_next() when there are no more matches */
+#define PEER_MAP_NONE UINT32_MAX
+
+struct peer_map_entry {
+    uint64_t key;
+    uint32_t index;    /* PEER_MAP_NONE marks an empty slot */
+    bool     deleted;
+};
+
+/*
+ * Open-addressing hash map from 64-bit keys to peer list indices.
+ *
+ * A key may map to any number of indices, since nicks aren't unique and keys derived from hashes can
+ * collide, so callers must check that the peer at each index they get back is the one they want.
+ */
+typedef struct Peer_Map {
+    struct peer_map_entry *entries;
+    uint32_t size;     /* always zero or a power of two */
+    uint32_t count;    /* number of live entries */
+    uint32_t used;     /* number of live and deleted entries */
+} Peer_Map;
+
+/* Position of a lookup in a Peer_Map. Must be zero-initialized before the first call to peer_map_next(). */
+typedef struct Peer_Map_Iter {
+    uint32_t pos;
+    uint32_t probes;
+} Peer_Map_Iter;
+
+/* Maps `key` to `index`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int peer_map_add(Peer_Map *map, uint64_t key, uint32_t index);
+
+/* Removes the mapping of `key` to `index`.
+ *
+ * Return true if it was found.
+ */
+bool peer_map_remove(Peer_Map *map, uint64_t key, uint32_t index);
+
+/* Returns the next index that `key` maps to, or PEER_MAP_NONE if there are no more. */
+uint32_t peer_map_next(const Peer_Map *map, uint64_t key, Peer_Map_Iter *iter);
+
+/* Removes all entries from `map`. */
+void peer_map_clear(Peer_Map *map);
+
+/* Frees all memory associated with `map`. */
+void peer_map_free(Peer_Map *map);
+
+/* Returns the key of `length` bytes of `data`. */
+uint64_t peer_map_key_bytes(const void *data, size_t length);
+
+/* Returns the key of a nick, ignoring ASCII case. */
+uint64_t peer_map_key_nick(const char *nick, size_t length);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* PEER_MAP_H */
@@ -0,0 +1,115 @@
+#include "peer_map.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+std::vector<uint32_t> lookup(const Peer_Map *map, uint64_t key)
+{
+    std::vector<uint32_t> result;
+    Peer_Map_Iter iter {};
+
+    for (uint32_t i = peer_map_next(map, key, &iter); i != PEER_MAP_NONE; i = peer_map_next(map, key, &iter)) {
+        result.push_back(i);
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+class PeerMap : public ::testing::Test {
+protected:
+    void TearDown() override
+    {
+        peer_map_free(&map_);
+    }
+
+    Peer_Map map_ {};
+};
+
+TEST_F(PeerMap, EmptyMapFindsNothing)
+{
+    EXPECT_EQ(lookup(&map_, 1), std::vector<uint32_t> {});
+    EXPECT_FALSE(peer_map_remove(&map_, 1, 0));
+}
+
+TEST_F(PeerMap, KeysMapToSeveralIndices)
+{
+    ASSERT_EQ(peer_map_add(&map_, 7, 3), 0);
+    ASSERT_EQ(peer_map_add(&map_, 7, 1), 0);
+    ASSERT_EQ(peer_map_add(&map_, 8, 2), 0);
+
+    EXPECT_EQ(lookup(&map_, 7), (std::vector<uint32_t> {1, 3}));
+    EXPECT_EQ(lookup(&map_, 8), (std::vector<uint32_t> {2}));
+    EXPECT_EQ(map_.count, 3u);
+
+    EXPECT_TRUE(peer_map_remove(&map_, 7, 3));
+    EXPECT_FALSE(peer_map_remove(&map_, 7, 3));
+    EXPECT_FALSE(peer_map_remove(&map_, 8, 1));
+
+    EXPECT_EQ(lookup(&map_, 7), (std::vector<uint32_t> {1}));
+    EXPECT_EQ(map_.count, 2u);
+}
+
+TEST_F(PeerMap, ChurnDoesNotGrowTheTable)
+{
+    // peers joining and leaving a group of constant size shouldn't make the table grow forever
+    for (uint32_t i = 0; i < 100; ++i) {
+        ASSERT_EQ(peer_map_add(&map_, i, i), 0);
+    }
+
+    uint32_t size = 0;
+
+    for (uint32_t i = 100; i < 100000; ++i) {
+        ASSERT_TRUE(peer_map_remove(&map_, i - 100, i - 100));
+        ASSERT_EQ(peer_map_add(&map_, i, i), 0);
+
+        if (i == 1000) {
+            size = map_.size;
+        }
+    }
+
+    EXPECT_EQ(map_.size, size);
+    EXPECT_LE(map_.size, 1024u);
+    EXPECT_EQ(map_.count, 100u);
+
+    for (uint32_t i = 99900; i < 100000; ++i) {
+        EXPECT_EQ(lookup(&map_, i), (std::vector<uint32_t> {i}));
+    }
+
+    EXPECT_EQ(lookup(&map_, 5), std::vector<uint32_t> {});
+}
+
+TEST_F(PeerMap, ClearRemovesEverything)
+{
+    for (uint32_t i = 0; i < 1000; ++i) {
+        ASSERT_EQ(peer_map_add(&map_, i % 10, i), 0);
+    }
+
+    peer_map_clear(&map_);
+
+    EXPECT_EQ(map_.count, 0u);
+    EXPECT_EQ(lookup(&map_, 3), std::vector<uint32_t> {});
+}
+
+TEST(PeerMapKey, NickIgnoresCase)
+{
+    EXPECT_EQ(peer_map_key_nick("Alice", 5), peer_map_key_nick("aLICE", 5));
+    EXPECT_EQ(peer_map_key_nick("Alice\0junk", 10), peer_map_key_nick("alice", 5));
+    EXPECT_NE(peer_map_key_nick("Alice", 5), peer_map_key_nick("Alicf", 5));
+    EXPECT_NE(peer_map_key_nick("Alice", 5), peer_map_key_nick("Alic", 4));
+}
+
+TEST(PeerMapKey, Bytes)
+{
+    const uint8_t a[] = {1, 2, 3, 4};
+    const uint8_t b[] = {1, 2, 3, 5};
+
+    EXPECT_EQ(peer_map_key_bytes(a, sizeof(a)), peer_map_key_bytes(a, sizeof(a)));
+    EXPECT_NE(peer_map_key_bytes(a, sizeof(a)), peer_map_key_bytes(b, sizeof(b)));
+}
+
+}  // namespace
@@ -0,0 +1,298 @@
+/*  peer_order.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <stdlib.h>
+
+#include "peer_order.h"
+
+#define NIL PEER_ORDER_NONE
+
+/* A zeroed Peer_Order with no nodes is empty whatever its root says. */
+static uint32_t peer_order_root(const Peer_Order *order)
+{
+    return order->nodes_size > 0 ? order->root : NIL;
+}
+
+static uint32_t peer_order_size(const Peer_Order *order, uint32_t t)
+{
+    return t == NIL ? 0 : order->nodes[t].size;
+}
+
+static void peer_order_update(Peer_Order *order, uint32_t t)
+{
+    struct peer_order_node *node = &order->nodes[t];
+    node->size = 1 + peer_order_size(order, node->left) + peer_order_size(order, node->right);
+}
+
+/* Returns true if the peer at `index1` sorts before the one at `index2`. */
+static bool peer_order_less(const Peer_Order *order, uint32_t index1, uint32_t index2)
+{
+    const int res = order->cmp(index1, index2, order->userdata);
+
+    if (res != 0) {
+        return res < 0;
+    }
+
+    return index1 < index2;
+}
+
+/* Returns a pseudo-random priority for a new node. */
+static uint32_t peer_order_priority(Peer_Order *order)
+{
+    uint64_t x = (uint64_t) ++order->seed * 0x9e3779b97f4a7c15ULL;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    return (uint32_t)(x >> 32);
+}
+
+/* Splits the subtree rooted at `t` into the nodes that sort before `index` and the nodes that sort after it. */
+static void peer_order_split(Peer_Order *order, uint32_t t, uint32_t index, uint32_t *left, uint32_t *right)
+{
+    if (t == NIL) {
+        *left = NIL;
+        *right = NIL;
+        return;
+    }
+
+    struct peer_order_node *node = &order->nodes[t];
+
+    if (peer_order_less(order, t, index)) {
+        peer_order_split(order, node->right, index, &node->right, right);
+        *left = t;
+    } else {
+        peer_order_split(order, node->left, index, left, &node->left);
+        *right = t;
+    }
+
+    peer_order_update(order, t);
+}
+
+/* Merges two subtrees where every node in `left` sorts before every node in `right`. */
+static uint32_t peer_order_merge(Peer_Order *order, uint32_t left, uint32_t right)
+{
+    if (left == NIL) {
+        return right;
+    }
+
+    if (right == NIL) {
+        return left;
+    }
+
+    if (order->nodes[left].priority > order->nodes[right].priority) {
+        order->nodes[left].right = peer_order_merge(order, order->nodes[left].right, right);
+        peer_order_update(order, left);
+        return left;
+    }
+
+    order->nodes[right].left = peer_order_merge(order, left, order->nodes[right].left);
+    peer_order_update(order, right);
+    return right;
+}
+
+static uint32_t peer_order_insert_node(Peer_Order *order, uint32_t t, uint32_t index)
+{
+    if (t == NIL) {
+        return index;
+    }
+
+    struct peer_order_node *node = &order->nodes[t];
+
+    if (order->nodes[index].priority > node->priority) {
+        peer_order_split(order, t, index, &order->nodes[index].left, &order->nodes[index].right);
+        peer_order_update(order, index);
+        return index;
+    }
+
+    if (peer_order_less(order, index, t)) {
+        node->left = peer_order_insert_node(order, node->left, index);
+    } else {
+        node->right = peer_order_insert_node(order, node->right, index);
+    }
+
+    peer_order_update(order, t);
+
+    return t;
+}
+
+static uint32_t peer_order_remove_node(Peer_Order *order, uint32_t t, uint32_t index)
+{
+    if (t == NIL) {
+        return NIL;
+    }
+
+    struct peer_order_node *node = &order->nodes[t];
+
+    if (t == index) {
+        return peer_order_merge(order, node->left, node->right);
+    }
+
+    if (peer_order_less(order, index, t)) {
+        node->left = peer_order_remove_node(order, node->left, index);
+    } else {
+        node->right = peer_order_remove_node(order, node->right, index);
+    }
+
+    peer_order_update(order, t);
+
+    return t;
+}
+
+static int peer_order_grow(Peer_Order *order, uint32_t index)
+{
+    if (index < order->nodes_size) {
+        return 0;
+    }
+
+    uint32_t new_size = order->nodes_size > 0 ? order->nodes_size : 16;
+
+    while (new_size <= index) {
+        if (new_size > UINT32_MAX / 2) {
+            return -1;
+        }
+
+        new_size *= 2;
+    }
+
+    struct peer_order_node *new_nodes = realloc(order->nodes, new_size * sizeof(struct peer_order_node));
+
+    if (new_nodes == NULL) {
+        return -1;
+    }
+
+    for (uint32_t i = order->nodes_size; i < new_size; ++i) {
+        new_nodes[i] = (struct peer_order_node) {
+            NIL, NIL, 0, 0, false
+        };
+    }
+
+    if (order->nodes_size == 0) {
+        order->root = NIL;
+    }
+
+    order->nodes = new_nodes;
+    order->nodes_size = new_size;
+
+    return 0;
+}
+
+void peer_order_init(Peer_Order *order, peer_order_cmp_cb *cmp, const void *userdata)
+{
+    *order = (Peer_Order) {
+        NULL
+    };
+
+    order->root = NIL;
+    order->cmp = cmp;
+    order->userdata = userdata;
+}
+
+int peer_order_insert(Peer_Order *order, uint32_t index)
+{
+    if (index == NIL || peer_order_grow(order, index) != 0) {
+        return -1;
+    }
+
+    struct peer_order_node *node = &order->nodes[index];
+
+    if (node->linked) {
+        return -1;
+    }
+
+    *node = (struct peer_order_node) {
+        NIL, NIL, 1, peer_order_priority(order), true
+    };
+
+    order->root = peer_order_insert_node(order, order->root, index);
+
+    return 0;
+}
+
+bool peer_order_remove(Peer_Order *order, uint32_t index)
+{
+    if (index >= order->nodes_size || !order->nodes[index].linked) {
+        return false;
+    }
+
+    order->root = peer_order_remove_node(order, order->root, index);
+    order->nodes[index].linked = false;
+
+    return true;
+}
+
+uint32_t peer_order_count(const Peer_Order *order)
+{
+    return peer_order_size(order, peer_order_root(order));
+}
+
+uint32_t peer_order_get(const Peer_Order *order, uint32_t pos)
+{
+    uint32_t t = peer_order_root(order);
+
+    while (t != NIL) {
+        const struct peer_order_node *node = &order->nodes[t];
+        const uint32_t left_size = peer_order_size(order, node->left);
+
+        if (pos < left_size) {
+            t = node->left;
+        } else if (pos == left_size) {
+            return t;
+        } else {
+            pos -= left_size + 1;
+            t = node->right;
+        }
+    }
+
+    return NIL;
+}
+
+static void peer_order_copy_node(const Peer_Order *order, uint32_t t, uint32_t *skip, uint32_t *indices,
+                                 uint32_t max, uint32_t *count)
+{
+    if (t == NIL || *count == max) {
+        return;
+    }
+
+    const struct peer_order_node *node = &order->nodes[t];
+
+    if (*skip >= node->size) {
+        *skip -= node->size;
+        return;
+    }
+
+    peer_order_copy_node(order, node->left, skip, indices, max, count);
+
+    if (*count == max) {
+        return;
+    }
+
+    if (*skip > 0) {
+        --*skip;
+    } else {
+        indices[*count] = t;
+        ++*count;
+    }
+
+    peer_order_copy_node(order, node->right, skip, indices, max, count);
+}
+
+uint32_t peer_order_copy(const Peer_Order *order, uint32_t pos, uint32_t *indices, uint32_t max)
+{
+    uint32_t count = 0;
+    peer_order_copy_node(order, peer_order_root(order), &pos, indices, max, &count);
+    return count;
+}
+
+void peer_order_free(Peer_Order *order)
+{
+    free(order->nodes);
+
+    order->nodes = NULL;
+    order->nodes_size = 0;
+    order->root = NIL;
+}
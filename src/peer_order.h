@@ -0,0 +1,97 @@
+/*  peer_order.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef PEER_ORDER_H
+#define PEER_ORDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Returned by peer_order_get() when the position is out of range */
+#define PEER_ORDER_NONE UINT32_MAX
+
+/*
+ * Compares the peers at peer list indices `index1` and `index2`.
+ *
+ * Return a negative number if the first peer sorts before the second, a positive number if it sorts
+ * after it, and 0 if they're equal.
+ */
+typedef int peer_order_cmp_cb(uint32_t index1, uint32_t index2, const void *userdata);
+
+struct peer_order_node {
+    uint32_t left;
+    uint32_t right;
+    uint32_t size;       /* number of nodes in the subtree rooted at this node */
+    uint32_t priority;
+    bool     linked;
+};
+
+/*
+ * Keeps a set of peer list indices sorted by a comparison callback, with O(log n) insertion, removal
+ * and lookup by position.
+ *
+ * The order is a treap whose nodes are stored at the peer list index they represent, so inserting a
+ * peer doesn't allocate unless the peer list has grown. Peers that compare equal are ordered by index.
+ *
+ * The order only stays correct if a peer is removed before anything that affects how it compares
+ * (e.g. its name or role) changes, and inserted again afterwards.
+ */
+typedef struct Peer_Order {
+    struct peer_order_node *nodes;
+    uint32_t nodes_size;
+    uint32_t root;
+    uint32_t seed;
+
+    peer_order_cmp_cb *cmp;
+    const void *userdata;
+} Peer_Order;
+
+/* Initializes an empty order that sorts peers with `cmp`, which is passed `userdata`. */
+void peer_order_init(Peer_Order *order, peer_order_cmp_cb *cmp, const void *userdata);
+
+/* Inserts the peer at peer list index `index`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure or if the peer is already in the order.
+ */
+int peer_order_insert(Peer_Order *order, uint32_t index);
+
+/* Removes the peer at peer list index `index`.
+ *
+ * Return true if it was in the order.
+ */
+bool peer_order_remove(Peer_Order *order, uint32_t index);
+
+/* Returns the number of peers in the order. */
+uint32_t peer_order_count(const Peer_Order *order);
+
+/* Returns the peer list index of the peer at position `pos` in the order, or PEER_ORDER_NONE if
+ * `pos` is past the last peer.
+ */
+uint32_t peer_order_get(const Peer_Order *order, uint32_t pos);
+
+/* Puts the peer list indices of up to `max` peers, starting at position `pos`, in `indices` in order.
+ *
+ * Returns the number of indices written.
+ */
+uint32_t peer_order_copy(const Peer_Order *order, uint32_t pos, uint32_t *indices, uint32_t max);
+
+/* Frees all memory associated with `order` and empties it. The comparison callback is kept. */
+void peer_order_free(Peer_Order *order);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* PEER_ORDER_H */
@@ -0,0 +1,253 @@
+#include "peer_order.h"
+
+#include <gtest/gtest.h>
+
+#include <strings.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Fake_Peer {
+    int role;
+    std::string name;
+};
+
+int fake_peer_cmp(uint32_t index1, uint32_t index2, const void *userdata)
+{
+    const auto *peers = static_cast<const std::vector<Fake_Peer> *>(userdata);
+    const Fake_Peer &peer1 = (*peers)[index1];
+    const Fake_Peer &peer2 = (*peers)[index2];
+
+    if (peer1.role != peer2.role) {
+        return peer1.role - peer2.role;
+    }
+
+    return strcasecmp(peer1.name.c_str(), peer2.name.c_str());
+}
+
+class PeerOrder : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        peer_order_init(&order_, fake_peer_cmp, &peers_);
+    }
+
+    void TearDown() override
+    {
+        peer_order_free(&order_);
+    }
+
+    std::vector<uint32_t> contents() const
+    {
+        std::vector<uint32_t> result;
+
+        for (uint32_t i = 0; i < peer_order_count(&order_); ++i) {
+            result.push_back(peer_order_get(&order_, i));
+        }
+
+        return result;
+    }
+
+    // The order the peers in `linked` should be in.
+    std::vector<uint32_t> expected(const std::vector<bool> &linked) const
+    {
+        std::vector<uint32_t> result;
+
+        for (uint32_t i = 0; i < linked.size(); ++i) {
+            if (linked[i]) {
+                result.push_back(i);
+            }
+        }
+
+        std::sort(result.begin(), result.end(), [this](uint32_t a, uint32_t b) {
+            const int res = fake_peer_cmp(a, b, &peers_);
+            return res != 0 ? res < 0 : a < b;
+        });
+
+        return result;
+    }
+
+    std::vector<Fake_Peer> peers_;
+    Peer_Order order_ {};
+};
+
+TEST_F(PeerOrder, SortsByRoleThenName)
+{
+    peers_ = {{1, "carol"}, {0, "Zed"}, {1, "Alice"}, {1, "bob"}, {0, "amy"}};
+
+    for (uint32_t i = 0; i < peers_.size(); ++i) {
+        ASSERT_EQ(peer_order_insert(&order_, i), 0);
+    }
+
+    EXPECT_EQ(contents(), (std::vector<uint32_t> {4, 1, 2, 3, 0}));
+    EXPECT_EQ(peer_order_get(&order_, 5), PEER_ORDER_NONE);
+    EXPECT_EQ(peer_order_insert(&order_, 3), -1);
+}
+
+TEST_F(PeerOrder, EqualPeersAreOrderedByIndex)
+{
+    peers_ = {{0, "same"}, {0, "SAME"}, {0, "same"}};
+
+    ASSERT_EQ(peer_order_insert(&order_, 2), 0);
+    ASSERT_EQ(peer_order_insert(&order_, 0), 0);
+    ASSERT_EQ(peer_order_insert(&order_, 1), 0);
+
+    EXPECT_EQ(contents(), (std::vector<uint32_t> {0, 1, 2}));
+
+    EXPECT_TRUE(peer_order_remove(&order_, 1));
+    EXPECT_FALSE(peer_order_remove(&order_, 1));
+    EXPECT_EQ(contents(), (std::vector<uint32_t> {0, 2}));
+}
+
+TEST_F(PeerOrder, CopyFromPosition)
+{
+    for (uint32_t i = 0; i < 100; ++i) {
+        char name[16];
+        std::snprintf(name, sizeof(name), "peer%03u", 99 - i);
+        peers_.push_back({0, name});
+        ASSERT_EQ(peer_order_insert(&order_, i), 0);
+    }
+
+    uint32_t indices[10];
+    ASSERT_EQ(peer_order_copy(&order_, 45, indices, 10), 10u);
+
+    for (uint32_t i = 0; i < 10; ++i) {
+        EXPECT_EQ(indices[i], 99 - 45 - i);
+    }
+
+    EXPECT_EQ(peer_order_copy(&order_, 95, indices, 10), 5u);
+    EXPECT_EQ(peer_order_copy(&order_, 100, indices, 10), 0u);
+}
+
+TEST_F(PeerOrder, ZeroedOrderIsEmpty)
+{
+    Peer_Order zeroed {};
+
+    EXPECT_EQ(peer_order_count(&zeroed), 0u);
+    EXPECT_EQ(peer_order_get(&zeroed, 0), PEER_ORDER_NONE);
+    EXPECT_FALSE(peer_order_remove(&zeroed, 0));
+}
+
+TEST_F(PeerOrder, RandomJoinsExitsAndRenames)
+{
+    constexpr uint32_t kSlots = 300;
+    std::vector<bool> linked(kSlots);
+    peers_.resize(kSlots);
+    uint32_t seed = 42;
+
+    auto random = [&seed](uint32_t n) {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 8) % n;
+    };
+
+    for (int step = 0; step < 20000; ++step) {
+        const uint32_t i = random(kSlots);
+
+        if (!linked[i]) {
+            peers_[i] = {static_cast<int>(random(4)), std::string(1, 'a' + random(26)) + std::to_string(random(50))};
+            ASSERT_EQ(peer_order_insert(&order_, i), 0);
+            linked[i] = true;
+        } else if (random(2) == 0) {
+            ASSERT_TRUE(peer_order_remove(&order_, i));
+            linked[i] = false;
+        } else {
+            // a rename or role change takes the peer out of the order while it changes
+            ASSERT_TRUE(peer_order_remove(&order_, i));
+            peers_[i].name = std::string(1, 'A' + random(26));
+            peers_[i].role = random(4);
+            ASSERT_EQ(peer_order_insert(&order_, i), 0);
+        }
+
+        if (step % 500 == 0) {
+            ASSERT_EQ(contents(), expected(linked));
+        }
+    }
+
+    EXPECT_EQ(contents(), expected(linked));
+}
+
+// Simulates reconnecting to a big group, where every peer joins one after the other, comparing the order
+// with what the join handler used to do: rebuild the name list and sort the whole peer list after each join.
+TEST_F(PeerOrder, DISABLED_JoinStormBenchmark)
+{
+    constexpr uint32_t num_peers = 2000;
+    constexpr size_t kNameLength = 128;
+
+    uint32_t seed = 12345;
+
+    for (uint32_t i = 0; i < num_peers; ++i) {
+        seed = seed * 1103515245 + 12345;
+        char name[32];
+        std::snprintf(name, sizeof(name), "peer%08x", seed);
+        peers_.push_back({static_cast<int>((seed >> 4) % 4 == 0 ? 0 : 1), name});
+    }
+
+    struct Sorted_Peer {
+        int role;
+        char name[kNameLength];
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Sorted_Peer> peer_list;
+
+    for (uint32_t n = 0; n < num_peers; ++n) {
+        Sorted_Peer peer {peers_[n].role, {0}};
+        std::snprintf(peer.name, sizeof(peer.name), "%s", peers_[n].name.c_str());
+        peer_list.push_back(peer);
+
+        char **name_list = static_cast<char **>(std::malloc(peer_list.size() * sizeof(char *)));
+
+        for (size_t i = 0; i < peer_list.size(); ++i) {
+            name_list[i] = static_cast<char *>(std::malloc(kNameLength + 1));
+            std::memcpy(name_list[i], peer_list[i].name, kNameLength);
+        }
+
+        std::qsort(peer_list.data(), peer_list.size(), sizeof(Sorted_Peer), [](const void *a, const void *b) {
+            const Sorted_Peer *peer1 = static_cast<const Sorted_Peer *>(a);
+            const Sorted_Peer *peer2 = static_cast<const Sorted_Peer *>(b);
+
+            if (peer1->role != peer2->role) {
+                return peer1->role - peer2->role;
+            }
+
+            return strcasecmp(peer1->name, peer2->name);
+        });
+
+        for (size_t i = 0; i < peer_list.size(); ++i) {
+            std::free(name_list[i]);
+        }
+
+        std::free(name_list);
+    }
+
+    const auto rebuild_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+
+    for (uint32_t n = 0; n < num_peers; ++n) {
+        ASSERT_EQ(peer_order_insert(&order_, n), 0);
+    }
+
+    const auto order_time = std::chrono::steady_clock::now() - start;
+
+    ASSERT_EQ(peer_order_count(&order_), num_peers);
+
+    for (uint32_t i = 0; i < num_peers; ++i) {
+        const Fake_Peer &peer = peers_[peer_order_get(&order_, i)];
+        ASSERT_EQ(peer.role, peer_list[i].role);
+        ASSERT_STRCASEEQ(peer.name.c_str(), peer_list[i].name);
+    }
+
+    std::printf("%u peers joining: rebuild and sort %lld ms, ordered insert %lld ms\n", num_peers,
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(rebuild_time).count()),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(order_time).count()));
+}
+
+}  // namespace
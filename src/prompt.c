@@ -42,6 +42,7 @@ static const char *const glob_cmd_list[] = {
     "/connect",
     "/decline",
     "/exit",
+    "/frames",
     "/group",
     "/conference",
 #ifdef GAMES
@@ -59,7 +60,9 @@ static const char *const glob_cmd_list[] = {
     "/nospam",
     "/quit",
     "/requests",
+    "/search",
     "/status",
+    "/wakeups",
 
 #ifdef AUDIO
 
@@ -89,12 +92,11 @@ void kill_prompt_window(ToxWindow *self, Windows *windows, const Client_Config *
     StatusBar *statusbar = self->stb;
 
     if (ctx != NULL)  {
-        log_disable(ctx->log);
         line_info_cleanup(ctx->hst);
 
         delwin(ctx->linewin);
         delwin(ctx->history);
-        free(ctx->log);
+        log_free(ctx->log);
         free(ctx);
     }
 
@@ -625,7 +627,11 @@ static bool key_is_similar(const FriendsList *friends, const char *key)
         return false;
     }
 
-    for (size_t i = 0; i < friends->max_idx; ++i) {
+    const uint64_t ident = peer_map_key_bytes(key, KEY_IDENT_BYTES / 2);
+    Peer_Map_Iter iter = {0};
+
+    for (uint32_t i = peer_map_next(&friends->key_idents, ident, &iter); i != PEER_MAP_NONE;
+            i = peer_map_next(&friends->key_idents, ident, &iter)) {
         const ToxicFriend *friend = &friends->list[i];
 
         if (!friend->active) {
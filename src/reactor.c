@@ -0,0 +1,187 @@
+/*  reactor.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif /* __linux__ */
+
+#include "reactor.h"
+
+#ifndef __linux__
+static int set_nonblocking(int fd)
+{
+    const int flags = fcntl(fd, F_GETFL);
+
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        return -1;
+    }
+
+    return fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+#endif /* __linux__ */
+
+int reactor_init(Reactor *reactor)
+{
+    memset(reactor, 0, sizeof(Reactor));
+
+#ifdef __linux__
+    const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    reactor->read_fd = fd;
+    reactor->write_fd = fd;
+#else
+    int fds[2];
+
+    if (pipe(fds) == -1) {
+        return -1;
+    }
+
+    if (set_nonblocking(fds[0]) == -1 || set_nonblocking(fds[1]) == -1) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    reactor->read_fd = fds[0];
+    reactor->write_fd = fds[1];
+#endif /* __linux__ */
+
+    if (pthread_mutex_init(&reactor->stats_lock, NULL) != 0) {
+        if (reactor->write_fd != reactor->read_fd) {
+            close(reactor->write_fd);
+        }
+
+        close(reactor->read_fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+void reactor_free(Reactor *reactor)
+{
+    if (reactor->write_fd != reactor->read_fd) {
+        close(reactor->write_fd);
+    }
+
+    close(reactor->read_fd);
+    pthread_mutex_destroy(&reactor->stats_lock);
+
+    reactor->read_fd = -1;
+    reactor->write_fd = -1;
+}
+
+void reactor_signal(Reactor *reactor)
+{
+    const int saved_errno = errno;
+
+#ifdef __linux__
+    const uint64_t one = 1;
+    const ssize_t ret = write(reactor->write_fd, &one, sizeof(one));
+#else
+    const char one = 1;
+    const ssize_t ret = write(reactor->write_fd, &one, sizeof(one));
+#endif /* __linux__ */
+
+    /* a full pipe or eventfd counter means a wakeup is already pending */
+    (void) ret;
+
+    errno = saved_errno;
+}
+
+/* Empties the signal fd, returning the number of signals it held. */
+static uint64_t reactor_drain(Reactor *reactor)
+{
+#ifdef __linux__
+    uint64_t count = 0;
+
+    if (read(reactor->read_fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+
+    return count;
+#else
+    uint64_t count = 0;
+    char buf[256];
+    ssize_t ret;
+
+    while ((ret = read(reactor->read_fd, buf, sizeof(buf))) > 0) {
+        count += (uint64_t) ret;
+    }
+
+    return count;
+#endif /* __linux__ */
+}
+
+int reactor_wait(Reactor *reactor, int fd, int timeout_ms)
+{
+    struct pollfd fds[2] = {
+        { reactor->read_fd, POLLIN, 0 },
+        { fd, POLLIN, 0 },
+    };
+
+    const nfds_t nfds = fd >= 0 ? 2 : 1;
+    int ret = poll(fds, nfds, timeout_ms);
+
+    if (ret == -1 && errno == EINTR) {
+        /* a signal handler may have signalled us; pick up whatever is ready now */
+        ret = poll(fds, nfds, 0);
+    }
+
+    if (ret == -1) {
+        return -1;
+    }
+
+    int flags = 0;
+    uint64_t signals = 0;
+
+    if (fds[0].revents & POLLIN) {
+        signals = reactor_drain(reactor);
+        flags |= REACTOR_WAKE_SIGNAL;
+    }
+
+    if (nfds == 2 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+        flags |= REACTOR_WAKE_FD;
+    }
+
+    pthread_mutex_lock(&reactor->stats_lock);
+
+    ++reactor->stats.waits;
+    reactor->stats.signals += signals;
+
+    if (flags == 0) {
+        ++reactor->stats.timeouts;
+    } else {
+        ++reactor->stats.wakeups;
+    }
+
+    if (flags & REACTOR_WAKE_FD) {
+        ++reactor->stats.fd_events;
+    }
+
+    pthread_mutex_unlock(&reactor->stats_lock);
+
+    return flags;
+}
+
+void reactor_get_stats(Reactor *reactor, Reactor_Stats *stats)
+{
+    pthread_mutex_lock(&reactor->stats_lock);
+    *stats = reactor->stats;
+    pthread_mutex_unlock(&reactor->stats_lock);
+}
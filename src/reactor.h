@@ -0,0 +1,79 @@
+/*  reactor.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Flags returned by reactor_wait() */
+#define REACTOR_WAKE_SIGNAL 0x1    /* reactor_signal() was called */
+#define REACTOR_WAKE_FD     0x2    /* the watched file descriptor is readable */
+
+typedef struct Reactor_Stats {
+    uint64_t waits;        /* number of calls to reactor_wait() */
+    uint64_t wakeups;      /* number of times a wait returned because of a signal or the watched fd */
+    uint64_t timeouts;     /* number of times a wait returned because its timeout elapsed */
+    uint64_t signals;      /* number of calls to reactor_signal() that were consumed by a wait */
+    uint64_t fd_events;    /* number of times the watched fd was readable */
+} Reactor_Stats;
+
+/*
+ * Lets a thread sleep until another thread or a signal handler has work for it, a file descriptor
+ * becomes readable, or a timeout elapses.
+ *
+ * Signals are delivered through an eventfd on Linux and a pipe elsewhere, so any number of
+ * reactor_signal() calls made while the thread is busy are coalesced into a single wakeup.
+ */
+typedef struct Reactor {
+    int read_fd;
+    int write_fd;
+
+    pthread_mutex_t stats_lock;
+    Reactor_Stats stats;
+} Reactor;
+
+/* Initializes `reactor`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int reactor_init(Reactor *reactor);
+
+/* Frees all resources associated with `reactor`. */
+void reactor_free(Reactor *reactor);
+
+/* Wakes up the thread waiting on `reactor`, or makes its next wait return immediately.
+ *
+ * This function is thread safe and async-signal-safe.
+ */
+void reactor_signal(Reactor *reactor);
+
+/* Waits until `reactor` is signalled, `fd` is readable, or `timeout_ms` milliseconds have elapsed.
+ * `fd` may be -1 to only wait for signals, and `timeout_ms` may be -1 to wait indefinitely.
+ *
+ * Returns a combination of REACTOR_WAKE_SIGNAL and REACTOR_WAKE_FD, or 0 if the timeout elapsed.
+ * Returns -1 on error.
+ */
+int reactor_wait(Reactor *reactor, int fd, int timeout_ms);
+
+/* Puts a snapshot of the wakeup counters of `reactor` in `stats`. */
+void reactor_get_stats(Reactor *reactor, Reactor_Stats *stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* REACTOR_H */
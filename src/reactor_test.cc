@@ -0,0 +1,92 @@
+#include "reactor.h"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+class ReactorTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(reactor_init(&reactor_), 0);
+    }
+
+    void TearDown() override
+    {
+        reactor_free(&reactor_);
+    }
+
+    Reactor reactor_;
+};
+
+TEST_F(ReactorTest, TimesOutWithoutSignal)
+{
+    EXPECT_EQ(reactor_wait(&reactor_, -1, 10), 0);
+
+    Reactor_Stats stats;
+    reactor_get_stats(&reactor_, &stats);
+
+    EXPECT_EQ(stats.waits, 1u);
+    EXPECT_EQ(stats.timeouts, 1u);
+    EXPECT_EQ(stats.wakeups, 0u);
+}
+
+TEST_F(ReactorTest, SignalsAreCoalesced)
+{
+    reactor_signal(&reactor_);
+    reactor_signal(&reactor_);
+    reactor_signal(&reactor_);
+
+    EXPECT_EQ(reactor_wait(&reactor_, -1, 1000), REACTOR_WAKE_SIGNAL);
+    EXPECT_EQ(reactor_wait(&reactor_, -1, 0), 0);
+
+    Reactor_Stats stats;
+    reactor_get_stats(&reactor_, &stats);
+
+    EXPECT_EQ(stats.waits, 2u);
+    EXPECT_EQ(stats.wakeups, 1u);
+    EXPECT_EQ(stats.signals, 3u);
+    EXPECT_EQ(stats.timeouts, 1u);
+}
+
+TEST_F(ReactorTest, WakesOnReadableFd)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+
+    EXPECT_EQ(reactor_wait(&reactor_, fds[0], 0), 0);
+
+    ASSERT_EQ(write(fds[1], "x", 1), 1);
+    EXPECT_EQ(reactor_wait(&reactor_, fds[0], 1000), REACTOR_WAKE_FD);
+
+    reactor_signal(&reactor_);
+    EXPECT_EQ(reactor_wait(&reactor_, fds[0], 1000), REACTOR_WAKE_SIGNAL | REACTOR_WAKE_FD);
+
+    Reactor_Stats stats;
+    reactor_get_stats(&reactor_, &stats);
+    EXPECT_EQ(stats.fd_events, 2u);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_F(ReactorTest, SignalFromAnotherThreadWakesWaiter)
+{
+    std::thread signaller([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        reactor_signal(&reactor_);
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(reactor_wait(&reactor_, -1, 10000), REACTOR_WAKE_SIGNAL);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+
+    signaller.join();
+}
+
+}  // namespace
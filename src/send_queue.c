@@ -0,0 +1,153 @@
+/*  send_queue.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "send_queue.h"
+
+#define SEND_QUEUE_MIN_CAPACITY 8
+
+/* Makes room for one more item at the back of `queue`, either by moving the items to the start of
+ * the array if popping has left enough space there, or by doubling the array.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+static int send_queue_reserve(struct send_queue *queue)
+{
+    if (queue->tail < queue->capacity) {
+        return 0;
+    }
+
+    const size_t length = queue->tail - queue->head;
+
+    if (queue->head > 0 && length <= queue->capacity / 2) {
+        memmove(queue->items, &queue->items[queue->head], length * sizeof(struct send_queue_item));
+        queue->head = 0;
+        queue->tail = length;
+        return 0;
+    }
+
+    const size_t new_capacity = queue->capacity > 0 ? queue->capacity * 2 : SEND_QUEUE_MIN_CAPACITY;
+    struct send_queue_item *new_items = realloc(queue->items, new_capacity * sizeof(struct send_queue_item));
+
+    if (new_items == NULL) {
+        return -1;
+    }
+
+    queue->items = new_items;
+    queue->capacity = new_capacity;
+
+    return 0;
+}
+
+int send_queue_push(struct send_queue *queue, const char *path, size_t length, uint32_t *id)
+{
+    if (send_queue_reserve(queue) != 0) {
+        return -1;
+    }
+
+    char *copy = malloc(length + 1);
+
+    if (copy == NULL) {
+        return -1;
+    }
+
+    memcpy(copy, path, length);
+    copy[length] = '\0';
+
+    struct send_queue_item *item = &queue->items[queue->tail];
+    item->id = queue->next_id;
+    item->path = copy;
+    item->length = length;
+
+    ++queue->next_id;
+    ++queue->tail;
+
+    if (id != NULL) {
+        *id = item->id;
+    }
+
+    return 0;
+}
+
+const struct send_queue_item *send_queue_front(const struct send_queue *queue)
+{
+    if (queue->head == queue->tail) {
+        return NULL;
+    }
+
+    return &queue->items[queue->head];
+}
+
+void send_queue_pop(struct send_queue *queue)
+{
+    if (queue->head == queue->tail) {
+        return;
+    }
+
+    free(queue->items[queue->head].path);
+    ++queue->head;
+
+    if (queue->head == queue->tail) {
+        queue->head = 0;
+        queue->tail = 0;
+    }
+}
+
+int send_queue_remove(struct send_queue *queue, uint32_t id)
+{
+    /* ids are handed out in increasing order, so the items are sorted by id */
+    size_t lo = queue->head;
+    size_t hi = queue->tail;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+
+        if (queue->items[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == queue->tail || queue->items[lo].id != id) {
+        return -1;
+    }
+
+    free(queue->items[lo].path);
+    memmove(&queue->items[lo], &queue->items[lo + 1], (queue->tail - lo - 1) * sizeof(struct send_queue_item));
+    --queue->tail;
+
+    if (queue->head == queue->tail) {
+        queue->head = 0;
+        queue->tail = 0;
+    }
+
+    return 0;
+}
+
+size_t send_queue_length(const struct send_queue *queue)
+{
+    return queue->tail - queue->head;
+}
+
+void send_queue_clear(struct send_queue *queue)
+{
+    for (size_t i = queue->head; i < queue->tail; ++i) {
+        free(queue->items[i].path);
+    }
+
+    free(queue->items);
+
+    const uint32_t next_id = queue->next_id;
+
+    memset(queue, 0, sizeof(struct send_queue));
+    queue->next_id = next_id;
+}
@@ -0,0 +1,76 @@
+/*  send_queue.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef SEND_QUEUE_H
+#define SEND_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * First-in first-out queue of paths of files that are waiting to be sent to a friend.
+ *
+ * Each item gets an id when it's added, which is never reused by the same queue, so that the user can
+ * cancel it by id no matter how many items have been started or removed since. The queue grows as
+ * needed; a zeroed struct is an empty queue.
+ */
+struct send_queue_item {
+    uint32_t id;
+    char *path;
+    size_t length;
+};
+
+struct send_queue {
+    struct send_queue_item *items;
+    size_t head;        /* index of the first item in `items` */
+    size_t tail;        /* index one past the last item in `items` */
+    size_t capacity;
+    uint32_t next_id;
+};
+
+/* Adds a copy of `path` of length `length` to the back of `queue` and puts its id in `id`.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int send_queue_push(struct send_queue *queue, const char *path, size_t length, uint32_t *id);
+
+/* Returns the item at the front of `queue`.
+ * Returns NULL if the queue is empty.
+ *
+ * The item stays valid until the queue is next modified.
+ */
+const struct send_queue_item *send_queue_front(const struct send_queue *queue);
+
+/* Removes the item at the front of `queue`, if there is one. */
+void send_queue_pop(struct send_queue *queue);
+
+/* Removes the item with the id `id` from `queue`.
+ *
+ * Return 0 on success.
+ * Return -1 if there is no item with that id.
+ */
+int send_queue_remove(struct send_queue *queue, uint32_t id);
+
+/* Returns the number of items in `queue`. */
+size_t send_queue_length(const struct send_queue *queue);
+
+/* Removes every item from `queue` and frees its memory. The queue can still be used afterwards. */
+void send_queue_clear(struct send_queue *queue);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* SEND_QUEUE_H */
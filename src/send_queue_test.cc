@@ -0,0 +1,133 @@
+#include "send_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+namespace {
+
+class SendQueue : public ::testing::Test {
+protected:
+    void TearDown() override
+    {
+        send_queue_clear(&queue_);
+    }
+
+    uint32_t push(const std::string &path)
+    {
+        uint32_t id = UINT32_MAX;
+        EXPECT_EQ(send_queue_push(&queue_, path.c_str(), path.size(), &id), 0);
+        return id;
+    }
+
+    std::string front() const
+    {
+        const struct send_queue_item *item = send_queue_front(&queue_);
+        return item != nullptr ? std::string(item->path, item->length) : std::string();
+    }
+
+    struct send_queue queue_ = {0};
+};
+
+TEST_F(SendQueue, EmptyQueue)
+{
+    EXPECT_EQ(send_queue_length(&queue_), 0);
+    EXPECT_EQ(send_queue_front(&queue_), nullptr);
+    EXPECT_EQ(send_queue_remove(&queue_, 0), -1);
+
+    send_queue_pop(&queue_);
+    EXPECT_EQ(send_queue_length(&queue_), 0);
+}
+
+TEST_F(SendQueue, FirstInFirstOut)
+{
+    EXPECT_EQ(push("/tmp/a"), 0);
+    EXPECT_EQ(push("/tmp/b"), 1);
+    EXPECT_EQ(push("/tmp/c"), 2);
+    EXPECT_EQ(send_queue_length(&queue_), 3);
+
+    EXPECT_EQ(front(), "/tmp/a");
+    send_queue_pop(&queue_);
+    EXPECT_EQ(front(), "/tmp/b");
+    send_queue_pop(&queue_);
+    EXPECT_EQ(front(), "/tmp/c");
+    send_queue_pop(&queue_);
+
+    EXPECT_EQ(send_queue_front(&queue_), nullptr);
+}
+
+TEST_F(SendQueue, PathIsCopied)
+{
+    char path[] = "/tmp/file";
+    ASSERT_EQ(send_queue_push(&queue_, path, 4, nullptr), 0);
+    std::memset(path, 'x', sizeof(path) - 1);
+
+    const struct send_queue_item *item = send_queue_front(&queue_);
+    ASSERT_NE(item, nullptr);
+    EXPECT_STREQ(item->path, "/tmp");
+    EXPECT_EQ(item->length, 4);
+}
+
+TEST_F(SendQueue, RemoveById)
+{
+    for (int i = 0; i < 5; ++i) {
+        push("/tmp/" + std::to_string(i));
+    }
+
+    EXPECT_EQ(send_queue_remove(&queue_, 2), 0);
+    EXPECT_EQ(send_queue_remove(&queue_, 2), -1);
+    EXPECT_EQ(send_queue_remove(&queue_, 0), 0);
+    EXPECT_EQ(send_queue_remove(&queue_, 4), 0);
+    EXPECT_EQ(send_queue_remove(&queue_, 5), -1);
+    EXPECT_EQ(send_queue_length(&queue_), 2);
+
+    EXPECT_EQ(front(), "/tmp/1");
+    send_queue_pop(&queue_);
+    EXPECT_EQ(front(), "/tmp/3");
+}
+
+TEST_F(SendQueue, IdsAreNotReused)
+{
+    push("/tmp/a");
+    push("/tmp/b");
+    send_queue_pop(&queue_);
+    send_queue_pop(&queue_);
+    send_queue_clear(&queue_);
+
+    EXPECT_EQ(push("/tmp/c"), 2);
+
+    /* an id that's been popped can't remove the item that took its place */
+    EXPECT_EQ(send_queue_remove(&queue_, 0), -1);
+    EXPECT_EQ(send_queue_length(&queue_), 1);
+}
+
+TEST_F(SendQueue, ManyItemsInterleaved)
+{
+    uint32_t next_popped = 0;
+
+    for (int i = 0; i < 10000; ++i) {
+        push("/tmp/" + std::to_string(i));
+
+        if (i % 3 == 0) {
+            ASSERT_EQ(front(), "/tmp/" + std::to_string(next_popped));
+            send_queue_pop(&queue_);
+            ++next_popped;
+        }
+    }
+
+    EXPECT_EQ(send_queue_length(&queue_), 10000 - next_popped);
+
+    /* the array is compacted as the front is popped rather than growing without bound */
+    EXPECT_LE(queue_.capacity, 2 * 16384);
+
+    while (send_queue_front(&queue_) != nullptr) {
+        ASSERT_EQ(front(), "/tmp/" + std::to_string(next_popped));
+        send_queue_pop(&queue_);
+        ++next_popped;
+    }
+
+    EXPECT_EQ(next_popped, 10000);
+}
+
+}  // namespace
@@ -16,6 +16,7 @@
 #include "configdir.h"
 #include "friendlist.h"
 #include "groupchats.h"
+#include "message_queue.h"
 #include "misc_tools.h"
 #include "term_mplex.h"
 #include "notify.h"
@@ -67,6 +68,8 @@ static struct ui_strings {
     const char *show_network_info;
     const char *nodeslist_update_freq;
     const char *autosave_freq;
+    const char *log_sync_interval;
+    const char *message_queue_window;
     const char *device_cooldown;
 
     const char *line_padding;
@@ -109,6 +112,8 @@ static struct ui_strings {
     "show_network_info",
     "nodeslist_update_freq",
     "autosave_freq",
+    "log_sync_interval",
+    "message_queue_window",
     "device_cooldown",
     "line_padding",
     "line_join",
@@ -150,6 +155,8 @@ static void ui_defaults(Client_Config *settings)
     settings->show_network_info = false;
     settings->nodeslist_update_freq = 1;
     settings->autosave_freq = 600;
+    settings->log_sync_interval = 0;
+    settings->message_queue_window = CQUEUE_DEFAULT_WINDOW;
     settings->device_cooldown = 5;
 
     settings->line_padding = true;
@@ -708,6 +715,12 @@ int settings_load_blocked_words(Client_Data *client_data, const Run_Options *run
     client_data->blocked_words = words_list;
     client_data->num_blocked_words = num_blocked_words;
 
+    const char *const *words = (const char *const *) words_list;
+
+    if (word_filter_build(&client_data->blocked_words_filter, words, num_blocked_words) != 0) {
+        fprintf(stderr, "Warning: failed to compile blocked words list; falling back to searching for each word.\n");
+    }
+
     config_destroy(cfg);
 
     return 0;
@@ -820,6 +833,13 @@ static void settings_load_ui(config_t *cfg, Client_Config *s)
     config_setting_lookup_int(setting, ui_strings.notification_timeout, &s->notification_timeout);
     config_setting_lookup_int(setting, ui_strings.nodeslist_update_freq, &s->nodeslist_update_freq);
     config_setting_lookup_int(setting, ui_strings.autosave_freq, &s->autosave_freq);
+    config_setting_lookup_int(setting, ui_strings.log_sync_interval, &s->log_sync_interval);
+    config_setting_lookup_int(setting, ui_strings.message_queue_window, &s->message_queue_window);
+
+    if (s->message_queue_window < 1 || s->message_queue_window > CQUEUE_MAX_WINDOW) {
+        s->message_queue_window = CQUEUE_DEFAULT_WINDOW;
+    }
+
     config_setting_lookup_int(setting, ui_strings.device_cooldown, &s->device_cooldown);
 
     if (config_setting_lookup_bool(setting, ui_strings.line_padding, &bool_val)) {
@@ -1158,6 +1178,8 @@ void settings_reload(Toxic *toxic)
 
     free_ptr_array((void **) client_data->blocked_words);
     client_data->blocked_words = NULL;
+    client_data->num_blocked_words = 0;
+    word_filter_free(&client_data->blocked_words_filter);
 
     ret = settings_load_blocked_words(client_data, run_opts);
 
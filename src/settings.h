@@ -52,6 +52,8 @@ typedef struct Client_Config {
     int device_cooldown;
     int nodeslist_update_freq;  /* <= 0 to disable updates */
     int autosave_freq; /* <= 0 to disable autosave */
+    int log_sync_interval;  /* seconds between fsyncs of chat logs; <= 0 to never fsync */
+    int message_queue_window;  /* messages sent to a friend before waiting for read receipts */
 
     bool line_padding;
     char line_join[LINE_HINT_MAX + 1];
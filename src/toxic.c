@@ -37,6 +37,7 @@
 #include "bootstrap.h"
 #include "conference.h"
 #include "configdir.h"
+#include "dir_cache.h"
 #include "execute.h"
 #include "file_transfers.h"
 #include "friendlist.h"
@@ -44,6 +45,8 @@
 #include "init_queue.h"
 #include "line_info.h"
 #include "log.h"
+#include "log_search.h"
+#include "log_writer.h"
 #include "message_queue.h"
 #include "misc_tools.h"
 #include "name_lookup.h"
@@ -74,6 +77,8 @@
 #endif
 
 struct Winthread Winthread;
+struct cqueue_thread cqueue_thread;
+struct tox_thread tox_thread;
 
 static void kill_toxic(Toxic *toxic)
 {
@@ -86,6 +91,7 @@ static void kill_toxic(Toxic *toxic)
     free(client_data->data_path);
     free(client_data->block_path);
     free_ptr_array((void **) client_data->blocked_words);
+    word_filter_free(&client_data->blocked_words_filter);
     free(toxic->c_config);
     free(toxic->run_opts);
     free(toxic->windows);
@@ -131,6 +137,11 @@ void exit_toxic_success(Toxic *toxic)
 
     kill_all_file_transfers(toxic);
     kill_all_windows(toxic);
+    file_reader_stop();
+    file_writer_stop();
+    dir_cache_stop();
+    log_search_stop();
+    log_writer_stop();
 
 #ifdef AUDIO
 #ifdef VIDEO
@@ -183,10 +194,13 @@ void exit_toxic_err(int errcode, const char *errmsg, ...)
     exit(EXIT_FAILURE);
 }
 
-/* Sets ncurses refresh rate. Lower values make it refresh more often. */
+/* Sets how often the active window is redrawn while the interface is busy, in milliseconds.
+ * Lower values make it refresh more often.
+ */
 void set_window_refresh_rate(size_t refresh_rate)
 {
-    timeout(refresh_rate);
+    Winthread.refresh_rate = (int) refresh_rate;
+    reactor_signal(&Winthread.reactor);
 }
 
 static void get_custom_toxic_colours(const Client_Config *c_config, short *bar_bg_color, short *bar_fg_color,
@@ -323,6 +337,7 @@ void init_term(const Client_Config *c_config, Init_Queue *init_q, bool use_defau
     keypad(stdscr, 1);
     noecho();
     nonl();
+    timeout(0);  /* the UI thread waits for input itself, see thread_winref() */
     set_window_refresh_rate(NCURSES_DEFAULT_REFRESH_RATE);
 
     if (!has_colors()) {
@@ -507,6 +522,12 @@ int store_data(const Toxic *toxic)
  */
 void flag_interface_refresh(void)
 {
+    /* while the flag is set the UI thread redraws at the refresh rate anyway, so it only
+     * needs waking up for the first change */
+    if (!Winthread.flag_refresh) {
+        reactor_signal(&Winthread.reactor);
+    }
+
     Winthread.flag_refresh = 1;
     Winthread.last_refresh_flag = get_unix_time();
 }
@@ -43,6 +43,8 @@
 
 #include "settings.h"
 #include "toxic_constants.h"
+#include "window_events.h"
+#include "word_filter.h"
 
 #ifdef X11
 #include "x11focus.h"
@@ -56,6 +58,7 @@ typedef struct Client_Data {
     char *block_path;
     char **blocked_words;
     size_t num_blocked_words;
+    Word_Filter blocked_words_filter;    /* blocked_words compiled so that a line is searched only once */
     bool mplex_auto_away_initialized;
 } Client_Data;
 
@@ -84,6 +87,7 @@ typedef struct Windows {
     ToxWindow  **list;
     uint16_t   count;
     uint16_t   active_index;
+    Window_Events events;    /* routes tox events to the windows that handle them */
 } Windows;
 
 typedef struct Toxic {
@@ -120,7 +124,9 @@ void unlock_status(void);
 
 void flag_interface_refresh(void);
 
-/* Sets ncurses refresh rate. Lower values make it refresh more often. */
+/* Sets how often the active window is redrawn while the interface is busy, in milliseconds.
+ * Lower values make it refresh more often.
+ */
 void set_window_refresh_rate(size_t refresh_rate);
 
 void exit_toxic_success(Toxic *toxic) __attribute__((__noreturn__));
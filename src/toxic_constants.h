@@ -92,6 +92,7 @@ typedef enum _FATAL_ERRS {
     FATALERR_TOX_INIT = -9,         /* Tox instance failed to initialize */
     FATALERR_TOXIC_INIT = -10,      /* Toxic instance failed to initialize */
     FATALERR_CURSES = -11,          /* Unrecoverable Ncurses error */
+    FATALERR_REACTOR_INIT = -12,    /* thread wakeup init failed */
 } FATAL_ERRS;
 
 #endif  // TOXIC_CONSTANTS_H
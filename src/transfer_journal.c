@@ -0,0 +1,88 @@
+/*  transfer_journal.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "transfer_journal.h"
+
+/*
+ * A record is two lines:
+ *
+ *   <file size> <position> <checksum>
+ *   <file path>
+ */
+
+int transfer_journal_save(const char *path, const struct transfer_record *record)
+{
+    const size_t tmp_len = strlen(path) + sizeof(".tmp");
+    char *tmp_path = malloc(tmp_len);
+
+    if (tmp_path == NULL) {
+        return -1;
+    }
+
+    snprintf(tmp_path, tmp_len, "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "w");
+
+    if (fp == NULL) {
+        free(tmp_path);
+        return -1;
+    }
+
+    const int len = fprintf(fp, "%" PRIu64 " %" PRIu64 " %016" PRIx64 "\n%s\n", record->file_size, record->position,
+                            record->checksum, record->file_path);
+
+    if (fclose(fp) != 0 || len < 0 || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    free(tmp_path);
+
+    return 0;
+}
+
+int transfer_journal_load(const char *path, struct transfer_record *record)
+{
+    FILE *fp = fopen(path, "r");
+
+    if (fp == NULL) {
+        return -1;
+    }
+
+    char line[64];
+
+    const bool valid = fgets(line, sizeof(line), fp) != NULL
+                       && sscanf(line, "%" SCNu64 " %" SCNu64 " %" SCNx64, &record->file_size, &record->position,
+                                 &record->checksum) == 3
+                       && fgets(record->file_path, sizeof(record->file_path), fp) != NULL;
+
+    fclose(fp);
+
+    if (!valid || record->position > record->file_size) {
+        return -1;
+    }
+
+    /* a path without a newline was cut short */
+    const size_t path_len = strlen(record->file_path);
+
+    if (path_len <= 1 || record->file_path[path_len - 1] != '\n') {
+        return -1;
+    }
+
+    record->file_path[path_len - 1] = '\0';
+
+    return 0;
+}
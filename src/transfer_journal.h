@@ -0,0 +1,55 @@
+/*  transfer_journal.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef TRANSFER_JOURNAL_H
+#define TRANSFER_JOURNAL_H
+
+#include <stdint.h>
+
+#include "toxic_constants.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * On-disk record of how much of an incoming file transfer has been saved, so that it can be resumed
+ * from where it left off when the sender offers the same file again, even after a restart.
+ *
+ * Each transfer has its own small record file, which is replaced atomically every time it's saved. The
+ * record holds a checksum of the saved prefix of the file, which is checked before the transfer is
+ * resumed so that a partial file that's been changed or lost data in a crash is downloaded again
+ * instead of being extended.
+ */
+struct transfer_record {
+    uint64_t file_size;                       /* size of the whole file */
+    uint64_t position;                        /* number of bytes at the start of the file that have been saved */
+    uint64_t checksum;                        /* file_writer_checksum() of those bytes */
+    char file_path[TOXIC_MAX_PATH_LENGTH];    /* where the file is being saved */
+};
+
+/* Writes `record` to `path`, replacing whatever was there.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int transfer_journal_save(const char *path, const struct transfer_record *record);
+
+/* Reads the record at `path` into `record`.
+ *
+ * Return 0 on success.
+ * Return -1 if the record doesn't exist or is invalid.
+ */
+int transfer_journal_load(const char *path, struct transfer_record *record);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* TRANSFER_JOURNAL_H */
@@ -0,0 +1,112 @@
+#include "transfer_journal.h"
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+namespace {
+
+class TransferJournal : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        std::snprintf(path_, sizeof(path_), "%s/toxic_transfer_journal_test_XXXXXX", testing::TempDir().c_str());
+        const int fd = mkstemp(path_);
+        ASSERT_NE(fd, -1);
+        close(fd);
+    }
+
+    void TearDown() override
+    {
+        std::remove(path_);
+    }
+
+    void write_raw(const std::string &contents)
+    {
+        FILE *fp = std::fopen(path_, "w");
+        ASSERT_NE(fp, nullptr);
+        std::fputs(contents.c_str(), fp);
+        std::fclose(fp);
+    }
+
+    char path_[PATH_MAX];
+};
+
+TEST_F(TransferJournal, SaveAndLoad)
+{
+    struct transfer_record saved = {0};
+    saved.file_size = 5ULL * 1024 * 1024 * 1024;
+    saved.position = 123456789;
+    saved.checksum = 0xcbf29ce484222325ULL;
+    std::snprintf(saved.file_path, sizeof(saved.file_path), "/home/user/Downloads/holiday photos (2).tar");
+
+    ASSERT_EQ(transfer_journal_save(path_, &saved), 0);
+
+    struct transfer_record loaded;
+    ASSERT_EQ(transfer_journal_load(path_, &loaded), 0);
+
+    EXPECT_EQ(loaded.file_size, saved.file_size);
+    EXPECT_EQ(loaded.position, saved.position);
+    EXPECT_EQ(loaded.checksum, saved.checksum);
+    EXPECT_STREQ(loaded.file_path, saved.file_path);
+}
+
+TEST_F(TransferJournal, SaveReplacesRecord)
+{
+    struct transfer_record record = {0};
+    record.file_size = 1000;
+    std::snprintf(record.file_path, sizeof(record.file_path), "a");
+
+    for (uint64_t position = 0; position <= 1000; position += 100) {
+        record.position = position;
+        ASSERT_EQ(transfer_journal_save(path_, &record), 0);
+    }
+
+    struct transfer_record loaded;
+    ASSERT_EQ(transfer_journal_load(path_, &loaded), 0);
+    EXPECT_EQ(loaded.position, 1000u);
+
+    // the temporary file is renamed into place
+    const std::string tmp = std::string(path_) + ".tmp";
+    EXPECT_NE(access(tmp.c_str(), F_OK), 0);
+}
+
+TEST_F(TransferJournal, MissingRecord)
+{
+    std::remove(path_);
+
+    struct transfer_record loaded;
+    EXPECT_EQ(transfer_journal_load(path_, &loaded), -1);
+}
+
+TEST_F(TransferJournal, InvalidRecordsAreRejected)
+{
+    struct transfer_record loaded;
+
+    write_raw("");
+    EXPECT_EQ(transfer_journal_load(path_, &loaded), -1);
+
+    write_raw("100 50 00000000000000ff\n");
+    EXPECT_EQ(transfer_journal_load(path_, &loaded), -1);
+
+    // cut off in the middle of the path
+    write_raw("100 50 00000000000000ff\n/tmp/fi");
+    EXPECT_EQ(transfer_journal_load(path_, &loaded), -1);
+
+    // more saved than the file holds
+    write_raw("100 150 00000000000000ff\n/tmp/file\n");
+    EXPECT_EQ(transfer_journal_load(path_, &loaded), -1);
+
+    write_raw("garbage\n/tmp/file\n");
+    EXPECT_EQ(transfer_journal_load(path_, &loaded), -1);
+
+    write_raw("100 50 00000000000000ff\n/tmp/file\n");
+    EXPECT_EQ(transfer_journal_load(path_, &loaded), 0);
+}
+
+}  // namespace
@@ -0,0 +1,192 @@
+/*  transfer_manifest.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <string.h>
+
+#include "transfer_manifest.h"
+
+/*
+ * Every packet starts with a one byte type and a four byte id. Integers are big-endian.
+ *
+ *   BEGIN  <name>
+ *   ENTRY  <file_id: 32> <size: 8> <path>
+ *   END    <count: 4> <size: 8>
+ */
+#define MANIFEST_HEADER_SIZE (1 + 4)
+#define MANIFEST_ENTRY_SIZE (MANIFEST_HEADER_SIZE + MANIFEST_FILE_ID_SIZE + 8)
+#define MANIFEST_END_SIZE (MANIFEST_HEADER_SIZE + 4 + 8)
+
+static void pack_u32(uint8_t *buf, uint32_t n)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        buf[i] = (uint8_t)(n >> (8 * (3 - i)));
+    }
+}
+
+static void pack_u64(uint8_t *buf, uint64_t n)
+{
+    for (size_t i = 0; i < 8; ++i) {
+        buf[i] = (uint8_t)(n >> (8 * (7 - i)));
+    }
+}
+
+static uint32_t unpack_u32(const uint8_t *buf)
+{
+    uint32_t n = 0;
+
+    for (size_t i = 0; i < 4; ++i) {
+        n = (n << 8) | buf[i];
+    }
+
+    return n;
+}
+
+static uint64_t unpack_u64(const uint8_t *buf)
+{
+    uint64_t n = 0;
+
+    for (size_t i = 0; i < 8; ++i) {
+        n = (n << 8) | buf[i];
+    }
+
+    return n;
+}
+
+int manifest_packet_pack(const struct manifest_packet *packet, uint8_t *buf, size_t size)
+{
+    size_t length;
+
+    switch (packet->type) {
+        case MANIFEST_PACKET_BEGIN: {
+            length = MANIFEST_HEADER_SIZE + packet->name_length;
+
+            if (length > size) {
+                return -1;
+            }
+
+            memcpy(buf + MANIFEST_HEADER_SIZE, packet->name, packet->name_length);
+            break;
+        }
+
+        case MANIFEST_PACKET_ENTRY: {
+            length = MANIFEST_ENTRY_SIZE + packet->name_length;
+
+            if (length > size) {
+                return -1;
+            }
+
+            memcpy(buf + MANIFEST_HEADER_SIZE, packet->file_id, MANIFEST_FILE_ID_SIZE);
+            pack_u64(buf + MANIFEST_HEADER_SIZE + MANIFEST_FILE_ID_SIZE, packet->size);
+            memcpy(buf + MANIFEST_ENTRY_SIZE, packet->name, packet->name_length);
+            break;
+        }
+
+        case MANIFEST_PACKET_END: {
+            length = MANIFEST_END_SIZE;
+
+            if (length > size) {
+                return -1;
+            }
+
+            pack_u32(buf + MANIFEST_HEADER_SIZE, packet->count);
+            pack_u64(buf + MANIFEST_HEADER_SIZE + 4, packet->size);
+            break;
+        }
+
+        default: {
+            return -1;
+        }
+    }
+
+    buf[0] = (uint8_t) packet->type;
+    pack_u32(buf + 1, packet->id);
+
+    return (int) length;
+}
+
+int manifest_packet_unpack(const uint8_t *data, size_t length, struct manifest_packet *packet)
+{
+    if (length < MANIFEST_HEADER_SIZE) {
+        return -1;
+    }
+
+    memset(packet, 0, sizeof(struct manifest_packet));
+    packet->id = unpack_u32(data + 1);
+
+    switch (data[0]) {
+        case MANIFEST_PACKET_BEGIN: {
+            packet->type = MANIFEST_PACKET_BEGIN;
+            packet->name = (const char *)(data + MANIFEST_HEADER_SIZE);
+            packet->name_length = length - MANIFEST_HEADER_SIZE;
+            return 0;
+        }
+
+        case MANIFEST_PACKET_ENTRY: {
+            if (length < MANIFEST_ENTRY_SIZE) {
+                return -1;
+            }
+
+            packet->type = MANIFEST_PACKET_ENTRY;
+            memcpy(packet->file_id, data + MANIFEST_HEADER_SIZE, MANIFEST_FILE_ID_SIZE);
+            packet->size = unpack_u64(data + MANIFEST_HEADER_SIZE + MANIFEST_FILE_ID_SIZE);
+            packet->name = (const char *)(data + MANIFEST_ENTRY_SIZE);
+            packet->name_length = length - MANIFEST_ENTRY_SIZE;
+            return 0;
+        }
+
+        case MANIFEST_PACKET_END: {
+            if (length != MANIFEST_END_SIZE) {
+                return -1;
+            }
+
+            packet->type = MANIFEST_PACKET_END;
+            packet->count = unpack_u32(data + MANIFEST_HEADER_SIZE);
+            packet->size = unpack_u64(data + MANIFEST_HEADER_SIZE + 4);
+            return 0;
+        }
+
+        default: {
+            return -1;
+        }
+    }
+}
+
+bool manifest_path_is_valid(const char *path, size_t length)
+{
+    if (length == 0 || path[0] == '/') {
+        return false;
+    }
+
+    size_t start = 0;
+
+    for (size_t i = 0; i <= length; ++i) {
+        if (i < length && path[i] == '\0') {
+            return false;
+        }
+
+        if (i < length && path[i] != '/') {
+            continue;
+        }
+
+        const char *component = path + start;
+        const size_t component_len = i - start;
+
+        if (component_len == 0 || component[0] == ' ' || component[0] == '-') {
+            return false;
+        }
+
+        if ((component_len == 1 && component[0] == '.')
+                || (component_len == 2 && component[0] == '.' && component[1] == '.')) {
+            return false;
+        }
+
+        start = i + 1;
+    }
+
+    return true;
+}
@@ -0,0 +1,73 @@
+/*  transfer_manifest.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef TRANSFER_MANIFEST_H
+#define TRANSFER_MANIFEST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define MANIFEST_FILE_ID_SIZE 32    /* same as TOX_FILE_ID_LENGTH */
+
+/*
+ * The manifest of a directory that's being sent is streamed to the receiver one packet at a time, as
+ * the sender walks the directory:
+ *
+ *   BEGIN  names the directory.
+ *   ENTRY  is sent just before each file's transfer is offered, and gives the path of the file within
+ *          the directory along with the file_id of the transfer, which is how the receiver matches the
+ *          two up.
+ *   END    is sent once every file has been offered, and gives how many there were.
+ */
+typedef enum Manifest_Packet_Type {
+    MANIFEST_PACKET_BEGIN = 0,
+    MANIFEST_PACKET_ENTRY = 1,
+    MANIFEST_PACKET_END   = 2,
+} Manifest_Packet_Type;
+
+struct manifest_packet {
+    Manifest_Packet_Type type;
+    uint32_t id;                                /* identifies the directory transfer */
+    uint8_t  file_id[MANIFEST_FILE_ID_SIZE];    /* ENTRY */
+    uint64_t size;                              /* ENTRY: size of the file. END: size of all the files */
+    uint32_t count;                             /* END: number of files */
+    const char *name;                           /* BEGIN: name of the directory. ENTRY: path of the file */
+    size_t name_length;
+};
+
+/* Packs `packet` into `buf`.
+ *
+ * Return the length of the packed packet on success.
+ * Return -1 if `buf` is too small.
+ */
+int manifest_packet_pack(const struct manifest_packet *packet, uint8_t *buf, size_t size);
+
+/* Unpacks the packet in `data` into `packet`. The name in `packet` points into `data`, and isn't
+ * null terminated.
+ *
+ * Return 0 on success.
+ * Return -1 if the packet is invalid.
+ */
+int manifest_packet_unpack(const uint8_t *data, size_t length, struct manifest_packet *packet);
+
+/* Returns true if `path` of length `length` is a relative path that stays inside the directory it's
+ * relative to, and none of whose components is empty, "." or "..", or starts with a space or a dash.
+ */
+bool manifest_path_is_valid(const char *path, size_t length);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* TRANSFER_MANIFEST_H */
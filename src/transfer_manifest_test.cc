@@ -0,0 +1,127 @@
+#include "transfer_manifest.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+namespace {
+
+std::string packet_name(const struct manifest_packet &packet)
+{
+    return std::string(packet.name, packet.name_length);
+}
+
+TEST(TransferManifest, Begin)
+{
+    struct manifest_packet packet = {};
+    packet.type = MANIFEST_PACKET_BEGIN;
+    packet.id = 0xdeadbeef;
+    packet.name = "holiday photos";
+    packet.name_length = std::strlen(packet.name);
+
+    uint8_t buf[128];
+    const int length = manifest_packet_pack(&packet, buf, sizeof(buf));
+    ASSERT_GT(length, 0);
+
+    struct manifest_packet unpacked;
+    ASSERT_EQ(manifest_packet_unpack(buf, length, &unpacked), 0);
+    EXPECT_EQ(unpacked.type, MANIFEST_PACKET_BEGIN);
+    EXPECT_EQ(unpacked.id, 0xdeadbeef);
+    EXPECT_EQ(packet_name(unpacked), "holiday photos");
+}
+
+TEST(TransferManifest, Entry)
+{
+    struct manifest_packet packet = {};
+    packet.type = MANIFEST_PACKET_ENTRY;
+    packet.id = 7;
+    packet.size = 5ULL * 1024 * 1024 * 1024;
+    packet.name = "2026/june/beach.jpg";
+    packet.name_length = std::strlen(packet.name);
+
+    for (size_t i = 0; i < MANIFEST_FILE_ID_SIZE; ++i) {
+        packet.file_id[i] = (uint8_t) i;
+    }
+
+    uint8_t buf[128];
+    const int length = manifest_packet_pack(&packet, buf, sizeof(buf));
+    ASSERT_GT(length, 0);
+
+    struct manifest_packet unpacked;
+    ASSERT_EQ(manifest_packet_unpack(buf, length, &unpacked), 0);
+    EXPECT_EQ(unpacked.type, MANIFEST_PACKET_ENTRY);
+    EXPECT_EQ(unpacked.id, 7);
+    EXPECT_EQ(unpacked.size, packet.size);
+    EXPECT_EQ(std::memcmp(unpacked.file_id, packet.file_id, MANIFEST_FILE_ID_SIZE), 0);
+    EXPECT_EQ(packet_name(unpacked), "2026/june/beach.jpg");
+
+    /* a packet cut short before the path is still missing its size */
+    EXPECT_EQ(manifest_packet_unpack(buf, 20, &unpacked), -1);
+}
+
+TEST(TransferManifest, End)
+{
+    struct manifest_packet packet = {};
+    packet.type = MANIFEST_PACKET_END;
+    packet.id = 1;
+    packet.count = 123456;
+    packet.size = 987654321012ULL;
+
+    uint8_t buf[64];
+    const int length = manifest_packet_pack(&packet, buf, sizeof(buf));
+    ASSERT_GT(length, 0);
+
+    struct manifest_packet unpacked;
+    ASSERT_EQ(manifest_packet_unpack(buf, length, &unpacked), 0);
+    EXPECT_EQ(unpacked.type, MANIFEST_PACKET_END);
+    EXPECT_EQ(unpacked.count, 123456);
+    EXPECT_EQ(unpacked.size, 987654321012ULL);
+
+    EXPECT_EQ(manifest_packet_unpack(buf, length + 1, &unpacked), -1);
+}
+
+TEST(TransferManifest, BufferTooSmall)
+{
+    struct manifest_packet packet = {};
+    packet.type = MANIFEST_PACKET_ENTRY;
+    packet.name = "file";
+    packet.name_length = 4;
+
+    uint8_t buf[44];
+    EXPECT_EQ(manifest_packet_pack(&packet, buf, sizeof(buf)), -1);
+}
+
+TEST(TransferManifest, InvalidPackets)
+{
+    struct manifest_packet unpacked;
+    const uint8_t unknown[] = {9, 0, 0, 0, 1};
+    const uint8_t short_header[] = {0, 0, 0};
+
+    EXPECT_EQ(manifest_packet_unpack(unknown, sizeof(unknown), &unpacked), -1);
+    EXPECT_EQ(manifest_packet_unpack(short_header, sizeof(short_header), &unpacked), -1);
+}
+
+TEST(TransferManifest, PathValidation)
+{
+    const auto valid = [](const std::string &path) {
+        return manifest_path_is_valid(path.data(), path.size());
+    };
+
+    EXPECT_TRUE(valid("file"));
+    EXPECT_TRUE(valid("a/b/c.txt"));
+    EXPECT_TRUE(valid("..hidden/.file"));
+
+    EXPECT_FALSE(valid(""));
+    EXPECT_FALSE(valid("/etc/passwd"));
+    EXPECT_FALSE(valid("../escape"));
+    EXPECT_FALSE(valid("a/../../escape"));
+    EXPECT_FALSE(valid("a/./b"));
+    EXPECT_FALSE(valid("a//b"));
+    EXPECT_FALSE(valid("a/"));
+    EXPECT_FALSE(valid("a/-rf"));
+    EXPECT_FALSE(valid(" a"));
+    EXPECT_FALSE(valid(std::string("a\0b", 3)));
+}
+
+}  // namespace
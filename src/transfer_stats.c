@@ -0,0 +1,101 @@
+/*  transfer_stats.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <time.h>
+
+#include "transfer_stats.h"
+
+uint64_t transfer_stats_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000 + ((uint64_t) t.tv_nsec) / 1000000;
+}
+
+double transfer_rate_sample(struct transfer_rate *rate, uint64_t position, uint64_t now)
+{
+    /* the first sample, or a transfer that has started over */
+    if (rate->last_sample == 0 || position < rate->last_position || now < rate->last_sample) {
+        rate->last_position = position;
+        rate->last_sample = now > 0 ? now : 1;
+        rate->bps = 0;
+        return 0;
+    }
+
+    const uint64_t elapsed = now - rate->last_sample;
+
+    if (elapsed < TRANSFER_RATE_SAMPLE_INTERVAL) {
+        return rate->bps;
+    }
+
+    const double current = (double)(position - rate->last_position) * 1000 / elapsed;
+
+    /* a transfer that was idle starts from its current speed instead of climbing slowly up to it */
+    if (rate->bps == 0) {
+        rate->bps = current;
+    } else {
+        const double weight = (double) elapsed / (elapsed + TRANSFER_RATE_SMOOTHING);
+        rate->bps += (current - rate->bps) * weight;
+    }
+
+    rate->last_position = position;
+    rate->last_sample = now;
+
+    return rate->bps;
+}
+
+double transfer_stat_percent(const struct transfer_stat *stat)
+{
+    if (stat->size == 0) {
+        return 0;
+    }
+
+    if (stat->position >= stat->size) {
+        return 100;
+    }
+
+    return (double) stat->position * 100 / stat->size;
+}
+
+void transfer_stat_bar(const struct transfer_stat *stat, char *buf, size_t width)
+{
+    const double percent = transfer_stat_percent(stat);
+    const size_t filled = (size_t)(percent * width / 100);
+
+    for (size_t i = 0; i < width; ++i) {
+        if (i < filled) {
+            buf[i] = '=';
+        } else if (i == filled) {
+            buf[i] = '>';
+        } else {
+            buf[i] = '-';
+        }
+    }
+
+    buf[width] = '\0';
+}
+
+size_t transfer_stat_name_fit(const char *name, size_t max_bytes)
+{
+    size_t length = 0;
+
+    while (length < max_bytes && name[length] != '\0') {
+        ++length;
+    }
+
+    if (name[length] == '\0') {
+        return length;
+    }
+
+    /* back up to the start of the character that was cut off */
+    while (length > 0 && (name[length] & 0xC0) == 0x80) {
+        --length;
+    }
+
+    return length;
+}
@@ -0,0 +1,78 @@
+/*  transfer_stats.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef TRANSFER_STATS_H
+#define TRANSFER_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* The minimum number of milliseconds between two samples of a transfer's rate */
+#define TRANSFER_RATE_SAMPLE_INTERVAL 250
+
+/* How many milliseconds it takes for a change in a transfer's speed to be mostly reflected in its rate */
+#define TRANSFER_RATE_SMOOTHING 2000
+
+#define TRANSFER_STAT_SENDING   (1 << 0)
+#define TRANSFER_STAT_PAUSED    (1 << 1)
+#define TRANSFER_STAT_DIRECTORY (1 << 2)
+
+/* The smoothed throughput of a transfer, sampled from its position. */
+struct transfer_rate {
+    uint64_t last_position;
+    uint64_t last_sample;   /* milliseconds; 0 until the first sample */
+    double   bps;
+};
+
+/* A snapshot of one transfer's progress, as shown in a chat window's transfer pane. Snapshots are taken
+ * once per frame and only live until the frame has been drawn.
+ */
+struct transfer_stat {
+    const char *name;
+    uint64_t position;
+    uint64_t size;      /* 0 if it isn't known yet */
+    double   bps;
+    int32_t  id;        /* the id used to cancel the transfer, or -1 if it has none */
+    uint8_t  flags;     /* TRANSFER_STAT_* */
+};
+
+/* Returns the current time in milliseconds from a monotonic clock. */
+uint64_t transfer_stats_now(void);
+
+/* Updates `rate` with a transfer that has reached `position` at time `now` (in milliseconds). Samples closer
+ * together than TRANSFER_RATE_SAMPLE_INTERVAL are ignored, and each one is blended into the rate with an
+ * exponential moving average, so that a bursty transfer's rate doesn't jump around from frame to frame.
+ *
+ * Return the smoothed rate in bytes per second.
+ */
+double transfer_rate_sample(struct transfer_rate *rate, uint64_t position, uint64_t now);
+
+/* Returns how far along `stat` is, from 0 to 100. A transfer whose size isn't known is at 0. */
+double transfer_stat_percent(const struct transfer_stat *stat);
+
+/* Puts a progress bar of `width` characters (not counting the null terminator) for `stat` in `buf`, which
+ * must have room for at least `width` + 1 bytes.
+ */
+void transfer_stat_bar(const struct transfer_stat *stat, char *buf, size_t width);
+
+/* Returns the number of bytes of the UTF-8 string `name` that fit in `max_bytes` without splitting a
+ * multibyte character.
+ */
+size_t transfer_stat_name_fit(const char *name, size_t max_bytes);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* TRANSFER_STATS_H */
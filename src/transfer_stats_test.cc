@@ -0,0 +1,117 @@
+#include "transfer_stats.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+TEST(TransferRate, FirstSampleOnlyRecordsPosition)
+{
+    struct transfer_rate rate = {};
+
+    EXPECT_EQ(transfer_rate_sample(&rate, 5000, 1000), 0);
+    EXPECT_EQ(rate.last_position, 5000);
+    EXPECT_EQ(rate.last_sample, 1000);
+}
+
+TEST(TransferRate, SteadyTransfer)
+{
+    struct transfer_rate rate = {};
+    uint64_t position = 0;
+
+    for (uint64_t now = 1000; now <= 11000; now += 500) {
+        transfer_rate_sample(&rate, position, now);
+        position += 50000;  // 100 KB/s
+    }
+
+    EXPECT_NEAR(rate.bps, 100000, 1);
+}
+
+TEST(TransferRate, IgnoresSamplesTooCloseTogether)
+{
+    struct transfer_rate rate = {};
+
+    transfer_rate_sample(&rate, 0, 1000);
+    EXPECT_EQ(transfer_rate_sample(&rate, 10000, 1100), 0);
+    EXPECT_EQ(rate.last_position, 0);
+
+    EXPECT_NEAR(transfer_rate_sample(&rate, 10000, 1000 + TRANSFER_RATE_SAMPLE_INTERVAL), 40000, 1);
+}
+
+TEST(TransferRate, SmoothsBursts)
+{
+    struct transfer_rate rate = {};
+    uint64_t position = 0;
+    uint64_t now = 1000;
+
+    transfer_rate_sample(&rate, position, now);
+
+    for (int i = 0; i < 20; ++i) {
+        now += 500;
+        position += 50000;
+        transfer_rate_sample(&rate, position, now);
+    }
+
+    /* a single burst at ten times the speed only moves the rate part of the way */
+    now += 500;
+    position += 500000;
+    const double bps = transfer_rate_sample(&rate, position, now);
+
+    EXPECT_GT(bps, 100000);
+    EXPECT_LT(bps, 500000);
+
+    /* and a stall doesn't drop it straight to zero */
+    now += 500;
+    EXPECT_GT(transfer_rate_sample(&rate, position, now), 50000);
+}
+
+TEST(TransferRate, RestartedTransferResets)
+{
+    struct transfer_rate rate = {};
+
+    transfer_rate_sample(&rate, 0, 1000);
+    transfer_rate_sample(&rate, 100000, 2000);
+    ASSERT_GT(rate.bps, 0);
+
+    EXPECT_EQ(transfer_rate_sample(&rate, 10, 3000), 0);
+    EXPECT_EQ(rate.last_position, 10);
+}
+
+TEST(TransferStat, Bar)
+{
+    struct transfer_stat stat = {};
+    char buf[11];
+
+    stat.size = 100;
+    transfer_stat_bar(&stat, buf, 10);
+    EXPECT_EQ(std::string(buf), ">---------");
+
+    stat.position = 45;
+    transfer_stat_bar(&stat, buf, 10);
+    EXPECT_EQ(std::string(buf), "====>-----");
+    EXPECT_DOUBLE_EQ(transfer_stat_percent(&stat), 45);
+
+    stat.position = 100;
+    transfer_stat_bar(&stat, buf, 10);
+    EXPECT_EQ(std::string(buf), "==========");
+
+    stat.size = 0;
+    EXPECT_EQ(transfer_stat_percent(&stat), 0);
+}
+
+TEST(TransferStat, NameFit)
+{
+    EXPECT_EQ(transfer_stat_name_fit("short", 10), 5);
+    EXPECT_EQ(transfer_stat_name_fit("exactly", 7), 7);
+    EXPECT_EQ(transfer_stat_name_fit("truncated", 4), 4);
+
+    /* "a" followed by a two byte and a three byte character */
+    const char *name = "a\xc3\xa9\xe2\x82\xac";
+    EXPECT_EQ(transfer_stat_name_fit(name, 2), 1);
+    EXPECT_EQ(transfer_stat_name_fit(name, 3), 3);
+    EXPECT_EQ(transfer_stat_name_fit(name, 5), 3);
+    EXPECT_EQ(transfer_stat_name_fit(name, 6), 6);
+}
+
+}  // namespace
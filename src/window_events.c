@@ -0,0 +1,251 @@
+/*  window_events.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "window_events.h"
+
+static uint64_t window_event_key(Window_Event event, uint32_t number)
+{
+    return ((uint64_t)(event + 1) << 32) | number;
+}
+
+static size_t window_event_hash(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (size_t)key;
+}
+
+static struct window_event_slot *window_events_lookup(const Window_Events *events, uint64_t key)
+{
+    if (events->slots_size == 0) {
+        return NULL;
+    }
+
+    const size_t mask = events->slots_size - 1;
+
+    for (size_t i = window_event_hash(key) & mask;; i = (i + 1) & mask) {
+        struct window_event_slot *slot = &events->slots[i];
+
+        if (slot->key == key) {
+            return slot;
+        }
+
+        if (slot->key == 0) {
+            return NULL;
+        }
+    }
+}
+
+static bool window_events_grow(Window_Events *events)
+{
+    const size_t new_size = events->slots_size > 0 ? events->slots_size * 2 : 64;
+    struct window_event_slot *new_slots = calloc(new_size, sizeof(struct window_event_slot));
+
+    if (new_slots == NULL) {
+        return false;
+    }
+
+    const size_t mask = new_size - 1;
+
+    for (size_t i = 0; i < events->slots_size; ++i) {
+        const struct window_event_slot *slot = &events->slots[i];
+
+        if (slot->key == 0) {
+            continue;
+        }
+
+        size_t j = window_event_hash(slot->key) & mask;
+
+        while (new_slots[j].key != 0) {
+            j = (j + 1) & mask;
+        }
+
+        new_slots[j] = *slot;
+    }
+
+    free(events->slots);
+    events->slots = new_slots;
+    events->slots_size = new_size;
+
+    return true;
+}
+
+/* Returns the slot for `key`, inserting an empty one if it doesn't exist. */
+static struct window_event_slot *window_events_insert(Window_Events *events, uint64_t key)
+{
+    struct window_event_slot *slot = window_events_lookup(events, key);
+
+    if (slot != NULL) {
+        return slot;
+    }
+
+    /* keep the load factor at or below 1/2 */
+    if ((events->slots_used + 1) * 2 > events->slots_size && !window_events_grow(events)) {
+        return NULL;
+    }
+
+    const size_t mask = events->slots_size - 1;
+    size_t i = window_event_hash(key) & mask;
+
+    while (events->slots[i].key != 0) {
+        i = (i + 1) & mask;
+    }
+
+    slot = &events->slots[i];
+    slot->key = key;
+    ++events->slots_used;
+
+    return slot;
+}
+
+static int window_subscribers_add(Window_Subscribers *subs, ToxWindow *w)
+{
+    for (uint16_t i = 0; i < subs->count; ++i) {
+        if (subs->list[i] == w) {
+            return 0;
+        }
+    }
+
+    if (subs->count == UINT16_MAX) {
+        return -1;
+    }
+
+    if (subs->count == subs->size) {
+        const uint16_t new_size = subs->size > 0 ? (subs->size > UINT16_MAX / 2 ? UINT16_MAX : subs->size * 2) : 2;
+        ToxWindow **new_list = realloc(subs->list, new_size * sizeof(ToxWindow *));
+
+        if (new_list == NULL) {
+            return -1;
+        }
+
+        subs->list = new_list;
+        subs->size = new_size;
+    }
+
+    subs->list[subs->count] = w;
+    ++subs->count;
+
+    return 0;
+}
+
+/* Removes `w` from `subs`, keeping the remaining windows in the order they subscribed. */
+static void window_subscribers_remove(Window_Subscribers *subs, const ToxWindow *w)
+{
+    for (uint16_t i = 0; i < subs->count; ++i) {
+        if (subs->list[i] != w) {
+            continue;
+        }
+
+        --subs->count;
+        memmove(&subs->list[i], &subs->list[i + 1], (subs->count - i) * sizeof(ToxWindow *));
+        return;
+    }
+}
+
+int window_events_subscribe(Window_Events *events, Window_Event event, uint32_t number, ToxWindow *w)
+{
+    if (event >= WINDOW_EVENT_MAX || w == NULL) {
+        return -1;
+    }
+
+    if (number == WINDOW_EVENT_ANY) {
+        return window_subscribers_add(&events->any[event], w);
+    }
+
+    struct window_event_slot *slot = window_events_insert(events, window_event_key(event, number));
+
+    if (slot == NULL) {
+        return -1;
+    }
+
+    return window_subscribers_add(&slot->subscribers, w);
+}
+
+void window_events_unsubscribe(Window_Events *events, Window_Event event, uint32_t number, const ToxWindow *w)
+{
+    if (event >= WINDOW_EVENT_MAX) {
+        return;
+    }
+
+    if (number == WINDOW_EVENT_ANY) {
+        window_subscribers_remove(&events->any[event], w);
+        return;
+    }
+
+    struct window_event_slot *slot = window_events_lookup(events, window_event_key(event, number));
+
+    if (slot != NULL) {
+        window_subscribers_remove(&slot->subscribers, w);
+    }
+}
+
+const Window_Subscribers *window_events_any(const Window_Events *events, Window_Event event)
+{
+    if (event >= WINDOW_EVENT_MAX) {
+        return NULL;
+    }
+
+    return &events->any[event];
+}
+
+const Window_Subscribers *window_events_find(const Window_Events *events, Window_Event event, uint32_t number)
+{
+    if (event >= WINDOW_EVENT_MAX || number == WINDOW_EVENT_ANY) {
+        return NULL;
+    }
+
+    const struct window_event_slot *slot = window_events_lookup(events, window_event_key(event, number));
+
+    if (slot == NULL || slot->subscribers.count == 0) {
+        return NULL;
+    }
+
+    return &slot->subscribers;
+}
+
+ToxWindow *window_events_get(const Window_Events *events, Window_Event event, uint32_t number, uint16_t index)
+{
+    if (event >= WINDOW_EVENT_MAX) {
+        return NULL;
+    }
+
+    const Window_Subscribers *any = &events->any[event];
+
+    if (index < any->count) {
+        return any->list[index];
+    }
+
+    index -= any->count;
+
+    const Window_Subscribers *subs = window_events_find(events, event, number);
+
+    if (subs == NULL || index >= subs->count) {
+        return NULL;
+    }
+
+    return subs->list[index];
+}
+
+void window_events_free(Window_Events *events)
+{
+    for (size_t i = 0; i < WINDOW_EVENT_MAX; ++i) {
+        free(events->any[i].list);
+    }
+
+    for (size_t i = 0; i < events->slots_size; ++i) {
+        free(events->slots[i].subscribers.list);
+    }
+
+    free(events->slots);
+
+    memset(events, 0, sizeof(Window_Events));
+}
@@ -0,0 +1,132 @@
+/*  window_events.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef WINDOW_EVENTS_H
+#define WINDOW_EVENTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct ToxWindow ToxWindow;
+
+/* Events that are dispatched to windows. Each corresponds to one of the ToxWindow callbacks. */
+typedef enum Window_Event {
+    WINDOW_EVENT_FRIEND_REQUEST,
+    WINDOW_EVENT_FRIEND_ADDED,
+    WINDOW_EVENT_CONNECTION_CHANGE,
+    WINDOW_EVENT_MESSAGE,
+    WINDOW_EVENT_NICK_CHANGE,
+    WINDOW_EVENT_STATUS_CHANGE,
+    WINDOW_EVENT_STATUS_MESSAGE_CHANGE,
+    WINDOW_EVENT_TYPING_CHANGE,
+    WINDOW_EVENT_READ_RECEIPT,
+    WINDOW_EVENT_FILE_CHUNK_REQUEST,
+    WINDOW_EVENT_FILE_RECV_CHUNK,
+    WINDOW_EVENT_FILE_CONTROL,
+    WINDOW_EVENT_FILE_RECV,
+    WINDOW_EVENT_GAME_INVITE,
+    WINDOW_EVENT_GAME_DATA,
+    WINDOW_EVENT_CONFERENCE_INVITE,
+    WINDOW_EVENT_GROUP_INVITE,
+
+    WINDOW_EVENT_CONFERENCE_MESSAGE,
+    WINDOW_EVENT_CONFERENCE_NAME_LIST_CHANGE,
+    WINDOW_EVENT_CONFERENCE_PEER_NAME_CHANGE,
+    WINDOW_EVENT_CONFERENCE_TITLE_CHANGE,
+
+    WINDOW_EVENT_GROUP_MESSAGE,
+    WINDOW_EVENT_GROUP_PRIVATE_MESSAGE,
+    WINDOW_EVENT_GROUP_PEER_JOIN,
+    WINDOW_EVENT_GROUP_PEER_EXIT,
+    WINDOW_EVENT_GROUP_NICK_CHANGE,
+    WINDOW_EVENT_GROUP_STATUS_CHANGE,
+    WINDOW_EVENT_GROUP_TOPIC_CHANGE,
+    WINDOW_EVENT_GROUP_PEER_LIMIT,
+    WINDOW_EVENT_GROUP_PRIVACY_STATE,
+    WINDOW_EVENT_GROUP_TOPIC_LOCK,
+    WINDOW_EVENT_GROUP_PASSWORD,
+    WINDOW_EVENT_GROUP_SELF_JOIN,
+    WINDOW_EVENT_GROUP_REJECTED,
+    WINDOW_EVENT_GROUP_MODERATION,
+    WINDOW_EVENT_GROUP_VOICE_STATE,
+
+    WINDOW_EVENT_MAX,
+} Window_Event;
+
+/* Subscribes a window to an event for every friend, conference or group number */
+#define WINDOW_EVENT_ANY UINT32_MAX
+
+typedef struct Window_Subscribers {
+    ToxWindow **list;
+    uint16_t   count;
+    uint16_t   size;
+} Window_Subscribers;
+
+struct window_event_slot {
+    uint64_t key;      /* 0 marks an empty slot */
+    Window_Subscribers subscribers;
+};
+
+/*
+ * Subscription table that routes each event to the windows that handle it.
+ *
+ * Windows that care about an event for a single friend, conference or group (e.g. a chat window)
+ * subscribe to it with that number, and are kept in an open-addressing table keyed by the
+ * (event, number) pair. Windows that care about it for every number (e.g. the friend list) are kept
+ * in a plain list per event. Dispatching an event therefore only touches the windows that receive it.
+ *
+ * Slots are never removed from the table, since the numbers they're keyed by are reused.
+ */
+typedef struct Window_Events {
+    Window_Subscribers any[WINDOW_EVENT_MAX];
+
+    struct window_event_slot *slots;
+    size_t slots_size;    /* always zero or a power of two */
+    size_t slots_used;
+} Window_Events;
+
+/* Subscribes `w` to `event` for `number`, which may be WINDOW_EVENT_ANY.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+int window_events_subscribe(Window_Events *events, Window_Event event, uint32_t number, ToxWindow *w);
+
+/* Unsubscribes `w` from `event` for `number`. */
+void window_events_unsubscribe(Window_Events *events, Window_Event event, uint32_t number, const ToxWindow *w);
+
+/* Returns the windows subscribed to `event` for every number. */
+const Window_Subscribers *window_events_any(const Window_Events *events, Window_Event event);
+
+/* Returns the windows subscribed to `event` for `number`, or NULL if there are none. */
+const Window_Subscribers *window_events_find(const Window_Events *events, Window_Event event, uint32_t number);
+
+/* Returns the `index`'th window that should receive `event` for `number`: first the windows subscribed
+ * for every number, then the ones subscribed for `number`.
+ *
+ * Returns NULL once `index` is past the last window.
+ *
+ * Callers should look up each index in turn rather than holding on to a subscriber list, since event
+ * handlers may open or close windows.
+ */
+ToxWindow *window_events_get(const Window_Events *events, Window_Event event, uint32_t number, uint16_t index);
+
+/* Frees all memory associated with `events`. */
+void window_events_free(Window_Events *events);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* WINDOW_EVENTS_H */
@@ -0,0 +1,215 @@
+#include "window_events.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// The table never dereferences windows, so any distinct addresses will do.
+std::vector<char> window_storage(1 << 16);
+
+ToxWindow *window(size_t i)
+{
+    return reinterpret_cast<ToxWindow *>(&window_storage[i]);
+}
+
+std::vector<ToxWindow *> receivers(const Window_Events *events, Window_Event event, uint32_t number)
+{
+    std::vector<ToxWindow *> result;
+
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(events, event, number, i);
+
+        if (w == nullptr) {
+            break;
+        }
+
+        result.push_back(w);
+    }
+
+    return result;
+}
+
+class WindowEvents : public ::testing::Test {
+protected:
+    void TearDown() override
+    {
+        window_events_free(&events_);
+    }
+
+    Window_Events events_ {};
+};
+
+TEST_F(WindowEvents, RoutesByNumber)
+{
+    ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_MESSAGE, WINDOW_EVENT_ANY, window(0)), 0);
+    ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_MESSAGE, 5, window(1)), 0);
+    ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_MESSAGE, 6, window(2)), 0);
+    ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_TYPING_CHANGE, 5, window(1)), 0);
+
+    EXPECT_EQ(receivers(&events_, WINDOW_EVENT_MESSAGE, 5), (std::vector<ToxWindow *> {window(0), window(1)}));
+    EXPECT_EQ(receivers(&events_, WINDOW_EVENT_MESSAGE, 6), (std::vector<ToxWindow *> {window(0), window(2)}));
+    EXPECT_EQ(receivers(&events_, WINDOW_EVENT_MESSAGE, 7), (std::vector<ToxWindow *> {window(0)}));
+    EXPECT_EQ(receivers(&events_, WINDOW_EVENT_TYPING_CHANGE, 6), (std::vector<ToxWindow *> {}));
+    EXPECT_EQ(receivers(&events_, WINDOW_EVENT_GROUP_MESSAGE, 5), (std::vector<ToxWindow *> {}));
+}
+
+TEST_F(WindowEvents, SubscribingTwiceIsHarmless)
+{
+    ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_GROUP_PEER_JOIN, 1, window(3)), 0);
+    ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_GROUP_PEER_JOIN, 1, window(3)), 0);
+
+    EXPECT_EQ(receivers(&events_, WINDOW_EVENT_GROUP_PEER_JOIN, 1), (std::vector<ToxWindow *> {window(3)}));
+}
+
+TEST_F(WindowEvents, UnsubscribeKeepsOrder)
+{
+    for (size_t i = 0; i < 4; ++i) {
+        ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_FILE_RECV, 9, window(i)), 0);
+    }
+
+    window_events_unsubscribe(&events_, WINDOW_EVENT_FILE_RECV, 9, window(1));
+    window_events_unsubscribe(&events_, WINDOW_EVENT_FILE_RECV, 10, window(2));
+
+    EXPECT_EQ(receivers(&events_, WINDOW_EVENT_FILE_RECV, 9),
+              (std::vector<ToxWindow *> {window(0), window(2), window(3)}));
+
+    for (size_t i = 0; i < 4; ++i) {
+        window_events_unsubscribe(&events_, WINDOW_EVENT_FILE_RECV, 9, window(i));
+    }
+
+    EXPECT_EQ(window_events_find(&events_, WINDOW_EVENT_FILE_RECV, 9), nullptr);
+}
+
+TEST_F(WindowEvents, WindowsAddedDuringDispatchReceiveTheEvent)
+{
+    // The friend list opens a chat window when a message arrives from a friend without one, and the new
+    // window must receive the message too.
+    ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_MESSAGE, WINDOW_EVENT_ANY, window(0)), 0);
+
+    std::vector<ToxWindow *> received;
+
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&events_, WINDOW_EVENT_MESSAGE, 42, i);
+
+        if (w == nullptr) {
+            break;
+        }
+
+        received.push_back(w);
+
+        if (w == window(0)) {
+            ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_MESSAGE, 42, window(1)), 0);
+        }
+    }
+
+    EXPECT_EQ(received, (std::vector<ToxWindow *> {window(0), window(1)}));
+}
+
+TEST_F(WindowEvents, ManyNumbers)
+{
+    for (uint32_t i = 0; i < 1000; ++i) {
+        ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_GROUP_MESSAGE, i, window(i)), 0);
+        ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_MESSAGE, i, window(i + 1000)), 0);
+    }
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(receivers(&events_, WINDOW_EVENT_GROUP_MESSAGE, i), (std::vector<ToxWindow *> {window(i)}));
+        EXPECT_EQ(receivers(&events_, WINDOW_EVENT_MESSAGE, i), (std::vector<ToxWindow *> {window(i + 1000)}));
+    }
+}
+
+// Replays a stream of group and friend events against a friend list and N chat and group windows,
+// comparing the table with calling every window for every event like the callbacks used to.
+TEST_F(WindowEvents, DISABLED_Benchmark)
+{
+    constexpr uint32_t num_windows = 200;
+    constexpr size_t kEvents = 1000000;
+
+    struct Fake_Window {
+        uint32_t num;
+        bool group;
+        bool any;
+        uint64_t received;
+    };
+
+    std::vector<Fake_Window> windows;
+    windows.push_back({0, false, true, 0});  // friend list
+
+    for (uint32_t i = 0; i < num_windows; ++i) {
+        windows.push_back({i / 2, i % 2 == 1, false, 0});
+    }
+
+    for (size_t i = 0; i < windows.size(); ++i) {
+        const Fake_Window &fw = windows[i];
+        ToxWindow *w = reinterpret_cast<ToxWindow *>(&windows[i]);
+
+        if (fw.any) {
+            ASSERT_EQ(window_events_subscribe(&events_, WINDOW_EVENT_MESSAGE, WINDOW_EVENT_ANY, w), 0);
+        } else {
+            ASSERT_EQ(window_events_subscribe(&events_, fw.group ? WINDOW_EVENT_GROUP_MESSAGE : WINDOW_EVENT_MESSAGE,
+                                              fw.num, w), 0);
+        }
+    }
+
+    // mostly group traffic spread over all groups, with some friend messages mixed in
+    std::vector<std::pair<Window_Event, uint32_t>> stream;
+    uint32_t seed = 12345;
+
+    for (size_t i = 0; i < kEvents; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const Window_Event event = (seed >> 16) % 10 == 0 ? WINDOW_EVENT_MESSAGE : WINDOW_EVENT_GROUP_MESSAGE;
+        stream.emplace_back(event, (seed >> 8) % (num_windows / 2));
+    }
+
+    // broadcast: every window is called and checks the event against its own number
+    auto start = std::chrono::steady_clock::now();
+    uint64_t broadcast_delivered = 0;
+
+    for (const auto &e : stream) {
+        const Window_Event event = e.first;
+        const uint32_t number = e.second;
+
+        for (Fake_Window &fw : windows) {
+            volatile Fake_Window *vw = &fw;
+
+            if (vw->any ? event == WINDOW_EVENT_MESSAGE
+                    : (vw->num == number && vw->group == (event == WINDOW_EVENT_GROUP_MESSAGE))) {
+                ++vw->received;
+                ++broadcast_delivered;
+            }
+        }
+    }
+
+    const auto broadcast_time = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    uint64_t routed_delivered = 0;
+
+    for (const auto &e : stream) {
+        for (uint16_t i = 0;; ++i) {
+            ToxWindow *w = window_events_get(&events_, e.first, e.second, i);
+
+            if (w == nullptr) {
+                break;
+            }
+
+            ++reinterpret_cast<Fake_Window *>(w)->received;
+            ++routed_delivered;
+        }
+    }
+
+    const auto routed_time = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(broadcast_delivered, routed_delivered);
+
+    std::printf("%zu events against %zu windows: broadcast %lld ms, routed %lld ms\n", kEvents, windows.size(),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(broadcast_time).count()),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(routed_time).count()));
+}
+
+}  // namespace
@@ -10,10 +10,12 @@
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "avatars.h"
 #include "chat.h"
 #include "conference.h"
+#include "dir_transfers.h"
 #include "file_transfers.h"
 #include "friendlist.h"
 #include "groupchats.h"
@@ -45,12 +47,14 @@ void on_friend_request(Tox *tox, const uint8_t *public_key, const uint8_t *data,
     length = copy_tox_str(msg, sizeof(msg), (const char *) data, length);
     filter_string(msg, length, false);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_FRIEND_REQUEST, WINDOW_EVENT_ANY, i);
 
-        if (w->onFriendRequest != NULL) {
-            w->onFriendRequest(w, toxic, (const char *) public_key, msg, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onFriendRequest(w, toxic, (const char *) public_key, msg, length);
     }
 }
 
@@ -63,12 +67,19 @@ void on_friend_connection_status(Tox *tox, uint32_t friendnumber, Tox_Connection
 
     on_avatar_friend_connection_status(toxic, friendnumber, connection_status);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_CONNECTION_CHANGE, friendnumber, i);
 
-        if (w->onConnectionChange != NULL) {
-            w->onConnectionChange(w, toxic, friendnumber, connection_status);
+        if (w == NULL) {
+            break;
         }
+
+        w->onConnectionChange(w, toxic, friendnumber, connection_status);
+    }
+
+    if (connection_status != TOX_CONNECTION_NONE) {
+        /* let the message queue thread send anything that was waiting for this friend */
+        reactor_signal(&cqueue_thread.reactor);
     }
 
     flag_interface_refresh();
@@ -84,12 +95,14 @@ void on_friend_typing(Tox *tox, uint32_t friendnumber, bool is_typing, void *use
         return;
     }
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_TYPING_CHANGE, friendnumber, i);
 
-        if (w->onTypingChange != NULL) {
-            w->onTypingChange(w, toxic, friendnumber, is_typing);
+        if (w == NULL) {
+            break;
         }
+
+        w->onTypingChange(w, toxic, friendnumber, is_typing);
     }
 
     flag_interface_refresh();
@@ -105,12 +118,14 @@ void on_friend_message(Tox *tox, uint32_t friendnumber, Tox_Message_Type type, c
     char msg[MAX_STR_SIZE + 1];
     length = copy_tox_str(msg, sizeof(msg), (const char *) string, length);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_MESSAGE, friendnumber, i);
 
-        if (w->onMessage != NULL) {
-            w->onMessage(w, toxic, friendnumber, type, msg, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onMessage(w, toxic, friendnumber, type, msg, length);
     }
 }
 
@@ -128,12 +143,14 @@ void on_friend_name(Tox *tox, uint32_t friendnumber, const uint8_t *string, size
     length = copy_tox_str(nick, sizeof(nick), (const char *) string, length);
     filter_string(nick, length, true);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_NICK_CHANGE, friendnumber, i);
 
-        if (w->onNickChange != NULL) {
-            w->onNickChange(w, toxic, friendnumber, nick, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onNickChange(w, toxic, friendnumber, nick, length);
     }
 
     flag_interface_refresh();
@@ -151,12 +168,14 @@ void on_friend_status_message(Tox *tox, uint32_t friendnumber, const uint8_t *st
     length = copy_tox_str(msg, sizeof(msg), (const char *) string, length);
     filter_string(msg, length, false);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_STATUS_MESSAGE_CHANGE, friendnumber, i);
 
-        if (w->onStatusMessageChange != NULL) {
-            w->onStatusMessageChange(w, toxic, friendnumber, msg, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onStatusMessageChange(w, toxic, friendnumber, msg, length);
     }
 
     flag_interface_refresh();
@@ -168,12 +187,14 @@ void on_friend_status(Tox *tox, uint32_t friendnumber, Tox_User_Status status, v
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_STATUS_CHANGE, friendnumber, i);
 
-        if (w->onStatusChange != NULL) {
-            w->onStatusChange(w, toxic, friendnumber, status);
+        if (w == NULL) {
+            break;
         }
+
+        w->onStatusChange(w, toxic, friendnumber, status);
     }
 
     flag_interface_refresh();
@@ -184,12 +205,14 @@ void on_friend_added(Toxic *toxic, uint32_t friendnumber, bool sort)
 {
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_FRIEND_ADDED, friendnumber, i);
 
-        if (w->onFriendAdded != NULL) {
-            w->onFriendAdded(w, toxic, friendnumber, sort);
+        if (w == NULL) {
+            break;
         }
+
+        w->onFriendAdded(w, toxic, friendnumber, sort);
     }
 
     store_data(toxic);
@@ -205,12 +228,14 @@ void on_conference_message(Tox *tox, uint32_t conferencenumber, uint32_t peernum
     char msg[MAX_STR_SIZE + 1];
     length = copy_tox_str(msg, sizeof(msg), (const char *) message, length);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_CONFERENCE_MESSAGE, conferencenumber, i);
 
-        if (w->onConferenceMessage != NULL) {
-            w->onConferenceMessage(w, toxic, conferencenumber, peernumber, type, msg, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onConferenceMessage(w, toxic, conferencenumber, peernumber, type, msg, length);
     }
 }
 
@@ -221,12 +246,14 @@ void on_conference_invite(Tox *tox, uint32_t friendnumber, Tox_Conference_Type t
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_CONFERENCE_INVITE, friendnumber, i);
 
-        if (w->onConferenceInvite != NULL) {
-            w->onConferenceInvite(w, toxic, friendnumber, type, (const char *) conference_pub_key, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onConferenceInvite(w, toxic, friendnumber, type, (const char *) conference_pub_key, length);
     }
 }
 
@@ -236,12 +263,14 @@ void on_conference_peer_list_changed(Tox *tox, uint32_t conferencenumber, void *
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_CONFERENCE_NAME_LIST_CHANGE, conferencenumber, i);
 
-        if (w->onConferenceNameListChange != NULL) {
-            w->onConferenceNameListChange(w, toxic, conferencenumber);
+        if (w == NULL) {
+            break;
         }
+
+        w->onConferenceNameListChange(w, toxic, conferencenumber);
     }
 
     flag_interface_refresh();
@@ -258,12 +287,14 @@ void on_conference_peer_name(Tox *tox, uint32_t conferencenumber, uint32_t peern
     length = copy_tox_str(nick, sizeof(nick), (const char *) name, length);
     filter_string(nick, length, true);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_CONFERENCE_PEER_NAME_CHANGE, conferencenumber, i);
 
-        if (w->onConferencePeerNameChange != NULL) {
-            w->onConferencePeerNameChange(w, toxic, conferencenumber, peernumber, nick, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onConferencePeerNameChange(w, toxic, conferencenumber, peernumber, nick, length);
     }
 }
 
@@ -278,12 +309,14 @@ void on_conference_title(Tox *tox, uint32_t conferencenumber, uint32_t peernumbe
     length = copy_tox_str(data, sizeof(data), (const char *) title, length);
     filter_string(data, length, false);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_CONFERENCE_TITLE_CHANGE, conferencenumber, i);
 
-        if (w->onConferenceTitleChange != NULL) {
-            w->onConferenceTitleChange(w, toxic, conferencenumber, peernumber, data, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onConferenceTitleChange(w, toxic, conferencenumber, peernumber, data, length);
     }
 }
 
@@ -305,12 +338,14 @@ void on_file_chunk_request(Tox *tox, uint32_t friendnumber, uint32_t filenumber,
         return;
     }
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_FILE_CHUNK_REQUEST, friendnumber, i);
 
-        if (w->onFileChunkRequest != NULL) {
-            w->onFileChunkRequest(w, toxic, friendnumber, filenumber, position, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onFileChunkRequest(w, toxic, friendnumber, filenumber, position, length);
     }
 }
 
@@ -327,12 +362,14 @@ void on_file_recv_chunk(Tox *tox, uint32_t friendnumber, uint32_t filenumber, ui
         return;
     }
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_FILE_RECV_CHUNK, friendnumber, i);
 
-        if (w->onFileRecvChunk != NULL) {
-            w->onFileRecvChunk(w, toxic, friendnumber, filenumber, position, (const char *) data, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onFileRecvChunk(w, toxic, friendnumber, filenumber, position, (const char *) data, length);
     }
 }
 
@@ -354,12 +391,14 @@ void on_file_recv_control(Tox *tox, uint32_t friendnumber, uint32_t filenumber,
         return;
     }
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_FILE_CONTROL, friendnumber, i);
 
-        if (w->onFileControl != NULL) {
-            w->onFileControl(w, toxic, friendnumber, filenumber, control);
+        if (w == NULL) {
+            break;
         }
+
+        w->onFileControl(w, toxic, friendnumber, filenumber, control);
     }
 }
 
@@ -379,12 +418,14 @@ void on_file_recv(Tox *tox, uint32_t friendnumber, uint32_t filenumber, uint32_t
         return;
     }
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_FILE_RECV, friendnumber, i);
 
-        if (w->onFileRecv != NULL) {
-            w->onFileRecv(w, toxic, friendnumber, filenumber, file_size, filename, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onFileRecv(w, toxic, friendnumber, filenumber, file_size, filename, length);
     }
 }
 
@@ -394,12 +435,14 @@ void on_friend_read_receipt(Tox *tox, uint32_t friendnumber, uint32_t receipt, v
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_READ_RECEIPT, friendnumber, i);
 
-        if (w->onReadReceipt != NULL) {
-            w->onReadReceipt(w, toxic, friendnumber, receipt);
+        if (w == NULL) {
+            break;
         }
+
+        w->onReadReceipt(w, toxic, friendnumber, receipt);
     }
 }
 
@@ -420,33 +463,42 @@ void on_lossless_custom_packet(Tox *tox, uint32_t friendnumber, const uint8_t *d
 #ifdef GAMES
 
         case CUSTOM_PACKET_GAME_INVITE: {
-            for (uint16_t i = 0; i < windows->count; ++i) {
-                ToxWindow *w = windows->list[i];
+            for (uint16_t i = 0;; ++i) {
+                ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GAME_INVITE, friendnumber, i);
 
-                if (w->onGameInvite != NULL) {
-                    w->onGameInvite(w, toxic, friendnumber, data + 1, length - 1);
+                if (w == NULL) {
+                    break;
                 }
+
+                w->onGameInvite(w, toxic, friendnumber, data + 1, length - 1);
             }
 
             break;
         }
 
         case CUSTOM_PACKET_GAME_DATA: {
-            for (uint16_t i = 0; i < windows->count; ++i) {
-                ToxWindow *w = windows->list[i];
+            for (uint16_t i = 0;; ++i) {
+                ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GAME_DATA, friendnumber, i);
 
-                if (w->onGameData != NULL) {
-                    w->onGameData(w, toxic, friendnumber, data + 1, length - 1);
+                if (w == NULL) {
+                    break;
                 }
+
+                w->onGameData(w, toxic, friendnumber, data + 1, length - 1);
             }
 
             break;
         }
 
 #else
-        UNUSED_VAR(toxic);
+        UNUSED_VAR(windows);
 #endif // GAMES
 
+        case CUSTOM_PACKET_FILE_MANIFEST: {
+            dir_transfers_on_packet(toxic, friendnumber, data + 1, length - 1);
+            break;
+        }
+
         default: {
             fprintf(stderr, "Got unknown custom packet of type: %u\n", type);
             return;
@@ -465,13 +517,15 @@ void on_group_invite(Tox *tox, uint32_t friendnumber, const uint8_t *invite_data
     char gname[MAX_STR_SIZE + 1];
     group_name_length = copy_tox_str(gname, sizeof(gname), (const char *) group_name, group_name_length);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_INVITE, friendnumber, i);
 
-        if (w->onGroupInvite != NULL) {
-            w->onGroupInvite(w, toxic, friendnumber, (const char *) invite_data, length, gname,
-                             group_name_length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupInvite(w, toxic, friendnumber, (const char *) invite_data, length, gname,
+                         group_name_length);
     }
 }
 
@@ -487,12 +541,14 @@ void on_group_message(Tox *tox, uint32_t groupnumber, uint32_t peer_id, Tox_Mess
     char msg[MAX_STR_SIZE + 1];
     length = copy_tox_str(msg, sizeof(msg), (const char *) message, length);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_MESSAGE, groupnumber, i);
 
-        if (w->onGroupMessage != NULL) {
-            w->onGroupMessage(w, toxic, groupnumber, peer_id, type, msg, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupMessage(w, toxic, groupnumber, peer_id, type, msg, length);
     }
 }
 
@@ -510,12 +566,14 @@ void on_group_private_message(Tox *tox, uint32_t groupnumber, uint32_t peer_id,
     char msg[MAX_STR_SIZE + 1];
     length = copy_tox_str(msg, sizeof(msg), (const char *) message, length);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_PRIVATE_MESSAGE, groupnumber, i);
 
-        if (w->onGroupPrivateMessage != NULL) {
-            w->onGroupPrivateMessage(w, toxic, groupnumber, peer_id, msg, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupPrivateMessage(w, toxic, groupnumber, peer_id, msg, length);
     }
 }
 
@@ -526,12 +584,14 @@ void on_group_status_change(Tox *tox, uint32_t groupnumber, uint32_t peer_id, To
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_STATUS_CHANGE, groupnumber, i);
 
-        if (w->onGroupStatusChange != NULL) {
-            w->onGroupStatusChange(w, toxic, groupnumber, peer_id, status);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupStatusChange(w, toxic, groupnumber, peer_id, status);
     }
 
     flag_interface_refresh();
@@ -544,12 +604,14 @@ void on_group_peer_join(Tox *tox, uint32_t groupnumber, uint32_t peer_id, void *
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_PEER_JOIN, groupnumber, i);
 
-        if (w->onGroupPeerJoin != NULL) {
-            w->onGroupPeerJoin(w, toxic, groupnumber, peer_id);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupPeerJoin(w, toxic, groupnumber, peer_id);
     }
 
     flag_interface_refresh();
@@ -576,12 +638,14 @@ void on_group_peer_exit(Tox *tox, uint32_t groupnumber, uint32_t peer_id, Tox_Gr
         filter_string(buf, buf_len, false);
     }
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_PEER_EXIT, groupnumber, i);
 
-        if (w->onGroupPeerExit != NULL) {
-            w->onGroupPeerExit(w, toxic, groupnumber, peer_id, exit_type, toxic_nick, nick_len, buf, buf_len);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupPeerExit(w, toxic, groupnumber, peer_id, exit_type, toxic_nick, nick_len, buf, buf_len);
     }
 }
 
@@ -597,12 +661,14 @@ void on_group_topic_change(Tox *tox, uint32_t groupnumber, uint32_t peer_id, con
     length = copy_tox_str(data, sizeof(data), (const char *) topic, length);
     filter_string(data, length, false);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_TOPIC_CHANGE, groupnumber, i);
 
-        if (w->onGroupTopicChange != NULL) {
-            w->onGroupTopicChange(w, toxic, groupnumber, peer_id, data, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupTopicChange(w, toxic, groupnumber, peer_id, data, length);
     }
 }
 
@@ -613,12 +679,14 @@ void on_group_peer_limit(Tox *tox, uint32_t groupnumber, uint32_t peer_limit, vo
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_PEER_LIMIT, groupnumber, i);
 
-        if (w->onGroupPeerLimit != NULL) {
-            w->onGroupPeerLimit(w, toxic, groupnumber, peer_limit);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupPeerLimit(w, toxic, groupnumber, peer_limit);
     }
 }
 
@@ -629,12 +697,14 @@ void on_group_privacy_state(Tox *tox, uint32_t groupnumber, Tox_Group_Privacy_St
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_PRIVACY_STATE, groupnumber, i);
 
-        if (w->onGroupPrivacyState != NULL) {
-            w->onGroupPrivacyState(w, toxic, groupnumber, privacy_state);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupPrivacyState(w, toxic, groupnumber, privacy_state);
     }
 }
 
@@ -645,12 +715,14 @@ void on_group_topic_lock(Tox *tox, uint32_t groupnumber, Tox_Group_Topic_Lock to
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_TOPIC_LOCK, groupnumber, i);
 
-        if (w->onGroupTopicLock != NULL) {
-            w->onGroupTopicLock(w, toxic, groupnumber, topic_lock);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupTopicLock(w, toxic, groupnumber, topic_lock);
     }
 }
 
@@ -661,12 +733,14 @@ void on_group_password(Tox *tox, uint32_t groupnumber, const uint8_t *password,
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_PASSWORD, groupnumber, i);
 
-        if (w->onGroupPassword != NULL) {
-            w->onGroupPassword(w, toxic, groupnumber, (const char *) password, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupPassword(w, toxic, groupnumber, (const char *) password, length);
     }
 }
 
@@ -682,12 +756,14 @@ void on_group_nick_change(Tox *tox, uint32_t groupnumber, uint32_t peer_id, cons
     length = copy_tox_str(name, sizeof(name), (const char *) newname, length);
     filter_string(name, length, true);
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_NICK_CHANGE, groupnumber, i);
 
-        if (w->onGroupNickChange != NULL) {
-            w->onGroupNickChange(w, toxic, groupnumber, peer_id, name, length);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupNickChange(w, toxic, groupnumber, peer_id, name, length);
     }
 }
 
@@ -698,12 +774,14 @@ void on_group_self_join(Tox *tox, uint32_t groupnumber, void *userdata)
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_SELF_JOIN, groupnumber, i);
 
-        if (w->onGroupSelfJoin != NULL) {
-            w->onGroupSelfJoin(w, toxic, groupnumber);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupSelfJoin(w, toxic, groupnumber);
     }
 }
 
@@ -714,12 +792,14 @@ void on_group_rejected(Tox *tox, uint32_t groupnumber, Tox_Group_Join_Fail type,
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_REJECTED, groupnumber, i);
 
-        if (w->onGroupRejected != NULL) {
-            w->onGroupRejected(w, toxic, groupnumber, type);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupRejected(w, toxic, groupnumber, type);
     }
 }
 
@@ -731,12 +811,14 @@ void on_group_moderation(Tox *tox, uint32_t groupnumber, uint32_t source_peer_id
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_MODERATION, groupnumber, i);
 
-        if (w->onGroupModeration != NULL) {
-            w->onGroupModeration(w, toxic, groupnumber, source_peer_id, target_peer_id, type);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupModeration(w, toxic, groupnumber, source_peer_id, target_peer_id, type);
     }
 }
 
@@ -747,12 +829,14 @@ void on_group_voice_state(Tox *tox, uint32_t groupnumber, Tox_Group_Voice_State
     Toxic *toxic = (Toxic *) userdata;
     Windows *windows = toxic->windows;
 
-    for (uint16_t i = 0; i < windows->count; ++i) {
-        ToxWindow *w = windows->list[i];
+    for (uint16_t i = 0;; ++i) {
+        ToxWindow *w = window_events_get(&windows->events, WINDOW_EVENT_GROUP_VOICE_STATE, groupnumber, i);
 
-        if (w->onGroupVoiceState != NULL) {
-            w->onGroupVoiceState(w, toxic, groupnumber, voice_state);
+        if (w == NULL) {
+            break;
         }
+
+        w->onGroupVoiceState(w, toxic, groupnumber, voice_state);
     }
 }
 
@@ -787,6 +871,190 @@ static uint16_t get_new_window_id(Windows *windows)
 
 /* CALLBACKS END */
 
+/* Returns true if `w` has a handler for `event`. */
+static bool window_handles_event(const ToxWindow *w, Window_Event event)
+{
+    switch (event) {
+        case WINDOW_EVENT_FRIEND_REQUEST:
+            return w->onFriendRequest != NULL;
+
+        case WINDOW_EVENT_FRIEND_ADDED:
+            return w->onFriendAdded != NULL;
+
+        case WINDOW_EVENT_CONNECTION_CHANGE:
+            return w->onConnectionChange != NULL;
+
+        case WINDOW_EVENT_MESSAGE:
+            return w->onMessage != NULL;
+
+        case WINDOW_EVENT_NICK_CHANGE:
+            return w->onNickChange != NULL;
+
+        case WINDOW_EVENT_STATUS_CHANGE:
+            return w->onStatusChange != NULL;
+
+        case WINDOW_EVENT_STATUS_MESSAGE_CHANGE:
+            return w->onStatusMessageChange != NULL;
+
+        case WINDOW_EVENT_TYPING_CHANGE:
+            return w->onTypingChange != NULL;
+
+        case WINDOW_EVENT_READ_RECEIPT:
+            return w->onReadReceipt != NULL;
+
+        case WINDOW_EVENT_FILE_CHUNK_REQUEST:
+            return w->onFileChunkRequest != NULL;
+
+        case WINDOW_EVENT_FILE_RECV_CHUNK:
+            return w->onFileRecvChunk != NULL;
+
+        case WINDOW_EVENT_FILE_CONTROL:
+            return w->onFileControl != NULL;
+
+        case WINDOW_EVENT_FILE_RECV:
+            return w->onFileRecv != NULL;
+
+#ifdef GAMES
+
+        case WINDOW_EVENT_GAME_INVITE:
+            return w->onGameInvite != NULL;
+
+        case WINDOW_EVENT_GAME_DATA:
+            return w->onGameData != NULL;
+
+#else
+
+        case WINDOW_EVENT_GAME_INVITE:
+        case WINDOW_EVENT_GAME_DATA:
+            return false;
+
+#endif // GAMES
+
+        case WINDOW_EVENT_CONFERENCE_INVITE:
+            return w->onConferenceInvite != NULL;
+
+        case WINDOW_EVENT_GROUP_INVITE:
+            return w->onGroupInvite != NULL;
+
+        case WINDOW_EVENT_CONFERENCE_MESSAGE:
+            return w->onConferenceMessage != NULL;
+
+        case WINDOW_EVENT_CONFERENCE_NAME_LIST_CHANGE:
+            return w->onConferenceNameListChange != NULL;
+
+        case WINDOW_EVENT_CONFERENCE_PEER_NAME_CHANGE:
+            return w->onConferencePeerNameChange != NULL;
+
+        case WINDOW_EVENT_CONFERENCE_TITLE_CHANGE:
+            return w->onConferenceTitleChange != NULL;
+
+        case WINDOW_EVENT_GROUP_MESSAGE:
+            return w->onGroupMessage != NULL;
+
+        case WINDOW_EVENT_GROUP_PRIVATE_MESSAGE:
+            return w->onGroupPrivateMessage != NULL;
+
+        case WINDOW_EVENT_GROUP_PEER_JOIN:
+            return w->onGroupPeerJoin != NULL;
+
+        case WINDOW_EVENT_GROUP_PEER_EXIT:
+            return w->onGroupPeerExit != NULL;
+
+        case WINDOW_EVENT_GROUP_NICK_CHANGE:
+            return w->onGroupNickChange != NULL;
+
+        case WINDOW_EVENT_GROUP_STATUS_CHANGE:
+            return w->onGroupStatusChange != NULL;
+
+        case WINDOW_EVENT_GROUP_TOPIC_CHANGE:
+            return w->onGroupTopicChange != NULL;
+
+        case WINDOW_EVENT_GROUP_PEER_LIMIT:
+            return w->onGroupPeerLimit != NULL;
+
+        case WINDOW_EVENT_GROUP_PRIVACY_STATE:
+            return w->onGroupPrivacyState != NULL;
+
+        case WINDOW_EVENT_GROUP_TOPIC_LOCK:
+            return w->onGroupTopicLock != NULL;
+
+        case WINDOW_EVENT_GROUP_PASSWORD:
+            return w->onGroupPassword != NULL;
+
+        case WINDOW_EVENT_GROUP_SELF_JOIN:
+            return w->onGroupSelfJoin != NULL;
+
+        case WINDOW_EVENT_GROUP_REJECTED:
+            return w->onGroupRejected != NULL;
+
+        case WINDOW_EVENT_GROUP_MODERATION:
+            return w->onGroupModeration != NULL;
+
+        case WINDOW_EVENT_GROUP_VOICE_STATE:
+            return w->onGroupVoiceState != NULL;
+
+        case WINDOW_EVENT_MAX:
+            break;
+    }
+
+    return false;
+}
+
+/*
+ * Returns the number that `w` receives `event` for, or WINDOW_EVENT_ANY if it receives the event
+ * for every friend, conference or group.
+ *
+ * Chat and game windows belong to a friend, and conference and group windows to a conference or
+ * group, so they only receive the events that are about it. Every handler of these windows ignores
+ * events for other numbers anyway. All other windows receive every event they have a handler for.
+ */
+static uint32_t window_event_number(const ToxWindow *w, Window_Event event)
+{
+    switch (w->type) {
+        case WINDOW_TYPE_CHAT:
+#ifdef GAMES
+        case WINDOW_TYPE_GAME:
+#endif
+            return event < WINDOW_EVENT_CONFERENCE_MESSAGE && event != WINDOW_EVENT_FRIEND_REQUEST
+                   && event != WINDOW_EVENT_FRIEND_ADDED ? w->num : WINDOW_EVENT_ANY;
+
+        case WINDOW_TYPE_CONFERENCE:
+            return event >= WINDOW_EVENT_CONFERENCE_MESSAGE && event <= WINDOW_EVENT_CONFERENCE_TITLE_CHANGE
+                   ? w->num : WINDOW_EVENT_ANY;
+
+        case WINDOW_TYPE_GROUPCHAT:
+            return event >= WINDOW_EVENT_GROUP_MESSAGE ? w->num : WINDOW_EVENT_ANY;
+
+        default:
+            return WINDOW_EVENT_ANY;
+    }
+}
+
+/* Subscribes `w` to every event it has a handler for. */
+static int subscribe_window_events(Windows *windows, ToxWindow *w)
+{
+    for (Window_Event event = 0; event < WINDOW_EVENT_MAX; ++event) {
+        if (!window_handles_event(w, event)) {
+            continue;
+        }
+
+        if (window_events_subscribe(&windows->events, event, window_event_number(w, event), w) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void unsubscribe_window_events(Windows *windows, const ToxWindow *w)
+{
+    for (Window_Event event = 0; event < WINDOW_EVENT_MAX; ++event) {
+        if (window_handles_event(w, event)) {
+            window_events_unsubscribe(&windows->events, event, window_event_number(w, event), w);
+        }
+    }
+}
+
 int add_window(Toxic *toxic, ToxWindow *w)
 {
     if (w == NULL || LINES < 2) {
@@ -826,6 +1094,10 @@ int add_window(Toxic *toxic, ToxWindow *w)
     windows->list = tmp_list;
     ++windows->count;
 
+    if (subscribe_window_events(windows, w) != 0) {
+        exit_toxic_err(FATALERR_MEMORY, "window_events_subscribe() failed in add_window()");
+    }
+
     return w->id;
 }
 
@@ -884,6 +1156,8 @@ void del_window(ToxWindow *w, Windows *windows, const Client_Config *c_config)
         return;
     }
 
+    unsubscribe_window_events(windows, w);
+
     delwin(w->window_bar);
     delwin(w->window);
     free(w);
@@ -1048,6 +1322,8 @@ void on_window_resize(Windows *windows)
         scrollok(w->chatwin->history, 0);
         wmove(w->window, y2 - CURS_Y_OFFSET, 0);
 
+        w->chatwin->hst->redraw = true;
+
         if (!w->scroll_pause) {
             ChatContext *ctx = w->chatwin;
             line_info_reset_start(w, ctx->hst);
@@ -1244,10 +1520,37 @@ static wint_t get_input_sequence_code(void)
     return -1;
 }
 
-void draw_active_window(Toxic *toxic)
+static uint64_t get_time_usec(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ((uint64_t) t.tv_sec) * 1000000 + ((uint64_t) t.tv_nsec) / 1000;
+}
+
+/* Draws `w` to the screen and records how long it took in the frame stats. */
+static void draw_window(ToxWindow *w, Toxic *toxic)
+{
+    const uint64_t start = get_time_usec();
+
+    touchwin(w->window);
+    w->onDraw(w, toxic);
+    wrefresh(w->window);
+
+    const uint64_t elapsed = get_time_usec() - start;
+
+    Frame_Stats *stats = &Winthread.frame_stats;
+    ++stats->frames;
+    stats->total_usec += elapsed;
+
+    if (elapsed > stats->max_usec) {
+        stats->max_usec = elapsed;
+    }
+}
+
+bool draw_active_window(Toxic *toxic)
 {
     if (toxic == NULL) {
-        return;
+        return false;
     }
 
     const Client_Config *c_config = toxic->c_config;
@@ -1256,7 +1559,7 @@ void draw_active_window(Toxic *toxic)
     ToxWindow *a = windows->list[windows->active_index];
 
     if (a == NULL) {
-        return;
+        return false;
     }
 
     pthread_mutex_lock(&Winthread.lock);
@@ -1266,16 +1569,12 @@ void draw_active_window(Toxic *toxic)
     pthread_mutex_unlock(&Winthread.lock);
 
     if (flag_refresh) {
-        touchwin(a->window);
-        a->onDraw(a, toxic);
-        wrefresh(a->window);
+        draw_window(a, toxic);
     }
 
 #ifdef AUDIO
     else if (a->is_call && timed_out(a->chatwin->infobox.lastupdate, 1)) {
-        touchwin(a->window);
-        a->onDraw(a, toxic);
-        wrefresh(a->window);
+        draw_window(a, toxic);
     }
 
 #endif  // AUDIO
@@ -1284,15 +1583,13 @@ void draw_active_window(Toxic *toxic)
 
     if (a->type == WINDOW_TYPE_GAME) {
         if (!flag_refresh) {  // we always want to be continously refreshing game windows
-            touchwin(a->window);
-            a->onDraw(a, toxic);
-            wrefresh(a->window);
+            draw_window(a, toxic);
         }
 
         int ch = getch();
 
         if (ch == ERR) {
-            return;
+            return false;
         }
 
         pthread_mutex_lock(&Winthread.lock);
@@ -1305,7 +1602,7 @@ void draw_active_window(Toxic *toxic)
 
         a->onKey(a, toxic, ch, false);  // we lock only when necessary in the onKey callback
 
-        return;
+        return true;
     }
 
 #endif // GAMES
@@ -1314,7 +1611,7 @@ void draw_active_window(Toxic *toxic)
     int printable = get_current_char(&ch);
 
     if (printable < 0) {
-        return;
+        return false;
     }
 
     pthread_mutex_lock(&Winthread.lock);
@@ -1323,14 +1620,14 @@ void draw_active_window(Toxic *toxic)
 
     if (printable == 0 && (ch == c_config->key_next_tab || ch == c_config->key_prev_tab)) {
         set_next_window(windows, c_config, (int) ch);
-        return;
+        return true;
     } else if ((printable == 0) && (a->type != WINDOW_TYPE_FRIEND_LIST)) {
         pthread_mutex_lock(&Winthread.lock);
         const bool input_ret = a->onKey(a, toxic, ch, (bool) printable);
         pthread_mutex_unlock(&Winthread.lock);
 
         if (input_ret) {
-            return;
+            return true;
         }
 
         // if an unprintable key code is unrecognized by input handler we attempt to
@@ -1345,6 +1642,8 @@ void draw_active_window(Toxic *toxic)
     pthread_mutex_lock(&Winthread.lock);
     a->onKey(a, toxic, ch, (bool) printable);
     pthread_mutex_unlock(&Winthread.lock);
+
+    return true;
 }
 
 /* Refresh inactive windows to prevent scrolling bugs.
@@ -1531,4 +1830,6 @@ void kill_all_windows(Toxic *toxic)
             }
         }
     }
+
+    window_events_free(&windows->events);
 }
@@ -20,8 +20,10 @@
 #include <tox/toxav.h>
 #endif /* AUDIO */
 
+#include "reactor.h"
 #include "settings.h"
 #include "toxic.h"
+#include "transfer_stats.h"
 
 #define MAX_WINDOW_NAME_LENGTH 22
 #define CURS_Y_OFFSET 1    /* y-axis cursor offset for chat contexts */
@@ -33,6 +35,7 @@
 typedef enum CustomPacket {
     CUSTOM_PACKET_GAME_INVITE = 160,
     CUSTOM_PACKET_GAME_DATA   = 161,
+    CUSTOM_PACKET_FILE_MANIFEST = 162,
 } CustomPacket;
 
 /* Our own custom colours */
@@ -105,6 +108,16 @@ typedef enum Window_Type {
    Uncomment if necessary */
 /* #define URXVT_FIX */
 
+/* Counters for the work the UI thread does to draw the interface. Only used by the UI thread. */
+typedef struct Frame_Stats {
+    uint64_t frames;            /* number of times the active window was drawn */
+    uint64_t total_usec;        /* total time spent drawing the active window, in microseconds */
+    uint64_t max_usec;          /* the longest time spent drawing the active window once */
+    uint64_t full_redraws;      /* number of times a chat history was drawn in full */
+    uint64_t partial_redraws;   /* number of times only the lines that changed in a chat history were drawn */
+    uint64_t lines_drawn;       /* number of chat history lines drawn */
+} Frame_Stats;
+
 /*
  * Used to control access to global variables via a mutex, as well as to handle signals.
  * Any file, variable or data structure that is used by the UI/Window thread and any other thread
@@ -115,6 +128,9 @@ typedef enum Window_Type {
 struct Winthread {
     pthread_t tid;
     pthread_mutex_t lock;
+    Reactor reactor;      /* wakes the UI thread for redraws, resizes and exit */
+    Frame_Stats frame_stats;
+    int refresh_rate;     /* how often the active window is redrawn while the interface is busy, in ms */
     volatile sig_atomic_t sig_exit_toxic;
     volatile sig_atomic_t flag_resize;
     volatile sig_atomic_t flag_refresh;
@@ -125,8 +141,17 @@ extern struct Winthread Winthread;
 
 struct cqueue_thread {
     pthread_t tid;
+    Reactor reactor;      /* wakes the message queue thread when a message is queued or a friend comes online */
+};
+
+extern struct cqueue_thread cqueue_thread;
+
+struct tox_thread {
+    Reactor reactor;      /* wakes the main thread to iterate tox before its interval is up */
 };
 
+extern struct tox_thread tox_thread;
+
 struct av_thread {
     pthread_t tid;
 };
@@ -275,6 +300,17 @@ struct infobox {
 
 #endif /* AUDIO */
 
+/* Maximum number of transfers listed in a chat window's transfer pane. The rest are summed up on one line. */
+#define TRANSFER_PANE_MAX_ROWS 4
+
+/* Shows the file transfers with a friend that are in progress over the top of their chat window */
+struct transfer_pane {
+    struct transfer_stat stats[TRANSFER_PANE_MAX_ROWS];
+    size_t num_transfers;   /* the number of transfers in progress, which may be more than the number of stats */
+
+    WINDOW *win;            /* NULL while no transfers are in progress */
+};
+
 #define MAX_LINE_HIST 128
 
 /* chat and conference window/buffer holder */
@@ -299,6 +335,8 @@ struct ChatContext {
     struct infobox infobox;
 #endif
 
+    struct transfer_pane transfer_pane;
+
     uint8_t self_is_typing;
     uint8_t pastemode; /* whether to translate \r to \n */
 
@@ -314,7 +352,11 @@ struct Help {
 };
 
 void init_windows(Toxic *toxic);
-void draw_active_window(Toxic *toxic);
+/* Draws the active window if needed and handles at most one key of input.
+ *
+ * Returns true if a key was read, in which case more input may be waiting.
+ */
+bool draw_active_window(Toxic *toxic);
 void del_window(ToxWindow *w, Windows *windows, const Client_Config *c_config);
 void kill_all_windows(Toxic *toxic);    /* should only be called on shutdown */
 void on_window_resize(Windows *windows);
@@ -0,0 +1,268 @@
+/*  word_filter.c
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "word_filter.h"
+
+/* A state in the trie that the automaton is built from. The start state is never anyone's child,
+ * so 0 marks the end of a list of children. */
+struct word_filter_node {
+    uint32_t first_child;
+    uint32_t next_sibling;
+    uint32_t fail;
+    uint8_t  byte;
+    bool     match;
+};
+
+static uint8_t word_filter_fold(uint8_t byte)
+{
+    return byte >= 'A' && byte <= 'Z' ? byte + ('a' - 'A') : byte;
+}
+
+/* Returns the child of `node` reached by `byte`, or 0 if there isn't one. */
+static uint32_t word_filter_node_child(const struct word_filter_node *nodes, uint32_t node, uint8_t byte)
+{
+    for (uint32_t child = nodes[node].first_child; child != 0; child = nodes[child].next_sibling) {
+        if (nodes[child].byte == byte) {
+            return child;
+        }
+    }
+
+    return 0;
+}
+
+/* Adds `word` to the trie, which must have room for all of its bytes. */
+static void word_filter_insert(struct word_filter_node *nodes, uint32_t *num_nodes, const char *word)
+{
+    uint32_t node = 0;
+
+    for (const uint8_t *p = (const uint8_t *) word; *p != '\0'; ++p) {
+        const uint8_t byte = word_filter_fold(*p);
+        uint32_t child = word_filter_node_child(nodes, node, byte);
+
+        if (child == 0) {
+            child = (*num_nodes)++;
+            nodes[child] = (struct word_filter_node) {
+                .next_sibling = nodes[node].first_child,
+                .byte = byte,
+            };
+            nodes[node].first_child = child;
+        }
+
+        node = child;
+    }
+
+    nodes[node].match = true;
+}
+
+/* Sets the fail link of every state in the trie, visiting them in breadth-first order so that the
+ * links of shallower states are set first.
+ *
+ * Return 0 on success.
+ * Return -1 on failure.
+ */
+static int word_filter_link(struct word_filter_node *nodes, uint32_t num_nodes)
+{
+    uint32_t *queue = malloc(num_nodes * sizeof(uint32_t));
+
+    if (queue == NULL) {
+        return -1;
+    }
+
+    uint32_t head = 0;
+    uint32_t tail = 0;
+
+    for (uint32_t child = nodes[0].first_child; child != 0; child = nodes[child].next_sibling) {
+        nodes[child].fail = 0;
+        queue[tail++] = child;
+    }
+
+    while (head < tail) {
+        const uint32_t node = queue[head++];
+
+        for (uint32_t child = nodes[node].first_child; child != 0; child = nodes[child].next_sibling) {
+            uint32_t fail = nodes[node].fail;
+            uint32_t target;
+
+            while ((target = word_filter_node_child(nodes, fail, nodes[child].byte)) == 0 && fail != 0) {
+                fail = nodes[fail].fail;
+            }
+
+            nodes[child].fail = target;
+            nodes[child].match |= nodes[target].match;
+            queue[tail++] = child;
+        }
+    }
+
+    free(queue);
+
+    return 0;
+}
+
+/* Copies the trie into the flat arrays of `filter`, with each state's edges sorted by byte. */
+static void word_filter_flatten(Word_Filter *filter, const struct word_filter_node *nodes, uint32_t num_nodes)
+{
+    uint32_t num_edges = 0;
+
+    for (uint32_t node = 0; node < num_nodes; ++node) {
+        struct word_filter_state *state = &filter->states[node];
+
+        state->fail = nodes[node].fail;
+        state->match = nodes[node].match;
+        state->first_edge = num_edges;
+        state->num_edges = 0;
+
+        if (node == 0) {
+            for (uint32_t child = nodes[0].first_child; child != 0; child = nodes[child].next_sibling) {
+                filter->root_next[nodes[child].byte] = child;
+            }
+
+            continue;
+        }
+
+        for (uint32_t child = nodes[node].first_child; child != 0; child = nodes[child].next_sibling) {
+            /* insertion sort, since a state rarely has more than a few edges */
+            uint32_t pos = num_edges + state->num_edges;
+
+            while (pos > num_edges && filter->edges[pos - 1].byte > nodes[child].byte) {
+                filter->edges[pos] = filter->edges[pos - 1];
+                --pos;
+            }
+
+            filter->edges[pos] = (struct word_filter_edge) {
+                .target = child,
+                .byte = nodes[child].byte,
+            };
+
+            ++state->num_edges;
+        }
+
+        num_edges += state->num_edges;
+    }
+}
+
+int word_filter_build(Word_Filter *filter, const char *const *words, size_t num_words)
+{
+    word_filter_free(filter);
+
+    if (num_words == 0) {
+        return 0;
+    }
+
+    size_t max_nodes = 1;
+
+    for (size_t i = 0; i < num_words; ++i) {
+        max_nodes += strlen(words[i]);
+
+        if (max_nodes >= UINT32_MAX) {
+            return -1;
+        }
+    }
+
+    struct word_filter_node *nodes = calloc(max_nodes, sizeof(struct word_filter_node));
+
+    if (nodes == NULL) {
+        return -1;
+    }
+
+    uint32_t num_nodes = 1;
+
+    for (size_t i = 0; i < num_words; ++i) {
+        word_filter_insert(nodes, &num_nodes, words[i]);
+    }
+
+    if (word_filter_link(nodes, num_nodes) != 0) {
+        free(nodes);
+        return -1;
+    }
+
+    filter->states = malloc(num_nodes * sizeof(struct word_filter_state));
+    filter->edges = malloc(num_nodes * sizeof(struct word_filter_edge));
+
+    if (filter->states == NULL || filter->edges == NULL) {
+        free(nodes);
+        word_filter_free(filter);
+        return -1;
+    }
+
+    word_filter_flatten(filter, nodes, num_nodes);
+    filter->num_states = num_nodes;
+
+    free(nodes);
+
+    return 0;
+}
+
+/* Returns the state reached from `state`, which mustn't be the start state, by `byte`, or 0 if it
+ * has no edge for it. */
+static uint32_t word_filter_next(const Word_Filter *filter, uint32_t state, uint8_t byte)
+{
+    const struct word_filter_edge *edges = &filter->edges[filter->states[state].first_edge];
+    uint32_t low = 0;
+    uint32_t high = filter->states[state].num_edges;
+
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+
+        if (edges[mid].byte == byte) {
+            return edges[mid].target;
+        }
+
+        if (edges[mid].byte < byte) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return 0;
+}
+
+bool word_filter_match(const Word_Filter *filter, const char *string)
+{
+    if (filter->num_states == 0) {
+        return false;
+    }
+
+    const struct word_filter_state *states = filter->states;
+
+    if (states[0].match) {
+        return true;
+    }
+
+    uint32_t state = 0;
+
+    for (const uint8_t *p = (const uint8_t *) string; *p != '\0'; ++p) {
+        const uint8_t byte = word_filter_fold(*p);
+        uint32_t next = 0;
+
+        while (state != 0 && (next = word_filter_next(filter, state, byte)) == 0) {
+            state = states[state].fail;
+        }
+
+        state = state != 0 ? next : filter->root_next[byte];
+
+        if (states[state].match) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void word_filter_free(Word_Filter *filter)
+{
+    free(filter->states);
+    free(filter->edges);
+
+    *filter = (Word_Filter) {
+        0
+    };
+}
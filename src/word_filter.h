@@ -0,0 +1,65 @@
+/*  word_filter.h
+ *
+ *  Copyright (C) 2026 Toxic All Rights Reserved.
+ *
+ *  This file is part of Toxic. Toxic is free software licensed
+ *  under the GNU General Public License 3.0.
+ */
+
+#ifndef WORD_FILTER_H
+#define WORD_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+struct word_filter_state {
+    uint32_t fail;          /* the state for the longest proper suffix of this state that's also in the trie */
+    uint32_t first_edge;    /* position of this state's first edge in the edges array */
+    uint16_t num_edges;
+    bool     match;         /* true if a word ends at this state or at any state in its fail chain */
+};
+
+struct word_filter_edge {
+    uint32_t target;
+    uint8_t  byte;
+};
+
+/*
+ * An Aho-Corasick automaton that finds any of a list of words in a string in one pass, ignoring
+ * ASCII case, no matter how many words there are.
+ *
+ * The transitions out of the start state, which most bytes of most strings lead back to, are kept in
+ * a table. All other states keep their edges sorted by byte.
+ */
+typedef struct Word_Filter {
+    struct word_filter_state *states;
+    struct word_filter_edge *edges;
+    uint32_t num_states;
+    uint32_t root_next[256];    /* the state after the start state for each byte, or 0 for itself */
+} Word_Filter;
+
+/* Builds `filter` from the `num_words` strings in `words`, replacing anything it held before. An
+ * empty word matches every string.
+ *
+ * Return 0 on success.
+ * Return -1 on failure, in which case `filter` is left empty.
+ */
+int word_filter_build(Word_Filter *filter, const char *const *words, size_t num_words);
+
+/* Return true if `string` contains any of the words in `filter`, ignoring ASCII case. */
+bool word_filter_match(const Word_Filter *filter, const char *string);
+
+/* Frees all memory associated with `filter` and leaves it empty. */
+void word_filter_free(Word_Filter *filter);
+
+#ifdef __cplusplus
+} /* extern "C" */
+
+#endif /* __cplusplus */
+
+#endif /* WORD_FILTER_H */
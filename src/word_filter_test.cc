@@ -0,0 +1,200 @@
+#include "word_filter.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+namespace {
+
+class WordFilter : public ::testing::Test {
+protected:
+    void TearDown() override
+    {
+        word_filter_free(&filter_);
+    }
+
+    void build(const std::vector<const char *> &words)
+    {
+        ASSERT_EQ(word_filter_build(&filter_, words.data(), words.size()), 0);
+    }
+
+    Word_Filter filter_ = {};
+};
+
+TEST_F(WordFilter, Empty)
+{
+    build({});
+
+    EXPECT_FALSE(word_filter_match(&filter_, "anything"));
+    EXPECT_FALSE(word_filter_match(&filter_, ""));
+}
+
+TEST_F(WordFilter, FindsAnyWord)
+{
+    build({"spam", "eggs", "ham"});
+
+    EXPECT_TRUE(word_filter_match(&filter_, "spam"));
+    EXPECT_TRUE(word_filter_match(&filter_, "green eggs and"));
+    EXPECT_TRUE(word_filter_match(&filter_, "graham"));
+    EXPECT_FALSE(word_filter_match(&filter_, "spa m"));
+    EXPECT_FALSE(word_filter_match(&filter_, "egg"));
+    EXPECT_FALSE(word_filter_match(&filter_, ""));
+}
+
+TEST_F(WordFilter, IgnoresCase)
+{
+    build({"Free Money"});
+
+    EXPECT_TRUE(word_filter_match(&filter_, "get FREE MONEY now"));
+    EXPECT_TRUE(word_filter_match(&filter_, "free money"));
+    EXPECT_FALSE(word_filter_match(&filter_, "free  money"));
+}
+
+TEST_F(WordFilter, FollowsFailLinks)
+{
+    /* "she" is found while matching "hers", and "his" after a false start on "he" */
+    build({"he", "she", "his", "hers"});
+
+    EXPECT_TRUE(word_filter_match(&filter_, "ushe"));
+    EXPECT_TRUE(word_filter_match(&filter_, "ahis"));
+    EXPECT_FALSE(word_filter_match(&filter_, "hi sh"));
+
+    word_filter_free(&filter_);
+    build({"abcd", "bce"});
+
+    EXPECT_TRUE(word_filter_match(&filter_, "abce"));
+    EXPECT_FALSE(word_filter_match(&filter_, "abc"));
+}
+
+TEST_F(WordFilter, EmptyWordMatchesEverything)
+{
+    build({"x", ""});
+
+    EXPECT_TRUE(word_filter_match(&filter_, ""));
+    EXPECT_TRUE(word_filter_match(&filter_, "abc"));
+}
+
+TEST_F(WordFilter, MultiByteWords)
+{
+    build({"привет", "\xff\xfe"});
+
+    EXPECT_TRUE(word_filter_match(&filter_, "ну привет!"));
+    EXPECT_TRUE(word_filter_match(&filter_, "a\xff\xfe"));
+    EXPECT_FALSE(word_filter_match(&filter_, "приве"));
+}
+
+TEST_F(WordFilter, SameAsStrcasestr)
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> letter(0, 5);
+    std::uniform_int_distribution<int> length(1, 5);
+
+    auto random_string = [&](int len) {
+        std::string s;
+
+        for (int i = 0; i < len; ++i) {
+            s += "abcABC"[letter(rng)];
+        }
+
+        return s;
+    };
+
+    for (int round = 0; round < 50; ++round) {
+        std::vector<std::string> words;
+        std::vector<const char *> word_ptrs;
+
+        for (int i = 0; i < 8; ++i) {
+            words.push_back(random_string(length(rng)));
+        }
+
+        for (const std::string &word : words) {
+            word_ptrs.push_back(word.c_str());
+        }
+
+        word_filter_free(&filter_);
+        build(word_ptrs);
+
+        for (int i = 0; i < 50; ++i) {
+            const std::string text = random_string(length(rng) * 4);
+            bool expected = false;
+
+            for (const std::string &word : words) {
+                expected = expected || strcasestr(text.c_str(), word.c_str()) != nullptr;
+            }
+
+            EXPECT_EQ(word_filter_match(&filter_, text.c_str()), expected) << text;
+        }
+    }
+}
+
+// Not a pass/fail benchmark: reports how fast messages are checked against a large list of blocked
+// phrases, compared to searching for each phrase in turn.
+TEST_F(WordFilter, DISABLED_ThroughputBenchmark)
+{
+    constexpr int num_words = 5000;
+    constexpr int num_messages = 200;
+
+    std::vector<std::string> words;
+    std::vector<const char *> word_ptrs;
+
+    for (int i = 0; i < num_words; ++i) {
+        words.push_back("spam phrase " + std::to_string(i * 7919 % 100003));
+    }
+
+    for (const std::string &word : words) {
+        word_ptrs.push_back(word.c_str());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    build(word_ptrs);
+    const auto build_time = std::chrono::steady_clock::now() - start;
+
+    std::string message;
+
+    while (message.size() < 500) {
+        message += "an ordinary message about spam and phrases that shouldn't be blocked. ";
+    }
+
+    size_t linear_matches = 0;
+
+    start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < num_messages; ++i) {
+        for (const std::string &word : words) {
+            if (strcasestr(message.c_str(), word.c_str()) != nullptr) {
+                ++linear_matches;
+                break;
+            }
+        }
+    }
+
+    const auto linear = std::chrono::steady_clock::now() - start;
+
+    size_t matches = 0;
+
+    start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < num_messages; ++i) {
+        matches += word_filter_match(&filter_, message.c_str());
+    }
+
+    const auto automaton = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(matches, linear_matches);
+
+    const double megabytes = static_cast<double>(message.size()) * num_messages / (1024 * 1024);
+
+    std::printf("%d blocked phrases, %zu byte messages: built in %.1f ms, %.2f MB/s with strcasestr, "
+                "%.1f MB/s with the automaton\n", num_words, message.size(),
+                std::chrono::duration<double, std::milli>(build_time).count(),
+                megabytes / std::chrono::duration<double>(linear).count(),
+                megabytes / std::chrono::duration<double>(automaton).count());
+}
+
+}  // namespace